@@ -0,0 +1,123 @@
+#include "BookChecksum.hpp"
+#include "CoreLog.hpp"
+#include "PhonePrefixIndex.hpp" // NormalizePhone
+#include <algorithm>
+
+namespace {
+
+uint64_t Fnv1a(const std::string& text, uint64_t hash = 1469598103934665603ull) {
+    for (unsigned char c : text) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// splitmix64 finalizer: FNV-1a alone leaves the low bits weak, and leaf sums add
+// hashes, so every bit has to be well mixed
+uint64_t Mix(uint64_t value) {
+    value ^= value >> 30;
+    value *= 0xbf58476d1ce4e5b9ull;
+    value ^= value >> 27;
+    value *= 0x94d049bb133111ebull;
+    return value ^ (value >> 31);
+}
+
+std::string ColumnText(sqlite3_stmt* stmt, int column) {
+    const char* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, column));
+    return text ? std::string(text, static_cast<size_t>(sqlite3_column_bytes(stmt, column))) : std::string();
+}
+
+} // namespace
+
+BookChecksumTree::BookChecksumTree(unsigned depth)
+    : depth(std::min(depth, 24u)), sums(GetRangeCount()), counts(GetRangeCount()), nodes(2 * GetRangeCount()) {}
+
+size_t BookChecksumTree::RangeOf(const std::string& phone) const {
+    // Top bits, so a deeper tree splits every range of a shallower one in two
+    return depth == 0 ? 0 : static_cast<size_t>(Mix(Fnv1a(NormalizePhone(phone))) >> (64 - depth));
+}
+
+void BookChecksumTree::Add(const std::string& name, const std::string& phone, const std::string& email) {
+    // Separators keep ("ab", "c") and ("a", "bc") apart
+    uint64_t hash = Mix(Fnv1a(email, Fnv1a(phone + '\0', Fnv1a(name + '\0'))));
+    size_t range = RangeOf(phone);
+    sums[range] += hash;
+    ++counts[range];
+    ++count;
+}
+
+void BookChecksumTree::Seal() {
+    size_t leaves = GetRangeCount();
+    for (size_t i = 0; i < leaves; ++i) {
+        nodes[leaves + i] = Mix(sums[i] ^ Mix(counts[i] + 1));
+    }
+    for (size_t i = leaves - 1; i >= 1; --i) {
+        nodes[i] = Mix(nodes[2 * i] ^ Mix(nodes[2 * i + 1] + i));
+    }
+}
+
+std::vector<size_t> BookChecksumTree::DifferingRanges(const BookChecksumTree& other, size_t* nodesCompared) const {
+    std::vector<size_t> ranges;
+    size_t compared = 0;
+    if (other.depth != depth) {
+        LogError("Cannot compare checksum trees of depth %u and %u", depth, other.depth);
+        return ranges;
+    }
+    size_t leaves = GetRangeCount();
+    std::vector<size_t> pending{1}; // Depth first, right child pushed first: ranges come out ascending
+    while (!pending.empty()) {
+        size_t node = pending.back();
+        pending.pop_back();
+        ++compared;
+        if (nodes[node] == other.nodes[node]) {
+            continue;
+        }
+        if (node >= leaves) {
+            ranges.push_back(node - leaves);
+        } else {
+            pending.push_back(2 * node + 1);
+            pending.push_back(2 * node);
+        }
+    }
+    if (nodesCompared) {
+        *nodesCompared = compared;
+    }
+    return ranges;
+}
+
+bool ComputeBookChecksum(sqlite3* db, BookChecksumTree& tree, uint64_t* sequence) {
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, "SELECT name, phone, email FROM contacts;", -1, &stmt, 0) != SQLITE_OK) {
+        LogError("Cannot read contacts: %s", sqlite3_errmsg(db));
+        return false;
+    }
+    sqlite3_exec(db, "BEGIN;", 0, 0, 0);
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        tree.Add(ColumnText(stmt, 0), ColumnText(stmt, 1), ColumnText(stmt, 2));
+    }
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_DONE) {
+        LogError("Reading contacts failed: %s", sqlite3_errmsg(db));
+        sqlite3_exec(db, "COMMIT;", 0, 0, 0);
+        return false;
+    }
+    if (sequence) {
+        // A replica records how far it got in the primary's log; any other book is at
+        // its own latest change
+        *sequence = 0;
+        if (sqlite3_prepare_v2(db, "SELECT sequence FROM replica_state;", -1, &stmt, 0) != SQLITE_OK &&
+            sqlite3_prepare_v2(db, "SELECT seq FROM sqlite_sequence WHERE name = 'contact_changes';", -1, &stmt, 0) !=
+                SQLITE_OK) {
+            stmt = nullptr;
+        }
+        if (stmt && sqlite3_step(stmt) == SQLITE_ROW) {
+            *sequence = static_cast<uint64_t>(sqlite3_column_int64(stmt, 0));
+        }
+        sqlite3_finalize(stmt);
+    }
+    sqlite3_exec(db, "COMMIT;", 0, 0, 0);
+    tree.Seal();
+    return true;
+}
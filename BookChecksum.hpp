@@ -0,0 +1,53 @@
+#ifndef BOOKCHECKSUM_HPP
+#define BOOKCHECKSUM_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <sqlite3.h>
+
+// Merkle-style checksum tree over the contacts of a book, for checking that two books
+// (a replica and its primary) hold the same rows without comparing them one by one.
+//
+// The hash space of the normalized phone number is cut into 2^depth ranges. A leaf
+// holds the row count and the sum of the row hashes of its range, so rows can be added
+// in any order; an inner node hashes its two children. Equal roots mean equal books
+// (up to hash collisions). Otherwise DifferingRanges() walks down only into the
+// subtrees whose hashes differ, so when the trees are exchanged between processes only
+// a few nodes have to be compared to find where the books disagree.
+class BookChecksumTree {
+public:
+    explicit BookChecksumTree(unsigned depth = 12);
+
+    void Add(const std::string& name, const std::string& phone, const std::string& email);
+    // Computes the inner nodes; call after the last Add() and before the queries below.
+    void Seal();
+
+    uint64_t Root() const { return nodes[1]; }
+    uint64_t Count() const { return count; }
+    unsigned GetDepth() const { return depth; }
+    size_t GetRangeCount() const { return size_t(1) << depth; }
+
+    // Range a phone number falls into (0 .. GetRangeCount() - 1).
+    size_t RangeOf(const std::string& phone) const;
+
+    // Ranges whose rows differ between the two trees (which must have the same depth),
+    // in ascending order. 'nodesCompared' (optional) receives the number of nodes visited.
+    std::vector<size_t> DifferingRanges(const BookChecksumTree& other, size_t* nodesCompared = nullptr) const;
+
+private:
+    unsigned depth;
+    uint64_t count = 0;
+    std::vector<uint64_t> sums;   // Per range: sum of row hashes
+    std::vector<uint64_t> counts; // Per range: number of rows
+    std::vector<uint64_t> nodes;  // Heap order, root at 1, leaves at 2^depth ..
+};
+
+// Adds every row of the contacts table of 'db' to 'tree' and seals it. Runs in one read
+// transaction; 'sequence' (optional) receives the position of the rows read in the
+// primary's change log: the applied sequence for a replica (see BookReplica.hpp), the
+// book's own latest change otherwise. Trees are only comparable at equal positions.
+bool ComputeBookChecksum(sqlite3* db, BookChecksumTree& tree, uint64_t* sequence = nullptr);
+
+#endif // BOOKCHECKSUM_HPP
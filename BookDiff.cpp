@@ -0,0 +1,506 @@
+#include "BookDiff.hpp"
+#include "CoreLog.hpp"
+#include "Phonetic.hpp"
+#include "PhonePrefixIndex.hpp" // NormalizePhone
+#include <cstring>
+#include <sqlite3.h>
+#include <vector>
+
+namespace {
+
+const char* kChangesetHeader = "# phonebook changeset 1";
+
+void NormalizePhoneFunction(sqlite3_context* context, int, sqlite3_value** argv) {
+    const char* text = reinterpret_cast<const char*>(sqlite3_value_text(argv[0]));
+    std::string normalized = NormalizePhone(text ? text : "");
+    sqlite3_result_text(context, normalized.c_str(), static_cast<int>(normalized.size()), SQLITE_TRANSIENT);
+}
+
+struct DiffRow {
+    std::string key; // Normalized phone
+    Contact contact;
+};
+
+// Reads a book's contacts ordered by normalized number, then by stored number, name
+// and e-mail, one row at a time.
+class SortedBookReader {
+public:
+    explicit SortedBookReader(const std::string& path) : path(path) {
+        if (sqlite3_open_v2(path.c_str(), &db, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK ||
+            sqlite3_create_function_v2(db, "normalize_phone", 1, SQLITE_UTF8 | SQLITE_DETERMINISTIC, nullptr,
+                                       &NormalizePhoneFunction, nullptr, nullptr, nullptr) != SQLITE_OK ||
+            sqlite3_prepare_v2(db,
+                               "SELECT normalize_phone(phone), IFNULL(name, ''), IFNULL(phone, ''), IFNULL(email, '') "
+                               "FROM contacts ORDER BY 1, 3, 2, 4;",
+                               -1, &stmt, 0) != SQLITE_OK) {
+            LogError("Cannot read %s: %s", path.c_str(), sqlite3_errmsg(db));
+            failed = true;
+            return;
+        }
+        sqlite3_busy_timeout(db, 5000);
+        Advance();
+    }
+
+    ~SortedBookReader() {
+        sqlite3_finalize(stmt);
+        sqlite3_close(db);
+    }
+
+    bool HasRow() const { return hasRow; }
+    bool Failed() const { return failed; }
+    const DiffRow& Row() const { return row; }
+
+    // Moves every row with the current key to 'group'.
+    void TakeGroup(std::vector<Contact>& group) {
+        group.clear();
+        std::string key = row.key;
+        while (hasRow && row.key == key) {
+            group.push_back(std::move(row.contact));
+            Advance();
+        }
+    }
+
+private:
+    void Advance() {
+        int rc = sqlite3_step(stmt);
+        hasRow = rc == SQLITE_ROW;
+        if (hasRow) {
+            auto text = [&](int column) {
+                return std::string(reinterpret_cast<const char*>(sqlite3_column_text(stmt, column)),
+                                   static_cast<size_t>(sqlite3_column_bytes(stmt, column)));
+            };
+            row.key = text(0);
+            row.contact = Contact(text(1), text(2), text(3));
+        } else if (rc != SQLITE_DONE) {
+            LogError("Reading %s failed: %s", path.c_str(), sqlite3_errmsg(db));
+            failed = true;
+        }
+    }
+
+    std::string path;
+    sqlite3* db = nullptr;
+    sqlite3_stmt* stmt = nullptr;
+    DiffRow row;
+    bool hasRow = false;
+    bool failed = false;
+};
+
+// Same order as the reader's ORDER BY within a group.
+bool RowLess(const Contact& a, const Contact& b) {
+    if (a.GetPhone() != b.GetPhone()) {
+        return a.GetPhone() < b.GetPhone();
+    }
+    if (a.GetName() != b.GetName()) {
+        return a.GetName() < b.GetName();
+    }
+    return a.GetEmail() < b.GetEmail();
+}
+
+bool SameRow(const Contact& a, const Contact& b) {
+    return a.GetPhone() == b.GetPhone() && a.GetName() == b.GetName() && a.GetEmail() == b.GetEmail();
+}
+
+// Changes between the rows of one normalized number (each side sorted by RowLess).
+bool DiffGroup(const std::vector<Contact>& base, const std::vector<Contact>& target,
+               const std::function<bool(const BookChange&)>& visit, BookDiffStats& stats) {
+    std::vector<const Contact*> removed;
+    std::vector<const Contact*> added;
+    size_t i = 0;
+    size_t j = 0;
+    while (i < base.size() || j < target.size()) {
+        if (i < base.size() && j < target.size() && SameRow(base[i], target[j])) {
+            ++stats.unchanged;
+            ++i;
+            ++j;
+        } else if (j == target.size() || (i < base.size() && RowLess(base[i], target[j]))) {
+            removed.push_back(&base[i++]);
+        } else {
+            added.push_back(&target[j++]);
+        }
+    }
+    // Usually one row per side; pair rows with the same stored number first
+    BookChange change;
+    change.kind = BookChangeKind::Modified;
+    for (int pass = 0; pass < 2; ++pass) {
+        for (const Contact*& before : removed) {
+            for (const Contact*& after : added) {
+                if (before && after && (pass == 1 || before->GetPhone() == after->GetPhone())) {
+                    change.before = *before;
+                    change.after = *after;
+                    before = nullptr;
+                    after = nullptr;
+                    ++stats.modified;
+                    if (!visit(change)) {
+                        return false;
+                    }
+                }
+            }
+        }
+    }
+    change = BookChange();
+    for (const Contact* before : removed) {
+        if (before) {
+            change.kind = BookChangeKind::Removed;
+            change.before = *before;
+            ++stats.removed;
+            if (!visit(change)) {
+                return false;
+            }
+        }
+    }
+    change = BookChange();
+    for (const Contact* after : added) {
+        if (after) {
+            change.kind = BookChangeKind::Added;
+            change.after = *after;
+            ++stats.added;
+            if (!visit(change)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void AppendEscaped(std::string& line, const std::string& field) {
+    line += '\t';
+    for (char c : field) {
+        switch (c) {
+        case '\t': line += "\\t"; break;
+        case '\n': line += "\\n"; break;
+        case '\r': line += "\\r"; break;
+        case '\\': line += "\\\\"; break;
+        default: line += c;
+        }
+    }
+}
+
+// Splits a changeset line at tabs and undoes the escaping; false on a bad escape.
+bool SplitFields(const std::string& line, std::vector<std::string>& fields) {
+    fields.assign(1, std::string());
+    for (size_t i = 0; i < line.size(); ++i) {
+        char c = line[i];
+        if (c == '\t') {
+            fields.emplace_back();
+        } else if (c != '\\') {
+            fields.back() += c;
+        } else if (++i < line.size()) {
+            char escaped = line[i];
+            if (escaped == 't' || escaped == 'n' || escaped == 'r' || escaped == '\\') {
+                fields.back() += escaped == 't' ? '\t' : escaped == 'n' ? '\n' : escaped == 'r' ? '\r' : '\\';
+            } else {
+                return false;
+            }
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+bool DiffBooks(const std::string& basePath, const std::string& targetPath,
+               const std::function<bool(const BookChange&)>& visit, BookDiffStats* stats) {
+    SortedBookReader base(basePath);
+    SortedBookReader target(targetPath);
+    BookDiffStats counts;
+    std::vector<Contact> baseGroup;
+    std::vector<Contact> targetGroup;
+    bool stopped = false;
+    while (!stopped && !base.Failed() && !target.Failed() && (base.HasRow() || target.HasRow())) {
+        // The smaller number goes first; a number on both sides is compared as a group
+        int order = !base.HasRow() ? 1 : !target.HasRow() ? -1 : base.Row().key.compare(target.Row().key);
+        baseGroup.clear();
+        targetGroup.clear();
+        if (order <= 0) {
+            base.TakeGroup(baseGroup);
+        }
+        if (order >= 0) {
+            target.TakeGroup(targetGroup);
+        }
+        stopped = !DiffGroup(baseGroup, targetGroup, visit, counts);
+    }
+    if (stats) {
+        *stats = counts;
+    }
+    return !base.Failed() && !target.Failed();
+}
+
+ChangesetWriter::ChangesetWriter(std::FILE* out) : out(out) {
+    std::fprintf(out, "%s\n", kChangesetHeader);
+}
+
+bool ChangesetWriter::Write(const BookChange& change) {
+    line.clear();
+    if (change.kind == BookChangeKind::Added) {
+        line += '+';
+    } else {
+        line += change.kind == BookChangeKind::Removed ? '-' : '~';
+        AppendEscaped(line, change.before.GetName());
+        AppendEscaped(line, change.before.GetPhone());
+        AppendEscaped(line, change.before.GetEmail());
+    }
+    if (change.kind != BookChangeKind::Removed) {
+        AppendEscaped(line, change.after.GetName());
+        AppendEscaped(line, change.after.GetPhone());
+        AppendEscaped(line, change.after.GetEmail());
+    }
+    line += '\n';
+    return std::fwrite(line.data(), 1, line.size(), out) == line.size();
+}
+
+ChangesetReader::ChangesetReader(std::FILE* in) : in(in) {}
+
+bool ChangesetReader::Next(BookChange& change) {
+    char buffer[4096];
+    std::vector<std::string> fields;
+    while (!failed) {
+        line.clear();
+        bool read = false;
+        while (std::fgets(buffer, sizeof(buffer), in)) {
+            read = true;
+            line += buffer;
+            if (!line.empty() && line.back() == '\n') {
+                line.pop_back();
+                break;
+            }
+        }
+        if (!read) {
+            return false; // End of the changeset
+        }
+        ++lineNumber;
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        size_t expected = line[0] == '~' ? 7 : 4;
+        if (!SplitFields(line, fields) || fields.size() != expected || fields[0].size() != 1 ||
+            std::strchr("+-~", fields[0][0]) == nullptr) {
+            LogError("Malformed changeset line %zu", lineNumber);
+            failed = true;
+            return false;
+        }
+        change = BookChange();
+        if (fields[0][0] == '+') {
+            change.kind = BookChangeKind::Added;
+            change.after = Contact(fields[1], fields[2], fields[3]);
+        } else if (fields[0][0] == '-') {
+            change.kind = BookChangeKind::Removed;
+            change.before = Contact(fields[1], fields[2], fields[3]);
+        } else {
+            change.kind = BookChangeKind::Modified;
+            change.before = Contact(fields[1], fields[2], fields[3]);
+            change.after = Contact(fields[4], fields[5], fields[6]);
+        }
+        return true;
+    }
+    return false;
+}
+
+namespace {
+
+// The statements ApplyChangeset runs on the target, prepared once.
+class ChangesetTarget {
+public:
+    explicit ChangesetTarget(sqlite3* db) : db(db) {}
+
+    ~ChangesetTarget() {
+        for (sqlite3_stmt* stmt : {findRow, countPhone, insert, update, removeRow, removePhone}) {
+            sqlite3_finalize(stmt);
+        }
+    }
+
+    bool Prepare() {
+        return Prepare("SELECT rowid FROM contacts WHERE phone = ? AND IFNULL(name, '') = ? AND IFNULL(email, '') = ? "
+                       "LIMIT 1;", findRow) &&
+               Prepare("SELECT COUNT(*) FROM contacts WHERE phone = ?;", countPhone) &&
+               Prepare("INSERT INTO contacts (name, phone, email, phonetic) VALUES (?, ?, ?, ?);", insert) &&
+               Prepare("UPDATE contacts SET name = ?, phone = ?, email = ?, phonetic = ? WHERE rowid = ?;", update) &&
+               Prepare("DELETE FROM contacts WHERE rowid = ?;", removeRow) &&
+               Prepare("DELETE FROM contacts WHERE phone = ?;", removePhone);
+    }
+
+    // Row id of a row equal to 'contact', or 0.
+    sqlite3_int64 Find(const Contact& contact) {
+        Bind(findRow, 1, contact.GetPhone());
+        Bind(findRow, 2, contact.GetName());
+        Bind(findRow, 3, contact.GetEmail());
+        sqlite3_int64 rowid = Step(findRow) == SQLITE_ROW ? sqlite3_column_int64(findRow, 0) : 0;
+        sqlite3_reset(findRow);
+        return rowid;
+    }
+
+    bool HasPhone(const std::string& phone) {
+        Bind(countPhone, 1, phone);
+        bool found = Step(countPhone) == SQLITE_ROW && sqlite3_column_int64(countPhone, 0) > 0;
+        sqlite3_reset(countPhone);
+        return found;
+    }
+
+    bool Insert(const Contact& contact) {
+        BindContact(insert, contact);
+        return Run(insert);
+    }
+
+    bool Update(sqlite3_int64 rowid, const Contact& contact) {
+        BindContact(update, contact);
+        sqlite3_bind_int64(update, 5, rowid);
+        return Run(update);
+    }
+
+    bool Remove(sqlite3_int64 rowid) {
+        sqlite3_bind_int64(removeRow, 1, rowid);
+        return Run(removeRow);
+    }
+
+    bool RemovePhone(const std::string& phone) {
+        Bind(removePhone, 1, phone);
+        return Run(removePhone);
+    }
+
+    bool Failed() const { return failed; }
+
+private:
+    bool Prepare(const char* sql, sqlite3_stmt*& stmt) {
+        if (sqlite3_prepare_v2(db, sql, -1, &stmt, 0) != SQLITE_OK) {
+            LogError("Failed to prepare changeset statement: %s", sqlite3_errmsg(db));
+            return false;
+        }
+        return true;
+    }
+
+    void Bind(sqlite3_stmt* stmt, int index, const std::string& text) {
+        sqlite3_bind_text(stmt, index, text.c_str(), static_cast<int>(text.size()), SQLITE_TRANSIENT);
+    }
+
+    void BindContact(sqlite3_stmt* stmt, const Contact& contact) {
+        Bind(stmt, 1, contact.GetName());
+        Bind(stmt, 2, contact.GetPhone());
+        Bind(stmt, 3, contact.GetEmail());
+        Bind(stmt, 4, PhoneticKey(contact.GetName()));
+    }
+
+    int Step(sqlite3_stmt* stmt) {
+        int rc = sqlite3_step(stmt);
+        if (rc != SQLITE_ROW && rc != SQLITE_DONE) {
+            LogError("Changeset statement failed: %s", sqlite3_errmsg(db));
+            failed = true;
+        }
+        return rc;
+    }
+
+    bool Run(sqlite3_stmt* stmt) {
+        bool done = Step(stmt) == SQLITE_DONE;
+        sqlite3_reset(stmt);
+        return done;
+    }
+
+    sqlite3* db;
+    sqlite3_stmt* findRow = nullptr;
+    sqlite3_stmt* countPhone = nullptr;
+    sqlite3_stmt* insert = nullptr;
+    sqlite3_stmt* update = nullptr;
+    sqlite3_stmt* removeRow = nullptr;
+    sqlite3_stmt* removePhone = nullptr;
+    bool failed = false;
+};
+
+const char* DescribeChange(const BookChange& change) {
+    return change.kind == BookChangeKind::Added ? "add" : change.kind == BookChangeKind::Removed ? "removal" : "edit";
+}
+
+// One change; 'conflict' is set when it does not fit the target.
+bool ApplyChange(ChangesetTarget& target, const BookChange& change, ConflictPolicy policy, bool& conflict) {
+    if (change.kind != BookChangeKind::Removed) {
+        // The same rules as AddContact and EditContact, whatever wrote the changeset
+        uint32_t errors = change.after.Validate();
+        if (errors != kContactFieldsValid) {
+            LogError("Invalid contact '%s' in changeset: %s; nothing applied", change.after.GetName().c_str(),
+                     DescribeContactErrors(errors).c_str());
+            return false;
+        }
+    }
+    sqlite3_int64 rowid = 0;
+    switch (change.kind) {
+    case BookChangeKind::Added:
+        conflict = target.HasPhone(change.after.GetPhone());
+        if (!conflict) {
+            return target.Insert(change.after);
+        }
+        return policy != ConflictPolicy::Overwrite ||
+               (target.RemovePhone(change.after.GetPhone()) && target.Insert(change.after));
+    case BookChangeKind::Removed:
+        rowid = target.Find(change.before);
+        conflict = rowid == 0;
+        if (!conflict) {
+            return target.Remove(rowid);
+        }
+        return policy != ConflictPolicy::Overwrite || target.RemovePhone(change.before.GetPhone());
+    case BookChangeKind::Modified:
+        rowid = target.Find(change.before);
+        conflict = rowid == 0 || (change.after.GetPhone() != change.before.GetPhone() &&
+                                  target.HasPhone(change.after.GetPhone()));
+        if (!conflict) {
+            return target.Update(rowid, change.after);
+        }
+        return policy != ConflictPolicy::Overwrite ||
+               (target.RemovePhone(change.before.GetPhone()) && target.RemovePhone(change.after.GetPhone()) &&
+                target.Insert(change.after));
+    }
+    return false;
+}
+
+} // namespace
+
+bool ApplyChangeset(const std::string& targetPath, ChangesetReader& changes, ConflictPolicy policy, ApplyStats* stats) {
+    sqlite3* db = nullptr;
+    if (sqlite3_open_v2(targetPath.c_str(), &db, SQLITE_OPEN_READWRITE, nullptr) != SQLITE_OK) {
+        LogError("Cannot open %s: %s", targetPath.c_str(), sqlite3_errmsg(db));
+        sqlite3_close(db);
+        return false;
+    }
+    sqlite3_busy_timeout(db, 5000);
+    ApplyStats counts;
+    bool ok = false;
+    {
+        ChangesetTarget target(db);
+        ok = target.Prepare() && sqlite3_exec(db, "BEGIN IMMEDIATE;", 0, 0, 0) == SQLITE_OK;
+        bool inTransaction = ok;
+        BookChange change;
+        while (ok && changes.Next(change)) {
+            bool conflict = false;
+            ok = ApplyChange(target, change, policy, conflict) && !target.Failed();
+            if (!conflict) {
+                ++counts.applied;
+                continue;
+            }
+            ++counts.conflicts;
+            if (policy == ConflictPolicy::Abort) {
+                LogError("Changeset conflicts with %s at the %s of %s (%s); nothing applied", targetPath.c_str(),
+                         DescribeChange(change),
+                         (change.kind == BookChangeKind::Added ? change.after : change.before).GetName().c_str(),
+                         (change.kind == BookChangeKind::Added ? change.after : change.before).GetPhone().c_str());
+                ok = false;
+            } else if (policy == ConflictPolicy::Overwrite) {
+                ++counts.overwritten;
+            }
+        }
+        ok = ok && !changes.Failed();
+        if (ok && sqlite3_exec(db, "COMMIT;", 0, 0, 0) != SQLITE_OK) {
+            LogError("Failed to commit changeset: %s", sqlite3_errmsg(db));
+            ok = false;
+        }
+        if (!ok && inTransaction) {
+            sqlite3_exec(db, "ROLLBACK;", 0, 0, 0);
+        }
+        if (!ok) {
+            counts.applied = 0; // Rolled back; only the conflict count stays meaningful
+            counts.overwritten = 0;
+        }
+    }
+    sqlite3_close(db);
+    if (stats) {
+        *stats = counts;
+    }
+    return ok;
+}
@@ -0,0 +1,99 @@
+#ifndef BOOKDIFF_HPP
+#define BOOKDIFF_HPP
+
+#include <cstddef>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include "Contact.hpp"
+
+// Differences between two book files and a compact text changeset to carry them, for
+// consolidating books without going through AddContact row by row.
+//
+// DiffBooks streams both contacts tables ordered by normalized phone number (sorted by
+// SQLite, which spills to temporary files for large books) and merges them in one pass,
+// holding only the rows of one number at a time. Rows of a number that are identical
+// on both sides are unchanged; the remaining ones are paired into modifications (same
+// stored number first) and the rest are additions or removals.
+//
+// Changeset format, one change per line, fields separated by tabs (tab, newline and
+// backslash inside a field are escaped as \t, \n and \\):
+//   # phonebook changeset 1
+//   +  name  phone  email                                       added
+//   -  name  phone  email                                       removed
+//   ~  old name  old phone  old email  new name  new phone  new email   modified
+
+enum class BookChangeKind {
+    Added,
+    Removed,
+    Modified
+};
+
+struct BookChange {
+    BookChangeKind kind = BookChangeKind::Added;
+    Contact before; // Removed and Modified
+    Contact after;  // Added and Modified
+};
+
+struct BookDiffStats {
+    size_t unchanged = 0;
+    size_t added = 0;
+    size_t removed = 0;
+    size_t modified = 0;
+};
+
+// Calls 'visit' for every change that turns 'basePath' into 'targetPath', in normalized
+// phone order; 'visit' may return false to stop. Returns false (and logs why) if a
+// book cannot be read.
+bool DiffBooks(const std::string& basePath, const std::string& targetPath,
+               const std::function<bool(const BookChange&)>& visit, BookDiffStats* stats = nullptr);
+
+class ChangesetWriter {
+public:
+    explicit ChangesetWriter(std::FILE* out); // Writes the header line
+    bool Write(const BookChange& change);
+
+private:
+    std::FILE* out;
+    std::string line;
+};
+
+class ChangesetReader {
+public:
+    explicit ChangesetReader(std::FILE* in);
+    // Next change; false at the end or on a malformed line (then Failed() is true).
+    bool Next(BookChange& change);
+    bool Failed() const { return failed; }
+
+private:
+    std::FILE* in;
+    std::string line;
+    size_t lineNumber = 0;
+    bool failed = false;
+};
+
+// What to do when a change does not fit the target: an added number is already there,
+// or the row a removal or modification expects is gone or different.
+enum class ConflictPolicy {
+    Abort,    // Roll back the whole changeset
+    Skip,     // Keep the target's rows for that change
+    Overwrite // Make the target match the change (replacing rows with the same number)
+};
+
+struct ApplyStats {
+    size_t applied = 0;     // Changes that fit the target
+    size_t conflicts = 0;   // Changes that did not
+    size_t overwritten = 0; // Conflicts resolved in favour of the change (Overwrite)
+};
+
+// Applies every change from 'changes' to the book at 'targetPath' in one transaction, so
+// either all of them take effect or none. Numbers are matched as stored, as AddContact's
+// duplicate check does. The target must have the current schema (opening it with
+// TelephoneBookLogic once migrates it). Running TelephoneBookLogic instances see the result through the
+// change log (RefreshFromDatabase). Returns false (and logs why) if the changeset is
+// malformed, adds a contact that breaks the Contact rules (see ContactValidation.hpp),
+// a write fails, or a conflict occurs under ConflictPolicy::Abort.
+bool ApplyChangeset(const std::string& targetPath, ChangesetReader& changes, ConflictPolicy policy,
+                    ApplyStats* stats = nullptr);
+
+#endif // BOOKDIFF_HPP
@@ -0,0 +1,378 @@
+#include "BookReplica.hpp"
+#include "CoreLog.hpp"
+#include "Phonetic.hpp"
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+
+const char* kReplicaStateSchema =
+    "CREATE TABLE IF NOT EXISTS replica_state ("
+    "  id INTEGER PRIMARY KEY CHECK (id = 1),"
+    "  sequence INTEGER NOT NULL);"; // No row until the first bootstrap
+
+// Rows are matched on all three fields; the primary's rows may hold NULL where the log
+// and the replica hold an empty string
+const char* kMatchRow =
+    "(SELECT rowid FROM contacts WHERE phone = ? AND IFNULL(name, '') = ? AND IFNULL(email, '') = ? LIMIT 1)";
+
+std::string ColumnText(sqlite3_stmt* stmt, int column) {
+    const char* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, column));
+    return text ? std::string(text, static_cast<size_t>(sqlite3_column_bytes(stmt, column))) : std::string();
+}
+
+void BindText(sqlite3_stmt* stmt, int index, const std::string& text) {
+    sqlite3_bind_text(stmt, index, text.c_str(), static_cast<int>(text.size()), SQLITE_TRANSIENT);
+}
+
+// Name, phone, email and phonetic key of 'contact' at parameters first .. first + 3.
+void BindContact(sqlite3_stmt* stmt, int first, const Contact& contact, bool withPhonetic) {
+    BindText(stmt, first, contact.GetName());
+    BindText(stmt, first + 1, contact.GetPhone());
+    BindText(stmt, first + 2, contact.GetEmail());
+    if (withPhonetic) {
+        BindText(stmt, first + 3, PhoneticKey(contact.GetName()));
+    }
+}
+
+// kMatchRow parameters for 'contact' starting at 'first'.
+void BindMatch(sqlite3_stmt* stmt, int first, const Contact& contact) {
+    BindText(stmt, first, contact.GetPhone());
+    BindText(stmt, first + 1, contact.GetName());
+    BindText(stmt, first + 2, contact.GetEmail());
+}
+
+} // namespace
+
+std::string ReplicaStats::ToPrometheusText() const {
+    std::string out;
+    char line[256];
+    auto metric = [&](const char* name, const char* type, const char* help, double value) {
+        std::snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s %s\n%s %.17g\n", name, help, name, type, name, value);
+        out += line;
+    };
+    metric("phonebook_replica_applied_sequence", "gauge", "Last primary change contained in the replica.",
+           static_cast<double>(appliedSequence));
+    metric("phonebook_replica_primary_sequence", "gauge", "Last primary change seen by the replica.",
+           static_cast<double>(primarySequence));
+    metric("phonebook_replica_lag_changes", "gauge", "Primary changes not yet applied.", static_cast<double>(lagChanges));
+    metric("phonebook_replica_lag_seconds", "gauge", "Time since the replica was last caught up.", lagSeconds);
+    metric("phonebook_replica_batches_total", "counter", "Batches applied from the primary's log.",
+           static_cast<double>(batches));
+    metric("phonebook_replica_changes_applied_total", "counter", "Changes applied from the primary's log.",
+           static_cast<double>(changesApplied));
+    metric("phonebook_replica_bootstraps_total", "counter", "Full copies of the primary.", static_cast<double>(bootstraps));
+    metric("phonebook_replica_divergences_total", "counter", "Logged changes that did not match the replica.",
+           static_cast<double>(divergences));
+    return out;
+}
+
+BookReplica::BookReplica(const std::string& primaryPath, const std::string& replicaPath, const ReplicaConfig& config)
+    : primaryPath(primaryPath), replicaPath(replicaPath), config(config), lastCaughtUp(std::chrono::steady_clock::now()) {
+    if (this->config.batchSize == 0) {
+        this->config.batchSize = 1;
+    }
+    // Creates the schema (and the replica's own change log, which drives its snapshot)
+    book = std::make_unique<TelephoneBookLogic>(replicaPath, ConcurrencyMode::MultiReader, config.readPoolSize);
+    OpenConnections();
+}
+
+BookReplica::~BookReplica() {
+    watcher.reset(); // Its callback applies batches
+    sqlite3_close(primary);
+    sqlite3_close(local);
+}
+
+bool BookReplica::OpenConnections() {
+    if (!local) {
+        char* errMsg = nullptr;
+        if (sqlite3_open(replicaPath.c_str(), &local) != SQLITE_OK ||
+            sqlite3_exec(local, kReplicaStateSchema, 0, 0, &errMsg) != SQLITE_OK) {
+            LogError("Cannot open replica %s: %s", replicaPath.c_str(), errMsg ? errMsg : sqlite3_errmsg(local));
+            sqlite3_free(errMsg);
+            sqlite3_close(local);
+            local = nullptr;
+            return false;
+        }
+        sqlite3_busy_timeout(local, 5000);
+        sqlite3_stmt* stmt = nullptr;
+        if (sqlite3_prepare_v2(local, "SELECT sequence FROM replica_state;", -1, &stmt, 0) == SQLITE_OK &&
+            sqlite3_step(stmt) == SQLITE_ROW) {
+            appliedSequence = static_cast<uint64_t>(sqlite3_column_int64(stmt, 0));
+            bootstrapped = true;
+        }
+        sqlite3_finalize(stmt);
+        std::lock_guard<std::mutex> lock(statsMutex);
+        stats.appliedSequence = appliedSequence;
+    }
+    if (!primary) {
+        // Read-only: the replica never takes a write lock on the primary
+        if (sqlite3_open_v2(primaryPath.c_str(), &primary, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+            LogError("Cannot open primary %s: %s", primaryPath.c_str(), sqlite3_errmsg(primary));
+            sqlite3_close(primary);
+            primary = nullptr;
+            return false;
+        }
+        sqlite3_busy_timeout(primary, 5000);
+    }
+    return true;
+}
+
+bool BookReplica::ReadPrimarySequence(uint64_t& sequence) {
+    sequence = 0;
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(primary, "SELECT seq FROM sqlite_sequence WHERE name = 'contact_changes';", -1, &stmt, 0) !=
+        SQLITE_OK) {
+        // Books from before schema version 3 get their log when the application opens them
+        LogError("Primary %s has no change log (%s); open it once with TelephoneBookLogic first", primaryPath.c_str(),
+                 sqlite3_errmsg(primary));
+        return false;
+    }
+    int rc = sqlite3_step(stmt);
+    if (rc == SQLITE_ROW) {
+        sequence = static_cast<uint64_t>(sqlite3_column_int64(stmt, 0));
+    }
+    sqlite3_finalize(stmt);
+    return rc == SQLITE_ROW || rc == SQLITE_DONE;
+}
+
+bool BookReplica::ApplyNextBatch(bool& gap, bool& diverged, size_t& applied) {
+    gap = false;
+    diverged = false;
+    applied = 0;
+    sqlite3_stmt* read = nullptr;
+    if (sqlite3_prepare_v2(primary,
+                           "SELECT seq, op, name, phone, email, old_name, old_phone, old_email FROM contact_changes "
+                           "WHERE seq > ? ORDER BY seq LIMIT ?;",
+                           -1, &read, 0) != SQLITE_OK) {
+        LogError("Cannot read the primary's change log: %s", sqlite3_errmsg(primary));
+        return false;
+    }
+    sqlite3_bind_int64(read, 1, static_cast<sqlite3_int64>(appliedSequence));
+    sqlite3_bind_int64(read, 2, static_cast<sqlite3_int64>(config.batchSize));
+    std::vector<ContactChange> changes;
+    int rc;
+    while ((rc = sqlite3_step(read)) == SQLITE_ROW) {
+        ContactChange change;
+        change.sequence = static_cast<uint64_t>(sqlite3_column_int64(read, 0));
+        std::string op = ColumnText(read, 1);
+        change.type = op == "add" ? ContactChangeType::Add : op == "edit" ? ContactChangeType::Edit : ContactChangeType::Delete;
+        change.after = Contact(ColumnText(read, 2), ColumnText(read, 3), ColumnText(read, 4));
+        change.before = Contact(ColumnText(read, 5), ColumnText(read, 6), ColumnText(read, 7));
+        changes.push_back(std::move(change));
+    }
+    sqlite3_finalize(read);
+    if (rc != SQLITE_DONE) {
+        LogError("Reading the primary's change log failed: %s", sqlite3_errmsg(primary));
+        return false;
+    }
+    if (changes.empty()) {
+        return true;
+    }
+    if (changes.front().sequence != appliedSequence + 1) {
+        gap = true; // Pruned on the primary before we got to it
+        return true;
+    }
+
+    sqlite3_stmt* insert = nullptr;
+    sqlite3_stmt* update = nullptr;
+    sqlite3_stmt* remove = nullptr;
+    sqlite3_stmt* position = nullptr;
+    std::string updateSql =
+        std::string("UPDATE contacts SET name = ?, phone = ?, email = ?, phonetic = ? WHERE rowid = ") + kMatchRow + ";";
+    std::string deleteSql = std::string("DELETE FROM contacts WHERE rowid = ") + kMatchRow + ";";
+    if (sqlite3_prepare_v2(local, "INSERT INTO contacts (name, phone, email, phonetic) VALUES (?, ?, ?, ?);", -1,
+                           &insert, 0) != SQLITE_OK ||
+        sqlite3_prepare_v2(local, updateSql.c_str(), -1, &update, 0) != SQLITE_OK ||
+        sqlite3_prepare_v2(local, deleteSql.c_str(), -1, &remove, 0) != SQLITE_OK ||
+        sqlite3_prepare_v2(local, "UPDATE replica_state SET sequence = ?;", -1, &position, 0) != SQLITE_OK) {
+        LogError("Failed to prepare replica statements: %s", sqlite3_errmsg(local));
+        sqlite3_finalize(insert);
+        sqlite3_finalize(update);
+        sqlite3_finalize(remove);
+        sqlite3_finalize(position);
+        return false;
+    }
+
+    bool ok = sqlite3_exec(local, "BEGIN IMMEDIATE;", 0, 0, 0) == SQLITE_OK;
+    for (size_t i = 0; ok && !diverged && i < changes.size(); ++i) {
+        const ContactChange& change = changes[i];
+        sqlite3_stmt* stmt = change.type == ContactChangeType::Add ? insert
+                             : change.type == ContactChangeType::Edit ? update : remove;
+        sqlite3_reset(stmt);
+        if (change.type == ContactChangeType::Add) {
+            BindContact(stmt, 1, change.after, true);
+        } else if (change.type == ContactChangeType::Edit) {
+            BindContact(stmt, 1, change.after, true);
+            BindMatch(stmt, 5, change.before);
+        } else {
+            BindMatch(stmt, 1, change.before);
+        }
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
+            LogError("Applying change %llu failed: %s", static_cast<unsigned long long>(change.sequence),
+                     sqlite3_errmsg(local));
+            ok = false;
+        } else if (change.type != ContactChangeType::Add && sqlite3_changes(local) == 0) {
+            LogError("Change %llu does not match the replica %s", static_cast<unsigned long long>(change.sequence),
+                     replicaPath.c_str());
+            diverged = true;
+        }
+    }
+    if (ok && !diverged) {
+        sqlite3_bind_int64(position, 1, static_cast<sqlite3_int64>(changes.back().sequence));
+        ok = sqlite3_step(position) == SQLITE_DONE && sqlite3_exec(local, "COMMIT;", 0, 0, 0) == SQLITE_OK;
+        if (!ok) {
+            LogError("Committing replica batch failed: %s", sqlite3_errmsg(local));
+        }
+    }
+    if (!ok || diverged) {
+        sqlite3_exec(local, "ROLLBACK;", 0, 0, 0);
+    } else {
+        appliedSequence = changes.back().sequence;
+        applied = changes.size();
+    }
+    sqlite3_finalize(insert);
+    sqlite3_finalize(update);
+    sqlite3_finalize(remove);
+    sqlite3_finalize(position);
+    return ok;
+}
+
+bool BookReplica::Bootstrap() {
+    LogMessage("Bootstrapping replica %s from %s", replicaPath.c_str(), primaryPath.c_str());
+    sqlite3_stmt* read = nullptr;
+    sqlite3_stmt* insert = nullptr;
+    if (sqlite3_prepare_v2(primary, "SELECT name, phone, email FROM contacts;", -1, &read, 0) != SQLITE_OK ||
+        sqlite3_prepare_v2(local, "INSERT INTO contacts (name, phone, email, phonetic) VALUES (?, ?, ?, ?);", -1,
+                           &insert, 0) != SQLITE_OK) {
+        LogError("Cannot copy %s: %s", primaryPath.c_str(), sqlite3_errmsg(read ? local : primary));
+        sqlite3_finalize(read);
+        sqlite3_finalize(insert);
+        return false;
+    }
+
+    // The copy and its log position come from one read transaction on the primary;
+    // rows are streamed, so memory does not grow with the book
+    sqlite3_exec(primary, "BEGIN;", 0, 0, 0);
+    uint64_t sequence = 0;
+    bool ok = ReadPrimarySequence(sequence) && sqlite3_exec(local, "BEGIN IMMEDIATE;", 0, 0, 0) == SQLITE_OK;
+    bool inTransaction = ok;
+    ok = ok && sqlite3_exec(local, "DELETE FROM contacts;", 0, 0, 0) == SQLITE_OK;
+    size_t copied = 0;
+    int rc = SQLITE_DONE;
+    while (ok && (rc = sqlite3_step(read)) == SQLITE_ROW) {
+        Contact contact(ColumnText(read, 0), ColumnText(read, 1), ColumnText(read, 2));
+        sqlite3_reset(insert);
+        BindContact(insert, 1, contact, true);
+        ok = sqlite3_step(insert) == SQLITE_DONE;
+        ++copied;
+    }
+    ok = ok && rc == SQLITE_DONE;
+    sqlite3_finalize(read);
+    sqlite3_finalize(insert);
+    sqlite3_exec(primary, "COMMIT;", 0, 0, 0);
+
+    if (ok) {
+        char sql[96];
+        std::snprintf(sql, sizeof(sql), "INSERT OR REPLACE INTO replica_state (id, sequence) VALUES (1, %llu);",
+                      static_cast<unsigned long long>(sequence));
+        ok = sqlite3_exec(local, sql, 0, 0, 0) == SQLITE_OK && sqlite3_exec(local, "COMMIT;", 0, 0, 0) == SQLITE_OK;
+    }
+    if (!ok) {
+        LogError("Bootstrapping replica %s failed: %s", replicaPath.c_str(), sqlite3_errmsg(local));
+        if (inTransaction) {
+            sqlite3_exec(local, "ROLLBACK;", 0, 0, 0);
+        }
+        return false;
+    }
+    appliedSequence = sequence;
+    bootstrapped = true;
+    // The copy logged a delete and an add per row in the replica's own change log; drop
+    // them, so the replica book reloads once instead of replaying them
+    book->PruneChanges(book->GetChangeSequence());
+    LogMessage("Replica %s copied %zu contacts at sequence %llu", replicaPath.c_str(), copied,
+               static_cast<unsigned long long>(sequence));
+    std::lock_guard<std::mutex> lock(statsMutex);
+    ++stats.bootstraps;
+    return true;
+}
+
+bool BookReplica::Resync() {
+    {
+        std::lock_guard<std::mutex> lock(applyMutex);
+        bootstrapped = false;
+    }
+    return CatchUp();
+}
+
+bool BookReplica::CatchUp() {
+    std::lock_guard<std::mutex> lock(applyMutex);
+    if (!OpenConnections()) {
+        return false;
+    }
+    uint64_t target = 0;
+    if (!ReadPrimarySequence(target)) {
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> statsLock(statsMutex);
+        stats.primarySequence = target;
+    }
+    // Contacts from before the primary had a change log are only in a copy, and a
+    // primary behind the replica was replaced or restored from a backup
+    bool ok = true;
+    bool bootstrap = !bootstrapped || target < appliedSequence;
+    while (ok && (bootstrap || appliedSequence < target)) {
+        if (bootstrap) {
+            ok = Bootstrap();
+            bootstrap = false;
+            continue;
+        }
+        bool gap = false;
+        bool diverged = false;
+        size_t applied = 0;
+        ok = ApplyNextBatch(gap, diverged, applied);
+        if (!ok) {
+            break;
+        }
+        // An empty batch before 'target' means the tail of the log was pruned
+        bootstrap = gap || diverged || applied == 0;
+        std::lock_guard<std::mutex> statsLock(statsMutex);
+        stats.divergences += diverged ? 1 : 0;
+        stats.batches += applied > 0 ? 1 : 0;
+        stats.changesApplied += applied;
+    }
+    // Bring the replica book's snapshot up to what was just committed. The book is the
+    // only reader of the replica's own change log, so what it has applied can go; the
+    // log would otherwise grow by every change copied from the primary.
+    if (book->RefreshFromDatabase()) {
+        book->PruneChanges(book->GetSnapshotWithSequence().second);
+    }
+
+    std::lock_guard<std::mutex> statsLock(statsMutex);
+    stats.appliedSequence = appliedSequence;
+    stats.primarySequence = std::max(stats.primarySequence, appliedSequence);
+    if (appliedSequence >= stats.primarySequence) {
+        lastCaughtUp = std::chrono::steady_clock::now();
+    }
+    return ok;
+}
+
+void BookReplica::Start() {
+    watcher.reset(); // Replaces any previous watcher
+    watcher = std::make_unique<DatabaseWatcher>(primaryPath, [this]() { CatchUp(); }, config.pollInterval);
+}
+
+void BookReplica::Stop() {
+    watcher.reset();
+}
+
+ReplicaStats BookReplica::GetStats() const {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    ReplicaStats result = stats;
+    result.lagChanges = result.primarySequence > result.appliedSequence ? result.primarySequence - result.appliedSequence : 0;
+    if (result.lagChanges > 0) {
+        result.lagSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - lastCaughtUp).count();
+    }
+    return result;
+}
@@ -0,0 +1,98 @@
+#ifndef BOOKREPLICA_HPP
+#define BOOKREPLICA_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <sqlite3.h>
+#include "DatabaseWatcher.hpp"
+#include "TelephoneBookLogic.hpp"
+
+struct ReplicaConfig {
+    size_t batchSize = 1000;                                 // Changes per replica transaction
+    std::chrono::milliseconds pollInterval = std::chrono::seconds(1); // Fallback when inotify misses a write
+    size_t readPoolSize = 1;                                 // Read connections of the replica book
+};
+
+struct ReplicaStats {
+    uint64_t appliedSequence = 0; // Last primary change contained in the replica
+    uint64_t primarySequence = 0; // Last primary change seen at the latest poll
+    uint64_t lagChanges = 0;      // primarySequence - appliedSequence
+    double lagSeconds = 0;        // Time since the replica was last fully caught up (0 if it is)
+    uint64_t batches = 0;         // Replica transactions from the log
+    uint64_t changesApplied = 0;
+    uint64_t bootstraps = 0;      // Full copies (first start, pruned log, divergence)
+    uint64_t divergences = 0;     // Logged changes that did not match the replica's rows
+
+    // Gauges and counters in Prometheus text format (phonebook_replica_*).
+    std::string ToPrometheusText() const;
+};
+
+// A read-only copy of a book in its own database file, kept up to date by shipping the
+// primary's change log (see TelephoneBookLogic::ChangesSince): new log entries are read
+// straight from the primary's file and applied in batches, one replica transaction per
+// batch that also records the last applied sequence, so a restarted replica continues
+// where it stopped. The primary needs no configuration and may run in another process.
+//
+// A replica that is new, whose position was pruned from the primary's log or whose rows
+// no longer match the log bootstraps instead: it copies the primary's contacts as of one
+// read transaction together with the log position of that copy, and then follows the
+// log from there.
+//
+// Reads go to GetBook(), a normal TelephoneBookLogic over the replica file that picks
+// up every applied batch incrementally. Nothing else may write to the replica file.
+class BookReplica {
+public:
+    BookReplica(const std::string& primaryPath, const std::string& replicaPath, const ReplicaConfig& config = {});
+    ~BookReplica();
+
+    BookReplica(const BookReplica&) = delete;
+    BookReplica& operator=(const BookReplica&) = delete;
+
+    // Applies everything the primary has logged so far, bootstrapping first if needed.
+    // Returns false (and logs why) if the primary cannot be read or a batch fails.
+    bool CatchUp();
+    // Copies the primary again and then catches up, e.g. after bookverify found rows
+    // that were changed on the replica directly (the log cannot repair those).
+    bool Resync();
+
+    // Follows the primary asynchronously: CatchUp() runs whenever the primary's files
+    // change (inotify) and at least every pollInterval.
+    void Start();
+    void Stop();
+
+    TelephoneBookLogic& GetBook() { return *book; }
+    ReplicaStats GetStats() const;
+
+private:
+    bool OpenConnections();
+    // Latest sequence in the primary's log (0 if it has none)
+    bool ReadPrimarySequence(uint64_t& sequence);
+    // Reads up to batchSize changes after appliedSequence and applies them in one
+    // transaction; 'gap' is set when the next change is no longer in the log and
+    // 'diverged' when a change did not match the replica's rows
+    bool ApplyNextBatch(bool& gap, bool& diverged, size_t& applied);
+    bool Bootstrap();
+
+    std::string primaryPath;
+    std::string replicaPath;
+    ReplicaConfig config;
+
+    std::unique_ptr<TelephoneBookLogic> book; // Reads; its snapshot follows 'local'
+    sqlite3* primary = nullptr;               // Read-only connection to the primary file
+    sqlite3* local = nullptr;                 // The only writer of the replica file
+
+    std::mutex applyMutex; // Serializes CatchUp() (caller and watcher thread)
+    uint64_t appliedSequence = 0; // Guarded by applyMutex
+    bool bootstrapped = false;    // replica_state has a row; guarded by applyMutex
+
+    mutable std::mutex statsMutex;
+    ReplicaStats stats;
+    std::chrono::steady_clock::time_point lastCaughtUp;
+
+    std::unique_ptr<DatabaseWatcher> watcher; // Stopped first in the destructor
+};
+
+#endif // BOOKREPLICA_HPP
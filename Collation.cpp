@@ -0,0 +1,460 @@
+#include "Collation.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+namespace {
+
+// Key layout: primary weights, kLevelSeparator, one secondary byte per primary
+// weight, kLevelSeparator, one tertiary byte per primary weight. Primary weights
+// start with a byte >= 0x02, so the separator sorts a shorter string first.
+constexpr char kLevelSeparator = 0x01;
+
+// Lead bytes of the two-byte primary weights; the second byte orders within a group.
+constexpr uint8_t kPunctuation = 0x02; // ASCII non-alphanumerics, by code
+constexpr uint8_t kDigit = 0x03;       // 0-9 in any script
+constexpr uint8_t kLatin = 0x04;       // a-z
+constexpr uint8_t kPersian = 0x06;     // Persian alphabet order
+// Other characters: kOther followed by the folded code point in three bytes.
+constexpr uint8_t kOther = 0xF0;
+
+constexpr uint8_t kBaseForm = 0x02; // Secondary: no accent / not a variant
+constexpr uint8_t kLower = 0x02;    // Tertiary
+constexpr uint8_t kUpper = 0x03;
+
+// Base letters of U+00C0..U+00FF. '*' marks expansions (Æ, Þ, ß, æ, þ), '#' the
+// two symbols in the block (× and ÷).
+constexpr char kLatin1Base[] =
+    "aaaaaa*ceeeeiiiidnooooo#ouuuuy**"
+    "aaaaaa*ceeeeiiiidnooooo#ouuuuy*y";
+
+// Base letters of U+0100..U+017F (Latin Extended-A). '*' marks Ĳ/ĳ and Œ/œ.
+constexpr char kLatinExtABase[] =
+    "aaaaaaccccccccdd" "ddeeeeeeeeeegggg"
+    "gggghhhhiiiiiiii" "ii**jjkkklllllll"
+    "lllnnnnnnnnnoooo" "oo**rrrrrrssssss"
+    "ssttttttuuuuuuuu" "uuuuwwyyyzzzzzzs";
+
+static_assert(sizeof(kLatin1Base) == 0x40 + 1 && sizeof(kLatinExtABase) == 0x80 + 1, "one entry per code point");
+
+// Persian alphabet: primary position and the secondary byte for letter variants.
+struct PersianLetter {
+    char32_t codePoint;
+    uint8_t position;
+    uint8_t variant;  // kBaseForm for the letter itself
+    char32_t folded;  // FoldCase result
+};
+
+constexpr PersianLetter kPersianLetters[] = {
+    {0x0621, 0, kBaseForm, 0x0621},  // ء
+    {0x0622, 1, kBaseForm, 0x0627},  // آ (sorts before ا)
+    {0x0627, 2, kBaseForm, 0x0627},  // ا
+    {0x0623, 2, 0x03, 0x0627},       // أ
+    {0x0625, 2, 0x04, 0x0627},       // إ
+    {0x0671, 2, 0x05, 0x0627},       // ٱ
+    {0x0628, 3, kBaseForm, 0x0628},  // ب
+    {0x067E, 4, kBaseForm, 0x067E},  // پ
+    {0x062A, 5, kBaseForm, 0x062A},  // ت
+    {0x062B, 6, kBaseForm, 0x062B},  // ث
+    {0x062C, 7, kBaseForm, 0x062C},  // ج
+    {0x0686, 8, kBaseForm, 0x0686},  // چ
+    {0x062D, 9, kBaseForm, 0x062D},  // ح
+    {0x062E, 10, kBaseForm, 0x062E}, // خ
+    {0x062F, 11, kBaseForm, 0x062F}, // د
+    {0x0630, 12, kBaseForm, 0x0630}, // ذ
+    {0x0631, 13, kBaseForm, 0x0631}, // ر
+    {0x0632, 14, kBaseForm, 0x0632}, // ز
+    {0x0698, 15, kBaseForm, 0x0698}, // ژ
+    {0x0633, 16, kBaseForm, 0x0633}, // س
+    {0x0634, 17, kBaseForm, 0x0634}, // ش
+    {0x0635, 18, kBaseForm, 0x0635}, // ص
+    {0x0636, 19, kBaseForm, 0x0636}, // ض
+    {0x0637, 20, kBaseForm, 0x0637}, // ط
+    {0x0638, 21, kBaseForm, 0x0638}, // ظ
+    {0x0639, 22, kBaseForm, 0x0639}, // ع
+    {0x063A, 23, kBaseForm, 0x063A}, // غ
+    {0x0641, 24, kBaseForm, 0x0641}, // ف
+    {0x0642, 25, kBaseForm, 0x0642}, // ق
+    {0x06A9, 26, kBaseForm, 0x06A9}, // ک
+    {0x0643, 26, 0x03, 0x06A9},      // ك (Arabic kaf)
+    {0x06AF, 27, kBaseForm, 0x06AF}, // گ
+    {0x0644, 28, kBaseForm, 0x0644}, // ل
+    {0x0645, 29, kBaseForm, 0x0645}, // م
+    {0x0646, 30, kBaseForm, 0x0646}, // ن
+    {0x0648, 31, kBaseForm, 0x0648}, // و
+    {0x0624, 31, 0x03, 0x0648},      // ؤ
+    {0x0647, 32, kBaseForm, 0x0647}, // ه
+    {0x0629, 32, 0x03, 0x0647},      // ة
+    {0x06C0, 32, 0x04, 0x0647},      // ۀ
+    {0x06CC, 33, kBaseForm, 0x06CC}, // ی
+    {0x064A, 33, 0x03, 0x06CC},      // ي (Arabic yeh)
+    {0x0649, 33, 0x04, 0x06CC},      // ى
+    {0x0626, 33, 0x05, 0x06CC},      // ئ
+};
+
+// Index into kPersianLetters for U+0600..U+06FF, -1 if not a letter we know.
+const std::array<int8_t, 256>& PersianTable() {
+    static const std::array<int8_t, 256> table = [] {
+        std::array<int8_t, 256> t;
+        t.fill(-1);
+        for (size_t i = 0; i < sizeof(kPersianLetters) / sizeof(kPersianLetters[0]); ++i) {
+            t[kPersianLetters[i].codePoint - 0x0600] = static_cast<int8_t>(i);
+        }
+        return t;
+    }();
+    return table;
+}
+
+// Characters with no weight at all: harakat, superscript alef, tatweel, ZWNJ/ZWJ,
+// soft hyphen and combining accents.
+bool IsIgnorable(char32_t c) {
+    return (c >= 0x064B && c <= 0x0652) || c == 0x0670 || c == 0x0640 || c == 0x200C || c == 0x200D ||
+           c == 0x00AD || (c >= 0x0300 && c <= 0x036F);
+}
+
+// Persian (U+06F0..) and Arabic-Indic (U+0660..) digits; -1 otherwise.
+int ScriptDigit(char32_t c) {
+    if (c >= 0x06F0 && c <= 0x06F9) {
+        return static_cast<int>(c - 0x06F0);
+    }
+    if (c >= 0x0660 && c <= 0x0669) {
+        return static_cast<int>(c - 0x0660);
+    }
+    return -1;
+}
+
+// Decodes one code point at 'i' and advances it; malformed sequences give U+FFFD.
+char32_t DecodeUtf8(std::string_view text, size_t& i) {
+    unsigned char lead = static_cast<unsigned char>(text[i++]);
+    if (lead < 0x80) {
+        return lead;
+    }
+    int extra = lead >= 0xF0 ? 3 : lead >= 0xE0 ? 2 : lead >= 0xC0 ? 1 : -1;
+    if (extra < 0 || lead > 0xF4 || i + static_cast<size_t>(extra) > text.size()) {
+        return 0xFFFD;
+    }
+    char32_t c = lead & (0x3F >> extra);
+    for (int k = 0; k < extra; ++k) {
+        unsigned char next = static_cast<unsigned char>(text[i]);
+        if ((next & 0xC0) != 0x80) {
+            return 0xFFFD;
+        }
+        c = (c << 6) | (next & 0x3F);
+        ++i;
+    }
+    return c;
+}
+
+void AppendUtf8(char32_t c, std::string& out) {
+    if (c < 0x80) {
+        out += static_cast<char>(c);
+    } else if (c < 0x800) {
+        out += static_cast<char>(0xC0 | (c >> 6));
+        out += static_cast<char>(0x80 | (c & 0x3F));
+    } else if (c < 0x10000) {
+        out += static_cast<char>(0xE0 | (c >> 12));
+        out += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (c & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (c >> 18));
+        out += static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (c & 0x3F));
+    }
+}
+
+bool IsUpperLatinExtA(char32_t c) {
+    if (c == 0x0130 || c == 0x0178) {
+        return true; // İ, Ÿ
+    }
+    if (c == 0x0131 || c == 0x0138 || c == 0x0149 || c == 0x017F) {
+        return false; // ı, ĸ, ŉ, ſ have no upper-case partner in the block
+    }
+    bool oddUpper = (c >= 0x0139 && c <= 0x0148) || (c >= 0x0179 && c <= 0x017E);
+    return oddUpper ? (c & 1) != 0 : (c & 1) == 0;
+}
+
+// Simple lower-case mapping for the blocks we fold (one code point to one).
+char32_t ToLower(char32_t c) {
+    if (c < 0x80) {
+        return c >= 'A' && c <= 'Z' ? c + 0x20 : c;
+    }
+    if (c >= 0xC0 && c <= 0xDE && c != 0xD7) {
+        return c + 0x20;
+    }
+    if (c >= 0x0100 && c <= 0x017F) {
+        if (c == 0x0130) {
+            return 'i';
+        }
+        if (c == 0x0178) {
+            return 0xFF;
+        }
+        if (c == 0x017F) {
+            return 's';
+        }
+        return IsUpperLatinExtA(c) ? c + 1 : c;
+    }
+    if (c >= 0x0391 && c <= 0x03A9 && c != 0x03A2) {
+        return c + 0x20; // Greek capitals
+    }
+    if (c == 0x03C2) {
+        return 0x03C3; // Final sigma
+    }
+    if (c == 0x0386) {
+        return 0x03AC;
+    }
+    if (c >= 0x0388 && c <= 0x038A) {
+        return c + 0x25;
+    }
+    if (c == 0x038C) {
+        return 0x03CC;
+    }
+    if (c == 0x038E || c == 0x038F) {
+        return c + 0x3F;
+    }
+    if (c >= 0x0410 && c <= 0x042F) {
+        return c + 0x20; // Cyrillic capitals
+    }
+    if (c >= 0x0400 && c <= 0x040F) {
+        return c + 0x50;
+    }
+    return c;
+}
+
+bool IsUpper(char32_t c) {
+    if (c >= 0x0100 && c <= 0x017F) {
+        return IsUpperLatinExtA(c);
+    }
+    return ToLower(c) != c && c != 0x03C2;
+}
+
+// Expansions of '*' entries in the Latin tables.
+const char* LatinExpansion(char32_t c) {
+    switch (ToLower(c)) {
+    case 0xE6: return "ae";   // æ
+    case 0xFE: return "th";   // þ
+    case 0xDF: return "ss";   // ß
+    case 0x0133: return "ij"; // ĳ
+    case 0x0153: return "oe"; // œ
+    default: return nullptr;
+    }
+}
+
+struct KeyBuilder {
+    std::string& primary;
+    std::string& secondary;
+    std::string& tertiary;
+
+    void Add(uint8_t lead, uint8_t second, uint8_t accent, uint8_t caseByte) {
+        primary += static_cast<char>(lead);
+        primary += static_cast<char>(second);
+        secondary += static_cast<char>(accent);
+        tertiary += static_cast<char>(caseByte);
+    }
+
+    void AddOther(char32_t c, uint8_t caseByte) {
+        primary += static_cast<char>(kOther);
+        primary += static_cast<char>((c >> 16) & 0xFF);
+        primary += static_cast<char>((c >> 8) & 0xFF);
+        primary += static_cast<char>(c & 0xFF);
+        secondary += static_cast<char>(kBaseForm);
+        tertiary += static_cast<char>(caseByte);
+    }
+};
+
+void AddWeights(char32_t c, KeyBuilder& key) {
+    if (c < 0x80) {
+        if (c >= 'a' && c <= 'z') {
+            key.Add(kLatin, static_cast<uint8_t>(c - 'a'), kBaseForm, kLower);
+        } else if (c >= 'A' && c <= 'Z') {
+            key.Add(kLatin, static_cast<uint8_t>(c - 'A'), kBaseForm, kUpper);
+        } else if (c >= '0' && c <= '9') {
+            key.Add(kDigit, static_cast<uint8_t>(c - '0'), kBaseForm, kLower);
+        } else {
+            key.Add(kPunctuation, static_cast<uint8_t>(c), kBaseForm, kLower);
+        }
+        return;
+    }
+    if (IsIgnorable(c)) {
+        return;
+    }
+    if (c >= 0xC0 && c <= 0x017F) {
+        char base = c < 0x100 ? kLatin1Base[c - 0xC0] : kLatinExtABase[c - 0x100];
+        // Distinct per accented letter, taken from the lower-case form so that "Ä" and
+        // "ä" differ only in the case byte (İ has no accented partner and keeps its own)
+        char32_t lower = ToLower(c);
+        uint8_t accent = static_cast<uint8_t>(0x03 + ((lower >= 0xC0 ? lower : c) - 0xC0));
+        uint8_t caseByte = IsUpper(c) ? kUpper : kLower;
+        if (base == '*') {
+            for (const char* letter = LatinExpansion(c); *letter; ++letter) {
+                key.Add(kLatin, static_cast<uint8_t>(*letter - 'a'), accent, caseByte);
+            }
+        } else if (base == '#') {
+            key.AddOther(c, kLower);
+        } else {
+            key.Add(kLatin, static_cast<uint8_t>(base - 'a'), accent, caseByte);
+        }
+        return;
+    }
+    int digit = ScriptDigit(c);
+    if (digit >= 0) {
+        key.Add(kDigit, static_cast<uint8_t>(digit), c >= 0x06F0 ? 0x04 : 0x03, kLower);
+        return;
+    }
+    if (c >= 0x0600 && c <= 0x06FF) {
+        int index = PersianTable()[c - 0x0600];
+        if (index >= 0) {
+            const PersianLetter& letter = kPersianLetters[index];
+            key.Add(kPersian, letter.position, letter.variant, kLower);
+            return;
+        }
+    }
+    key.AddOther(ToLower(c), IsUpper(c) ? kUpper : kLower);
+}
+
+// Primary weight of an ASCII byte as one number, for CollationCompare's fast path.
+uint16_t AsciiPrimary(unsigned char c) {
+    if (c >= 'a' && c <= 'z') {
+        return static_cast<uint16_t>(kLatin << 8 | (c - 'a'));
+    }
+    if (c >= 'A' && c <= 'Z') {
+        return static_cast<uint16_t>(kLatin << 8 | (c - 'A'));
+    }
+    if (c >= '0' && c <= '9') {
+        return static_cast<uint16_t>(kDigit << 8 | (c - '0'));
+    }
+    return static_cast<uint16_t>(kPunctuation << 8 | c);
+}
+
+bool IsAscii(std::string_view text) {
+    for (char c : text) {
+        if (static_cast<unsigned char>(c) >= 0x80) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int CollationCallback(void*, int lengthA, const void* a, int lengthB, const void* b) {
+    return CollationCompare(std::string_view(static_cast<const char*>(a), static_cast<size_t>(lengthA)),
+                            std::string_view(static_cast<const char*>(b), static_cast<size_t>(lengthB)));
+}
+
+void FoldFunction(sqlite3_context* context, int, sqlite3_value** argv) {
+    const unsigned char* text = sqlite3_value_text(argv[0]);
+    if (!text) {
+        sqlite3_result_null(context);
+        return;
+    }
+    std::string folded = FoldCase(std::string_view(reinterpret_cast<const char*>(text),
+                                                   static_cast<size_t>(sqlite3_value_bytes(argv[0]))));
+    sqlite3_result_text(context, folded.data(), static_cast<int>(folded.size()), SQLITE_TRANSIENT);
+}
+
+} // namespace
+
+std::string FoldCase(std::string_view utf8) {
+    std::string folded;
+    folded.reserve(utf8.size());
+    size_t i = 0;
+    while (i < utf8.size()) {
+        unsigned char byte = static_cast<unsigned char>(utf8[i]);
+        if (byte < 0x80) {
+            folded += static_cast<char>(byte >= 'A' && byte <= 'Z' ? byte + 0x20 : byte);
+            ++i;
+            continue;
+        }
+        char32_t c = DecodeUtf8(utf8, i);
+        if (IsIgnorable(c) && !(c >= 0x0300 && c <= 0x036F)) {
+            continue; // Combining accents are kept: folding does not strip accents
+        }
+        int digit = ScriptDigit(c);
+        if (digit >= 0) {
+            folded += static_cast<char>('0' + digit);
+            continue;
+        }
+        if (c >= 0x0600 && c <= 0x06FF) {
+            int index = PersianTable()[c - 0x0600];
+            AppendUtf8(index >= 0 ? kPersianLetters[index].folded : c, folded);
+            continue;
+        }
+        if (c == 0xDF) {
+            folded += "ss";
+            continue;
+        }
+        AppendUtf8(ToLower(c), folded);
+    }
+    return folded;
+}
+
+void AppendCollationKey(std::string_view utf8, std::string& key) {
+    // Lower levels are collected on the side and appended after the primary weights
+    thread_local std::string secondary;
+    thread_local std::string tertiary;
+    secondary.clear();
+    tertiary.clear();
+    KeyBuilder builder{key, secondary, tertiary};
+    size_t i = 0;
+    while (i < utf8.size()) {
+        unsigned char byte = static_cast<unsigned char>(utf8[i]);
+        if (byte < 0x80) {
+            AddWeights(byte, builder);
+            ++i;
+        } else {
+            AddWeights(DecodeUtf8(utf8, i), builder);
+        }
+    }
+    key += kLevelSeparator;
+    key += secondary;
+    key += kLevelSeparator;
+    key += tertiary;
+}
+
+std::string CollationKey(std::string_view utf8) {
+    std::string key;
+    key.reserve(utf8.size() * 4 + 2);
+    AppendCollationKey(utf8, key);
+    return key;
+}
+
+int CollationCompare(std::string_view a, std::string_view b) {
+    if (IsAscii(a) && IsAscii(b)) {
+        // One weight per byte and no accents: compare primaries, then lengths, then case.
+        size_t common = std::min(a.size(), b.size());
+        for (size_t i = 0; i < common; ++i) {
+            uint16_t wa = AsciiPrimary(static_cast<unsigned char>(a[i]));
+            uint16_t wb = AsciiPrimary(static_cast<unsigned char>(b[i]));
+            if (wa != wb) {
+                return wa < wb ? -1 : 1;
+            }
+        }
+        if (a.size() != b.size()) {
+            return a.size() < b.size() ? -1 : 1;
+        }
+        for (size_t i = 0; i < common; ++i) {
+            bool upperA = a[i] >= 'A' && a[i] <= 'Z';
+            bool upperB = b[i] >= 'A' && b[i] <= 'Z';
+            if (upperA != upperB) {
+                return upperA ? 1 : -1;
+            }
+        }
+        return 0;
+    }
+    // Keys are rebuilt per comparison here; bulk sorts should precompute them instead.
+    thread_local std::string keyA;
+    thread_local std::string keyB;
+    keyA.clear();
+    keyB.clear();
+    AppendCollationKey(a, keyA);
+    AppendCollationKey(b, keyB);
+    int order = keyA.compare(keyB);
+    return order < 0 ? -1 : order > 0 ? 1 : 0;
+}
+
+bool RegisterCollation(sqlite3* db) {
+    return sqlite3_create_collation_v2(db, kPhonebookCollation, SQLITE_UTF8, nullptr, &CollationCallback,
+                                       nullptr) == SQLITE_OK &&
+           sqlite3_create_function_v2(db, "fold", 1, SQLITE_UTF8 | SQLITE_DETERMINISTIC, nullptr, &FoldFunction,
+                                      nullptr, nullptr, nullptr) == SQLITE_OK;
+}
@@ -0,0 +1,42 @@
+#ifndef COLLATION_HPP
+#define COLLATION_HPP
+
+#include <string>
+#include <string_view>
+#include <sqlite3.h>
+
+// Table-driven Unicode case folding and collation for contact names, covering the
+// scripts of our books (Latin incl. German, Persian/Arabic, Greek, Cyrillic) without
+// a dependency on ICU. Everything works on UTF-8; invalid bytes count as U+FFFD.
+
+// Name of the SQLite collation registered by RegisterCollation ("ORDER BY name COLLATE PHONEBOOK").
+constexpr const char* kPhonebookCollation = "PHONEBOOK";
+
+// Folds 'utf8' for case-insensitive matching: Latin, Greek and Cyrillic letters are
+// lower-cased, "ß" becomes "ss", Arabic letter variants become their Persian forms
+// (ي/ى/ئ -> ی, ك -> ک, أ/إ/آ -> ا, ة/ۀ -> ه, ؤ -> و), Persian and Arabic-Indic digits
+// become ASCII digits, and harakat, tatweel and ZWNJ are dropped. ASCII input is
+// lower-cased in place without decoding.
+std::string FoldCase(std::string_view utf8);
+
+// Sort key for 'utf8': comparing keys with memcmp (std::string operator<) gives the
+// collation order, so a list can be sorted with one key per element instead of a
+// Unicode comparison per pair. Three levels, as in the Unicode Collation Algorithm:
+//  1. base letters: case and accents ignored, German umlauts sort as their base
+//     vowel and "ß" as "ss" (DIN 5007-1), Persian letters in alphabet order
+//     (آ ا ب پ ت ... ک گ ... و ه ی) with Arabic variants on their Persian letter;
+//     punctuation and spaces < digits < Latin < Persian < other scripts
+//  2. accents and letter variants ("Muller" < "Müller")
+//  3. case (lower before upper)
+std::string CollationKey(std::string_view utf8);
+// Appends the key to 'key' (reuses its capacity).
+void AppendCollationKey(std::string_view utf8, std::string& key);
+
+// Same order as comparing collation keys (<0, 0, >0), without allocating for ASCII.
+int CollationCompare(std::string_view a, std::string_view b);
+
+// Registers the PHONEBOOK collation and the SQL function fold(text) (FoldCase) on 'db'.
+// Needed on every connection that runs the logic layer's queries.
+bool RegisterCollation(sqlite3* db);
+
+#endif // COLLATION_HPP
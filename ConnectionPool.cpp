@@ -0,0 +1,181 @@
+#include "ConnectionPool.hpp"
+#include <algorithm>
+#include <chrono>
+
+ConnectionPool::Lease::Lease(ConnectionPool* pool, std::unique_ptr<PooledConnection> connection)
+    : pool(pool), connection(std::move(connection)) {}
+
+ConnectionPool::Lease::Lease(Lease&& other) noexcept
+    : pool(other.pool), connection(std::move(other.connection)), used(std::move(other.used)) {
+    other.pool = nullptr;
+}
+
+ConnectionPool::Lease& ConnectionPool::Lease::operator=(Lease&& other) noexcept {
+    if (this != &other) {
+        Release();
+        pool = other.pool;
+        connection = std::move(other.connection);
+        used = std::move(other.used);
+        other.pool = nullptr;
+    }
+    return *this;
+}
+
+ConnectionPool::Lease::~Lease() {
+    Release();
+}
+
+void ConnectionPool::Lease::Release() {
+    if (!connection) {
+        return;
+    }
+    // Resetting ends any read transaction still open on the connection, so an idle
+    // pooled connection never holds back a WAL checkpoint.
+    for (sqlite3_stmt* stmt : used) {
+        sqlite3_reset(stmt);
+        sqlite3_clear_bindings(stmt);
+    }
+    used.clear();
+    pool->CheckIn(std::move(connection));
+    pool = nullptr;
+}
+
+sqlite3_stmt* ConnectionPool::Lease::Prepare(const char* sql) {
+    if (!connection) {
+        return nullptr;
+    }
+    auto it = connection->statements.find(sql);
+    if (it != connection->statements.end()) {
+        sqlite3_reset(it->second);
+        sqlite3_clear_bindings(it->second);
+        used.push_back(it->second);
+        pool->statementCacheHits.fetch_add(1, std::memory_order_relaxed);
+        return it->second;
+    }
+
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v3(connection->db, sql, -1, SQLITE_PREPARE_PERSISTENT, &stmt, nullptr) != SQLITE_OK) {
+        return nullptr;
+    }
+    connection->statements.emplace(sql, stmt);
+    used.push_back(stmt);
+    pool->statementCacheMisses.fetch_add(1, std::memory_order_relaxed);
+    return stmt;
+}
+
+ConnectionPool::ConnectionPool(const std::string& dbPath, size_t capacity)
+    : databasePath(dbPath), capacity(std::max<size_t>(capacity, 1)) {}
+
+ConnectionPool::~ConnectionPool() {
+    // All leases must have been returned by now.
+    for (auto& connection : idle) {
+        CloseConnection(*connection);
+    }
+}
+
+ConnectionPool::Lease ConnectionPool::Checkout() {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    if (idle.empty() && opened >= capacity) {
+        auto waitStart = std::chrono::steady_clock::now();
+        available.wait(lock, [this]() { return !idle.empty() || opened < capacity; });
+        auto waited = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - waitStart).count());
+        ++stats.waits;
+        stats.totalWaitNanos += waited;
+        stats.maxWaitNanos = std::max(stats.maxWaitNanos, waited);
+    }
+
+    if (!idle.empty()) {
+        std::unique_ptr<PooledConnection> connection = std::move(idle.back());
+        idle.pop_back();
+        ++stats.checkouts;
+        uint64_t generation = configGeneration;
+        lock.unlock();
+        Configure(*connection, generation);
+        return Lease(this, std::move(connection));
+    }
+
+    // Reserve a slot and open the connection outside the lock.
+    ++opened;
+    lock.unlock();
+
+    auto connection = std::make_unique<PooledConnection>();
+    int rc = sqlite3_open_v2(databasePath.c_str(), &connection->db,
+                             SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, nullptr);
+    if (rc != SQLITE_OK) {
+        std::string error = sqlite3_errmsg(connection->db);
+        sqlite3_close(connection->db);
+        lock.lock();
+        --opened;
+        lastError = error;
+        available.notify_one();
+        return Lease();
+    }
+    sqlite3_busy_timeout(connection->db, 5000);
+    if (connectionInitializer) {
+        connectionInitializer(connection->db);
+    }
+
+    lock.lock();
+    ++stats.checkouts;
+    uint64_t generation = configGeneration;
+    lock.unlock();
+    Configure(*connection, generation);
+    return Lease(this, std::move(connection));
+}
+
+void ConnectionPool::Configure(PooledConnection& connection, uint64_t generation) {
+    if (connection.configuredGeneration != generation) {
+        if (connectionConfigurator) {
+            connectionConfigurator(connection.db);
+        }
+        connection.configuredGeneration = generation;
+    }
+}
+
+void ConnectionPool::CheckIn(std::unique_ptr<PooledConnection> connection) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        idle.push_back(std::move(connection));
+    }
+    available.notify_one();
+}
+
+ConnectionPoolStats ConnectionPool::GetStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    ConnectionPoolStats result = stats;
+    result.opened = opened;
+    result.idle = idle.size();
+    result.capacity = capacity;
+    result.statementCacheHits = statementCacheHits.load(std::memory_order_relaxed);
+    result.statementCacheMisses = statementCacheMisses.load(std::memory_order_relaxed);
+    return result;
+}
+
+void ConnectionPool::SetConnectionInitializer(std::function<void(sqlite3*)> initializer) {
+    connectionInitializer = std::move(initializer);
+}
+
+void ConnectionPool::SetConnectionConfigurator(std::function<void(sqlite3*)> configurator) {
+    connectionConfigurator = std::move(configurator);
+}
+
+void ConnectionPool::Reconfigure() {
+    std::lock_guard<std::mutex> lock(mutex);
+    ++configGeneration;
+}
+
+std::string ConnectionPool::GetLastError() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return lastError;
+}
+
+void ConnectionPool::CloseConnection(PooledConnection& connection) {
+    for (auto& entry : connection.statements) {
+        sqlite3_finalize(entry.second);
+    }
+    connection.statements.clear();
+    sqlite3_close(connection.db);
+    connection.db = nullptr;
+}
@@ -0,0 +1,115 @@
+#ifndef CONNECTIONPOOL_HPP
+#define CONNECTIONPOOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <sqlite3.h>
+
+// Counters describing how the read pool is used (all values are totals since creation).
+struct ConnectionPoolStats {
+    uint64_t checkouts = 0;          // Number of successful Checkout() calls
+    uint64_t waits = 0;              // Checkouts that had to wait for a free connection
+    uint64_t totalWaitNanos = 0;     // Time spent waiting, summed over all checkouts
+    uint64_t maxWaitNanos = 0;       // Longest single wait
+    uint64_t statementCacheHits = 0; // Prepare() calls served from a connection's cache
+    uint64_t statementCacheMisses = 0;
+    size_t opened = 0;               // Connections currently open
+    size_t idle = 0;                 // Connections currently checked in
+    size_t capacity = 0;             // Upper bound on open connections
+};
+
+// Bounded pool of read-only SQLite connections.
+// Connections are opened lazily (up to 'capacity') with SQLITE_OPEN_READONLY |
+// SQLITE_OPEN_NOMUTEX; a connection is only ever used by the thread holding its
+// lease, so SQLite's internal mutex is not needed. Each connection keeps its own
+// cache of prepared statements keyed by SQL text.
+class ConnectionPool {
+private:
+    struct PooledConnection {
+        sqlite3* db = nullptr;
+        std::unordered_map<std::string, sqlite3_stmt*> statements;
+        uint64_t configuredGeneration = 0; // Reconfigure() generation last applied
+    };
+
+public:
+    // RAII handle for a checked-out connection; returns it to the pool on destruction.
+    class Lease {
+    public:
+        Lease() = default;
+        Lease(Lease&& other) noexcept;
+        Lease& operator=(Lease&& other) noexcept;
+        ~Lease();
+
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+
+        explicit operator bool() const { return connection != nullptr; }
+        sqlite3* Get() const { return connection ? connection->db : nullptr; }
+
+        // Returns a reset, unbound statement for 'sql' from this connection's cache,
+        // preparing it on first use. The statement is owned by the pool: do not finalize it.
+        sqlite3_stmt* Prepare(const char* sql);
+
+    private:
+        friend class ConnectionPool;
+        Lease(ConnectionPool* pool, std::unique_ptr<PooledConnection> connection);
+        void Release();
+
+        ConnectionPool* pool = nullptr;
+        std::unique_ptr<PooledConnection> connection;
+        std::vector<sqlite3_stmt*> used; // Statements to reset when the lease ends
+    };
+
+    ConnectionPool(const std::string& dbPath, size_t capacity);
+    ~ConnectionPool();
+
+    ConnectionPool(const ConnectionPool&) = delete;
+    ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+    // Blocks until a connection is available. Returns an empty lease if a new
+    // connection had to be opened and that failed (see GetLastError()).
+    Lease Checkout();
+
+    ConnectionPoolStats GetStats() const;
+    std::string GetLastError() const;
+
+    // Called once for every newly opened connection (e.g. to register functions).
+    // Set it before the first Checkout().
+    void SetConnectionInitializer(std::function<void(sqlite3*)> initializer);
+    // Called for a connection on its first checkout and again on the first checkout
+    // after each Reconfigure(), by the checking-out thread while no one else uses the
+    // connection (e.g. to install or remove trace hooks). Set it before the first Checkout().
+    void SetConnectionConfigurator(std::function<void(sqlite3*)> configurator);
+    void Reconfigure();
+
+private:
+    void CheckIn(std::unique_ptr<PooledConnection> connection);
+    // Runs the configurator if 'connection' has not seen 'generation' yet
+    void Configure(PooledConnection& connection, uint64_t generation);
+    static void CloseConnection(PooledConnection& connection);
+
+    std::string databasePath;
+    size_t capacity;
+    std::function<void(sqlite3*)> connectionInitializer;
+    std::function<void(sqlite3*)> connectionConfigurator;
+
+    mutable std::mutex mutex;
+    std::condition_variable available;
+    std::vector<std::unique_ptr<PooledConnection>> idle;
+    size_t opened = 0;
+    uint64_t configGeneration = 1;
+    std::string lastError;
+    ConnectionPoolStats stats; // Guarded by 'mutex', except the statement cache counters below
+    // Counted by Prepare() on every query, so they stay off the pool mutex
+    std::atomic<uint64_t> statementCacheHits{0};
+    std::atomic<uint64_t> statementCacheMisses{0};
+};
+
+#endif // CONNECTIONPOOL_HPP
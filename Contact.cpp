@@ -1,94 +1,53 @@
 #include "Contact.hpp"
-#include <wx/log.h> // For logging errors, useful for debugging
-#include <cctype>   // For isdigit
+#include "CoreLog.hpp" // For logging errors, useful for debugging
+#include <utility>
 
 Contact::Contact() {}
 
-Contact::Contact(const wxString& name, const wxString& phone, const wxString& email)
-    : name(name), phone(phone), email(email) {}
+Contact::Contact(std::string name, std::string phone, std::string email)
+    : name(std::move(name)), phone(std::move(phone)), email(std::move(email)) {}
 
-wxString Contact::GetName() const {
-    return name;
-}
-
-wxString Contact::GetPhone() const {
-    return phone;
-}
-
-wxString Contact::GetEmail() const {
-    return email;
-}
-
-bool Contact::SetName(const wxString& name) {
-    if (name.IsEmpty()) {
-        wxLogError("Name cannot be empty.");
+bool Contact::SetName(const std::string& name) {
+    if (name.empty()) {
+        LogError("Name cannot be empty.");
         return false;
     }
     this->name = name;
     return true;
 }
 
-bool Contact::SetPhone(const wxString& phone) {
+bool Contact::SetPhone(const std::string& phone) {
     if (IsValidPhone(phone)) {
         this->phone = phone;
         return true;
     }
     // Log an error if validation fails
-    wxLogError("Invalid phone number: '%s'. Phone must be at least 11 digits and contain only numbers.", phone);
+    LogError("Invalid phone number: '%s'. Phone must be at least 11 digits and contain only numbers.", phone.c_str());
     return false;
 }
 
-bool Contact::SetEmail(const wxString& email) {
+bool Contact::SetEmail(const std::string& email) {
     if (IsValidEmail(email)) {
         this->email = email;
         return true;
     }
     // Log an error if validation fails
-    wxLogError("Invalid email: '%s'. Email must be empty or contain '@' and '.' after '@'.", email);
+    LogError("Invalid email: '%s'. Email must be empty or contain '@' and '.' after '@'.", email.c_str());
     return false;
 }
 
 // --- Validation Implementations ---
 
-bool Contact::IsValidPhone(const wxString& phone) const {
-    // 1. Phone number must be at least 11 characters
-    if (phone.Length() < 11) {
-        return false;
-    }
-
-    // 2. All characters must be digits
-    for (wxChar c : phone) {
-        if (!wxIsdigit(c)) { // Use wxIsdigit for wxChar
-            return false;
-        }
-    }
-
-    return true;
+bool Contact::IsValidPhone(const std::string& phone) const {
+    // At least 11 characters, all digits (see ContactValidation.hpp)
+    return ValidatePhone(phone) == kContactFieldsValid;
 }
 
-bool Contact::IsValidEmail(const wxString& email) const {
-    // If email is empty, it's considered valid (as per your requirement "if it is not empty")
-    if (email.IsEmpty()) {
-        return true;
-    }
-
-    // Must contain '@' and '.'
-    int atPos = email.Find('@');
-    if (atPos == wxNOT_FOUND || atPos == 0 || atPos == email.Length() - 1) {
-        // No '@' found, or '@' is at the beginning, or '@' is at the end
-        return false;
-    }
-
-    int dotPos = email.Find('.', atPos + 1); // Find '.' after '@'
-    if (dotPos == wxNOT_FOUND || dotPos == atPos + 1 || dotPos == email.Length() - 1) {
-        // No '.' found after '@', or '.' is immediately after '@', or '.' is at the end
-        return false;
-    }
-
-    // Optional: Check for spaces (emails shouldn't have spaces)
-    if (email.Contains(' ')) {
-        return false;
-    }
+bool Contact::IsValidEmail(const std::string& email) const {
+    // Empty, or '@' and a '.' after it, without spaces (see ContactValidation.hpp)
+    return ValidateEmail(email) == kContactFieldsValid;
+}
 
-    return true;
+uint32_t Contact::Validate() const {
+    return ValidateContactFields(name, phone, email);
 }
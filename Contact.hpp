@@ -2,30 +2,39 @@
 #define CONTACT_HPP
 
 #pragma once
-#include <wx/string.h>
+#include <cstdint>
+#include <string>
+#include "ContactValidation.hpp"
 
+// One phone book entry. Fields are UTF-8, exactly as stored in SQLite, so the core
+// never converts strings on a bind or a column read (the GUI converts at its edge,
+// see WxAdapter.hpp).
 class Contact {
 public:
     Contact();
-    Contact(const wxString& name, const wxString& phone, const wxString& email);
+    Contact(std::string name, std::string phone, std::string email);
 
-    wxString GetName() const;
-    wxString GetPhone() const;
-    wxString GetEmail() const;
+    const std::string& GetName() const { return name; }
+    const std::string& GetPhone() const { return phone; }
+    const std::string& GetEmail() const { return email; }
 
     // Use a return type (e.g., bool) to indicate success/failure of setting
-    bool SetName(const wxString& name);
-    bool SetPhone(const wxString& phone); // Now returns bool
-    bool SetEmail(const wxString& email); // Now returns bool
+    bool SetName(const std::string& name);
+    bool SetPhone(const std::string& phone); // Now returns bool
+    bool SetEmail(const std::string& email); // Now returns bool
 
     // New validation methods
-    bool IsValidPhone(const wxString& phone) const;
-    bool IsValidEmail(const wxString& email) const;
+    bool IsValidPhone(const std::string& phone) const;
+    bool IsValidEmail(const std::string& email) const;
+
+    // ContactFieldError bits for all three fields, found in one pass over each; unlike
+    // the setters this never logs, so it is cheap enough for bulk imports.
+    uint32_t Validate() const;
 
 private:
-    wxString name;
-    wxString phone;
-    wxString email;
+    std::string name;
+    std::string phone;
+    std::string email;
 };
 
 #endif // CONTACT_HPP
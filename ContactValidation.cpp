@@ -0,0 +1,194 @@
+#include "ContactValidation.hpp"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// Number of leading bytes of 'bytes' that are ASCII.
+size_t AsciiPrefixLength(std::string_view bytes) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    for (; i + 16 <= bytes.size(); i += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes.data() + i));
+        if (_mm_movemask_epi8(chunk) != 0) {
+            break; // Some byte has its high bit set
+        }
+    }
+#endif
+    while (i < bytes.size() && static_cast<unsigned char>(bytes[i]) < 0x80) {
+        ++i;
+    }
+    return i;
+}
+
+// Characters in 'bytes', counting every byte that does not continue a sequence.
+size_t CodePointCount(std::string_view bytes) {
+    size_t count = 0;
+    for (char c : bytes) {
+        count += (static_cast<unsigned char>(c) & 0xC0) != 0x80;
+    }
+    return count;
+}
+
+} // namespace
+
+bool IsAsciiDigits(std::string_view bytes) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    // c is a digit iff (c - '0') < 10 unsigned; SSE2 only compares signed bytes, so
+    // both sides are shifted by 0x80 first.
+    const __m128i zero = _mm_set1_epi8('0');
+    const __m128i limit = _mm_set1_epi8(static_cast<char>(10 ^ 0x80));
+    const __m128i bias = _mm_set1_epi8(static_cast<char>(0x80));
+    for (; i + 16 <= bytes.size(); i += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes.data() + i));
+        __m128i shifted = _mm_xor_si128(_mm_sub_epi8(chunk, zero), bias);
+        if (_mm_movemask_epi8(_mm_cmplt_epi8(shifted, limit)) != 0xFFFF) {
+            return false;
+        }
+    }
+#endif
+    for (; i < bytes.size(); ++i) {
+        if (static_cast<unsigned char>(bytes[i] - '0') >= 10) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool IsValidUtf8(std::string_view bytes) {
+    size_t i = AsciiPrefixLength(bytes);
+    while (i < bytes.size()) {
+        unsigned char lead = static_cast<unsigned char>(bytes[i]);
+        if (lead < 0x80) {
+            i += AsciiPrefixLength(bytes.substr(i));
+            continue;
+        }
+        // Allowed range of the second byte rules out overlong forms and surrogates
+        // (Unicode table 3-7); later continuation bytes are always 80..BF.
+        size_t length = 0;
+        unsigned char low = 0x80, high = 0xBF;
+        if (lead >= 0xC2 && lead <= 0xDF) {
+            length = 2;
+        } else if (lead >= 0xE0 && lead <= 0xEF) {
+            length = 3;
+            low = lead == 0xE0 ? 0xA0 : 0x80;
+            high = lead == 0xED ? 0x9F : 0xBF;
+        } else if (lead >= 0xF0 && lead <= 0xF4) {
+            length = 4;
+            low = lead == 0xF0 ? 0x90 : 0x80;
+            high = lead == 0xF4 ? 0x8F : 0xBF;
+        } else {
+            return false;
+        }
+        if (bytes.size() - i < length) {
+            return false;
+        }
+        unsigned char second = static_cast<unsigned char>(bytes[i + 1]);
+        if (second < low || second > high) {
+            return false;
+        }
+        for (size_t k = 2; k < length; ++k) {
+            if ((static_cast<unsigned char>(bytes[i + k]) & 0xC0) != 0x80) {
+                return false;
+            }
+        }
+        i += length;
+    }
+    return true;
+}
+
+uint32_t ValidateName(std::string_view name) {
+    if (name.empty()) {
+        return kNameEmpty;
+    }
+    return IsValidUtf8(name) ? kContactFieldsValid : kNameInvalidUtf8;
+}
+
+uint32_t ValidatePhone(std::string_view phone) {
+    if (IsAsciiDigits(phone)) {
+        return phone.size() < kMinPhoneLength ? kPhoneTooShort : kContactFieldsValid;
+    }
+    // Rare path: the length rule counts characters, not bytes
+    uint32_t errors = kPhoneNotDigits;
+    if (CodePointCount(phone) < kMinPhoneLength) {
+        errors |= kPhoneTooShort;
+    }
+    return errors;
+}
+
+uint32_t ValidateEmail(std::string_view email) {
+    if (email.empty()) {
+        return kContactFieldsValid; // E-mail is optional
+    }
+    // One pass records everything the rules need. '@', '.' and ' ' never occur
+    // inside a multi-byte UTF-8 sequence, so byte positions work like characters.
+    const size_t npos = std::string_view::npos;
+    size_t at = npos;
+    size_t dot = npos; // First '.' after the first '@'
+    bool space = false;
+    bool ascii = true;
+    for (size_t i = 0; i < email.size(); ++i) {
+        char c = email[i];
+        if (c == '@') {
+            if (at == npos) {
+                at = i;
+            }
+        } else if (c == '.') {
+            if (at != npos && dot == npos) {
+                dot = i;
+            }
+        } else if (c == ' ') {
+            space = true;
+        } else if (static_cast<unsigned char>(c) >= 0x80) {
+            ascii = false;
+        }
+    }
+
+    uint32_t errors = kContactFieldsValid;
+    size_t last = email.size() - 1;
+    if (at == npos || at == 0 || at == last) {
+        errors |= kEmailMissingAt;
+    }
+    if (at != npos && (dot == npos || dot == at + 1 || dot == last)) {
+        errors |= kEmailMissingDot;
+    }
+    if (space) {
+        errors |= kEmailHasSpace;
+    }
+    if (!ascii && !IsValidUtf8(email)) {
+        errors |= kEmailInvalidUtf8;
+    }
+    return errors;
+}
+
+uint32_t ValidateContactFields(std::string_view name, std::string_view phone, std::string_view email) {
+    return ValidateName(name) | ValidatePhone(phone) | ValidateEmail(email);
+}
+
+std::string DescribeContactErrors(uint32_t errors) {
+    static const struct {
+        ContactFieldError error;
+        const char* text;
+    } kMessages[] = {
+        {kNameEmpty, "name is empty"},
+        {kNameInvalidUtf8, "name is not valid UTF-8"},
+        {kPhoneTooShort, "phone has fewer than 11 digits"},
+        {kPhoneNotDigits, "phone contains characters other than digits"},
+        {kEmailMissingAt, "email has no '@' between its first and last character"},
+        {kEmailMissingDot, "email has no '.' after the '@'"},
+        {kEmailHasSpace, "email contains a space"},
+        {kEmailInvalidUtf8, "email is not valid UTF-8"},
+    };
+    std::string description;
+    for (const auto& message : kMessages) {
+        if (errors & message.error) {
+            if (!description.empty()) {
+                description += "; ";
+            }
+            description += message.text;
+        }
+    }
+    return description;
+}
@@ -0,0 +1,44 @@
+#ifndef CONTACTVALIDATION_HPP
+#define CONTACTVALIDATION_HPP
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Byte-level validation of contact fields given as UTF-8. Every field is checked in a
+// single pass and all problems are reported at once as a bit set, without logging, so
+// bulk imports can validate millions of rows and report them however they like.
+// The rules are the ones Contact has always applied:
+//  - name: not empty
+//  - phone: at least 11 characters, all of them ASCII digits
+//  - email: empty, or '@' neither first nor last, followed by a '.' that is neither
+//    right after the '@' nor last, and no spaces
+// and additionally every field must be well-formed UTF-8.
+enum ContactFieldError : uint32_t {
+    kContactFieldsValid = 0,
+    kNameEmpty = 1u << 0,
+    kNameInvalidUtf8 = 1u << 1,
+    kPhoneTooShort = 1u << 2,
+    kPhoneNotDigits = 1u << 3,    // Also set for malformed UTF-8
+    kEmailMissingAt = 1u << 4,    // No '@', or '@' first or last
+    kEmailMissingDot = 1u << 5,   // No '.' after the '@', or right after it, or last
+    kEmailHasSpace = 1u << 6,
+    kEmailInvalidUtf8 = 1u << 7
+};
+
+// Minimum number of characters in a phone number.
+constexpr size_t kMinPhoneLength = 11;
+
+uint32_t ValidateName(std::string_view name);
+uint32_t ValidatePhone(std::string_view phone);
+uint32_t ValidateEmail(std::string_view email);
+uint32_t ValidateContactFields(std::string_view name, std::string_view phone, std::string_view email);
+
+// Human-readable list of the problems in 'errors' ("phone has fewer than 11 digits; ...").
+std::string DescribeContactErrors(uint32_t errors);
+
+// Building blocks, 16 bytes per step where SSE2 is available.
+bool IsAsciiDigits(std::string_view bytes);
+bool IsValidUtf8(std::string_view bytes);
+
+#endif // CONTACTVALIDATION_HPP
@@ -0,0 +1,70 @@
+#include "CoreLog.hpp"
+#include <cstdarg>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+
+namespace {
+
+std::mutex sinkMutex;
+std::shared_ptr<const LogSink> currentSink; // Null = stderr
+
+void WriteToStderr(LogLevel level, const std::string& text) {
+    std::fprintf(stderr, "%s%s\n", level == LogLevel::Error ? "Error: " : "", text.c_str());
+}
+
+void Dispatch(LogLevel level, const char* format, va_list args) {
+    va_list copy;
+    va_copy(copy, args);
+    char buffer[512];
+    int length = std::vsnprintf(buffer, sizeof(buffer), format, copy);
+    va_end(copy);
+    if (length < 0) {
+        return;
+    }
+    std::string text;
+    if (static_cast<size_t>(length) < sizeof(buffer)) {
+        text.assign(buffer, static_cast<size_t>(length));
+    } else {
+        text.resize(static_cast<size_t>(length) + 1);
+        std::vsnprintf(text.data(), text.size(), format, args);
+        text.resize(static_cast<size_t>(length));
+    }
+
+    std::shared_ptr<const LogSink> sink;
+    {
+        std::lock_guard<std::mutex> lock(sinkMutex);
+        sink = currentSink;
+    }
+    // Called without the lock, so a sink may log or replace itself
+    if (sink) {
+        (*sink)(level, text);
+    } else {
+        WriteToStderr(level, text);
+    }
+}
+
+} // namespace
+
+void SetLogSink(LogSink sink) {
+    std::shared_ptr<const LogSink> replacement;
+    if (sink) {
+        replacement = std::make_shared<const LogSink>(std::move(sink));
+    }
+    std::lock_guard<std::mutex> lock(sinkMutex);
+    currentSink = std::move(replacement);
+}
+
+void LogError(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    Dispatch(LogLevel::Error, format, args);
+    va_end(args);
+}
+
+void LogMessage(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    Dispatch(LogLevel::Message, format, args);
+    va_end(args);
+}
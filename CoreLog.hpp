@@ -0,0 +1,31 @@
+#ifndef CORELOG_HPP
+#define CORELOG_HPP
+
+#include <functional>
+#include <string>
+
+// Logging for phonebook_core, which must not depend on wxWidgets. The core reports
+// through LogError/LogMessage (printf-style, UTF-8); where the text ends up is decided
+// by the program: by default errors and messages go to stderr, the GUI routes them to
+// wxLog (see WxAdapter.hpp) and tools may install their own sink or silence it.
+
+enum class LogLevel {
+    Message,
+    Error
+};
+
+using LogSink = std::function<void(LogLevel level, const std::string& text)>;
+
+// Replaces the sink for all threads; an empty function restores the stderr default.
+void SetLogSink(LogSink sink);
+
+#if defined(__GNUC__)
+#define PHONEBOOK_PRINTF_FORMAT __attribute__((format(printf, 1, 2)))
+#else
+#define PHONEBOOK_PRINTF_FORMAT
+#endif
+
+void LogError(const char* format, ...) PHONEBOOK_PRINTF_FORMAT;
+void LogMessage(const char* format, ...) PHONEBOOK_PRINTF_FORMAT;
+
+#endif // CORELOG_HPP
@@ -0,0 +1,97 @@
+#include "DatabaseWatcher.hpp"
+#include "CoreLog.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+DatabaseWatcher::DatabaseWatcher(const std::string& dbPath, std::function<void()> onChange,
+                                 std::chrono::milliseconds interval)
+    : onChange(std::move(onChange)), interval(interval) {
+    size_t slash = dbPath.rfind('/');
+    std::string directory = slash == std::string::npos ? "." : slash == 0 ? "/" : dbPath.substr(0, slash);
+    fileName = slash == std::string::npos ? dbPath : dbPath.substr(slash + 1);
+
+    stopFd = eventfd(0, EFD_CLOEXEC);
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    // The directory, not the file: SQLite creates and deletes the -wal/-journal files,
+    // and tools that replace contacts.db by rename would leave a file watch behind
+    if (inotifyFd >= 0 &&
+        inotify_add_watch(inotifyFd, directory.c_str(), IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0) {
+        LogError("Cannot watch %s: %s (polling every %lld ms)", directory.c_str(), std::strerror(errno),
+                 static_cast<long long>(interval.count()));
+        close(inotifyFd);
+        inotifyFd = -1;
+    }
+    worker = std::thread(&DatabaseWatcher::Run, this);
+}
+
+DatabaseWatcher::~DatabaseWatcher() {
+    uint64_t one = 1;
+    if (stopFd < 0 || write(stopFd, &one, sizeof(one)) != sizeof(one)) {
+        LogError("Cannot signal the database watcher to stop");
+    }
+    worker.join();
+    if (inotifyFd >= 0) {
+        close(inotifyFd);
+    }
+    if (stopFd >= 0) {
+        close(stopFd);
+    }
+}
+
+bool DatabaseWatcher::ReadEvents() {
+    alignas(inotify_event) char buffer[4096];
+    bool relevant = false;
+    ssize_t length;
+    while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0) {
+        for (ssize_t offset = 0; offset < length;) {
+            const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+            if (event->len == 0) {
+                continue;
+            }
+            std::string name(event->name); // NUL-padded to 'len'
+            if (name.compare(0, fileName.size(), fileName) != 0) {
+                continue;
+            }
+            std::string suffix = name.substr(fileName.size());
+            relevant = relevant || suffix.empty() || suffix == "-wal" || suffix == "-journal";
+        }
+    }
+    if (length < 0 && errno != EAGAIN && errno != EINTR) {
+        LogError("Reading inotify events failed: %s", std::strerror(errno));
+    }
+    return relevant;
+}
+
+void DatabaseWatcher::Run() {
+    pollfd fds[2] = {{stopFd, POLLIN, 0}, {inotifyFd, POLLIN, 0}};
+    nfds_t count = inotifyFd >= 0 ? 2 : 1;
+    auto nextPoll = std::chrono::steady_clock::now() + interval;
+    for (;;) {
+        auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(nextPoll - std::chrono::steady_clock::now());
+        int ready = poll(fds, count, static_cast<int>(std::max<long long>(0, wait.count())));
+        if (ready < 0 && errno != EINTR) {
+            LogError("Database watcher poll failed: %s", std::strerror(errno));
+            return;
+        }
+        if (fds[0].revents & POLLIN) {
+            return;
+        }
+        bool changed = false;
+        if (count == 2 && (fds[1].revents & POLLIN)) {
+            changed = ReadEvents();
+        }
+        if (std::chrono::steady_clock::now() >= nextPoll) {
+            changed = true;
+        }
+        if (changed) {
+            onChange();
+            nextPoll = std::chrono::steady_clock::now() + interval;
+        }
+    }
+}
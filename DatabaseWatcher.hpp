@@ -0,0 +1,43 @@
+#ifndef DATABASEWATCHER_HPP
+#define DATABASEWATCHER_HPP
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <thread>
+
+// Calls 'onChange' on a background thread when another process may have written the
+// SQLite file at 'dbPath'. The directory is watched with inotify for writes to the
+// database, its -wal and its -journal file (the -shm index is touched by every reader,
+// so it is ignored); bursts of events are delivered as one call. Every 'interval' the
+// callback runs anyway, as a fallback for file systems without inotify (NFS, some
+// container mounts) and for writes inotify cannot see.
+//
+// The callback only hints that something may have changed; it is expected to check
+// cheaply (PRAGMA data_version) before doing any work.
+class DatabaseWatcher {
+public:
+    DatabaseWatcher(const std::string& dbPath, std::function<void()> onChange, std::chrono::milliseconds interval);
+    ~DatabaseWatcher(); // Stops and joins the thread; no callback runs afterwards
+
+    DatabaseWatcher(const DatabaseWatcher&) = delete;
+    DatabaseWatcher& operator=(const DatabaseWatcher&) = delete;
+
+    // False when inotify could not be set up and only the interval is polled.
+    bool IsWatchingFiles() const { return inotifyFd >= 0; }
+
+private:
+    void Run();
+    // Drains pending inotify events; true if one of them concerns the database files.
+    bool ReadEvents();
+
+    std::string fileName; // Database file name without directory
+    std::function<void()> onChange;
+    std::chrono::milliseconds interval;
+
+    int inotifyFd = -1;
+    int stopFd = -1; // eventfd, signalled by the destructor
+    std::thread worker;
+};
+
+#endif // DATABASEWATCHER_HPP
@@ -0,0 +1,129 @@
+#include "EmailDomainIndex.hpp"
+#include <algorithm>
+#include <mutex>
+
+namespace {
+
+std::string ReverseLabels(const std::string& domain) {
+    std::string reversed;
+    reversed.reserve(domain.size());
+    size_t end = domain.size();
+    while (end > 0) {
+        size_t dot = domain.rfind('.', end - 1);
+        size_t start = dot == std::string::npos ? 0 : dot + 1;
+        if (end > start) {
+            if (!reversed.empty()) {
+                reversed.push_back('.');
+            }
+            reversed.append(domain, start, end - start);
+        }
+        if (dot == std::string::npos) {
+            break;
+        }
+        end = dot;
+    }
+    return reversed;
+}
+
+std::string ToLowerAscii(std::string text) {
+    for (char& c : text) {
+        if (c >= 'A' && c <= 'Z') {
+            c = static_cast<char>(c - 'A' + 'a');
+        }
+    }
+    return text;
+}
+
+} // namespace
+
+std::string ReversedEmailDomain(const std::string& email) {
+    size_t at = email.rfind('@');
+    if (at == std::string::npos) {
+        return "";
+    }
+    return ReverseLabels(ToLowerAscii(email.substr(at + 1)));
+}
+
+void EmailDomainIndex::Add(const std::string& name, const std::string& phone, const std::string& email) {
+    std::string domain = ReversedEmailDomain(email);
+    if (domain.empty()) {
+        return; // Not an address; nothing to group by
+    }
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    byDomain[domain].emplace(std::make_pair(phone, email), Entry{name, phone, email});
+    ++entryCount;
+}
+
+void EmailDomainIndex::Remove(const std::string& name, const std::string& phone, const std::string& email) {
+    std::string domain = ReversedEmailDomain(email);
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    auto bucket = byDomain.find(domain);
+    if (bucket == byDomain.end()) {
+        return;
+    }
+    auto [first, last] = bucket->second.equal_range(std::make_pair(phone, email));
+    if (first == last) {
+        return;
+    }
+    // Prefer the entry with the same name; any other one carries the same phone and address
+    auto match = std::find_if(first, last, [&name](const auto& entry) { return entry.second.name == name; });
+    bucket->second.erase(match != last ? match : first);
+    --entryCount;
+    if (bucket->second.empty()) {
+        byDomain.erase(bucket);
+    }
+}
+
+void EmailDomainIndex::Clear() {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    byDomain.clear();
+    entryCount = 0;
+}
+
+std::vector<EmailDomainIndex::Entry> EmailDomainIndex::Find(const std::string& domain, bool includeSubdomains) const {
+    std::string key = ReversedEmailDomain(domain.find('@') == std::string::npos ? "@" + domain : domain);
+    std::vector<Entry> result;
+    if (key.empty()) {
+        return result;
+    }
+
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    auto append = [&result](const std::multimap<std::pair<std::string, std::string>, Entry>& bucket) {
+        for (const auto& entry : bucket) {
+            result.push_back(entry.second);
+        }
+    };
+    auto exact = byDomain.find(key);
+    if (exact != byDomain.end()) {
+        append(exact->second);
+    }
+    if (includeSubdomains) {
+        // Subdomains of "com.example" are exactly the keys in ["com.example.", "com.example/").
+        auto first = byDomain.lower_bound(key + '.');
+        auto last = byDomain.lower_bound(key + '/');
+        for (auto it = first; it != last; ++it) {
+            append(it->second);
+        }
+    }
+    return result;
+}
+
+std::vector<std::pair<std::string, size_t>> EmailDomainIndex::Histogram() const {
+    std::vector<std::pair<std::string, size_t>> histogram;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        histogram.reserve(byDomain.size());
+        for (const auto& bucket : byDomain) {
+            histogram.emplace_back(ReverseLabels(bucket.first), bucket.second.size());
+        }
+    }
+    std::sort(histogram.begin(), histogram.end(), [](const auto& a, const auto& b) {
+        return a.second != b.second ? a.second > b.second : a.first < b.first;
+    });
+    return histogram;
+}
+
+size_t EmailDomainIndex::Size() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return entryCount;
+}
@@ -0,0 +1,49 @@
+#ifndef EMAILDOMAININDEX_HPP
+#define EMAILDOMAININDEX_HPP
+
+#include <map>
+#include <shared_mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Lower-cased domain of an e-mail address with its labels reversed:
+// "Ali@Mail.Example.com" -> "com.example.mail". Empty if there is no '@'.
+std::string ReversedEmailDomain(const std::string& email);
+
+// Contacts grouped by e-mail domain, keyed by the reversed domain so that a domain
+// and all of its subdomains are neighbours in the map ("com.example",
+// "com.example.mail", ...). Unlike the snapshot indexes it is updated in place by
+// the writer (Add/Remove per changed contact); readers take a shared lock.
+// Entries are keyed by (phone, e-mail) and may repeat: nothing stops two contacts
+// from sharing a number (an edit or another process can write one), so a removal
+// names the exact values it drops rather than a phone.
+class EmailDomainIndex {
+public:
+    struct Entry {
+        std::string name;
+        std::string phone;
+        std::string email;
+    };
+
+    void Add(const std::string& name, const std::string& phone, const std::string& email);
+    void Remove(const std::string& name, const std::string& phone, const std::string& email);
+    void Clear();
+
+    // Contacts at 'domain' (e.g. "example.com" or "@example.com"), optionally with
+    // its subdomains, ordered by domain and then phone.
+    std::vector<Entry> Find(const std::string& domain, bool includeSubdomains = true) const;
+
+    // (domain, contact count) for every domain, largest first.
+    std::vector<std::pair<std::string, size_t>> Histogram() const;
+
+    size_t Size() const;
+
+private:
+    mutable std::shared_mutex mutex;
+    // reversed domain -> (phone, e-mail) -> entries
+    std::map<std::string, std::multimap<std::pair<std::string, std::string>, Entry>> byDomain;
+    size_t entryCount = 0;
+};
+
+#endif // EMAILDOMAININDEX_HPP
@@ -0,0 +1,542 @@
+#include "FuzzyNameIndex.hpp"
+#include <algorithm>
+#include <functional>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+// Decodes UTF-8 into code points, lower-casing ASCII on the way.
+// Malformed sequences become U+FFFD rather than being dropped.
+std::u32string DecodeUtf8(std::string_view text) {
+    std::u32string result;
+    result.reserve(text.size());
+    size_t i = 0;
+    while (i < text.size()) {
+        unsigned char lead = static_cast<unsigned char>(text[i]);
+        char32_t codePoint = 0xFFFD;
+        size_t length = 1;
+        if (lead < 0x80) {
+            codePoint = (lead >= 'A' && lead <= 'Z') ? static_cast<char32_t>(lead + ('a' - 'A')) : lead;
+        } else if ((lead >> 5) == 0x6) {
+            length = 2;
+            codePoint = lead & 0x1Fu;
+        } else if ((lead >> 4) == 0xE) {
+            length = 3;
+            codePoint = lead & 0x0Fu;
+        } else if ((lead >> 3) == 0x1E) {
+            length = 4;
+            codePoint = lead & 0x07u;
+        }
+        if (length > 1) {
+            bool valid = i + length <= text.size();
+            for (size_t k = 1; valid && k < length; ++k) {
+                unsigned char next = static_cast<unsigned char>(text[i + k]);
+                valid = (next & 0xC0) == 0x80;
+                codePoint = (codePoint << 6) | (next & 0x3Fu);
+            }
+            if (!valid) {
+                codePoint = 0xFFFD;
+                length = 1;
+            }
+        }
+        result.push_back(codePoint);
+        i += length;
+    }
+    return result;
+}
+
+bool IsSeparator(char32_t c) {
+    return c == U' ' || c == U'\t' || c == U'-' || c == U',' || c == U'.';
+}
+
+std::vector<std::u32string> SplitWords(const std::u32string& text) {
+    std::vector<std::u32string> words;
+    size_t start = 0;
+    for (size_t i = 0; i <= text.size(); ++i) {
+        if (i == text.size() || IsSeparator(text[i])) {
+            if (i > start) {
+                words.emplace_back(text, start, i - start);
+            }
+            start = i + 1;
+        }
+    }
+    return words;
+}
+
+// FNV-1a over the code points.
+uint64_t HashWord(std::u32string_view word) {
+    uint64_t hash = 1469598103934665603ull;
+    for (char32_t c : word) {
+        hash = (hash ^ static_cast<uint64_t>(c)) * 1099511628211ull;
+    }
+    return hash;
+}
+
+// Appends the hashes of 'word' with up to 'remaining' characters deleted.
+// Deletions are made at increasing positions so every deletion set is generated once.
+void CollectDeletions(std::u32string& word, size_t from, uint32_t remaining, std::vector<uint64_t>& out) {
+    out.push_back(HashWord(word));
+    if (remaining == 0) {
+        return;
+    }
+    for (size_t i = from; i < word.size(); ++i) {
+        char32_t removed = word[i];
+        word.erase(i, 1);
+        CollectDeletions(word, i, remaining - 1, out);
+        word.insert(i, 1, removed);
+    }
+}
+
+std::vector<uint64_t> DeletionHashes(std::u32string_view prefix, uint32_t maxDistance) {
+    std::u32string word(prefix);
+    std::vector<uint64_t> hashes;
+    CollectDeletions(word, 0, maxDistance, hashes);
+    std::sort(hashes.begin(), hashes.end());
+    hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+    return hashes;
+}
+
+// Per-character match masks of a pattern of at most 64 code points
+// (bit i is set when pattern[i] == c).
+class PatternMasks {
+public:
+    explicit PatternMasks(std::u32string_view pattern) {
+        for (size_t i = 0; i < pattern.size(); ++i) {
+            uint64_t bit = uint64_t{1} << i;
+            char32_t c = pattern[i];
+            if (c < 128) {
+                ascii[c] |= bit;
+                continue;
+            }
+            auto it = std::find_if(other.begin(), other.end(), [c](const auto& entry) { return entry.first == c; });
+            if (it == other.end()) {
+                other.emplace_back(c, bit);
+            } else {
+                it->second |= bit;
+            }
+        }
+    }
+
+    uint64_t Get(char32_t c) const {
+        if (c < 128) {
+            return ascii[c];
+        }
+        for (const auto& entry : other) {
+            if (entry.first == c) {
+                return entry.second;
+            }
+        }
+        return 0;
+    }
+
+private:
+    uint64_t ascii[128] = {};
+    std::vector<std::pair<char32_t, uint64_t>> other; // Non-ASCII characters (rare, few)
+};
+
+// Hyyrö (2003), "A bit-vector algorithm for computing Levenshtein and Damerau edit
+// distances": Myers' column recurrence plus the TR vector for adjacent transpositions.
+// One column of the DP matrix per text character, one machine word per column.
+uint32_t BitParallelDistance(const PatternMasks& masks, size_t patternLength, std::u32string_view text) {
+    const uint64_t last = uint64_t{1} << (patternLength - 1);
+    uint64_t vp = patternLength == 64 ? ~uint64_t{0} : (uint64_t{1} << patternLength) - 1;
+    uint64_t vn = 0;
+    uint64_t d0 = 0;
+    uint64_t previousMatch = 0;
+    uint32_t score = static_cast<uint32_t>(patternLength);
+    for (char32_t c : text) {
+        uint64_t match = masks.Get(c);
+        uint64_t transposition = (((~d0) & match) << 1) & previousMatch;
+        d0 = (((match & vp) + vp) ^ vp) | match | vn | transposition;
+        uint64_t hp = vn | ~(d0 | vp);
+        uint64_t hn = d0 & vp;
+        if (hp & last) {
+            ++score;
+        } else if (hn & last) {
+            --score;
+        }
+        hp = (hp << 1) | 1; // Row 0 grows by one per column (global distance)
+        hn <<= 1;
+        vp = hn | ~(d0 | hp);
+        vn = hp & d0;
+        previousMatch = match;
+    }
+    return score;
+}
+
+// Textbook optimal string alignment DP, for patterns longer than a machine word.
+uint32_t DynamicProgrammingDistance(std::u32string_view a, std::u32string_view b) {
+    std::vector<uint32_t> twoBack(b.size() + 1), previous(b.size() + 1), current(b.size() + 1);
+    for (size_t j = 0; j <= b.size(); ++j) {
+        previous[j] = static_cast<uint32_t>(j);
+    }
+    for (size_t i = 1; i <= a.size(); ++i) {
+        current[0] = static_cast<uint32_t>(i);
+        for (size_t j = 1; j <= b.size(); ++j) {
+            uint32_t cost = a[i - 1] == b[j - 1] ? 0 : 1;
+            current[j] = std::min({previous[j] + 1, current[j - 1] + 1, previous[j - 1] + cost});
+            if (i > 1 && j > 1 && a[i - 1] == b[j - 2] && a[i - 2] == b[j - 1]) {
+                current[j] = std::min(current[j], twoBack[j - 2] + 1);
+            }
+        }
+        std::swap(twoBack, previous);
+        std::swap(previous, current);
+    }
+    return previous[b.size()];
+}
+
+uint32_t LengthDifference(size_t a, size_t b) {
+    return static_cast<uint32_t>(a > b ? a - b : b - a);
+}
+
+// Words added by patches stay in a small table of their own, searched next to the
+// shared one, until they reach this share of it; words no name contains any more stay
+// until they reach this share of all words. Either triggers a merge of the two tables
+// that drops the dead words.
+constexpr size_t kNewTermsMergeDivisor = 16;
+constexpr size_t kDeadTermsMergeDivisor = 8;
+constexpr size_t kTermsMergeMinimum = 4096;
+
+} // namespace
+
+uint32_t DamerauLevenshteinDistance(std::u32string_view a, std::u32string_view b) {
+    if (a.empty()) {
+        return static_cast<uint32_t>(b.size());
+    }
+    if (a.size() > 64) {
+        return DynamicProgrammingDistance(a, b);
+    }
+    return BitParallelDistance(PatternMasks(a), a.size(), b);
+}
+
+FuzzyNameIndex::FuzzyNameIndex(const std::vector<std::string>& utf8Names, uint32_t maxDistance, size_t prefixLength)
+    : maxDistance(maxDistance), prefixLength(std::max<size_t>(prefixLength, 1)) {
+    auto table = std::make_shared<TermTable>();
+    std::vector<std::u32string>& terms = table->terms;
+    std::unordered_map<std::u32string, uint32_t> termIds;
+    nameTermOffsets.reserve(utf8Names.size() + 1);
+    nameTermOffsets.push_back(0);
+    for (const std::string& name : utf8Names) {
+        size_t first = nameTerms.size();
+        for (std::u32string& word : SplitWords(DecodeUtf8(name))) {
+            auto inserted = termIds.emplace(std::move(word), static_cast<uint32_t>(terms.size()));
+            if (inserted.second) {
+                terms.push_back(inserted.first->first);
+            }
+            uint32_t id = inserted.first->second;
+            // Names have a handful of words, so a linear duplicate check is enough.
+            if (std::find(nameTerms.begin() + static_cast<std::ptrdiff_t>(first), nameTerms.end(), id) == nameTerms.end()) {
+                nameTerms.push_back(id);
+            }
+        }
+        nameTermOffsets.push_back(static_cast<uint32_t>(nameTerms.size()));
+    }
+
+    for (uint32_t id = 0; id < terms.size(); ++id) {
+        const std::u32string& term = terms[id];
+        AddDeletions(*table, std::u32string_view(term).substr(0, this->prefixLength), id);
+    }
+    std::sort(table->deletions.begin(), table->deletions.end());
+    sharedTerms = std::move(table);
+    newTerms = std::make_shared<const TermTable>();
+    BuildPostings();
+}
+
+FuzzyNameIndex::FuzzyNameIndex(const FuzzyNameIndex& previous, const SnapshotDelta& delta,
+                               const std::vector<std::string>& addedNames)
+    : maxDistance(previous.maxDistance), prefixLength(previous.prefixLength), sharedTerms(previous.sharedTerms),
+      newTerms(previous.newTerms) {
+    // Term ids of the added names. Words seen for the first time become new terms in
+    // 'fresh', added to a copy of 'newTerms' after the loop; until then FindTerm() misses
+    // them and 'created' finds them instead.
+    std::unordered_map<std::u32string, uint32_t> created;
+    TermTable fresh;
+    std::vector<uint32_t> addedOffsets = {0};
+    std::vector<uint32_t> addedTerms;
+    for (const std::string& name : addedNames) {
+        size_t first = addedTerms.size();
+        for (std::u32string& word : SplitWords(DecodeUtf8(name))) {
+            uint32_t id = FindTerm(word);
+            if (id == UINT32_MAX) {
+                auto inserted = created.emplace(word, static_cast<uint32_t>(GetTermCount() + fresh.terms.size()));
+                id = inserted.first->second;
+                if (inserted.second) {
+                    AddDeletions(fresh, std::u32string_view(word).substr(0, prefixLength), id);
+                    fresh.terms.push_back(std::move(word));
+                }
+            }
+            if (std::find(addedTerms.begin() + static_cast<std::ptrdiff_t>(first), addedTerms.end(), id) == addedTerms.end()) {
+                addedTerms.push_back(id);
+            }
+        }
+        addedOffsets.push_back(static_cast<uint32_t>(addedTerms.size()));
+    }
+    if (!fresh.terms.empty()) {
+        // The indexes of earlier snapshots keep the table they were built with
+        auto grown = std::make_shared<TermTable>();
+        grown->terms.reserve(newTerms->terms.size() + fresh.terms.size());
+        grown->terms.insert(grown->terms.end(), newTerms->terms.begin(), newTerms->terms.end());
+        grown->terms.insert(grown->terms.end(), std::make_move_iterator(fresh.terms.begin()),
+                            std::make_move_iterator(fresh.terms.end()));
+        std::sort(fresh.deletions.begin(), fresh.deletions.end());
+        grown->deletions.resize(newTerms->deletions.size() + fresh.deletions.size());
+        std::merge(newTerms->deletions.begin(), newTerms->deletions.end(), fresh.deletions.begin(),
+                   fresh.deletions.end(), grown->deletions.begin());
+        newTerms = std::move(grown);
+    }
+
+    // Name -> terms in the new order: survivors keep their lists, additions slot in at
+    // their new positions
+    size_t nameCount = addedNames.size();
+    for (uint32_t position : delta.remap) {
+        nameCount += position != SnapshotDelta::kRemoved ? 1 : 0;
+    }
+    nameTermOffsets.reserve(nameCount + 1);
+    nameTermOffsets.push_back(0);
+    nameTerms.reserve(previous.nameTerms.size() + addedTerms.size());
+    size_t old = 0;
+    size_t next = 0;
+    for (uint32_t position = 0; position < nameCount; ++position) {
+        if (next < delta.added.size() && delta.added[next] == position) {
+            nameTerms.insert(nameTerms.end(), addedTerms.begin() + addedOffsets[next],
+                             addedTerms.begin() + addedOffsets[next + 1]);
+            ++next;
+        } else {
+            while (delta.remap[old] == SnapshotDelta::kRemoved) {
+                ++old;
+            }
+            nameTerms.insert(nameTerms.end(), previous.nameTerms.begin() + previous.nameTermOffsets[old],
+                             previous.nameTerms.begin() + previous.nameTermOffsets[old + 1]);
+            ++old;
+        }
+        nameTermOffsets.push_back(static_cast<uint32_t>(nameTerms.size()));
+    }
+    BuildPostings();
+
+    size_t deadTerms = 0;
+    for (size_t t = 0; t + 1 < postingOffsets.size(); ++t) {
+        deadTerms += postingOffsets[t] == postingOffsets[t + 1] ? 1 : 0;
+    }
+    if (newTerms->terms.size() > std::max(kTermsMergeMinimum, sharedTerms->terms.size() / kNewTermsMergeDivisor) ||
+        deadTerms > std::max(kTermsMergeMinimum, GetTermCount() / kDeadTermsMergeDivisor)) {
+        MergeTerms();
+    }
+}
+
+void FuzzyNameIndex::MergeTerms() {
+    size_t termCount = GetTermCount();
+    std::vector<uint32_t> renumbered(termCount, UINT32_MAX);
+    auto merged = std::make_shared<TermTable>();
+    for (uint32_t id = 0; id < termCount; ++id) {
+        if (postingOffsets[id] < postingOffsets[id + 1]) {
+            renumbered[id] = static_cast<uint32_t>(merged->terms.size());
+            merged->terms.push_back(Term(id));
+        }
+    }
+    // Renumbering keeps the order of the surviving ids, so merging the two sorted
+    // tables and skipping dead terms leaves the result sorted
+    merged->deletions.reserve(GetDeletionCount());
+    auto a = sharedTerms->deletions.begin();
+    auto b = newTerms->deletions.begin();
+    while (a != sharedTerms->deletions.end() || b != newTerms->deletions.end()) {
+        bool fromShared = b == newTerms->deletions.end() || (a != sharedTerms->deletions.end() && *a < *b);
+        const std::pair<uint64_t, uint32_t>& deletion = fromShared ? *a++ : *b++;
+        if (renumbered[deletion.second] != UINT32_MAX) {
+            merged->deletions.emplace_back(deletion.first, renumbered[deletion.second]);
+        }
+    }
+    for (uint32_t& id : nameTerms) {
+        id = renumbered[id];
+    }
+    sharedTerms = std::move(merged);
+    newTerms = std::make_shared<const TermTable>();
+    BuildPostings();
+}
+
+void FuzzyNameIndex::BuildPostings() {
+    // Invert name -> terms into term -> names (counting sort keeps names in order).
+    size_t termCount = GetTermCount();
+    postingOffsets.assign(termCount + 1, 0);
+    for (uint32_t id : nameTerms) {
+        ++postingOffsets[id + 1];
+    }
+    for (size_t t = 0; t < termCount; ++t) {
+        postingOffsets[t + 1] += postingOffsets[t];
+    }
+    postings.resize(nameTerms.size());
+    std::vector<uint32_t> cursor(postingOffsets.begin(), postingOffsets.end() - 1);
+    for (size_t n = 0; n + 1 < nameTermOffsets.size(); ++n) {
+        for (uint32_t k = nameTermOffsets[n]; k < nameTermOffsets[n + 1]; ++k) {
+            postings[cursor[nameTerms[k]]++] = static_cast<uint32_t>(n);
+        }
+    }
+}
+
+void FuzzyNameIndex::AddDeletions(TermTable& table, std::u32string_view prefix, uint32_t termId) const {
+    for (uint64_t hash : DeletionHashes(prefix, maxDistance)) {
+        table.deletions.emplace_back(hash, termId);
+    }
+}
+
+uint32_t FuzzyNameIndex::FindTerm(const std::u32string& word) const {
+    // The undeleted prefix is one of every term's deletion variants
+    auto key = std::make_pair(HashWord(std::u32string_view(word).substr(0, prefixLength)), uint32_t{0});
+    auto byHash = [](const auto& a, const auto& b) { return a.first < b.first; };
+    for (const TermTable* table : {sharedTerms.get(), newTerms.get()}) {
+        auto range = std::equal_range(table->deletions.begin(), table->deletions.end(), key, byHash);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (Term(it->second) == word) {
+                return it->second;
+            }
+        }
+    }
+    return UINT32_MAX;
+}
+
+FuzzyNameIndex::TermMatches FuzzyNameIndex::MatchTerm(const std::u32string& word, uint32_t distance) const {
+    // Candidate terms share a deletion variant of the prefix with the query word.
+    // Hash collisions only add candidates; the verification below removes them.
+    std::vector<uint32_t> candidates;
+    for (uint64_t hash : DeletionHashes(std::u32string_view(word).substr(0, prefixLength), distance)) {
+        for (const TermTable* table : {sharedTerms.get(), newTerms.get()}) {
+            auto range = std::equal_range(table->deletions.begin(), table->deletions.end(), std::make_pair(hash, uint32_t{0}),
+                                          [](const auto& a, const auto& b) { return a.first < b.first; });
+            for (auto it = range.first; it != range.second; ++it) {
+                candidates.push_back(it->second);
+            }
+        }
+    }
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    TermMatches matches;
+    if (word.size() <= 64) {
+        PatternMasks masks(word);
+        for (uint32_t id : candidates) {
+            const std::u32string& term = Term(id);
+            if (LengthDifference(term.size(), word.size()) > distance) {
+                continue;
+            }
+            uint32_t d = word.empty() ? static_cast<uint32_t>(term.size()) : BitParallelDistance(masks, word.size(), term);
+            if (d <= distance) {
+                matches.emplace_back(id, d);
+            }
+        }
+    } else {
+        for (uint32_t id : candidates) {
+            if (LengthDifference(Term(id).size(), word.size()) <= distance) {
+                uint32_t d = DynamicProgrammingDistance(word, Term(id));
+                if (d <= distance) {
+                    matches.emplace_back(id, d);
+                }
+            }
+        }
+    }
+    return matches; // Already sorted by term id
+}
+
+std::vector<FuzzyMatch> FuzzyNameIndex::Search(const std::string& utf8Query, uint32_t distance, size_t limit) const {
+    std::vector<FuzzyMatch> results;
+    distance = std::min(distance, maxDistance);
+    std::vector<std::u32string> words = SplitWords(DecodeUtf8(utf8Query));
+    if (words.empty() || limit == 0) {
+        return results;
+    }
+
+    std::vector<TermMatches> perWord;
+    size_t driver = 0;         // Query word with the fewest matching names
+    size_t driverPostings = SIZE_MAX;
+    for (size_t w = 0; w < words.size(); ++w) {
+        perWord.push_back(MatchTerm(words[w], distance));
+        size_t count = 0;
+        for (const auto& match : perWord.back()) {
+            count += postingOffsets[match.first + 1] - postingOffsets[match.first];
+        }
+        if (count == 0) {
+            return results; // No name can contain every query word
+        }
+        if (count < driverPostings) {
+            driver = w;
+            driverPostings = count;
+        }
+    }
+
+    std::vector<FuzzyMatch> scored;
+    if (words.size() == 1) {
+        // Walk the matching terms closest first, one distance at a time. A name is first
+        // reached through its best word, so the walk can stop as soon as 'limit' names
+        // have been found; within a distance the terms' postings (each in position order)
+        // are merged, so the names kept do not depend on term ids.
+        TermMatches ordered = perWord[0];
+        std::sort(ordered.begin(), ordered.end(),
+                  [](const auto& a, const auto& b) { return a.second != b.second ? a.second < b.second : a.first < b.first; });
+        std::unordered_set<uint32_t> seen;
+        using Head = std::tuple<uint32_t, uint32_t, uint32_t>; // (name, posting, end of the term's postings)
+        std::vector<Head> heads;                               // A min-heap by name
+        auto later = std::greater<Head>();
+        for (size_t level = 0; level < ordered.size() && scored.size() < limit;) {
+            uint32_t levelDistance = ordered[level].second;
+            heads.clear();
+            for (; level < ordered.size() && ordered[level].second == levelDistance; ++level) {
+                uint32_t first = postingOffsets[ordered[level].first];
+                uint32_t end = postingOffsets[ordered[level].first + 1];
+                if (first < end) {
+                    heads.emplace_back(postings[first], first, end);
+                }
+            }
+            std::make_heap(heads.begin(), heads.end(), later);
+            while (!heads.empty() && scored.size() < limit) {
+                std::pop_heap(heads.begin(), heads.end(), later);
+                auto [name, p, end] = heads.back();
+                if (seen.insert(name).second) {
+                    scored.push_back({name, levelDistance});
+                }
+                if (p + 1 < end) {
+                    heads.back() = Head(postings[p + 1], p + 1, end);
+                    std::push_heap(heads.begin(), heads.end(), later);
+                } else {
+                    heads.pop_back();
+                }
+            }
+        }
+    } else {
+        // Names reached through the rarest query word are scored against the others by
+        // looking their words up in each query word's matches (sorted by term id), so the
+        // cost follows the candidates rather than the number of terms.
+        std::unordered_set<uint32_t> seen;
+        for (const auto& match : perWord[driver]) {
+            for (uint32_t p = postingOffsets[match.first]; p < postingOffsets[match.first + 1]; ++p) {
+                uint32_t name = postings[p];
+                if (!seen.insert(name).second) {
+                    continue;
+                }
+                uint32_t total = 0;
+                bool allMatched = true;
+                for (size_t w = 0; w < words.size() && allMatched; ++w) {
+                    uint32_t best = UINT32_MAX;
+                    for (uint32_t k = nameTermOffsets[name]; k < nameTermOffsets[name + 1]; ++k) {
+                        auto found = std::lower_bound(perWord[w].begin(), perWord[w].end(), std::make_pair(nameTerms[k], uint32_t{0}));
+                        if (found != perWord[w].end() && found->first == nameTerms[k]) {
+                            best = std::min(best, found->second);
+                        }
+                    }
+                    allMatched = best != UINT32_MAX;
+                    total += allMatched ? best : 0;
+                }
+                if (allMatched) {
+                    scored.push_back({name, total});
+                }
+            }
+        }
+    }
+
+    auto byRank = [](const FuzzyMatch& a, const FuzzyMatch& b) {
+        return a.distance != b.distance ? a.distance < b.distance : a.index < b.index;
+    };
+    size_t keep = std::min(limit, scored.size());
+    std::partial_sort(scored.begin(), scored.begin() + static_cast<std::ptrdiff_t>(keep), scored.end(), byRank);
+    scored.resize(keep);
+    return scored;
+}
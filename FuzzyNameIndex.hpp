@@ -0,0 +1,92 @@
+#ifndef FUZZYNAMEINDEX_HPP
+#define FUZZYNAMEINDEX_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "SnapshotIndex.hpp"
+
+// A name that matched a fuzzy query. 'index' is the position in the list the index
+// was built from; 'distance' is the summed edit distance over all query words.
+struct FuzzyMatch {
+    size_t index = 0;
+    uint32_t distance = 0;
+};
+
+// Optimal string alignment distance (Damerau-Levenshtein with adjacent transpositions),
+// computed with Hyyrö's bit-parallel extension of Myers' algorithm when 'a' fits in
+// 64 code points and with the plain dynamic program otherwise.
+uint32_t DamerauLevenshteinDistance(std::u32string_view a, std::u32string_view b);
+
+// Fuzzy word index over a list of names, built once and then patched per contact
+// snapshot. Names are split into words and every distinct word goes into a SymSpell-style
+// symmetric deletion index: all variants of the word's first 'prefixLength' code
+// points with up to 'maxDistance' characters deleted, stored as sorted hashes.
+// A query word only generates its own deletion variants and looks them up, so the
+// cost depends on the query and the number of similar words, not on the book size.
+// Every candidate is verified with DamerauLevenshteinDistance().
+//
+// A multi-word query matches names that contain a word within the distance for each
+// query word ("jon smiht" finds "John Smith"). Matching is case-insensitive for ASCII;
+// callers should lower-case other scripts before building and searching.
+class FuzzyNameIndex {
+public:
+    explicit FuzzyNameIndex(const std::vector<std::string>& utf8Names, uint32_t maxDistance = 2,
+                            size_t prefixLength = 7);
+    // The index of the list 'delta' made from the one 'previous' was built from;
+    // 'addedNames' are the names at delta.added, in the same order. Costs O(names) for
+    // the name <-> term lists plus the deletion variants of words not seen before; the
+    // deletion tables are shared with 'previous' (the small one of words added since the
+    // last merge is copied when new words arrive). Words no longer in any name keep their
+    // (now empty) term until they are a set share of all words; then, or when the added
+    // words outgrow their table, the tables are merged into one without them.
+    FuzzyNameIndex(const FuzzyNameIndex& previous, const SnapshotDelta& delta, const std::vector<std::string>& addedNames);
+
+    // Returns up to 'limit' names ranked by distance, then by position.
+    // 'maxDistance' is per query word and is capped at the distance the index was built for.
+    std::vector<FuzzyMatch> Search(const std::string& utf8Query, uint32_t maxDistance, size_t limit) const;
+
+    uint32_t GetMaxDistance() const { return maxDistance; }
+    size_t GetNameCount() const { return nameTermOffsets.size() - 1; }
+    size_t GetTermCount() const { return sharedTerms->terms.size() + newTerms->terms.size(); }
+    size_t GetDeletionCount() const { return sharedTerms->deletions.size() + newTerms->deletions.size(); }
+
+private:
+    // Distinct words matching one query word, as (term id, distance) sorted by term id.
+    using TermMatches = std::vector<std::pair<uint32_t, uint32_t>>;
+
+    // Distinct words (lower-cased) and their deletion variants as (variant hash, term id),
+    // sorted. Term ids continue from one table into the next.
+    struct TermTable {
+        std::vector<std::u32string> terms;
+        std::vector<std::pair<uint64_t, uint32_t>> deletions;
+    };
+
+    const std::u32string& Term(uint32_t id) const {
+        return id < sharedTerms->terms.size() ? sharedTerms->terms[id] : newTerms->terms[id - sharedTerms->terms.size()];
+    }
+    // Id of the term equal to 'word' (looked up through its undeleted prefix), or UINT32_MAX
+    uint32_t FindTerm(const std::u32string& word) const;
+    TermMatches MatchTerm(const std::u32string& word, uint32_t maxDistance) const;
+    void AddDeletions(TermTable& table, std::u32string_view prefix, uint32_t termId) const;
+    // Fills postingOffsets and postings from the name -> terms lists
+    void BuildPostings();
+    // Merges both term tables into a new shared one without the terms no name contains,
+    // renumbering the rest in order, and rebuilds the postings
+    void MergeTerms();
+
+    uint32_t maxDistance;
+    size_t prefixLength;
+
+    std::shared_ptr<const TermTable> sharedTerms; // Shared by the indexes of later snapshots
+    std::shared_ptr<const TermTable> newTerms;    // Words added by patches since, merged in when it grows
+    std::vector<uint32_t> postingOffsets;  // term id -> range in 'postings'
+    std::vector<uint32_t> postings;        // Name positions containing the term
+    std::vector<uint32_t> nameTermOffsets; // name position -> range in 'nameTerms'
+    std::vector<uint32_t> nameTerms;       // Term ids of each name
+};
+
+#endif // FUZZYNAMEINDEX_HPP
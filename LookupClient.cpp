@@ -0,0 +1,151 @@
+#include "LookupClient.hpp"
+#include "CoreLog.hpp"
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+namespace {
+
+const size_t kReadChunk = 64 * 1024;
+
+} // namespace
+
+LookupClient::~LookupClient() {
+    Close();
+}
+
+bool LookupClient::Connect(const std::string& socketPath) {
+    Close();
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socketPath.empty() || socketPath.size() >= sizeof(address.sun_path)) {
+        LogError("Invalid socket path '%s'.", socketPath.c_str());
+        return false;
+    }
+    std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size());
+
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        LogError("Cannot connect to '%s': %s", socketPath.c_str(), std::strerror(errno));
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void LookupClient::Close() {
+    if (fd >= 0) {
+        close(fd);
+        fd = -1;
+    }
+    output.clear();
+    input.clear();
+    inputOffset = 0;
+}
+
+uint32_t LookupClient::Send(LookupOp op, std::string_view query, uint16_t limit) {
+    uint32_t id = nextId++;
+    AppendLookupRequest(output, id, op, query, limit);
+    return id;
+}
+
+bool LookupClient::Flush() {
+    size_t written = 0;
+    while (fd >= 0 && written < output.size()) {
+        ssize_t sent = send(fd, output.data() + written, output.size() - written, MSG_NOSIGNAL);
+        if (sent > 0) {
+            written += static_cast<size_t>(sent);
+        } else if (sent < 0 && errno == EINTR) {
+            continue;
+        } else {
+            LogError("Lost the connection to the lookup server: %s", std::strerror(errno));
+            Close();
+            return false;
+        }
+    }
+    output.clear();
+    return fd >= 0;
+}
+
+bool LookupClient::HasBufferedResponse() const {
+    if (input.size() - inputOffset < kLookupHeaderSize) {
+        return false;
+    }
+    LookupFrameHeader header = ParseLookupHeader(input.data() + inputOffset);
+    return input.size() - inputOffset >= kLookupHeaderSize + header.length;
+}
+
+bool LookupClient::Receive(LookupResponse& response) {
+    if (!HasBufferedResponse() && !output.empty() && !Flush()) {
+        return false;
+    }
+    while (fd >= 0 && !HasBufferedResponse()) {
+        if (input.size() - inputOffset >= kLookupHeaderSize &&
+            ParseLookupHeader(input.data() + inputOffset).length > kMaxLookupResponseBytes) {
+            LogError("Lookup server sent an oversized response.");
+            Close();
+            return false;
+        }
+        if (inputOffset > 0) {
+            input.erase(0, inputOffset);
+            inputOffset = 0;
+        }
+        size_t used = input.size();
+        input.resize(used + kReadChunk);
+        ssize_t got = read(fd, input.data() + used, kReadChunk);
+        input.resize(used + (got > 0 ? static_cast<size_t>(got) : 0));
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            LogError("Lost the connection to the lookup server: %s", got == 0 ? "closed" : std::strerror(errno));
+            Close();
+            return false;
+        }
+    }
+    if (fd < 0) {
+        return false;
+    }
+
+    LookupFrameHeader header = ParseLookupHeader(input.data() + inputOffset);
+    std::string_view body(input.data() + inputOffset + kLookupHeaderSize, header.length);
+    inputOffset += kLookupHeaderSize + header.length;
+    response.id = header.id;
+    response.status = static_cast<LookupStatus>(header.code);
+    if (!ParseLookupRecords(body, header.count, response.contacts)) {
+        LogError("Lookup server sent a malformed response.");
+        Close();
+        return false;
+    }
+    return true;
+}
+
+bool LookupClient::RoundTrip(LookupOp op, const std::string& query, uint16_t limit, LookupResponse& response) {
+    uint32_t id = Send(op, query, limit);
+    // Responses to requests pipelined earlier by the caller are skipped
+    while (Receive(response)) {
+        if (response.id == id) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::optional<Contact> LookupClient::Lookup(const std::string& phone) {
+    LookupResponse response;
+    if (!RoundTrip(LookupOp::Lookup, phone, 0, response) || response.contacts.empty()) {
+        return std::nullopt;
+    }
+    return response.contacts.front();
+}
+
+std::vector<Contact> LookupClient::Search(LookupOp op, const std::string& query, uint16_t limit) {
+    LookupResponse response;
+    if (!RoundTrip(op, query, limit, response)) {
+        return {};
+    }
+    return std::move(response.contacts);
+}
@@ -0,0 +1,55 @@
+#ifndef LOOKUPCLIENT_HPP
+#define LOOKUPCLIENT_HPP
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "LookupProtocol.hpp"
+
+struct LookupResponse {
+    uint32_t id = 0;
+    LookupStatus status = LookupStatus::Ok;
+    std::vector<Contact> contacts;
+};
+
+// Blocking client for phonebookd (one connection, not thread-safe: use one client per
+// thread). Requests are queued by Send() and written together by Flush(), so callers
+// can pipeline; Receive() returns responses in the order the server sends them, which
+// is not necessarily request order (match them by id). Lookup() and Search() are
+// simple round trips on top of that. Errors are logged and close the connection.
+class LookupClient {
+public:
+    LookupClient() = default;
+    ~LookupClient();
+
+    LookupClient(const LookupClient&) = delete;
+    LookupClient& operator=(const LookupClient&) = delete;
+
+    bool Connect(const std::string& socketPath);
+    void Close();
+    bool IsConnected() const { return fd >= 0; }
+
+    // Queues a request and returns its id.
+    uint32_t Send(LookupOp op, std::string_view query, uint16_t limit = 0);
+    bool Flush();
+    // Returns the next response, flushing queued requests first if it has to wait.
+    bool Receive(LookupResponse& response);
+    // True if a complete response is already buffered, so Receive() will not block.
+    bool HasBufferedResponse() const;
+
+    std::optional<Contact> Lookup(const std::string& phone);
+    std::vector<Contact> Search(LookupOp op, const std::string& query, uint16_t limit = 0);
+
+private:
+    bool RoundTrip(LookupOp op, const std::string& query, uint16_t limit, LookupResponse& response);
+
+    int fd = -1;
+    uint32_t nextId = 1;
+    std::string output;
+    std::string input;
+    size_t inputOffset = 0;
+};
+
+#endif // LOOKUPCLIENT_HPP
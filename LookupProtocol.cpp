@@ -0,0 +1,101 @@
+#include "LookupProtocol.hpp"
+#include <algorithm>
+
+namespace {
+
+void AppendU16(std::string& out, uint16_t value) {
+    out.push_back(static_cast<char>(value & 0xFF));
+    out.push_back(static_cast<char>(value >> 8));
+}
+
+void AppendU32(std::string& out, uint32_t value) {
+    for (int shift = 0; shift < 32; shift += 8) {
+        out.push_back(static_cast<char>((value >> shift) & 0xFF));
+    }
+}
+
+uint16_t ReadU16(const char* data) {
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+    return static_cast<uint16_t>(bytes[0] | (bytes[1] << 8));
+}
+
+uint32_t ReadU32(const char* data) {
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+    return static_cast<uint32_t>(bytes[0]) | (static_cast<uint32_t>(bytes[1]) << 8) |
+           (static_cast<uint32_t>(bytes[2]) << 16) | (static_cast<uint32_t>(bytes[3]) << 24);
+}
+
+void AppendHeader(std::string& out, uint32_t length, uint32_t id, uint8_t code, uint16_t count) {
+    AppendU32(out, length);
+    AppendU32(out, id);
+    out.push_back(static_cast<char>(code));
+    out.push_back('\0');
+    AppendU16(out, count);
+}
+
+void AppendField(std::string& out, const std::string& field) {
+    uint16_t size = static_cast<uint16_t>(std::min<size_t>(field.size(), UINT16_MAX));
+    AppendU16(out, size);
+    out.append(field, 0, size);
+}
+
+bool ReadField(std::string_view body, size_t& pos, std::string& field) {
+    if (body.size() - pos < 2) {
+        return false;
+    }
+    size_t size = ReadU16(body.data() + pos);
+    pos += 2;
+    if (body.size() - pos < size) {
+        return false;
+    }
+    field.assign(body.data() + pos, size);
+    pos += size;
+    return true;
+}
+
+} // namespace
+
+LookupFrameHeader ParseLookupHeader(const char* data) {
+    LookupFrameHeader header;
+    header.length = ReadU32(data);
+    header.id = ReadU32(data + 4);
+    header.code = static_cast<uint8_t>(data[8]);
+    header.count = ReadU16(data + 10);
+    return header;
+}
+
+void AppendLookupRequest(std::string& out, uint32_t id, LookupOp op, std::string_view query, uint16_t limit) {
+    AppendHeader(out, static_cast<uint32_t>(query.size()), id, static_cast<uint8_t>(op), limit);
+    out.append(query);
+}
+
+void AppendLookupResponse(std::string& out, uint32_t id, LookupStatus status, const std::vector<Contact>& contacts) {
+    // The length is patched in once the records are written
+    size_t start = out.size();
+    uint16_t count = static_cast<uint16_t>(std::min<size_t>(contacts.size(), UINT16_MAX));
+    AppendHeader(out, 0, id, static_cast<uint8_t>(status), count);
+    for (size_t i = 0; i < count; ++i) {
+        AppendField(out, contacts[i].GetName());
+        AppendField(out, contacts[i].GetPhone());
+        AppendField(out, contacts[i].GetEmail());
+    }
+    std::string length;
+    AppendU32(length, static_cast<uint32_t>(out.size() - start - kLookupHeaderSize));
+    out.replace(start, 4, length);
+}
+
+bool ParseLookupRecords(std::string_view body, uint16_t count, std::vector<Contact>& contacts) {
+    contacts.clear();
+    contacts.reserve(count);
+    size_t pos = 0;
+    std::string name;
+    std::string phone;
+    std::string email;
+    for (uint16_t i = 0; i < count; ++i) {
+        if (!ReadField(body, pos, name) || !ReadField(body, pos, phone) || !ReadField(body, pos, email)) {
+            return false;
+        }
+        contacts.emplace_back(name, phone, email);
+    }
+    return pos == body.size();
+}
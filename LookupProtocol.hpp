@@ -0,0 +1,59 @@
+#ifndef LOOKUPPROTOCOL_HPP
+#define LOOKUPPROTOCOL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Contact.hpp"
+
+// Binary wire format spoken by phonebookd (LookupServer) and LookupClient over a Unix
+// domain socket. Every frame is a fixed 12-byte header followed by 'length' body bytes;
+// integers are little-endian.
+//
+//   request:  u32 length | u32 id | u8 op     | u8 0 | u16 limit | query (UTF-8)
+//   response: u32 length | u32 id | u8 status | u8 0 | u16 count | count records
+//   record:   u16 size + name | u16 size + phone | u16 size + email
+//
+// Clients may pipeline any number of requests. Responses carry the id of their request
+// and can arrive out of order, since slow searches do not hold up cheap lookups.
+
+enum class LookupOp : uint8_t {
+    Lookup = 1,     // Exact phone number (FindByPhone)
+    Search = 2,     // Substring over name, phone and e-mail (SearchContacts)
+    Prefix = 3,     // Phone prefix (SearchByPhonePrefix)
+    Structured = 4, // Field-qualified query (SearchStructured)
+    Ping = 5        // Empty answer, for health checks and round-trip measurements
+};
+
+enum class LookupStatus : uint8_t {
+    Ok = 0,
+    NotFound = 1,   // Lookup of an unknown number
+    BadRequest = 2  // Unknown op or oversized query; the server then closes the connection
+};
+
+const size_t kLookupHeaderSize = 12;
+const uint32_t kMaxLookupQueryBytes = 4096;
+const uint32_t kMaxLookupResponseBytes = 16 * 1024 * 1024;
+// Result cap for searches sent with limit 0.
+const uint16_t kDefaultLookupLimit = 100;
+
+struct LookupFrameHeader {
+    uint32_t length = 0;
+    uint32_t id = 0;
+    uint8_t code = 0;   // LookupOp in requests, LookupStatus in responses
+    uint16_t count = 0; // Result limit in requests, record count in responses
+};
+
+// Reads a header from kLookupHeaderSize bytes at 'data'.
+LookupFrameHeader ParseLookupHeader(const char* data);
+
+void AppendLookupRequest(std::string& out, uint32_t id, LookupOp op, std::string_view query, uint16_t limit = 0);
+// Encodes at most UINT16_MAX contacts; fields longer than UINT16_MAX bytes are cut.
+void AppendLookupResponse(std::string& out, uint32_t id, LookupStatus status, const std::vector<Contact>& contacts);
+
+// Decodes 'count' records from a response body. False if the body is malformed.
+bool ParseLookupRecords(std::string_view body, uint16_t count, std::vector<Contact>& contacts);
+
+#endif // LOOKUPPROTOCOL_HPP
@@ -0,0 +1,475 @@
+#include "LookupServer.hpp"
+#include "TelephoneBookLogic.hpp"
+#include "CoreLog.hpp"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace {
+
+const uint64_t kListenTag = 0;
+const uint64_t kWakeTag = 1;
+
+// Bytes requested per read() from a client.
+const size_t kReadChunk = 64 * 1024;
+
+// Events taken from epoll_wait at a time.
+const int kMaxEvents = 256;
+
+bool FillAddress(const std::string& path, sockaddr_un& address) {
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+        LogError("Invalid socket path '%s' (at most %zu bytes).", path.c_str(), sizeof(address.sun_path) - 1);
+        return false;
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size());
+    return true;
+}
+
+// True if a server is accepting connections on 'address' right now.
+bool SocketInUse(const sockaddr_un& address) {
+    int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (probe < 0) {
+        return false;
+    }
+    bool inUse = connect(probe, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0;
+    close(probe);
+    return inUse;
+}
+
+} // namespace
+
+LookupServer::LookupServer(TelephoneBookLogic& book, LookupServerConfig config)
+    : book(book), config(std::move(config)) {
+    if (this->config.workers == 0) {
+        this->config.workers = std::max(1u, std::thread::hardware_concurrency());
+    }
+}
+
+LookupServer::~LookupServer() {
+    Stop();
+}
+
+bool LookupServer::Start() {
+    std::lock_guard<std::mutex> lock(lifecycleMutex);
+    if (started) {
+        return true;
+    }
+    sockaddr_un address;
+    if (!FillAddress(config.socketPath, address)) {
+        return false;
+    }
+
+    // A socket file left behind by a crashed server is replaced, a live one is not
+    struct stat info;
+    if (lstat(config.socketPath.c_str(), &info) == 0) {
+        if (!S_ISSOCK(info.st_mode)) {
+            LogError("'%s' exists and is not a socket.", config.socketPath.c_str());
+            return false;
+        }
+        if (SocketInUse(address)) {
+            LogError("Another server is already listening on '%s'.", config.socketPath.c_str());
+            return false;
+        }
+        unlink(config.socketPath.c_str());
+    }
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listenFd < 0 || bind(listenFd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 ||
+        listen(listenFd, SOMAXCONN) != 0) {
+        LogError("Cannot listen on '%s': %s", config.socketPath.c_str(), std::strerror(errno));
+        if (listenFd >= 0) {
+            close(listenFd);
+            listenFd = -1;
+        }
+        return false;
+    }
+
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    epoll_event listenEvent{};
+    listenEvent.events = EPOLLIN;
+    listenEvent.data.u64 = kListenTag;
+    epoll_event wakeEvent{};
+    wakeEvent.events = EPOLLIN;
+    wakeEvent.data.u64 = kWakeTag;
+    if (epollFd < 0 || wakeFd < 0 || epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &listenEvent) != 0 ||
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &wakeEvent) != 0) {
+        LogError("Cannot set up the event loop: %s", std::strerror(errno));
+        for (int* fd : {&listenFd, &epollFd, &wakeFd}) {
+            if (*fd >= 0) {
+                close(*fd);
+                *fd = -1;
+            }
+        }
+        unlink(config.socketPath.c_str());
+        return false;
+    }
+
+    stopping.store(false);
+    for (size_t i = 0; i < config.workers; ++i) {
+        workers.emplace_back(&LookupServer::RunWorker, this);
+    }
+    loopThread = std::thread(&LookupServer::RunEventLoop, this);
+    started = true;
+    return true;
+}
+
+void LookupServer::Stop() {
+    std::lock_guard<std::mutex> lock(lifecycleMutex);
+    if (!started) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> jobLock(jobMutex);
+        stopping.store(true);
+    }
+    jobAvailable.notify_all();
+    uint64_t one = 1;
+    if (write(wakeFd, &one, sizeof(one)) < 0) {
+        LogError("Cannot wake the event loop: %s", std::strerror(errno));
+    }
+    loopThread.join();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+
+    close(listenFd);
+    close(epollFd);
+    close(wakeFd);
+    listenFd = epollFd = wakeFd = -1;
+    unlink(config.socketPath.c_str());
+    jobs.clear();
+    completions.clear();
+    started = false;
+}
+
+LookupServerStats LookupServer::GetStats() const {
+    LookupServerStats result;
+    result.accepted = accepted.load(std::memory_order_relaxed);
+    result.requests = requests.load(std::memory_order_relaxed);
+    result.inlineAnswers = inlineAnswers.load(std::memory_order_relaxed);
+    result.badRequests = badRequests.load(std::memory_order_relaxed);
+    result.backpressured = backpressured.load(std::memory_order_relaxed);
+    result.connections = openConnections.load(std::memory_order_relaxed);
+    return result;
+}
+
+void LookupServer::RunEventLoop() {
+    std::vector<epoll_event> events(kMaxEvents);
+    std::vector<uint64_t> touched; // Connections that got input or responses this round
+    while (!stopping.load()) {
+        int ready = epoll_wait(epollFd, events.data(), kMaxEvents, -1);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            LogError("epoll_wait failed: %s", std::strerror(errno));
+            break;
+        }
+        touched.clear();
+        for (int i = 0; i < ready; ++i) {
+            uint64_t tag = events[i].data.u64;
+            if (tag == kListenTag) {
+                Accept();
+                continue;
+            }
+            if (tag == kWakeTag) {
+                uint64_t count = 0;
+                if (read(wakeFd, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+                    LogError("Cannot read the wake-up event: %s", std::strerror(errno));
+                }
+                DrainCompletions(touched);
+                continue;
+            }
+            auto it = connections.find(tag);
+            if (it == connections.end()) {
+                continue; // Closed earlier in this round
+            }
+            if ((events[i].events & (EPOLLERR | EPOLLHUP)) && !(events[i].events & EPOLLIN)) {
+                CloseConnection(tag);
+                continue;
+            }
+            if ((events[i].events & EPOLLIN) && !HandleReadable(tag, it->second)) {
+                continue;
+            }
+            touched.push_back(tag);
+        }
+        // One write per connection for everything answered in this round
+        for (uint64_t tag : touched) {
+            auto it = connections.find(tag);
+            if (it != connections.end()) {
+                Service(tag, it->second);
+            }
+        }
+    }
+
+    while (!connections.empty()) {
+        CloseConnection(connections.begin()->first);
+    }
+}
+
+void LookupServer::Accept() {
+    while (true) {
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                LogError("accept failed: %s", std::strerror(errno));
+            }
+            return;
+        }
+        uint64_t id = nextConnectionId++;
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLRDHUP;
+        event.data.u64 = id;
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) != 0) {
+            LogError("Cannot watch a new connection: %s", std::strerror(errno));
+            close(fd);
+            continue;
+        }
+        connections[id].fd = fd;
+        accepted.fetch_add(1, std::memory_order_relaxed);
+        openConnections.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+bool LookupServer::HandleReadable(uint64_t connectionId, Connection& connection) {
+    while (!connection.peerClosed && !connection.closeAfterWrite && !Backpressured(connection)) {
+        // Parsed frames are dropped from the front before the buffer grows
+        if (connection.inputOffset == connection.input.size()) {
+            connection.input.clear();
+            connection.inputOffset = 0;
+        } else if (connection.inputOffset > kReadChunk) {
+            connection.input.erase(0, connection.inputOffset);
+            connection.inputOffset = 0;
+        }
+        size_t used = connection.input.size();
+        connection.input.resize(used + kReadChunk);
+        ssize_t got = read(connection.fd, connection.input.data() + used, kReadChunk);
+        connection.input.resize(used + (got > 0 ? static_cast<size_t>(got) : 0));
+        if (got > 0) {
+            ParseRequests(connectionId, connection);
+            if (static_cast<size_t>(got) < kReadChunk) {
+                break; // Drained for now; level-triggered epoll reports the rest
+            }
+        } else if (got == 0) {
+            connection.peerClosed = true; // Half-close: answer what was sent, then close
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            break;
+        } else {
+            CloseConnection(connectionId);
+            return false;
+        }
+    }
+    return true;
+}
+
+void LookupServer::ParseRequests(uint64_t connectionId, Connection& connection) {
+    std::vector<Job> batch;
+    std::vector<Contact> found;
+    while (!connection.closeAfterWrite && !Backpressured(connection) &&
+           connection.input.size() - connection.inputOffset >= kLookupHeaderSize) {
+        const char* frame = connection.input.data() + connection.inputOffset;
+        LookupFrameHeader header = ParseLookupHeader(frame);
+        LookupOp op = static_cast<LookupOp>(header.code);
+        if (header.length > kMaxLookupQueryBytes || header.code < static_cast<uint8_t>(LookupOp::Lookup) ||
+            header.code > static_cast<uint8_t>(LookupOp::Ping)) {
+            // The stream cannot be resynchronized after a bad frame
+            AppendLookupResponse(connection.output, header.id, LookupStatus::BadRequest, {});
+            connection.closeAfterWrite = true;
+            connection.input.clear();
+            connection.inputOffset = 0;
+            badRequests.fetch_add(1, std::memory_order_relaxed);
+            break;
+        }
+        if (connection.input.size() - connection.inputOffset < kLookupHeaderSize + header.length) {
+            break; // Rest of the body has not arrived yet
+        }
+        std::string query(frame + kLookupHeaderSize, header.length);
+        connection.inputOffset += kLookupHeaderSize + header.length;
+
+        if (op == LookupOp::Lookup || op == LookupOp::Ping) {
+            found.clear();
+            LookupStatus status = LookupStatus::Ok;
+            if (op == LookupOp::Lookup) {
+                // Safe on the loop: FindByPhone only reads the index published with the
+                // snapshot and never waits for a rebuild, so a write cannot stall it
+                std::optional<Contact> contact = book.FindByPhone(query);
+                if (contact) {
+                    found.push_back(std::move(*contact));
+                } else {
+                    status = LookupStatus::NotFound;
+                }
+            }
+            AppendLookupResponse(connection.output, header.id, status, found);
+            requests.fetch_add(1, std::memory_order_relaxed);
+            inlineAnswers.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            batch.push_back({connectionId, header.id, op, header.count, std::move(query)});
+            ++connection.inFlight;
+        }
+    }
+
+    if (!batch.empty()) {
+        {
+            std::lock_guard<std::mutex> lock(jobMutex);
+            for (Job& job : batch) {
+                jobs.push_back(std::move(job));
+            }
+        }
+        if (batch.size() == 1) {
+            jobAvailable.notify_one();
+        } else {
+            jobAvailable.notify_all();
+        }
+    }
+}
+
+void LookupServer::DrainCompletions(std::vector<uint64_t>& touched) {
+    std::vector<Completion> ready;
+    {
+        std::lock_guard<std::mutex> lock(completionMutex);
+        ready.swap(completions);
+    }
+    for (Completion& completion : ready) {
+        auto it = connections.find(completion.connection);
+        if (it == connections.end()) {
+            continue; // The client went away while its request was running
+        }
+        it->second.output += completion.frame;
+        --it->second.inFlight;
+        requests.fetch_add(1, std::memory_order_relaxed);
+        touched.push_back(completion.connection);
+    }
+}
+
+bool LookupServer::Service(uint64_t connectionId, Connection& connection) {
+    // Requests left in the buffer while the client was over its limits
+    if (connection.input.size() - connection.inputOffset >= kLookupHeaderSize) {
+        ParseRequests(connectionId, connection);
+    }
+
+    while (connection.outputOffset < connection.output.size()) {
+        ssize_t sent = send(connection.fd, connection.output.data() + connection.outputOffset,
+                            connection.output.size() - connection.outputOffset, MSG_NOSIGNAL);
+        if (sent > 0) {
+            connection.outputOffset += static_cast<size_t>(sent);
+        } else if (sent < 0 && errno == EINTR) {
+            continue;
+        } else if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        } else {
+            CloseConnection(connectionId);
+            return false;
+        }
+    }
+    if (connection.outputOffset == connection.output.size()) {
+        connection.output.clear();
+        connection.outputOffset = 0;
+    } else if (connection.outputOffset > kReadChunk) {
+        connection.output.erase(0, connection.outputOffset);
+        connection.outputOffset = 0;
+    }
+
+    // Once nothing is pending, whatever is still buffered can only be a partial frame
+    bool drained = connection.output.empty() && connection.inFlight == 0;
+    if (drained && (connection.closeAfterWrite || connection.peerClosed)) {
+        CloseConnection(connectionId);
+        return false;
+    }
+
+    bool wantRead = !connection.peerClosed && !connection.closeAfterWrite && !Backpressured(connection);
+    bool wantWrite = !connection.output.empty();
+    if (wantRead != connection.reading || wantWrite != connection.writing) {
+        if (!wantRead && connection.reading && !connection.peerClosed && !connection.closeAfterWrite) {
+            backpressured.fetch_add(1, std::memory_order_relaxed);
+        }
+        epoll_event event{};
+        event.events = (wantRead ? EPOLLIN | EPOLLRDHUP : 0u) | (wantWrite ? EPOLLOUT : 0u);
+        event.data.u64 = connectionId;
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, connection.fd, &event);
+        connection.reading = wantRead;
+        connection.writing = wantWrite;
+    }
+    return true;
+}
+
+bool LookupServer::Backpressured(const Connection& connection) const {
+    return connection.inFlight >= config.maxInFlightPerConnection ||
+           connection.output.size() - connection.outputOffset >= config.maxOutputPerConnection;
+}
+
+void LookupServer::CloseConnection(uint64_t connectionId) {
+    auto it = connections.find(connectionId);
+    if (it == connections.end()) {
+        return;
+    }
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, it->second.fd, nullptr);
+    close(it->second.fd);
+    connections.erase(it);
+    openConnections.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void LookupServer::RunWorker() {
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(jobMutex);
+            jobAvailable.wait(lock, [this]() { return stopping.load() || !jobs.empty(); });
+            if (stopping.load()) {
+                return;
+            }
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+        Completion completion{job.connection, Answer(job)};
+        bool wasEmpty;
+        {
+            std::lock_guard<std::mutex> lock(completionMutex);
+            wasEmpty = completions.empty();
+            completions.push_back(std::move(completion));
+        }
+        // The loop takes all completions at once, so only the first one needs a wake-up
+        uint64_t one = 1;
+        if (wasEmpty && write(wakeFd, &one, sizeof(one)) < 0) {
+            LogError("Cannot wake the event loop: %s", std::strerror(errno));
+        }
+    }
+}
+
+std::string LookupServer::Answer(const Job& job) {
+    size_t limit = job.limit == 0 ? kDefaultLookupLimit : job.limit;
+    std::vector<Contact> results;
+    switch (job.op) {
+        case LookupOp::Search:
+            results = book.SearchContacts(job.query);
+            break;
+        case LookupOp::Prefix:
+            results = book.SearchByPhonePrefix(job.query, limit);
+            break;
+        case LookupOp::Structured:
+            results = book.SearchStructured(job.query);
+            break;
+        default:
+            break;
+    }
+    if (results.size() > limit) {
+        results.resize(limit);
+    }
+    std::string frame;
+    AppendLookupResponse(frame, job.id, LookupStatus::Ok, results);
+    return frame;
+}
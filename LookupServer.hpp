@@ -0,0 +1,134 @@
+#ifndef LOOKUPSERVER_HPP
+#define LOOKUPSERVER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "LookupProtocol.hpp"
+
+class TelephoneBookLogic;
+
+struct LookupServerConfig {
+    std::string socketPath = "phonebookd.sock";
+    size_t workers = 0;                     // Threads answering searches (0 = one per core)
+    size_t maxInFlightPerConnection = 1024; // Reading from a client pauses beyond this...
+    size_t maxOutputPerConnection = 4 * 1024 * 1024; // ...or when this many response bytes are unsent
+};
+
+// Totals since Start().
+struct LookupServerStats {
+    uint64_t accepted = 0;     // Connections accepted
+    uint64_t requests = 0;     // Requests answered
+    uint64_t inlineAnswers = 0; // Of those, answered on the event loop (lookups and pings)
+    uint64_t badRequests = 0;
+    uint64_t backpressured = 0; // Times reading from a client was paused
+    size_t connections = 0;     // Currently open
+};
+
+// Serves one in-memory book to other processes over a Unix domain socket (the
+// protocol is in LookupProtocol.hpp). A single epoll thread accepts connections,
+// reads and parses pipelined requests and writes responses. Exact lookups and pings
+// take about a microsecond against the current snapshot, so the loop answers them
+// itself; searches go to a pool of worker threads, whose responses are handed back
+// through an eventfd and written in one batch per connection. Lookups stay that cheap
+// right after a write (ours or one picked up by StartChangeWatch()) because the book's
+// writer patches the phone index before publishing; FindByPhone never builds one.
+class LookupServer {
+public:
+    // 'book' must outlive the server.
+    LookupServer(TelephoneBookLogic& book, LookupServerConfig config = LookupServerConfig());
+    ~LookupServer();
+
+    LookupServer(const LookupServer&) = delete;
+    LookupServer& operator=(const LookupServer&) = delete;
+
+    // Binds the socket (replacing a stale socket file, refusing one another server is
+    // listening on) and starts the threads. Logs and returns false on failure.
+    bool Start();
+    // Closes every connection, joins the threads and removes the socket file. Safe to
+    // call from any thread and more than once.
+    void Stop();
+
+    LookupServerStats GetStats() const;
+
+private:
+    struct Connection {
+        int fd = -1;
+        std::string input;
+        size_t inputOffset = 0;  // Start of the first unparsed frame in 'input'
+        std::string output;
+        size_t outputOffset = 0; // Bytes of 'output' already written
+        size_t inFlight = 0;     // Requests handed to the workers and not yet answered
+        bool reading = true;     // EPOLLIN registered
+        bool writing = false;    // EPOLLOUT registered
+        bool peerClosed = false; // Close once everything has been answered
+        bool closeAfterWrite = false;
+    };
+
+    struct Job {
+        uint64_t connection = 0;
+        uint32_t id = 0;
+        LookupOp op = LookupOp::Ping;
+        uint16_t limit = 0;
+        std::string query;
+    };
+
+    struct Completion {
+        uint64_t connection = 0;
+        std::string frame;
+    };
+
+    void RunEventLoop();
+    void RunWorker();
+    void Accept();
+    // Reads and parses what the client sent; false if the connection was closed.
+    bool HandleReadable(uint64_t connectionId, Connection& connection);
+    void ParseRequests(uint64_t connectionId, Connection& connection);
+    void DrainCompletions(std::vector<uint64_t>& touched);
+    // Parses requests held back by backpressure, writes pending output, updates the
+    // epoll interest and closes the connection once it is finished (returning false).
+    bool Service(uint64_t connectionId, Connection& connection);
+    bool Backpressured(const Connection& connection) const;
+    void CloseConnection(uint64_t connectionId);
+    std::string Answer(const Job& job);
+
+    TelephoneBookLogic& book;
+    LookupServerConfig config;
+
+    int listenFd = -1;
+    int epollFd = -1;
+    int wakeFd = -1; // eventfd: completions are ready or Stop() was called
+    std::atomic<bool> stopping{false};
+    bool started = false;
+    std::mutex lifecycleMutex; // Serializes Start() and Stop()
+
+    // Owned by the event loop thread
+    std::unordered_map<uint64_t, Connection> connections;
+    uint64_t nextConnectionId = 2; // 0 and 1 tag the listening socket and the eventfd
+
+    std::mutex jobMutex;
+    std::condition_variable jobAvailable;
+    std::deque<Job> jobs;
+
+    std::mutex completionMutex;
+    std::vector<Completion> completions;
+
+    std::thread loopThread;
+    std::vector<std::thread> workers;
+
+    // Updated by the event loop only, read by GetStats() from any thread
+    std::atomic<uint64_t> accepted{0};
+    std::atomic<uint64_t> requests{0};
+    std::atomic<uint64_t> inlineAnswers{0};
+    std::atomic<uint64_t> badRequests{0};
+    std::atomic<uint64_t> backpressured{0};
+    std::atomic<size_t> openConnections{0};
+};
+
+#endif // LOOKUPSERVER_HPP
@@ -0,0 +1,233 @@
+#include "Metrics.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <fstream>
+
+const char* MetricOpName(MetricOp op) {
+    switch (op) {
+        case MetricOp::Add: return "add";
+        case MetricOp::Import: return "import";
+        case MetricOp::Search: return "search";
+        case MetricOp::FuzzySearch: return "fuzzy_search";
+        case MetricOp::PhoneticSearch: return "phonetic_search";
+        case MetricOp::PhonePrefixSearch: return "phone_prefix_search";
+        case MetricOp::EmailDomainSearch: return "email_domain_search";
+        case MetricOp::StructuredSearch: return "structured_search";
+        case MetricOp::Lookup: return "lookup";
+        case MetricOp::Edit: return "edit";
+        case MetricOp::Delete: return "delete";
+        case MetricOp::Sort: return "sort";
+        case MetricOp::Load: return "load";
+        case MetricOp::Count: break;
+    }
+    return "unknown";
+}
+
+// --- LatencyHistogram ---
+
+size_t LatencyHistogram::BucketIndex(uint64_t nanos) {
+    if (nanos < kSubBuckets) {
+        return static_cast<size_t>(nanos);
+    }
+    int msb = 63 - std::countl_zero(nanos);
+    int shift = msb - kSubBucketBits;
+    return static_cast<size_t>(shift + 1) * kSubBuckets + static_cast<size_t>((nanos >> shift) & (kSubBuckets - 1));
+}
+
+uint64_t LatencyHistogram::BucketUpperBound(size_t index) {
+    if (index < kSubBuckets) {
+        return index;
+    }
+    int shift = static_cast<int>(index / kSubBuckets) - 1;
+    uint64_t lower = (kSubBuckets + index % kSubBuckets) << shift;
+    return lower + ((uint64_t(1) << shift) - 1);
+}
+
+void LatencyHistogram::Record(uint64_t nanos) {
+    buckets[BucketIndex(nanos)].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    sumNanos.fetch_add(nanos, std::memory_order_relaxed);
+    uint64_t previous = maxNanos.load(std::memory_order_relaxed);
+    while (nanos > previous && !maxNanos.compare_exchange_weak(previous, nanos, std::memory_order_relaxed)) {
+    }
+}
+
+HistogramSnapshot LatencyHistogram::Snapshot() const {
+    HistogramSnapshot snapshot;
+    snapshot.buckets.resize(kBucketCount);
+    uint64_t total = 0;
+    for (size_t i = 0; i < kBucketCount; ++i) {
+        snapshot.buckets[i] = buckets[i].load(std::memory_order_relaxed);
+        total += snapshot.buckets[i];
+    }
+    // Use the bucket total so count and buckets always agree, even while recording.
+    snapshot.count = total;
+    snapshot.sumNanos = sumNanos.load(std::memory_order_relaxed);
+    snapshot.maxNanos = maxNanos.load(std::memory_order_relaxed);
+    return snapshot;
+}
+
+uint64_t HistogramSnapshot::Percentile(double p) const {
+    if (count == 0) {
+        return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(p / 100.0 * static_cast<double>(count) + 0.5);
+    rank = std::clamp<uint64_t>(rank, 1, count);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            return std::min(LatencyHistogram::BucketUpperBound(i), maxNanos);
+        }
+    }
+    return maxNanos;
+}
+
+uint64_t HistogramSnapshot::CountAtOrBelow(uint64_t nanos) const {
+    uint64_t total = 0;
+    for (size_t i = 0; i < buckets.size() && LatencyHistogram::BucketUpperBound(i) <= nanos; ++i) {
+        total += buckets[i];
+    }
+    return total;
+}
+
+// --- MetricsRegistry ---
+
+void MetricsRegistry::RecordStatement(sqlite3_stmt* stmt) {
+    if (!stmt) {
+        return;
+    }
+    sqliteStatements.fetch_add(1, std::memory_order_relaxed);
+    sqliteSteps.fetch_add(static_cast<uint64_t>(sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_VM_STEP, 1)),
+                          std::memory_order_relaxed);
+    rowsScanned.fetch_add(static_cast<uint64_t>(sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_FULLSCAN_STEP, 1)),
+                          std::memory_order_relaxed);
+}
+
+MetricsSnapshot MetricsRegistry::Snapshot() const {
+    MetricsSnapshot snapshot;
+    for (size_t i = 0; i < latency.size(); ++i) {
+        snapshot.latency[i] = latency[i].Snapshot();
+    }
+    snapshot.rowsScanned = rowsScanned.load(std::memory_order_relaxed);
+    snapshot.rowsReturned = rowsReturned.load(std::memory_order_relaxed);
+    snapshot.sqliteSteps = sqliteSteps.load(std::memory_order_relaxed);
+    snapshot.sqliteStatements = sqliteStatements.load(std::memory_order_relaxed);
+    return snapshot;
+}
+
+// --- MetricsSnapshot ---
+
+double MetricsSnapshot::CacheHitRatio() const {
+    uint64_t lookups = statementCacheHits + statementCacheMisses;
+    return lookups == 0 ? 0.0 : static_cast<double>(statementCacheHits) / static_cast<double>(lookups);
+}
+
+std::string MetricsSnapshot::ToPrometheusText() const {
+    // Coarse, fixed bucket boundaries for the exported histogram; the fine-grained
+    // HDR buckets are summarized separately as quantile gauges.
+    static const uint64_t kExportBoundsNanos[] = {
+        1000, 5000, 10000, 50000, 100000, 500000, 1000000, 5000000,
+        10000000, 50000000, 100000000, 500000000, 1000000000, 5000000000ULL
+    };
+    static const double kQuantiles[] = {0.5, 0.9, 0.99, 0.999};
+
+    std::string out;
+    char line[256];
+
+    out += "# HELP phonebook_operation_duration_seconds Latency of TelephoneBookLogic operations.\n";
+    out += "# TYPE phonebook_operation_duration_seconds histogram\n";
+    for (size_t i = 0; i < latency.size(); ++i) {
+        const char* op = MetricOpName(static_cast<MetricOp>(i));
+        const HistogramSnapshot& h = latency[i];
+        for (uint64_t bound : kExportBoundsNanos) {
+            std::snprintf(line, sizeof(line), "phonebook_operation_duration_seconds_bucket{op=\"%s\",le=\"%g\"} %llu\n",
+                          op, static_cast<double>(bound) / 1e9, static_cast<unsigned long long>(h.CountAtOrBelow(bound)));
+            out += line;
+        }
+        std::snprintf(line, sizeof(line), "phonebook_operation_duration_seconds_bucket{op=\"%s\",le=\"+Inf\"} %llu\n",
+                      op, static_cast<unsigned long long>(h.count));
+        out += line;
+        std::snprintf(line, sizeof(line), "phonebook_operation_duration_seconds_sum{op=\"%s\"} %.9f\n",
+                      op, static_cast<double>(h.sumNanos) / 1e9);
+        out += line;
+        std::snprintf(line, sizeof(line), "phonebook_operation_duration_seconds_count{op=\"%s\"} %llu\n",
+                      op, static_cast<unsigned long long>(h.count));
+        out += line;
+    }
+
+    out += "# HELP phonebook_operation_duration_quantile_seconds Latency quantiles from the HDR histogram.\n";
+    out += "# TYPE phonebook_operation_duration_quantile_seconds gauge\n";
+    for (size_t i = 0; i < latency.size(); ++i) {
+        const char* op = MetricOpName(static_cast<MetricOp>(i));
+        for (double q : kQuantiles) {
+            std::snprintf(line, sizeof(line), "phonebook_operation_duration_quantile_seconds{op=\"%s\",quantile=\"%g\"} %.9f\n",
+                          op, q, static_cast<double>(latency[i].Percentile(q * 100.0)) / 1e9);
+            out += line;
+        }
+    }
+
+    auto counter = [&](const char* name, const char* help, uint64_t value) {
+        std::snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s counter\n%s %llu\n",
+                      name, help, name, name, static_cast<unsigned long long>(value));
+        out += line;
+    };
+    counter("phonebook_rows_scanned_total", "Rows visited by scans.", rowsScanned);
+    counter("phonebook_rows_returned_total", "Rows returned to callers.", rowsReturned);
+    counter("phonebook_sqlite_steps_total", "SQLite virtual machine steps.", sqliteSteps);
+    counter("phonebook_sqlite_statements_total", "SQLite statements executed.", sqliteStatements);
+    counter("phonebook_statement_cache_hits_total", "Prepared statements reused from the cache.", statementCacheHits);
+    counter("phonebook_statement_cache_misses_total", "Prepared statements compiled on a cache miss.", statementCacheMisses);
+    counter("phonebook_search_cache_hits_total", "Searches answered from the result cache.", searchCacheHits);
+    counter("phonebook_search_cache_misses_total", "Searches that had to query the database.", searchCacheMisses);
+
+    std::snprintf(line, sizeof(line), "# HELP phonebook_statement_cache_hit_ratio Statement cache hit ratio.\n"
+                                      "# TYPE phonebook_statement_cache_hit_ratio gauge\n"
+                                      "phonebook_statement_cache_hit_ratio %.6f\n", CacheHitRatio());
+    out += line;
+    return out;
+}
+
+// --- MetricsFileDumper ---
+
+MetricsFileDumper::MetricsFileDumper(std::function<MetricsSnapshot()> source, std::string path,
+                                     std::chrono::milliseconds interval)
+    : source(std::move(source)), path(std::move(path)), interval(interval) {
+    worker = std::thread(&MetricsFileDumper::Run, this);
+}
+
+MetricsFileDumper::~MetricsFileDumper() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+    worker.join();
+    DumpNow();
+}
+
+bool MetricsFileDumper::DumpNow() {
+    std::string text = source().ToPrometheusText();
+    std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream out(tmpPath, std::ios::trunc);
+        out << text;
+        if (!out) {
+            return false;
+        }
+    }
+    return std::rename(tmpPath.c_str(), path.c_str()) == 0;
+}
+
+void MetricsFileDumper::Run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        if (wakeUp.wait_for(lock, interval, [this]() { return stopping; })) {
+            break;
+        }
+        lock.unlock();
+        DumpNow();
+        lock.lock();
+    }
+}
@@ -0,0 +1,159 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sqlite3.h>
+
+// Operations that get their own latency histogram.
+enum class MetricOp {
+    Add,
+    Import,
+    Search,
+    FuzzySearch,
+    PhoneticSearch,
+    PhonePrefixSearch,
+    EmailDomainSearch,
+    StructuredSearch,
+    Lookup,
+    Edit,
+    Delete,
+    Sort,
+    Load,
+    Count // Number of operations, not an operation
+};
+
+const char* MetricOpName(MetricOp op);
+
+// Copy of a LatencyHistogram at one point in time.
+struct HistogramSnapshot {
+    uint64_t count = 0;
+    uint64_t sumNanos = 0;
+    uint64_t maxNanos = 0;
+    std::vector<uint64_t> buckets; // Same layout as LatencyHistogram
+
+    // Value (in ns) at or below which 'p' percent of the samples fall, accurate to
+    // the bucket width (about 6%).
+    uint64_t Percentile(double p) const;
+    // Number of samples whose bucket lies entirely at or below 'nanos'.
+    uint64_t CountAtOrBelow(uint64_t nanos) const;
+};
+
+// HDR-style log-linear histogram of durations in nanoseconds.
+// Every power of two is split into 16 linear sub-buckets, so the relative error is
+// below 1/16 over the whole range from 1 ns to hours, with a fixed 8 KB footprint.
+// Recording is a handful of relaxed atomic increments and never blocks.
+class LatencyHistogram {
+public:
+    static constexpr int kSubBucketBits = 4;
+    static constexpr size_t kSubBuckets = size_t(1) << kSubBucketBits;
+    static constexpr size_t kBucketCount = (64 - kSubBucketBits + 1) * kSubBuckets;
+
+    void Record(uint64_t nanos);
+    HistogramSnapshot Snapshot() const;
+
+    static size_t BucketIndex(uint64_t nanos);
+    static uint64_t BucketUpperBound(size_t index);
+
+private:
+    std::array<std::atomic<uint64_t>, kBucketCount> buckets{};
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> sumNanos{0};
+    std::atomic<uint64_t> maxNanos{0};
+};
+
+// Everything GetMetrics() reports, copied out of the registry.
+struct MetricsSnapshot {
+    std::array<HistogramSnapshot, static_cast<size_t>(MetricOp::Count)> latency;
+    uint64_t rowsScanned = 0;          // Rows visited (SQLite full-scan steps + in-memory scans)
+    uint64_t rowsReturned = 0;         // Rows handed back to callers
+    uint64_t sqliteSteps = 0;          // SQLite virtual machine steps (SQLITE_STMTSTATUS_VM_STEP)
+    uint64_t sqliteStatements = 0;     // Statements executed
+    uint64_t statementCacheHits = 0;   // Prepared statements reused from the read pool
+    uint64_t statementCacheMisses = 0;
+    uint64_t searchCacheHits = 0;      // SearchContacts calls answered from the result cache
+    uint64_t searchCacheMisses = 0;
+
+    const HistogramSnapshot& For(MetricOp op) const { return latency[static_cast<size_t>(op)]; }
+    double CacheHitRatio() const;
+
+    // Prometheus text exposition format (suitable for node_exporter's textfile collector).
+    std::string ToPrometheusText() const;
+};
+
+// Lock-free counters and histograms filled in by TelephoneBookLogic.
+class MetricsRegistry {
+public:
+    LatencyHistogram& Latency(MetricOp op) { return latency[static_cast<size_t>(op)]; }
+
+    void AddRowsScanned(uint64_t rows) { rowsScanned.fetch_add(rows, std::memory_order_relaxed); }
+    void AddRowsReturned(uint64_t rows) { rowsReturned.fetch_add(rows, std::memory_order_relaxed); }
+
+    // Folds a statement's step counters into the registry and resets them on the
+    // statement, so cached statements can be recorded after every use.
+    void RecordStatement(sqlite3_stmt* stmt);
+
+    MetricsSnapshot Snapshot() const;
+
+private:
+    std::array<LatencyHistogram, static_cast<size_t>(MetricOp::Count)> latency;
+    std::atomic<uint64_t> rowsScanned{0};
+    std::atomic<uint64_t> rowsReturned{0};
+    std::atomic<uint64_t> sqliteSteps{0};
+    std::atomic<uint64_t> sqliteStatements{0};
+};
+
+// Records the lifetime of the object into a histogram.
+class ScopedLatency {
+public:
+    explicit ScopedLatency(LatencyHistogram& histogram)
+        : histogram(histogram), start(std::chrono::steady_clock::now()) {}
+    ~ScopedLatency() {
+        histogram.Record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count()));
+    }
+
+    ScopedLatency(const ScopedLatency&) = delete;
+    ScopedLatency& operator=(const ScopedLatency&) = delete;
+
+private:
+    LatencyHistogram& histogram;
+    std::chrono::steady_clock::time_point start;
+};
+
+// Background thread that periodically writes a metrics snapshot to a local file in
+// Prometheus text format. The file is written to '<path>.tmp' and renamed, so a
+// scraper never reads a half-written file.
+class MetricsFileDumper {
+public:
+    MetricsFileDumper(std::function<MetricsSnapshot()> source, std::string path,
+                      std::chrono::milliseconds interval);
+    ~MetricsFileDumper(); // Writes a final dump and stops the thread
+
+    MetricsFileDumper(const MetricsFileDumper&) = delete;
+    MetricsFileDumper& operator=(const MetricsFileDumper&) = delete;
+
+    bool DumpNow();
+
+private:
+    void Run();
+
+    std::function<MetricsSnapshot()> source;
+    std::string path;
+    std::chrono::milliseconds interval;
+
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    bool stopping = false;
+    std::thread worker;
+};
+
+#endif // METRICS_HPP
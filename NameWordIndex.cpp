@@ -0,0 +1,95 @@
+#include "NameWordIndex.hpp"
+#include <algorithm>
+
+namespace {
+
+std::string ToLowerAscii(std::string text) {
+    for (char& c : text) {
+        if (c >= 'A' && c <= 'Z') {
+            c = static_cast<char>(c - 'A' + 'a');
+        }
+    }
+    return text;
+}
+
+void AddWords(const std::string& name, uint32_t position, std::vector<std::pair<std::string, uint32_t>>& words) {
+    size_t start = 0;
+    while (start < name.size()) {
+        // Same word separators as the fuzzy and phonetic keys
+        size_t end = name.find_first_of(" \t-,.", start);
+        if (end == std::string::npos) {
+            end = name.size();
+        }
+        if (end > start) {
+            words.emplace_back(ToLowerAscii(name.substr(start, end - start)), position);
+        }
+        start = end + 1;
+    }
+}
+
+} // namespace
+
+NameWordIndex::NameWordIndex(const std::vector<std::string>& utf8Names) {
+    for (size_t position = 0; position < utf8Names.size(); ++position) {
+        AddWords(utf8Names[position], static_cast<uint32_t>(position), words);
+    }
+    std::sort(words.begin(), words.end());
+}
+
+NameWordIndex::NameWordIndex(const NameWordIndex& previous, const SnapshotDelta& delta,
+                             const std::vector<std::string>& addedNames) {
+    std::vector<std::pair<std::string, uint32_t>> added;
+    for (size_t i = 0; i < addedNames.size(); ++i) {
+        AddWords(addedNames[i], delta.added[i], added);
+    }
+    std::sort(added.begin(), added.end());
+
+    // The remap keeps survivors in (word, position) order, so only the additions need
+    // slotting in
+    words.reserve(previous.words.size() + added.size());
+    size_t next = 0;
+    for (const auto& entry : previous.words) {
+        uint32_t position = delta.remap[entry.second];
+        if (position == SnapshotDelta::kRemoved) {
+            continue;
+        }
+        while (next < added.size() && (added[next].first != entry.first ? added[next].first < entry.first
+                                                                         : added[next].second < position)) {
+            words.push_back(std::move(added[next++]));
+        }
+        words.emplace_back(entry.first, position);
+    }
+    for (; next < added.size(); ++next) {
+        words.push_back(std::move(added[next]));
+    }
+}
+
+std::pair<size_t, size_t> NameWordIndex::Range(const std::string& word, bool prefix) const {
+    std::string key = ToLowerAscii(word);
+    auto byWord = [](const std::pair<std::string, uint32_t>& entry, const std::string& value) { return entry.first < value; };
+    auto first = std::lower_bound(words.begin(), words.end(), key, byWord);
+    // char_traits<char> compares bytes as unsigned, so "\xff" sorts after any UTF-8 continuation.
+    auto last = prefix ? std::lower_bound(first, words.end(), key + '\xff', byWord)
+                       : std::upper_bound(first, words.end(), key,
+                                          [](const std::string& value, const std::pair<std::string, uint32_t>& entry) {
+                                              return value < entry.first;
+                                          });
+    return {static_cast<size_t>(first - words.begin()), static_cast<size_t>(last - words.begin())};
+}
+
+std::vector<uint32_t> NameWordIndex::Find(const std::string& word, bool prefix) const {
+    auto range = Range(word, prefix);
+    std::vector<uint32_t> positions;
+    positions.reserve(range.second - range.first);
+    for (size_t i = range.first; i < range.second; ++i) {
+        positions.push_back(words[i].second);
+    }
+    std::sort(positions.begin(), positions.end());
+    positions.erase(std::unique(positions.begin(), positions.end()), positions.end());
+    return positions;
+}
+
+size_t NameWordIndex::Count(const std::string& word, bool prefix) const {
+    auto range = Range(word, prefix);
+    return range.second - range.first;
+}
@@ -0,0 +1,35 @@
+#ifndef NAMEWORDINDEX_HPP
+#define NAMEWORDINDEX_HPP
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include "SnapshotIndex.hpp"
+
+// Sorted (word, position) pairs for every word of every name: the in-memory
+// equivalent of a B-tree over name words. Exact words and word prefixes are one
+// contiguous range each. Words are lower-cased for ASCII; callers lower-case other
+// scripts before building and searching.
+class NameWordIndex {
+public:
+    explicit NameWordIndex(const std::vector<std::string>& utf8Names);
+    // The index of the list 'delta' made from the one 'previous' was built from, in one
+    // merge pass; 'addedNames' are the names at delta.added, in the same order.
+    NameWordIndex(const NameWordIndex& previous, const SnapshotDelta& delta, const std::vector<std::string>& addedNames);
+
+    // Positions of names with a word equal to (or, with 'prefix', starting with)
+    // 'word', sorted and without duplicates.
+    std::vector<uint32_t> Find(const std::string& word, bool prefix) const;
+
+    // Number of matching words; an upper bound on Find().size() found with two
+    // binary searches.
+    size_t Count(const std::string& word, bool prefix) const;
+
+private:
+    std::pair<size_t, size_t> Range(const std::string& word, bool prefix) const;
+
+    std::vector<std::pair<std::string, uint32_t>> words; // Sorted by word, then position
+};
+
+#endif // NAMEWORDINDEX_HPP
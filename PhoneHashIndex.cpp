@@ -0,0 +1,117 @@
+#include "PhoneHashIndex.hpp"
+#include "PhonePrefixIndex.hpp"
+#include <algorithm>
+
+namespace {
+
+// Numbers per FindMany() round: enough misses in flight to hide memory latency,
+// few enough that the prefetched buckets are still cached when they are probed.
+constexpr size_t kBatch = 16;
+
+// Longest number normalized on the stack; longer ones (never real numbers) allocate.
+constexpr size_t kKeyBuffer = 64;
+
+uint64_t HashKey(std::string_view key) {
+    // FNV-1a, as in SharedPhoneTable: numbers are short, so no setup cost pays off
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (char c : key) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+
+} // namespace
+
+PhoneHashIndex::PhoneHashIndex(const std::vector<Contact>& contacts, bool normalized) : normalized(normalized) {
+    size_t bucketCount = 16;
+    while (bucketCount < contacts.size() * 2) {
+        bucketCount *= 2;
+    }
+    buckets.assign(bucketCount, Bucket{0, 0, 0, 0});
+
+    size_t mask = bucketCount - 1;
+    for (size_t position = 0; position < contacts.size(); ++position) {
+        std::string stored;
+        std::string_view key = contacts[position].GetPhone();
+        if (normalized) {
+            stored = NormalizePhone(contacts[position].GetPhone());
+            key = stored;
+        }
+        uint64_t hash = HashKey(key);
+        if (key.empty() || Probe(key, hash) != npos) {
+            continue; // The first contact with a number wins, as in FindByPhone()
+        }
+        size_t slot = static_cast<size_t>(hash) & mask;
+        while (buckets[slot].keyLength != 0) {
+            slot = (slot + 1) & mask;
+        }
+        buckets[slot] = Bucket{static_cast<uint32_t>(hash >> 32), static_cast<uint32_t>(keys.size()),
+                               static_cast<uint32_t>(key.size()), static_cast<uint32_t>(position)};
+        keys.append(key);
+        ++size;
+    }
+}
+
+std::string_view PhoneHashIndex::Key(std::string_view phone, char* buffer, size_t bufferSize,
+                                     std::string& spill) const {
+    if (!normalized) {
+        return phone;
+    }
+    if (phone.size() > bufferSize) {
+        spill = NormalizePhone(std::string(phone));
+        return spill;
+    }
+    // NormalizePhone() without the allocation: digits only, "00" prefix dropped
+    size_t length = 0;
+    for (char c : phone) {
+        if (c >= '0' && c <= '9') {
+            buffer[length++] = c;
+        }
+    }
+    if (length >= 2 && buffer[0] == '0' && buffer[1] == '0') {
+        return std::string_view(buffer + 2, length - 2);
+    }
+    return std::string_view(buffer, length);
+}
+
+size_t PhoneHashIndex::Find(std::string_view phone) const {
+    char buffer[kKeyBuffer];
+    std::string spill;
+    std::string_view key = Key(phone, buffer, sizeof(buffer), spill);
+    return Probe(key, HashKey(key));
+}
+
+void PhoneHashIndex::FindMany(const std::string_view* phones, size_t count, size_t* positions) const {
+    char buffers[kBatch][kKeyBuffer];
+    std::string spills[kBatch];
+    std::string_view batchKeys[kBatch];
+    uint64_t hashes[kBatch];
+    size_t mask = buckets.size() - 1;
+    for (size_t first = 0; first < count; first += kBatch) {
+        size_t batch = std::min(kBatch, count - first);
+        for (size_t i = 0; i < batch; ++i) {
+            batchKeys[i] = Key(phones[first + i], buffers[i], kKeyBuffer, spills[i]);
+            hashes[i] = HashKey(batchKeys[i]);
+            __builtin_prefetch(&buckets[static_cast<size_t>(hashes[i]) & mask]);
+        }
+        for (size_t i = 0; i < batch; ++i) {
+            positions[first + i] = Probe(batchKeys[i], hashes[i]);
+        }
+    }
+}
+
+size_t PhoneHashIndex::Probe(std::string_view key, uint64_t hash) const {
+    if (key.empty()) {
+        return npos;
+    }
+    uint32_t tag = static_cast<uint32_t>(hash >> 32);
+    size_t mask = buckets.size() - 1;
+    for (size_t slot = static_cast<size_t>(hash) & mask; buckets[slot].keyLength != 0; slot = (slot + 1) & mask) {
+        const Bucket& bucket = buckets[slot];
+        if (bucket.tag == tag && std::string_view(keys.data() + bucket.keyOffset, bucket.keyLength) == key) {
+            return bucket.position;
+        }
+    }
+    return npos;
+}
@@ -0,0 +1,54 @@
+#ifndef PHONEHASHINDEX_HPP
+#define PHONEHASHINDEX_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Contact.hpp"
+
+// Exact phone number -> position map over a contact list, for bulk joins that cannot
+// afford even the O(log N) PhonePrefixIndex lookup per row (see enrich.cpp). One flat
+// bucket array with linear probing and all keys in a single string pool, so a lookup
+// is one hash and usually one or two cache misses, and never allocates.
+class PhoneHashIndex {
+public:
+    static constexpr size_t npos = SIZE_MAX;
+
+    // With 'normalized' numbers are keyed by NormalizePhone() (see PhonePrefixIndex.hpp),
+    // so "+49 30 1234" finds "004930 1234"; otherwise they must match byte for byte.
+    explicit PhoneHashIndex(const std::vector<Contact>& contacts, bool normalized = false);
+
+    // Position of the first contact with this number, or npos.
+    size_t Find(std::string_view phone) const;
+
+    // Find() for 'count' numbers at once. Hashes all of them and prefetches their
+    // buckets before probing any, so the cache misses overlap instead of queuing up;
+    // several times faster than single lookups once the table outgrows the cache.
+    void FindMany(const std::string_view* phones, size_t count, size_t* positions) const;
+
+    size_t Size() const { return size; }
+    bool IsNormalized() const { return normalized; }
+
+private:
+    // Self-contained, so a probe touches only the bucket and then the key bytes.
+    struct Bucket {
+        uint32_t tag;       // High half of the key's hash
+        uint32_t keyOffset; // Into 'keys'
+        uint32_t keyLength; // 0 = empty (empty numbers are not indexed)
+        uint32_t position;  // Of the contact in the indexed list
+    };
+
+    // The number as stored in the table: itself, or normalized into 'buffer' (or 'spill'
+    // when it does not fit).
+    std::string_view Key(std::string_view phone, char* buffer, size_t bufferSize, std::string& spill) const;
+    size_t Probe(std::string_view key, uint64_t hash) const;
+
+    bool normalized;
+    size_t size = 0;
+    std::vector<Bucket> buckets; // Power-of-two size, at most half full
+    std::string keys;
+};
+
+#endif // PHONEHASHINDEX_HPP
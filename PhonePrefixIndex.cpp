@@ -0,0 +1,104 @@
+#include "PhonePrefixIndex.hpp"
+#include <algorithm>
+#include <numeric>
+
+std::string NormalizePhone(const std::string& phone) {
+    std::string digits;
+    digits.reserve(phone.size());
+    for (char c : phone) {
+        if (c >= '0' && c <= '9') {
+            digits.push_back(c);
+        }
+    }
+    // "+" is not a digit and is already gone; "00" is the same international prefix.
+    if (digits.size() >= 2 && digits[0] == '0' && digits[1] == '0') {
+        digits.erase(0, 2);
+    }
+    return digits;
+}
+
+PhonePrefixIndex::PhonePrefixIndex(const std::vector<std::string>& rawPhones) {
+    std::vector<std::string> normalized;
+    normalized.reserve(rawPhones.size());
+    for (const std::string& phone : rawPhones) {
+        normalized.push_back(NormalizePhone(phone));
+    }
+
+    // Sort a permutation and then lay the numbers out in that order.
+    std::vector<uint32_t> order(normalized.size());
+    std::iota(order.begin(), order.end(), 0u);
+    std::sort(order.begin(), order.end(), [&normalized](uint32_t a, uint32_t b) {
+        return normalized[a] != normalized[b] ? normalized[a] < normalized[b] : a < b;
+    });
+    phones.reserve(order.size());
+    for (uint32_t position : order) {
+        phones.push_back(std::move(normalized[position]));
+    }
+    positions = std::move(order);
+}
+
+PhonePrefixIndex::PhonePrefixIndex(const PhonePrefixIndex& previous, const SnapshotDelta& delta,
+                                   const std::vector<std::string>& addedPhones) {
+    std::vector<std::pair<std::string, uint32_t>> added;
+    added.reserve(addedPhones.size());
+    for (size_t i = 0; i < addedPhones.size(); ++i) {
+        added.emplace_back(NormalizePhone(addedPhones[i]), delta.added[i]);
+    }
+    std::sort(added.begin(), added.end());
+
+    // The remap keeps survivors in (number, position) order, so only the additions
+    // need slotting in
+    phones.reserve(previous.phones.size() + added.size());
+    positions.reserve(previous.phones.size() + added.size());
+    size_t next = 0;
+    for (size_t i = 0; i < previous.phones.size(); ++i) {
+        uint32_t position = delta.remap[previous.positions[i]];
+        if (position == SnapshotDelta::kRemoved) {
+            continue;
+        }
+        while (next < added.size() && (added[next].first != previous.phones[i] ? added[next].first < previous.phones[i]
+                                                                               : added[next].second < position)) {
+            phones.push_back(std::move(added[next].first));
+            positions.push_back(added[next++].second);
+        }
+        phones.push_back(previous.phones[i]);
+        positions.push_back(position);
+    }
+    for (; next < added.size(); ++next) {
+        phones.push_back(std::move(added[next].first));
+        positions.push_back(added[next].second);
+    }
+}
+
+std::pair<size_t, size_t> PhonePrefixIndex::Range(const std::string& prefix) const {
+    std::string key = NormalizePhone(prefix);
+    auto first = std::lower_bound(phones.begin(), phones.end(), key);
+    // ':' sorts right after '9', so key + ':' is the first string past every "key..." number.
+    auto last = std::lower_bound(first, phones.end(), key + ':');
+    return {static_cast<size_t>(first - phones.begin()), static_cast<size_t>(last - phones.begin())};
+}
+
+std::vector<size_t> PhonePrefixIndex::Find(const std::string& prefix, size_t limit) const {
+    auto range = Range(prefix);
+    std::vector<size_t> result;
+    size_t end = range.second - range.first > limit ? range.first + limit : range.second;
+    result.reserve(end - range.first);
+    for (size_t i = range.first; i < end; ++i) {
+        result.push_back(positions[i]);
+    }
+    return result;
+}
+
+std::vector<size_t> PhonePrefixIndex::FindExact(const std::string& phone) const {
+    auto range = std::equal_range(phones.begin(), phones.end(), NormalizePhone(phone));
+    std::vector<size_t> result;
+    for (auto it = range.first; it != range.second; ++it) {
+        result.push_back(positions[static_cast<size_t>(it - phones.begin())]);
+    }
+    return result;
+}
+
+size_t PhonePrefixIndex::Count(const std::string& prefix) const {
+    auto range = Range(prefix);
+    return range.second - range.first;
+}
@@ -0,0 +1,45 @@
+#ifndef PHONEPREFIXINDEX_HPP
+#define PHONEPREFIXINDEX_HPP
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include "SnapshotIndex.hpp"
+
+// Digits of a phone number in international form: separators are dropped and a
+// leading "+" or "00" is removed, so "+49 30 1234", "0049301234" and "49301234"
+// all become "49301234".
+std::string NormalizePhone(const std::string& phone);
+
+// Sorted array of normalized phone numbers for prefix (area / operator code) queries.
+// All numbers starting with a prefix form one contiguous range, found with two binary
+// searches, so a query costs O(len * log N) plus the matches it returns.
+class PhonePrefixIndex {
+public:
+    explicit PhonePrefixIndex(const std::vector<std::string>& phones);
+    // The index of the list 'delta' made from the one 'previous' was built from, in one
+    // merge pass; 'addedPhones' are the numbers at delta.added, in the same order.
+    PhonePrefixIndex(const PhonePrefixIndex& previous, const SnapshotDelta& delta,
+                     const std::vector<std::string>& addedPhones);
+
+    // Positions (in the list the index was built from) of the numbers starting with
+    // 'prefix', in phone number order, at most 'limit' of them.
+    std::vector<size_t> Find(const std::string& prefix, size_t limit = SIZE_MAX) const;
+
+    // Positions of the numbers equal to 'phone' once both are normalized (exact lookups).
+    std::vector<size_t> FindExact(const std::string& phone) const;
+
+    // Number of matches for 'prefix' without materializing them (for UI previews).
+    size_t Count(const std::string& prefix) const;
+
+    size_t Size() const { return phones.size(); }
+
+private:
+    std::pair<size_t, size_t> Range(const std::string& prefix) const;
+
+    std::vector<std::string> phones;  // Normalized, sorted
+    std::vector<uint32_t> positions;  // Original position of phones[i]
+};
+
+#endif // PHONEPREFIXINDEX_HPP
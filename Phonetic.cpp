@@ -0,0 +1,72 @@
+#include "Phonetic.hpp"
+
+namespace {
+
+// Soundex digit per letter; '0' for vowels (they separate equal digits),
+// '-' for 'h' and 'w' (they do not).
+const char kSoundexDigits[] = "01230120022455012623010202";
+
+bool IsAsciiLetter(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+char ToLowerAscii(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+char DigitFor(char lower) {
+    return (lower == 'h' || lower == 'w') ? '-' : kSoundexDigits[lower - 'a'];
+}
+
+} // namespace
+
+std::string SoundexCode(const std::string& word) {
+    std::string code;
+    char previous = 0;
+    for (char c : word) {
+        if (!IsAsciiLetter(c)) {
+            continue;
+        }
+        char lower = ToLowerAscii(c);
+        char digit = DigitFor(lower);
+        if (code.empty()) {
+            code.push_back(static_cast<char>(lower - 'a' + 'A'));
+            previous = digit;
+            continue;
+        }
+        if (digit == '-') {
+            continue; // 'h'/'w' keep the previous digit, so "Ashcraft" -> A261
+        }
+        if (digit != '0' && digit != previous) {
+            code.push_back(digit);
+            if (code.size() == 4) {
+                break;
+            }
+        }
+        previous = digit;
+    }
+    if (!code.empty()) {
+        code.resize(4, '0');
+    }
+    return code;
+}
+
+std::string PhoneticKey(const std::string& name) {
+    std::string key;
+    size_t start = 0;
+    while (start < name.size()) {
+        size_t end = name.find_first_of(" \t-,.", start);
+        if (end == std::string::npos) {
+            end = name.size();
+        }
+        std::string code = SoundexCode(name.substr(start, end - start));
+        if (!code.empty()) {
+            if (!key.empty()) {
+                key.push_back(' ');
+            }
+            key += code;
+        }
+        start = end + 1;
+    }
+    return key;
+}
@@ -0,0 +1,18 @@
+#ifndef PHONETIC_HPP
+#define PHONETIC_HPP
+
+#include <string>
+
+// American Soundex code of one word: the first letter followed by three digits
+// ("Smith" and "Smyth" -> "S530", "John" and "Jon" -> "J500").
+// Only ASCII letters are coded; other characters are skipped. Returns an empty
+// string when the word contains no ASCII letter.
+std::string SoundexCode(const std::string& word);
+
+// Phonetic key of a full name: the Soundex codes of its words, space-separated and
+// in name order ("John Smith" -> "J500 S530"). Words without a code are left out.
+// Keys of names that sound alike compare equal, and the key of a name's leading
+// words is a prefix of the full key, so both can be answered with one index range.
+std::string PhoneticKey(const std::string& name);
+
+#endif // PHONETIC_HPP
@@ -0,0 +1,210 @@
+#include "QueryProfiler.hpp"
+#include <ctime>
+#include <unordered_map>
+
+namespace {
+
+// Rows seen per statement, counted on the thread that steps it. A statement is
+// only ever stepped by one thread at a time, so no locking is needed per row.
+thread_local std::unordered_map<sqlite3_stmt*, uint64_t> rowsPerStatement;
+
+std::string Timestamp() {
+    std::time_t now = std::time(nullptr);
+    std::tm local{};
+    localtime_r(&now, &local);
+    char buffer[32];
+    std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &local);
+    return buffer;
+}
+
+} // namespace
+
+QueryProfiler::QueryProfiler(const std::string& dbPath, QueryProfilerConfig config)
+    : databasePath(dbPath) {
+    Configure(config);
+}
+
+QueryProfiler::~QueryProfiler() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (explainDb) {
+        sqlite3_close(explainDb);
+    }
+}
+
+void QueryProfiler::Attach(sqlite3* db) {
+    if (!db) {
+        return;
+    }
+    if (!IsActive()) {
+        Detach(db); // Nothing configured: no callback at all
+        return;
+    }
+    unsigned mask = SQLITE_TRACE_PROFILE | (countRows.load(std::memory_order_relaxed) ? SQLITE_TRACE_ROW : 0);
+    sqlite3_trace_v2(db, mask, &QueryProfiler::TraceCallback, this);
+}
+
+void QueryProfiler::Detach(sqlite3* db) {
+    if (db) {
+        sqlite3_trace_v2(db, 0, nullptr, nullptr);
+    }
+}
+
+void QueryProfiler::SetConnectionInitializer(std::function<void(sqlite3*)> newInitializer) {
+    std::lock_guard<std::mutex> lock(mutex);
+    initializer = std::move(newInitializer);
+}
+
+void QueryProfiler::Configure(const QueryProfilerConfig& newConfig) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (slowLog.is_open()) {
+        slowLog.close();
+    }
+    config = newConfig;
+    if (!config.slowLogPath.empty()) {
+        slowLog.open(config.slowLogPath, std::ios::app);
+    }
+    plans.clear();
+    active.store(!config.slowLogPath.empty() || config.explain != ExplainCapture::Off, std::memory_order_relaxed);
+    countRows.store(config.countRows, std::memory_order_relaxed);
+    explainAll.store(config.explain == ExplainCapture::All, std::memory_order_relaxed);
+    slowNanos.store(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        config.slowThreshold).count()), std::memory_order_relaxed);
+}
+
+QueryProfilerConfig QueryProfiler::GetConfig() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return config;
+}
+
+int QueryProfiler::TraceCallback(unsigned type, void* context, void* p, void* x) {
+    auto* profiler = static_cast<QueryProfiler*>(context);
+    auto* stmt = static_cast<sqlite3_stmt*>(p);
+    if (type == SQLITE_TRACE_ROW) {
+        ++rowsPerStatement[stmt];
+    } else if (type == SQLITE_TRACE_PROFILE) {
+        profiler->OnProfile(stmt, static_cast<uint64_t>(*static_cast<sqlite3_int64*>(x)));
+    }
+    return 0;
+}
+
+void QueryProfiler::OnProfile(sqlite3_stmt* stmt, uint64_t nanos) {
+    QueryProfile profile;
+    profile.wallNanos = nanos;
+
+    if (!rowsPerStatement.empty()) {
+        auto counted = rowsPerStatement.find(stmt);
+        if (counted != rowsPerStatement.end()) {
+            profile.rows = counted->second;
+            rowsPerStatement.erase(counted);
+        }
+    }
+    statements.fetch_add(1, std::memory_order_relaxed);
+    totalNanos.fetch_add(nanos, std::memory_order_relaxed);
+    profile.slow = nanos >= slowNanos.load(std::memory_order_relaxed);
+    if (!profile.slow && !explainAll.load(std::memory_order_relaxed)) {
+        return; // The common case: no SQL expansion and no lock
+    }
+
+    if (!sqlite3_stmt_readonly(stmt)) {
+        profile.rows += static_cast<uint64_t>(sqlite3_changes64(sqlite3_db_handle(stmt)));
+    }
+
+    if (profile.slow) {
+        char* expanded = sqlite3_expanded_sql(stmt);
+        profile.sql = expanded ? expanded : sqlite3_sql(stmt);
+        sqlite3_free(expanded);
+    }
+    const std::string originalSql = sqlite3_sql(stmt);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::string plan;
+    if (config.explain == ExplainCapture::All || (config.explain == ExplainCapture::SlowOnly && profile.slow)) {
+        plan = CapturePlan(originalSql);
+        // "SCAN contacts" without "USING INDEX" means every row is visited.
+        size_t scan = plan.find("SCAN ");
+        profile.fullScan = scan != std::string::npos && plan.find("USING", scan) == std::string::npos;
+    }
+
+    if (profile.fullScan) {
+        ++fullScans;
+    }
+    if (!profile.slow) {
+        return; // Only here for its plan (ExplainCapture::All)
+    }
+    ++slowStatements;
+
+    if (slowLog.is_open()) {
+        slowLog << Timestamp() << " " << static_cast<double>(nanos) / 1e6 << " ms rows=" << profile.rows
+                << (profile.fullScan ? " FULLSCAN" : "") << " " << profile.sql << "\n";
+        if (!plan.empty()) {
+            slowLog << plan;
+        }
+        slowLog.flush();
+    }
+
+    recent.push_back(std::move(profile));
+    while (recent.size() > config.recentCapacity) {
+        recent.pop_front();
+    }
+}
+
+std::string QueryProfiler::CapturePlan(const std::string& sql) {
+    auto cached = plans.find(sql);
+    if (cached != plans.end()) {
+        return cached->second;
+    }
+
+    // EXPLAIN runs on a private connection: the traced connection is in the middle
+    // of finishing a statement and must not be re-entered from its own callback.
+    if (!explainDb) {
+        if (sqlite3_open_v2(databasePath.c_str(), &explainDb, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, nullptr) != SQLITE_OK) {
+            sqlite3_close(explainDb);
+            explainDb = nullptr;
+            return "";
+        }
+        if (initializer) {
+            initializer(explainDb);
+        }
+    }
+
+    // No busy timeout: this runs on the traced (possibly writing) thread, and waiting
+    // for a lock that thread itself holds would never end. A busy database simply
+    // yields no plan this time and is retried on the next slow statement.
+    std::string plan;
+    sqlite3_stmt* explain = nullptr;
+    std::string explainSql = "EXPLAIN QUERY PLAN " + sql;
+    int rc = sqlite3_prepare_v2(explainDb, explainSql.c_str(), -1, &explain, nullptr);
+    if (rc == SQLITE_OK) {
+        while ((rc = sqlite3_step(explain)) == SQLITE_ROW) {
+            const unsigned char* detail = sqlite3_column_text(explain, 3);
+            plan += "  plan: ";
+            plan += detail ? reinterpret_cast<const char*>(detail) : "";
+            plan += "\n";
+        }
+    }
+    sqlite3_finalize(explain);
+    if (rc != SQLITE_BUSY && rc != SQLITE_LOCKED) {
+        plans.emplace(sql, plan); // Also caches "no plan" for PRAGMA, BEGIN and the like
+    }
+    return plan;
+}
+
+std::vector<QueryProfile> QueryProfiler::RecentQueries() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return std::vector<QueryProfile>(recent.begin(), recent.end());
+}
+
+QueryProfilerStats QueryProfiler::GetStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    QueryProfilerStats stats;
+    stats.statements = statements.load(std::memory_order_relaxed);
+    stats.slowStatements = slowStatements;
+    stats.totalNanos = totalNanos.load(std::memory_order_relaxed);
+    stats.fullScans = fullScans;
+    return stats;
+}
+
+std::map<std::string, std::string> QueryProfiler::CapturedPlans() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return plans;
+}
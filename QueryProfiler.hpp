@@ -0,0 +1,109 @@
+#ifndef QUERYPROFILER_HPP
+#define QUERYPROFILER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <sqlite3.h>
+
+// When EXPLAIN QUERY PLAN output is captured for a statement.
+enum class ExplainCapture {
+    Off,
+    SlowOnly, // Only for statements over the slow-query threshold
+    All       // For every distinct statement text
+};
+
+// The profiler is off (no trace hook on any connection) unless a slow-query log or
+// plan capture is configured.
+struct QueryProfilerConfig {
+    std::chrono::microseconds slowThreshold{10000}; // Statements at or above this are "slow"
+    std::string slowLogPath;                        // Empty = do not write a slow-query log
+    ExplainCapture explain = ExplainCapture::Off;
+    size_t recentCapacity = 256;                    // Slow statements kept for RecentQueries()
+    bool countRows = false;                         // Count rows returned by SELECTs (SQLITE_TRACE_ROW,
+                                                    // one callback per row); writes are always counted
+};
+
+// One finished statement, as reported by SQLITE_TRACE_PROFILE.
+struct QueryProfile {
+    std::string sql;       // Expanded SQL (bound parameters inlined)
+    uint64_t wallNanos = 0;
+    uint64_t rows = 0;     // Rows returned (SELECT, with countRows) or changed (INSERT/UPDATE/DELETE)
+    bool slow = false;
+    bool fullScan = false; // Captured plan contains a full table SCAN
+};
+
+struct QueryProfilerStats {
+    uint64_t statements = 0;
+    uint64_t slowStatements = 0;
+    uint64_t totalNanos = 0;
+    uint64_t fullScans = 0; // Statements whose captured plan is a full table scan
+};
+
+// Statement profiler based on sqlite3_trace_v2(SQLITE_TRACE_PROFILE, plus SQLITE_TRACE_ROW
+// when rows are counted). Attach it to any number of connections; callbacks can arrive
+// from several threads. Statements under the threshold only bump atomic counters; slow
+// ones are appended to the slow-query log together with their query plan (when plan
+// capture is on), which makes full scans such as "fold(name) LIKE ?" visible.
+class QueryProfiler {
+public:
+    QueryProfiler(const std::string& dbPath, QueryProfilerConfig config = QueryProfilerConfig());
+    ~QueryProfiler();
+
+    QueryProfiler(const QueryProfiler&) = delete;
+    QueryProfiler& operator=(const QueryProfiler&) = delete;
+
+    // Installs the trace hook on 'db' as the current configuration asks for (call again
+    // after Configure). Only call these from the thread that owns the connection.
+    void Attach(sqlite3* db);
+    static void Detach(sqlite3* db);
+    // True when the configuration asks for a slow-query log or plan capture.
+    bool IsActive() const { return active.load(std::memory_order_relaxed); }
+
+    // Called with the private EXPLAIN connection after it is opened, e.g. to register
+    // the collations and functions the profiled statements use.
+    void SetConnectionInitializer(std::function<void(sqlite3*)> initializer);
+
+    void Configure(const QueryProfilerConfig& config);
+    QueryProfilerConfig GetConfig() const;
+
+    // The most recent slow statements, oldest first.
+    std::vector<QueryProfile> RecentQueries() const;
+    QueryProfilerStats GetStats() const;
+    // Captured plans keyed by the statement's original (unexpanded) SQL.
+    std::map<std::string, std::string> CapturedPlans() const;
+
+private:
+    static int TraceCallback(unsigned type, void* context, void* p, void* x);
+    void OnProfile(sqlite3_stmt* stmt, uint64_t nanos);
+    std::string CapturePlan(const std::string& sql); // Caller holds 'mutex'
+
+    std::string databasePath;
+
+    mutable std::mutex mutex;
+    QueryProfilerConfig config;
+    std::ofstream slowLog;
+    sqlite3* explainDb = nullptr;                // Separate read-only connection for EXPLAIN
+    std::function<void(sqlite3*)> initializer;   // Run on explainDb once opened
+    std::map<std::string, std::string> plans;    // sql -> plan text
+    std::deque<QueryProfile> recent;
+    uint64_t slowStatements = 0;
+    uint64_t fullScans = 0;
+
+    // Read on every statement without taking 'mutex'
+    std::atomic<bool> active{false};
+    std::atomic<bool> countRows{false};
+    std::atomic<bool> explainAll{false};
+    std::atomic<uint64_t> slowNanos{0};
+    std::atomic<uint64_t> statements{0};
+    std::atomic<uint64_t> totalNanos{0};
+};
+
+#endif // QUERYPROFILER_HPP
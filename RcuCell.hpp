@@ -0,0 +1,110 @@
+#ifndef RCUCELL_HPP
+#define RCUCELL_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// RcuCell publishes immutable values to many reader threads using epoch-based
+// reclamation (a small user-space RCU).
+//
+// - Readers call Load(); it never blocks on the writer. The reader announces the
+//   current epoch in a slot, copies the shared_ptr, and clears the slot again.
+// - A single writer (callers serialize writers themselves) calls Store(). The old
+//   value is retired with the epoch it was replaced in and is freed only once no
+//   reader slot still announces an epoch that old.
+//
+// Values are handed out as shared_ptr, so a reader can keep using a value for as
+// long as it likes; the epoch only protects the short window of the copy.
+template <typename T>
+class RcuCell {
+public:
+    explicit RcuCell(std::shared_ptr<const T> initial)
+        : current(new Node{std::move(initial), 0}) {}
+
+    ~RcuCell() {
+        delete current.load(std::memory_order_relaxed);
+        for (Node* node : retired) {
+            delete node;
+        }
+    }
+
+    RcuCell(const RcuCell&) = delete;
+    RcuCell& operator=(const RcuCell&) = delete;
+
+    // Lock-free read of the current value.
+    std::shared_ptr<const T> Load() const {
+        Slot& slot = ClaimSlot();
+        slot.epoch.store(globalEpoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+        std::shared_ptr<const T> value = current.load(std::memory_order_seq_cst)->value;
+        slot.epoch.store(0, std::memory_order_release);
+        slot.busy.store(false, std::memory_order_release);
+        return value;
+    }
+
+    // Publishes a new value. Must not be called concurrently with another Store().
+    void Store(std::shared_ptr<const T> value) {
+        Node* old = current.exchange(new Node{std::move(value), 0}, std::memory_order_seq_cst);
+        old->retiredAt = globalEpoch.fetch_add(1, std::memory_order_seq_cst);
+        retired.push_back(old);
+        Reclaim();
+    }
+
+private:
+    struct Node {
+        std::shared_ptr<const T> value;
+        uint64_t retiredAt;
+    };
+
+    // One cache line per slot so that readers on different cores do not share lines.
+    struct alignas(64) Slot {
+        std::atomic<bool> busy{false};
+        std::atomic<uint64_t> epoch{0}; // 0 = not inside a read
+    };
+
+    static constexpr size_t kSlots = 64;
+
+    Slot& ClaimSlot() const {
+        // Start probing at a per-thread position so that threads rarely collide.
+        thread_local size_t hint = std::hash<std::thread::id>{}(std::this_thread::get_id());
+        for (size_t i = hint;; ++i) {
+            Slot& slot = slots[i % kSlots];
+            if (!slot.busy.load(std::memory_order_relaxed) &&
+                !slot.busy.exchange(true, std::memory_order_acquire)) {
+                hint = i;
+                return slot;
+            }
+        }
+    }
+
+    // Frees every retired node that no in-flight reader can still be looking at.
+    void Reclaim() {
+        uint64_t oldestActive = UINT64_MAX;
+        for (const Slot& slot : slots) {
+            uint64_t epoch = slot.epoch.load(std::memory_order_seq_cst);
+            if (epoch != 0 && epoch < oldestActive) {
+                oldestActive = epoch;
+            }
+        }
+        size_t kept = 0;
+        for (Node* node : retired) {
+            if (node->retiredAt < oldestActive) {
+                delete node;
+            } else {
+                retired[kept++] = node;
+            }
+        }
+        retired.resize(kept);
+    }
+
+    std::atomic<Node*> current;
+    std::atomic<uint64_t> globalEpoch{1};
+    mutable Slot slots[kSlots];
+    std::vector<Node*> retired; // Writer-only
+};
+
+#endif // RCUCELL_HPP
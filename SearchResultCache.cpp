@@ -0,0 +1,89 @@
+#include "SearchResultCache.hpp"
+#include <iterator>
+
+SearchResultCache::SearchResultCache(size_t budgetBytes) {
+    stats.budgetBytes = budgetBytes;
+}
+
+size_t SearchResultCache::EstimateBytes(const std::string& key, const std::vector<Contact>& results) {
+    // Node, map slot and strings (short fields live inside the std::string itself)
+    size_t bytes = sizeof(Entry) + 2 * sizeof(void*) + 2 * key.size() + sizeof(EntryList::iterator);
+    bytes += results.capacity() * sizeof(Contact);
+    for (const Contact& contact : results) {
+        bytes += contact.GetName().capacity() + contact.GetPhone().capacity() + contact.GetEmail().capacity();
+    }
+    return bytes;
+}
+
+bool SearchResultCache::Lookup(const std::string& key, uint64_t generation, std::vector<Contact>& results) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = byKey.find(key);
+    if (found == byKey.end()) {
+        ++stats.misses;
+        return false;
+    }
+    if (found->second->generation != generation) {
+        // Computed before the last write: it can never be valid again
+        Erase(found->second);
+        ++stats.invalidated;
+        ++stats.misses;
+        return false;
+    }
+    lru.splice(lru.begin(), lru, found->second);
+    results = found->second->results;
+    ++stats.hits;
+    return true;
+}
+
+void SearchResultCache::Store(const std::string& key, uint64_t generation, const std::vector<Contact>& results) {
+    size_t bytes = EstimateBytes(key, results);
+    std::lock_guard<std::mutex> lock(mutex);
+    if (bytes > stats.budgetBytes / 4) {
+        return; // One huge result would flush the whole working set
+    }
+    auto found = byKey.find(key);
+    if (found != byKey.end()) {
+        if (found->second->generation > generation) {
+            return; // A newer result was stored while this one was computed
+        }
+        Erase(found->second);
+    }
+    lru.push_front(Entry{key, generation, results, bytes});
+    byKey.emplace(key, lru.begin());
+    stats.bytes += bytes;
+    ++stats.entries;
+    EvictToBudget();
+}
+
+void SearchResultCache::SetBudget(size_t budgetBytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.budgetBytes = budgetBytes;
+    EvictToBudget();
+}
+
+void SearchResultCache::Clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    lru.clear();
+    byKey.clear();
+    stats.entries = 0;
+    stats.bytes = 0;
+}
+
+SearchCacheStats SearchResultCache::GetStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+void SearchResultCache::Erase(EntryList::iterator entry) {
+    stats.bytes -= entry->bytes;
+    --stats.entries;
+    byKey.erase(entry->key);
+    lru.erase(entry);
+}
+
+void SearchResultCache::EvictToBudget() {
+    while (stats.bytes > stats.budgetBytes && !lru.empty()) {
+        Erase(std::prev(lru.end()));
+        ++stats.evictions;
+    }
+}
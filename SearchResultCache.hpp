@@ -0,0 +1,70 @@
+#ifndef SEARCHRESULTCACHE_HPP
+#define SEARCHRESULTCACHE_HPP
+
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Contact.hpp"
+
+// Counters describing how the result cache is used (hits/misses are totals since creation).
+struct SearchCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;        // Includes lookups that found a stale entry
+    uint64_t invalidated = 0;   // Stale entries dropped because the data changed since they were stored
+    uint64_t evictions = 0;     // Entries dropped to stay within the memory budget
+    size_t entries = 0;
+    size_t bytes = 0;           // Estimated memory held by the cached results
+    size_t budgetBytes = 0;
+
+    double HitRatio() const {
+        uint64_t lookups = hits + misses;
+        return lookups == 0 ? 0.0 : static_cast<double>(hits) / static_cast<double>(lookups);
+    }
+};
+
+// LRU cache of search results keyed by normalized query text.
+// Every entry remembers the data generation it was computed at; the owner bumps the
+// generation after each committed write, so an entry is only ever returned for the
+// exact data it was computed from. Stale entries are dropped when they are looked up
+// or when they reach the cold end of the LRU list. Thread-safe.
+class SearchResultCache {
+public:
+    explicit SearchResultCache(size_t budgetBytes = 16 * 1024 * 1024);
+
+    // Copies the cached results for 'key' into 'results' and returns true if an entry
+    // computed at 'generation' exists.
+    bool Lookup(const std::string& key, uint64_t generation, std::vector<Contact>& results);
+
+    // Stores 'results' for 'key', evicting least recently used entries to stay within
+    // the budget. Result sets larger than a quarter of the budget are not cached.
+    void Store(const std::string& key, uint64_t generation, const std::vector<Contact>& results);
+
+    // Changes the memory budget (0 disables caching) and evicts down to it.
+    void SetBudget(size_t budgetBytes);
+    void Clear();
+
+    SearchCacheStats GetStats() const;
+
+private:
+    struct Entry {
+        std::string key;
+        uint64_t generation = 0;
+        std::vector<Contact> results;
+        size_t bytes = 0;
+    };
+    using EntryList = std::list<Entry>;
+
+    static size_t EstimateBytes(const std::string& key, const std::vector<Contact>& results);
+    void Erase(EntryList::iterator entry);
+    void EvictToBudget(); // Caller holds 'mutex'
+
+    mutable std::mutex mutex;
+    EntryList lru; // Most recently used first
+    std::unordered_map<std::string, EntryList::iterator> byKey;
+    SearchCacheStats stats;
+};
+
+#endif // SEARCHRESULTCACHE_HPP
@@ -0,0 +1,502 @@
+#include "ShardedBook.hpp"
+#include "Collation.hpp"
+#include "CoreLog.hpp"
+#include "Phonetic.hpp"
+#include "PhonePrefixIndex.hpp"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+
+// Runs tasks for one shard on threads of its own: the writes on a single thread, in
+// submission order, and the searches on a small pool. Post() blocks while 'maxQueued'
+// tasks are waiting, which keeps a fast producer (the resharding reader) from
+// buffering a whole book in memory.
+class ShardWorkers {
+public:
+    explicit ShardWorkers(size_t threadCount = 1, size_t maxQueued = SIZE_MAX) : maxQueued(maxQueued) {
+        for (size_t i = 0; i < std::max<size_t>(threadCount, 1); ++i) {
+            threads.emplace_back([this]() { Run(); });
+        }
+    }
+
+    ~ShardWorkers() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        taskQueued.notify_all();
+        for (std::thread& thread : threads) {
+            thread.join(); // Runs everything already queued first
+        }
+    }
+
+    template <typename Function>
+    auto Post(Function function) -> std::future<decltype(function())> {
+        using Result = decltype(function());
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::move(function));
+        std::future<Result> result = task->get_future();
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            spaceAvailable.wait(lock, [&]() { return tasks.size() < maxQueued; });
+            tasks.emplace_back([task]() { (*task)(); });
+        }
+        taskQueued.notify_one();
+        return result;
+    }
+
+private:
+    void Run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            taskQueued.wait(lock, [&]() { return stopping || !tasks.empty(); });
+            if (tasks.empty()) {
+                return; // Stopping and drained
+            }
+            std::function<void()> task = std::move(tasks.front());
+            tasks.pop_front();
+            spaceAvailable.notify_one();
+            lock.unlock();
+            task();
+            lock.lock();
+        }
+    }
+
+    size_t maxQueued;
+    std::mutex mutex;
+    std::condition_variable taskQueued;
+    std::condition_variable spaceAvailable;
+    std::deque<std::function<void()>> tasks;
+    bool stopping = false;
+    std::vector<std::thread> threads; // Last, so they start after everything above is constructed
+};
+
+namespace {
+
+// Runs 'query' on every shard at once, each on its shard's reader threads. Searches
+// bypass the writer threads, so they never queue behind writes.
+template <typename Shards, typename Query>
+auto ScatterGather(const Shards& shards, Query query) -> std::vector<decltype(query(*shards[0]->book))> {
+    using Part = decltype(query(*shards[0]->book));
+    std::vector<std::future<Part>> pending;
+    pending.reserve(shards.size());
+    for (const auto& shard : shards) {
+        TelephoneBookLogic* book = shard->book.get();
+        pending.push_back(shard->readers->Post([&query, book]() { return query(*book); }));
+    }
+    // The tasks refer to 'query': wait for all of them before a failed one is rethrown
+    for (std::future<Part>& part : pending) {
+        part.wait();
+    }
+    std::vector<Part> parts;
+    parts.reserve(shards.size());
+    for (std::future<Part>& part : pending) {
+        parts.push_back(part.get());
+    }
+    return parts;
+}
+
+// K-way merge of lists that are each sorted by 'compare' (<0, 0, >0). Ties keep shard
+// order, so the result does not depend on thread timing.
+std::vector<Contact> MergeSorted(std::vector<std::vector<Contact>>& parts,
+                                 const std::function<int(const Contact&, const Contact&)>& compare,
+                                 size_t limit = SIZE_MAX) {
+    using Cursor = std::pair<size_t, size_t>; // Part, position in it
+    auto after = [&](const Cursor& a, const Cursor& b) {
+        int order = compare(parts[a.first][a.second], parts[b.first][b.second]);
+        return order != 0 ? order > 0 : a.first > b.first;
+    };
+    std::priority_queue<Cursor, std::vector<Cursor>, decltype(after)> heads(after);
+    size_t total = 0;
+    for (size_t i = 0; i < parts.size(); ++i) {
+        total += parts[i].size();
+        if (!parts[i].empty()) {
+            heads.emplace(i, 0);
+        }
+    }
+    std::vector<Contact> merged;
+    merged.reserve(std::min(total, limit));
+    while (!heads.empty() && merged.size() < limit) {
+        Cursor head = heads.top();
+        heads.pop();
+        merged.push_back(std::move(parts[head.first][head.second]));
+        if (head.second + 1 < parts[head.first].size()) {
+            heads.emplace(head.first, head.second + 1);
+        }
+    }
+    return merged;
+}
+
+int CompareNames(const Contact& a, const Contact& b) {
+    return CollationCompare(a.GetName(), b.GetName());
+}
+
+int ComparePhones(const Contact& a, const Contact& b) {
+    return NormalizePhone(a.GetPhone()).compare(NormalizePhone(b.GetPhone()));
+}
+
+// Name order with one collation key per contact, for lists that come back unsorted.
+void SortByName(std::vector<Contact>& contacts) {
+    std::vector<std::pair<std::string, uint32_t>> keys;
+    keys.reserve(contacts.size());
+    for (size_t i = 0; i < contacts.size(); ++i) {
+        keys.emplace_back(CollationKey(contacts[i].GetName()), static_cast<uint32_t>(i));
+    }
+    std::sort(keys.begin(), keys.end());
+    std::vector<Contact> sorted;
+    sorted.reserve(contacts.size());
+    for (const auto& key : keys) {
+        sorted.push_back(std::move(contacts[key.second]));
+    }
+    contacts = std::move(sorted);
+}
+
+} // namespace
+
+std::string ShardPath(const std::string& basePath, size_t shard, size_t shardCount) {
+    if (shardCount <= 1) {
+        return basePath;
+    }
+    std::filesystem::path path(basePath);
+    std::string file = path.stem().string() + "-" + std::to_string(shard) + "of" + std::to_string(shardCount) +
+                       path.extension().string();
+    return (path.parent_path() / file).string();
+}
+
+size_t ShardOf(const std::string& phone, size_t shardCount) {
+    // FNV-1a over the normalized digits; stable across releases, since it decides
+    // which file a contact is stored in
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (char c : NormalizePhone(phone)) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 0x100000001B3ull;
+    }
+    return shardCount <= 1 ? 0 : static_cast<size_t>(hash % shardCount);
+}
+
+ShardedBook::ShardedBook(const std::string& basePath, size_t shardCount, size_t readPoolSize) {
+    shardCount = std::max<size_t>(1, shardCount);
+    shards.resize(shardCount);
+    // Opening loads every shard into memory; do it for all shards at once
+    std::vector<std::thread> openers;
+    for (size_t i = 0; i < shardCount; ++i) {
+        openers.emplace_back([&, i]() {
+            auto shard = std::make_unique<Shard>();
+            shard->book = std::make_unique<TelephoneBookLogic>(ShardPath(basePath, i, shardCount),
+                                                               ConcurrencyMode::MultiReader, readPoolSize);
+            shard->writer = std::make_unique<ShardWorkers>();
+            // As many search threads as read connections; more would only wait for one
+            shard->readers = std::make_unique<ShardWorkers>(
+                readPoolSize != 0 ? readPoolSize : std::max(1u, std::thread::hardware_concurrency()));
+            shards[i] = std::move(shard);
+        });
+    }
+    for (std::thread& opener : openers) {
+        opener.join();
+    }
+    LogMessage("Sharded book opened: %zu contacts in %zu shards.", Size(), shardCount);
+}
+
+ShardedBook::~ShardedBook() = default;
+
+std::future<bool> ShardedBook::AddContactAsync(const Contact& contact) {
+    Shard& shard = ShardFor(contact.GetPhone());
+    TelephoneBookLogic* book = shard.book.get();
+    return shard.writer->Post([book, contact]() { return book->AddContact(contact); });
+}
+
+bool ShardedBook::DeleteContact(const std::string& name, const std::string& phone) {
+    Shard& shard = ShardFor(phone);
+    TelephoneBookLogic* book = shard.book.get();
+    return shard.writer->Post([book, name, phone]() { return book->DeleteContact(name, phone); }).get();
+}
+
+bool ShardedBook::EditContact(const std::string& oldName, const std::string& oldPhone, const Contact& updatedContact) {
+    Shard& from = ShardFor(oldPhone);
+    Shard& to = ShardFor(updatedContact.GetPhone());
+    TelephoneBookLogic* fromBook = from.book.get();
+    if (&from == &to) {
+        return from.writer
+            ->Post([fromBook, oldName, oldPhone, updatedContact]() {
+                return fromBook->EditContact(oldName, oldPhone, updatedContact);
+            })
+            .get();
+    }
+
+    // The number moves to another shard: add there first, then remove the original
+    std::optional<Contact> existing = fromBook->FindByPhone(oldPhone);
+    if (!existing || existing->GetName() != oldName) {
+        return true; // Like EditContact on a missing row: nothing to change
+    }
+    TelephoneBookLogic* toBook = to.book.get();
+    if (!to.writer->Post([toBook, updatedContact]() { return toBook->AddContact(updatedContact); }).get()) {
+        return false;
+    }
+    bool removed = from.writer->Post([fromBook, oldName, oldPhone]() {
+        return fromBook->DeleteContact(oldName, oldPhone);
+    }).get();
+    if (!removed) {
+        to.writer->Post([toBook, updatedContact]() {
+            return toBook->DeleteContact(updatedContact.GetName(), updatedContact.GetPhone());
+        }).get();
+        LogError("Failed to move contact '%s' between shards.", oldName.c_str());
+    }
+    return removed;
+}
+
+size_t ShardedBook::ImportContacts(const std::vector<Contact>& newContacts, std::vector<ImportIssue>* rejected) {
+    struct Part {
+        std::vector<Contact> contacts;
+        std::vector<size_t> origins; // Index in 'newContacts' of each contact
+        std::vector<ImportIssue> rejected;
+    };
+    std::vector<Part> parts(shards.size());
+    for (size_t i = 0; i < newContacts.size(); ++i) {
+        Part& part = parts[ShardOf(newContacts[i].GetPhone(), shards.size())];
+        part.contacts.push_back(newContacts[i]);
+        part.origins.push_back(i);
+    }
+
+    std::vector<std::future<size_t>> pending;
+    for (size_t i = 0; i < shards.size(); ++i) {
+        TelephoneBookLogic* book = shards[i]->book.get();
+        Part* part = &parts[i];
+        bool wantRejected = rejected != nullptr;
+        pending.push_back(shards[i]->writer->Post([book, part, wantRejected]() {
+            return part->contacts.empty() ? size_t{0}
+                                          : book->ImportContacts(part->contacts, wantRejected ? &part->rejected : nullptr);
+        }));
+    }
+    size_t inserted = 0;
+    for (std::future<size_t>& count : pending) {
+        inserted += count.get();
+    }
+    if (rejected) {
+        size_t first = rejected->size();
+        for (Part& part : parts) {
+            for (ImportIssue issue : part.rejected) {
+                issue.index = part.origins[issue.index];
+                rejected->push_back(issue);
+            }
+        }
+        std::sort(rejected->begin() + static_cast<std::ptrdiff_t>(first), rejected->end(),
+                  [](const ImportIssue& a, const ImportIssue& b) { return a.index < b.index; });
+    }
+    return inserted;
+}
+
+std::optional<Contact> ShardedBook::FindByPhone(const std::string& phone) const {
+    return ShardFor(phone).book->FindByPhone(phone);
+}
+
+std::vector<Contact> ShardedBook::SearchContacts(const std::string& query) {
+    auto parts = ScatterGather(shards, [&query](TelephoneBookLogic& book) {
+        std::vector<Contact> results = book.SearchContacts(query);
+        SortByName(results); // On the shard's thread, so the sorts run in parallel too
+        return results;
+    });
+    return MergeSorted(parts, CompareNames);
+}
+
+std::vector<Contact> ShardedBook::SearchStructured(const std::string& query) const {
+    // Each shard already answers in snapshot (name) order
+    auto parts = ScatterGather(shards, [&query](TelephoneBookLogic& book) { return book.SearchStructured(query); });
+    return MergeSorted(parts, CompareNames);
+}
+
+std::vector<Contact> ShardedBook::SearchByPhonePrefix(const std::string& prefix, size_t limit) const {
+    // Every shard's first 'limit' numbers are enough for the first 'limit' overall
+    auto parts = ScatterGather(shards, [&prefix, limit](TelephoneBookLogic& book) {
+        return book.SearchByPhonePrefix(prefix, limit);
+    });
+    return MergeSorted(parts, ComparePhones, limit);
+}
+
+std::vector<Contact> ShardedBook::GetContacts() const {
+    std::vector<std::vector<Contact>> parts;
+    for (const auto& shard : shards) {
+        parts.push_back(*shard->book->GetSnapshot());
+    }
+    return MergeSorted(parts, CompareNames);
+}
+
+size_t ShardedBook::Size() const {
+    size_t size = 0;
+    for (const auto& shard : shards) {
+        size += shard->book->GetSnapshot()->size();
+    }
+    return size;
+}
+
+namespace {
+
+// Rows moved per transaction (and per queued task) while resharding.
+constexpr size_t kReshardBatch = 50000;
+
+struct ReshardRow {
+    std::string name;
+    std::string phone;
+    std::string email;
+};
+
+// Inserts batches into one new shard file on its writer thread.
+class ReshardTarget {
+public:
+    explicit ReshardTarget(const std::string& path) : path(path), writer(1, 4) {}
+
+    ~ReshardTarget() {
+        if (stmt || db) {
+            // Finish on the writer thread, which owns the connection
+            writer.Post([this]() {
+                sqlite3_finalize(stmt);
+                sqlite3_close(db);
+            }).get();
+        }
+    }
+
+    bool Open() {
+        return writer.Post([this]() {
+            if (sqlite3_open(path.c_str(), &db) != SQLITE_OK ||
+                sqlite3_prepare_v2(db, "INSERT INTO contacts (name, phone, email, phonetic) VALUES (?, ?, ?, ?);", -1,
+                                   &stmt, 0) != SQLITE_OK) {
+                LogError("Cannot open shard %s: %s", path.c_str(), sqlite3_errmsg(db));
+                return false;
+            }
+            return true;
+        }).get();
+    }
+
+    void Write(std::vector<ReshardRow> rows) {
+        writer.Post([this, rows = std::move(rows)]() {
+            if (failed.load()) {
+                return;
+            }
+            sqlite3_exec(db, "BEGIN;", 0, 0, 0);
+            for (const ReshardRow& row : rows) {
+                std::string phonetic = PhoneticKey(row.name);
+                sqlite3_reset(stmt);
+                sqlite3_bind_text(stmt, 1, row.name.c_str(), static_cast<int>(row.name.size()), SQLITE_STATIC);
+                sqlite3_bind_text(stmt, 2, row.phone.c_str(), static_cast<int>(row.phone.size()), SQLITE_STATIC);
+                sqlite3_bind_text(stmt, 3, row.email.c_str(), static_cast<int>(row.email.size()), SQLITE_STATIC);
+                sqlite3_bind_text(stmt, 4, phonetic.c_str(), static_cast<int>(phonetic.size()), SQLITE_TRANSIENT);
+                if (sqlite3_step(stmt) != SQLITE_DONE) {
+                    LogError("Insert into %s failed: %s", path.c_str(), sqlite3_errmsg(db));
+                    failed = true;
+                    break;
+                }
+            }
+            sqlite3_reset(stmt); // Drop the SQLITE_STATIC references before 'rows' goes away
+            if (failed.load() || sqlite3_exec(db, "COMMIT;", 0, 0, 0) != SQLITE_OK) {
+                LogError("Commit to %s failed: %s", path.c_str(), sqlite3_errmsg(db));
+                sqlite3_exec(db, "ROLLBACK;", 0, 0, 0);
+                failed = true;
+                return;
+            }
+            written += rows.size();
+        });
+    }
+
+    // Waits until everything queued so far is written.
+    bool Finish() {
+        writer.Post([]() {}).get();
+        return !failed.load();
+    }
+
+    size_t GetWritten() const { return written.load(); }
+
+private:
+    std::string path;
+    sqlite3* db = nullptr;
+    sqlite3_stmt* stmt = nullptr;
+    std::atomic<bool> failed{false};
+    std::atomic<size_t> written{0};
+    ShardWorkers writer; // Last: stops (draining its queue) before the rest goes away
+};
+
+} // namespace
+
+bool ReshardBook(const std::string& fromBase, size_t fromCount, const std::string& toBase, size_t toCount) {
+    fromCount = std::max<size_t>(1, fromCount);
+    toCount = std::max<size_t>(1, toCount);
+    for (size_t i = 0; i < fromCount; ++i) {
+        if (!std::filesystem::exists(ShardPath(fromBase, i, fromCount))) {
+            LogError("Source shard %s does not exist.", ShardPath(fromBase, i, fromCount).c_str());
+            return false;
+        }
+    }
+    for (size_t i = 0; i < toCount; ++i) {
+        if (std::filesystem::exists(ShardPath(toBase, i, toCount))) {
+            LogError("Target shard %s already exists.", ShardPath(toBase, i, toCount).c_str());
+            return false;
+        }
+    }
+
+    // Let the logic layer create the target files with the current schema and indexes
+    { ShardedBook created(toBase, toCount); }
+
+    std::vector<std::unique_ptr<ReshardTarget>> targets;
+    for (size_t i = 0; i < toCount; ++i) {
+        targets.push_back(std::make_unique<ReshardTarget>(ShardPath(toBase, i, toCount)));
+        if (!targets.back()->Open()) {
+            return false;
+        }
+    }
+
+    // Stream every source shard once; rows go out in batches to their target's writer
+    std::vector<std::vector<ReshardRow>> pending(toCount);
+    size_t read = 0;
+    bool ok = true;
+    for (size_t i = 0; i < fromCount && ok; ++i) {
+        std::string path = ShardPath(fromBase, i, fromCount);
+        sqlite3* source = nullptr;
+        sqlite3_stmt* select = nullptr;
+        if (sqlite3_open_v2(path.c_str(), &source, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK ||
+            sqlite3_prepare_v2(source, "SELECT name, phone, email FROM contacts;", -1, &select, 0) != SQLITE_OK) {
+            LogError("Cannot read shard %s: %s", path.c_str(), sqlite3_errmsg(source));
+            ok = false;
+        }
+        int rc = SQLITE_DONE;
+        while (ok && (rc = sqlite3_step(select)) == SQLITE_ROW) {
+            ReshardRow row;
+            for (int column = 0; column < 3; ++column) {
+                const char* text = reinterpret_cast<const char*>(sqlite3_column_text(select, column));
+                std::string value = text ? std::string(text, static_cast<size_t>(sqlite3_column_bytes(select, column)))
+                                         : std::string();
+                (column == 0 ? row.name : column == 1 ? row.phone : row.email) = std::move(value);
+            }
+            size_t target = ShardOf(row.phone, toCount);
+            pending[target].push_back(std::move(row));
+            ++read;
+            if (pending[target].size() >= kReshardBatch) {
+                targets[target]->Write(std::move(pending[target]));
+                pending[target] = std::vector<ReshardRow>();
+            }
+        }
+        if (ok && rc != SQLITE_DONE) {
+            LogError("Reading shard %s failed: %s", path.c_str(), sqlite3_errmsg(source));
+            ok = false;
+        }
+        sqlite3_finalize(select);
+        sqlite3_close(source);
+    }
+
+    size_t written = 0;
+    for (size_t i = 0; i < toCount; ++i) {
+        if (ok && !pending[i].empty()) {
+            targets[i]->Write(std::move(pending[i]));
+        }
+        ok = targets[i]->Finish() && ok;
+        written += targets[i]->GetWritten();
+    }
+    if (!ok || written != read) {
+        LogError("Resharding failed after %zu of %zu contacts; remove the target shards and retry.", written, read);
+        return false;
+    }
+    LogMessage("Resharded %zu contacts from %zu to %zu shards.", written, fromCount, toCount);
+    return true;
+}
@@ -0,0 +1,96 @@
+#ifndef SHARDEDBOOK_HPP
+#define SHARDEDBOOK_HPP
+
+#include <cstddef>
+#include <future>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+#include "Contact.hpp"
+#include "TelephoneBookLogic.hpp"
+
+// A book hash-partitioned by normalized phone number across N SQLite files, each
+// with its own TelephoneBookLogic (writer connection, read pool, snapshot and indexes)
+// and its own writer thread. Writes to different shards commit in parallel and each
+// only updates its own shard; searches run on all shards at once, on reader threads
+// each shard keeps for them, and the partial results are merged back into one
+// ordered list.
+//
+// Every spelling of a number ("+4930 1234", "004930 1234") lands on the same shard, so
+// the per-shard duplicate check in AddContact/ImportContacts is still global.
+//
+// The shard count is part of the file names (see ShardPath), so a book opened with the
+// wrong count finds empty shards instead of misrouting lookups; ReshardBook moves a
+// book to a new count.
+
+// File of shard 'shard' of 'shardCount': "contacts.db" -> "contacts-0of4.db". A book
+// of one shard is the plain file, so ShardedBook(path, 1) opens an ordinary book.
+std::string ShardPath(const std::string& basePath, size_t shard, size_t shardCount);
+
+// Shard a phone number belongs to (FNV-1a of NormalizePhone(phone), modulo the count).
+size_t ShardOf(const std::string& phone, size_t shardCount);
+
+class ShardWorkers; // Defined in ShardedBook.cpp
+
+class ShardedBook {
+public:
+    // Opens (or creates) all shard files in MultiReader mode; 'readPoolSize' read
+    // connections and search threads per shard (0 = one per core).
+    ShardedBook(const std::string& basePath, size_t shardCount, size_t readPoolSize = 1);
+    ~ShardedBook();
+
+    ShardedBook(const ShardedBook&) = delete;
+    ShardedBook& operator=(const ShardedBook&) = delete;
+
+    size_t GetShardCount() const { return shards.size(); }
+    TelephoneBookLogic& GetShard(size_t shard) { return *shards[shard]->book; }
+
+    // Writes are queued on the owning shard's writer thread. The Async variants return
+    // at once, so one caller can keep every shard busy; the others wait for the result.
+    std::future<bool> AddContactAsync(const Contact& contact);
+    bool AddContact(const Contact& contact) { return AddContactAsync(contact).get(); }
+    bool DeleteContact(const std::string& name, const std::string& phone);
+    // Refuses a number that is already taken, on the same shard or another one. A new
+    // number on another shard is added there before the old entry is removed (and
+    // removed again if that fails), so the contact is never lost; the two steps are not
+    // one transaction, though, and readers may briefly see both.
+    bool EditContact(const std::string& oldName, const std::string& oldPhone, const Contact& updatedContact);
+
+    // Splits the batch by shard and imports all parts in parallel. Indexes in
+    // 'rejected' refer to 'newContacts'. Returns the number inserted.
+    size_t ImportContacts(const std::vector<Contact>& newContacts, std::vector<ImportIssue>* rejected = nullptr);
+
+    // Routed to the one shard that can hold the number.
+    std::optional<Contact> FindByPhone(const std::string& phone) const;
+
+    // Scatter-gather: every shard is queried in parallel and the results are merged.
+    // SearchContacts and SearchStructured return contacts in name order (PHONEBOOK
+    // collation), SearchByPhonePrefix in normalized number order.
+    std::vector<Contact> SearchContacts(const std::string& query);
+    std::vector<Contact> SearchStructured(const std::string& query) const;
+    std::vector<Contact> SearchByPhonePrefix(const std::string& prefix, size_t limit = SIZE_MAX) const;
+
+    // All contacts of all shards in name order, merged from the shard snapshots.
+    std::vector<Contact> GetContacts() const;
+    size_t Size() const;
+
+private:
+    struct Shard {
+        std::unique_ptr<TelephoneBookLogic> book;
+        std::unique_ptr<ShardWorkers> writer;
+        std::unique_ptr<ShardWorkers> readers; // Run the shard's part of every search
+    };
+
+    Shard& ShardFor(const std::string& phone) const { return *shards[ShardOf(phone, shards.size())]; }
+
+    std::vector<std::unique_ptr<Shard>> shards;
+};
+
+// Copies the book stored as 'fromCount' shards at 'fromBase' (1 = a plain, unsharded
+// contacts.db) into 'toCount' new shards at 'toBase', one writer thread per target
+// shard with large transactions. The source is left untouched; the target files
+// must not exist yet. Returns false (and logs why) on any error.
+bool ReshardBook(const std::string& fromBase, size_t fromCount, const std::string& toBase, size_t toCount);
+
+#endif // SHARDEDBOOK_HPP
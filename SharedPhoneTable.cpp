@@ -0,0 +1,434 @@
+#include "SharedPhoneTable.hpp"
+#include "CoreLog.hpp"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+
+namespace {
+
+const uint64_t kSegmentMagic = 0x3142544E4F485042ull; // "BPHONTB1"
+const uint32_t kLayoutVersion = 1;
+
+// The header gets its own page; slot tables start after it.
+const size_t kHeaderBytes = 4096;
+const size_t kSlotAlignment = 64;
+const size_t kMinSlotCapacity = 64 * 1024;
+
+// Shared by every process mapping the segment, so all fields the writer changes after
+// initialization are atomics (lock-free 64/32-bit atomics are address-free).
+struct SlotHeader {
+    std::atomic<uint64_t> sequence; // Seqlock counter, odd while the slot is rewritten
+    std::atomic<uint64_t> offset;   // Start of the slot's table in the segment
+    std::atomic<uint64_t> capacity; // Bytes reserved at 'offset'
+    std::atomic<uint64_t> bytes;    // Bytes of the current table (0 = empty)
+};
+
+struct SegmentHeader {
+    std::atomic<uint64_t> magic; // Written last when the segment is initialized
+    uint32_t layoutVersion;
+    std::atomic<uint32_t> active;       // Slot readers should use
+    std::atomic<uint64_t> generation;   // Publish() calls so far
+    std::atomic<uint64_t> segmentBytes; // End of the last allocated slot region
+    SlotHeader slots[2];
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared-memory atomics must be lock-free");
+static_assert(sizeof(SegmentHeader) <= kHeaderBytes, "segment header must fit its page");
+
+// Table layout inside a slot:
+//   TableHeader | Bucket[bucketCount] | Record[count] | strings
+// Buckets use linear probing at a load factor of at most one half.
+struct TableHeader {
+    uint64_t count;
+    uint64_t bucketCount; // Power of two
+};
+
+struct Bucket {
+    uint32_t tag;    // High half of the phone's hash
+    uint32_t record; // Index + 1 into the records, 0 = empty bucket
+};
+
+struct Record {
+    uint32_t phoneOffset; // Into the string area
+    uint32_t nameOffset;
+    uint16_t phoneLength;
+    uint16_t nameLength;
+};
+
+uint64_t HashPhone(std::string_view phone) {
+    // FNV-1a: numbers are short, so this beats anything with a setup cost
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (char c : phone) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+
+size_t AlignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// Looks 'phone' up in a table of 'bytes' bytes that the writer may be changing under
+// us: every offset is checked before it is followed.
+bool ProbeTable(const char* table, uint64_t bytes, std::string_view phone, std::string& name) {
+    TableHeader header;
+    if (bytes < sizeof(header)) {
+        return false;
+    }
+    std::memcpy(&header, table, sizeof(header));
+    uint64_t bucketsEnd = sizeof(header) + header.bucketCount * sizeof(Bucket);
+    uint64_t recordsEnd = bucketsEnd + header.count * sizeof(Record);
+    if (header.bucketCount == 0 || (header.bucketCount & (header.bucketCount - 1)) != 0 ||
+        header.bucketCount > bytes || header.count > bytes || recordsEnd > bytes) {
+        return false;
+    }
+    const char* buckets = table + sizeof(header);
+    const char* records = table + bucketsEnd;
+    const char* strings = table + recordsEnd;
+    uint64_t stringBytes = bytes - recordsEnd;
+
+    uint64_t hash = HashPhone(phone);
+    uint32_t tag = static_cast<uint32_t>(hash >> 32);
+    uint64_t mask = header.bucketCount - 1;
+    for (uint64_t probe = 0, index = hash & mask; probe < header.bucketCount; ++probe, index = (index + 1) & mask) {
+        Bucket bucket;
+        std::memcpy(&bucket, buckets + index * sizeof(Bucket), sizeof(bucket));
+        if (bucket.record == 0) {
+            return false;
+        }
+        if (bucket.tag != tag || bucket.record > header.count) {
+            continue;
+        }
+        Record record;
+        std::memcpy(&record, records + (bucket.record - 1) * sizeof(Record), sizeof(record));
+        if (static_cast<uint64_t>(record.phoneOffset) + record.phoneLength > stringBytes ||
+            static_cast<uint64_t>(record.nameOffset) + record.nameLength > stringBytes) {
+            return false;
+        }
+        if (record.phoneLength == phone.size() &&
+            std::memcmp(strings + record.phoneOffset, phone.data(), phone.size()) == 0) {
+            name.assign(strings + record.nameOffset, record.nameLength);
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+// ---- Writer
+
+SharedPhoneTableWriter::~SharedPhoneTableWriter() {
+    Close();
+}
+
+bool SharedPhoneTableWriter::Open(const std::string& name) {
+    Close();
+    fd = shm_open(name.c_str(), O_CREAT | O_RDWR | O_CLOEXEC, 0644);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0) {
+        LogError("Cannot open shared memory '%s': %s", name.c_str(), std::strerror(errno));
+        Close();
+        return false;
+    }
+    size_t size = static_cast<size_t>(info.st_size);
+    if (!Resize(std::max(size, kHeaderBytes))) {
+        Close();
+        return false;
+    }
+
+    // A segment left by an earlier writer with the same layout is adopted, so readers
+    // that already have it mapped keep working
+    SegmentHeader* header = reinterpret_cast<SegmentHeader*>(base);
+    if (size >= kHeaderBytes && header->magic.load(std::memory_order_acquire) == kSegmentMagic &&
+        header->layoutVersion == kLayoutVersion && header->segmentBytes.load() <= size) {
+        return true;
+    }
+    header->magic.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    header->layoutVersion = kLayoutVersion;
+    header->active.store(0, std::memory_order_relaxed);
+    header->generation.store(0, std::memory_order_relaxed);
+    header->segmentBytes.store(kHeaderBytes, std::memory_order_relaxed);
+    for (SlotHeader& slot : header->slots) {
+        slot.sequence.store(0, std::memory_order_relaxed);
+        slot.offset.store(0, std::memory_order_relaxed);
+        slot.capacity.store(0, std::memory_order_relaxed);
+        slot.bytes.store(0, std::memory_order_relaxed);
+    }
+    header->magic.store(kSegmentMagic, std::memory_order_release);
+    return true;
+}
+
+void SharedPhoneTableWriter::Close() {
+    if (base) {
+        munmap(base, mappedBytes);
+        base = nullptr;
+        mappedBytes = 0;
+    }
+    if (fd >= 0) {
+        close(fd);
+        fd = -1;
+    }
+}
+
+bool SharedPhoneTableWriter::Resize(size_t bytes) {
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (static_cast<size_t>(info.st_size) < bytes && ftruncate(fd, static_cast<off_t>(bytes)) != 0)) {
+        LogError("Cannot grow the shared phone table to %zu bytes: %s", bytes, std::strerror(errno));
+        return false;
+    }
+    if (base) {
+        munmap(base, mappedBytes);
+    }
+    void* mapped = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapped == MAP_FAILED) {
+        LogError("Cannot map the shared phone table: %s", std::strerror(errno));
+        base = nullptr;
+        mappedBytes = 0;
+        return false;
+    }
+    base = static_cast<char*>(mapped);
+    mappedBytes = bytes;
+    return true;
+}
+
+bool SharedPhoneTableWriter::Publish(const std::vector<Contact>& contacts) {
+    if (!base) {
+        return false;
+    }
+    uint64_t bucketCount = 16;
+    while (bucketCount < contacts.size() * 2) {
+        bucketCount *= 2;
+    }
+    size_t stringBytes = 0;
+    for (const Contact& contact : contacts) {
+        stringBytes += std::min<size_t>(contact.GetPhone().size(), UINT16_MAX) +
+                       std::min<size_t>(contact.GetName().size(), UINT16_MAX);
+    }
+    size_t recordsStart = sizeof(TableHeader) + bucketCount * sizeof(Bucket);
+    size_t stringsStart = recordsStart + contacts.size() * sizeof(Record);
+    size_t bytes = stringsStart + stringBytes;
+    if (stringBytes > UINT32_MAX) {
+        LogError("Shared phone table is limited to 4 GiB of names and numbers.");
+        return false;
+    }
+
+    SegmentHeader* header = reinterpret_cast<SegmentHeader*>(base);
+    uint32_t target = 1 - header->active.load(std::memory_order_relaxed);
+    SlotHeader* slot = &header->slots[target];
+    uint64_t offset = slot->offset.load(std::memory_order_relaxed);
+    uint64_t capacity = slot->capacity.load(std::memory_order_relaxed);
+    bool moved = capacity < bytes;
+    if (moved) {
+        // The slot moves to a new region at the end; readers map the bigger segment on
+        // their next lookup. Headroom keeps this rare while the book grows.
+        offset = AlignUp(header->segmentBytes.load(std::memory_order_relaxed), kSlotAlignment);
+        capacity = std::max(bytes + bytes / 2, kMinSlotCapacity);
+        if (!Resize(offset + capacity)) {
+            return false;
+        }
+        header = reinterpret_cast<SegmentHeader*>(base);
+        slot = &header->slots[target];
+    }
+
+    uint64_t sequence = slot->sequence.load(std::memory_order_relaxed);
+    slot->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    if (moved) {
+        slot->offset.store(offset, std::memory_order_relaxed);
+        slot->capacity.store(capacity, std::memory_order_relaxed);
+        header->segmentBytes.store(offset + capacity, std::memory_order_relaxed);
+    }
+
+    char* table = base + offset;
+    char* buckets = table + sizeof(TableHeader);
+    char* records = table + recordsStart;
+    char* strings = table + stringsStart;
+    std::memset(buckets, 0, bucketCount * sizeof(Bucket));
+    uint64_t mask = bucketCount - 1;
+    uint32_t count = 0;
+    uint32_t stringOffset = 0;
+    for (const Contact& contact : contacts) {
+        std::string_view phone(contact.GetPhone().data(), std::min<size_t>(contact.GetPhone().size(), UINT16_MAX));
+        std::string_view name(contact.GetName().data(), std::min<size_t>(contact.GetName().size(), UINT16_MAX));
+        uint64_t hash = HashPhone(phone);
+        uint32_t tag = static_cast<uint32_t>(hash >> 32);
+        uint64_t index = hash & mask;
+        bool duplicate = false;
+        while (true) {
+            Bucket bucket;
+            std::memcpy(&bucket, buckets + index * sizeof(Bucket), sizeof(bucket));
+            if (bucket.record == 0) {
+                break;
+            }
+            if (bucket.tag == tag) {
+                Record existing;
+                std::memcpy(&existing, records + (bucket.record - 1) * sizeof(Record), sizeof(existing));
+                if (existing.phoneLength == phone.size() &&
+                    std::memcmp(strings + existing.phoneOffset, phone.data(), phone.size()) == 0) {
+                    duplicate = true;
+                    break;
+                }
+            }
+            index = (index + 1) & mask;
+        }
+        if (duplicate) {
+            continue;
+        }
+        Record record{stringOffset, static_cast<uint32_t>(stringOffset + phone.size()),
+                      static_cast<uint16_t>(phone.size()), static_cast<uint16_t>(name.size())};
+        std::memcpy(strings + stringOffset, phone.data(), phone.size());
+        std::memcpy(strings + record.nameOffset, name.data(), name.size());
+        stringOffset = static_cast<uint32_t>(record.nameOffset + name.size());
+        std::memcpy(records + count * sizeof(Record), &record, sizeof(record));
+        ++count;
+        Bucket bucket{tag, count};
+        std::memcpy(buckets + index * sizeof(Bucket), &bucket, sizeof(bucket));
+    }
+    TableHeader tableHeader{count, bucketCount};
+    std::memcpy(table, &tableHeader, sizeof(tableHeader));
+
+    // Records of skipped duplicates are not written, so the strings directly follow
+    // the records actually used
+    if (count < contacts.size()) {
+        size_t usedStrings = stringOffset;
+        std::memmove(records + count * sizeof(Record), strings, usedStrings);
+        bytes = recordsStart + count * sizeof(Record) + usedStrings;
+    }
+    slot->bytes.store(bytes, std::memory_order_relaxed);
+    slot->sequence.store(sequence + 2, std::memory_order_release);
+
+    header->active.store(target, std::memory_order_release);
+    header->generation.fetch_add(1, std::memory_order_release);
+    return true;
+}
+
+uint64_t SharedPhoneTableWriter::GetGeneration() const {
+    return base ? reinterpret_cast<const SegmentHeader*>(base)->generation.load(std::memory_order_acquire) : 0;
+}
+
+bool SharedPhoneTableWriter::Remove(const std::string& name) {
+    return shm_unlink(name.c_str()) == 0;
+}
+
+// ---- Reader
+
+SharedPhoneTableReader::~SharedPhoneTableReader() {
+    Close();
+}
+
+bool SharedPhoneTableReader::Open(const std::string& name) {
+    Close();
+    fd = shm_open(name.c_str(), O_RDONLY | O_CLOEXEC, 0);
+    if (fd < 0 || !Remap()) {
+        Close();
+        return false;
+    }
+    const SegmentHeader* header = reinterpret_cast<const SegmentHeader*>(base);
+    if (header->magic.load(std::memory_order_acquire) != kSegmentMagic || header->layoutVersion != kLayoutVersion) {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void SharedPhoneTableReader::Close() {
+    if (base) {
+        munmap(const_cast<char*>(base), mappedBytes);
+        base = nullptr;
+        mappedBytes = 0;
+    }
+    if (fd >= 0) {
+        close(fd);
+        fd = -1;
+    }
+}
+
+bool SharedPhoneTableReader::Remap() {
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < kHeaderBytes) {
+        return false;
+    }
+    if (base) {
+        munmap(const_cast<char*>(base), mappedBytes);
+        base = nullptr;
+    }
+    size_t size = static_cast<size_t>(info.st_size);
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (mapped == MAP_FAILED) {
+        mappedBytes = 0;
+        return false;
+    }
+    base = static_cast<const char*>(mapped);
+    mappedBytes = size;
+    return true;
+}
+
+bool SharedPhoneTableReader::Lookup(std::string_view phone, std::string& name) {
+    for (unsigned attempt = 0; base; ++attempt) {
+        if (attempt > 64) {
+            std::this_thread::yield(); // The writer is mid-publish twice in a row; let it finish
+        }
+        const SegmentHeader* header = reinterpret_cast<const SegmentHeader*>(base);
+        const SlotHeader& slot = header->slots[header->active.load(std::memory_order_acquire) & 1];
+        uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+        if (sequence & 1) {
+            continue;
+        }
+        uint64_t offset = slot.offset.load(std::memory_order_relaxed);
+        uint64_t bytes = slot.bytes.load(std::memory_order_relaxed);
+        if (bytes > 0 && (offset < kHeaderBytes || offset + bytes > mappedBytes)) {
+            // Grown by the writer since we mapped it (or a torn read: then this is a no-op)
+            if (!Remap()) {
+                return false;
+            }
+            continue;
+        }
+        bool found = bytes > 0 && ProbeTable(base + offset, bytes, phone, name);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) == sequence) {
+            return found;
+        }
+    }
+    return false;
+}
+
+uint64_t SharedPhoneTableReader::GetGeneration() const {
+    return base ? reinterpret_cast<const SegmentHeader*>(base)->generation.load(std::memory_order_acquire) : 0;
+}
+
+size_t SharedPhoneTableReader::Size() {
+    while (base) {
+        const SegmentHeader* header = reinterpret_cast<const SegmentHeader*>(base);
+        const SlotHeader& slot = header->slots[header->active.load(std::memory_order_acquire) & 1];
+        uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+        uint64_t offset = slot.offset.load(std::memory_order_relaxed);
+        uint64_t bytes = slot.bytes.load(std::memory_order_relaxed);
+        if (sequence & 1) {
+            continue;
+        }
+        if (bytes > 0 && (offset < kHeaderBytes || offset + bytes > mappedBytes)) {
+            if (!Remap()) {
+                return 0;
+            }
+            continue;
+        }
+        TableHeader table{0, 0};
+        if (bytes >= sizeof(table)) {
+            std::memcpy(&table, base + offset, sizeof(table));
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) == sequence) {
+            return static_cast<size_t>(table.count);
+        }
+    }
+    return 0;
+}
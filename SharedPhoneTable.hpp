@@ -0,0 +1,87 @@
+#ifndef SHAREDPHONETABLE_HPP
+#define SHAREDPHONETABLE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Contact.hpp"
+
+// Phone -> name table in a POSIX shared-memory segment, for caller ID in other
+// processes without a socket round trip or any syscall per lookup.
+//
+// The segment holds a header and two slots, each a complete open-addressing hash table
+// keyed by the stored phone number. The writer fills the slot readers are not using and
+// then flips 'active' atomically, so readers normally never wait. Every slot also has a
+// seqlock counter (odd while it is being rewritten): a reader that was still inside the
+// old slot when the writer came back to rewrite it sees the counter change and simply
+// retries on the new active slot. Everything a reader follows inside a slot is bounds
+// checked, so a torn read can only cause a retry, never a wild access.
+//
+// There must be only one writer per segment; any number of readers may map it.
+
+// Creates (or adopts) the segment and publishes contact lists into it.
+class SharedPhoneTableWriter {
+public:
+    SharedPhoneTableWriter() = default;
+    ~SharedPhoneTableWriter();
+
+    SharedPhoneTableWriter(const SharedPhoneTableWriter&) = delete;
+    SharedPhoneTableWriter& operator=(const SharedPhoneTableWriter&) = delete;
+
+    // 'name' is a shm_open name such as "/phonebook". Existing data of a previous
+    // writer stays readable until the first Publish().
+    bool Open(const std::string& name);
+    void Close();
+    bool IsOpen() const { return base != nullptr; }
+
+    // Replaces the table with the numbers in 'contacts' (the first contact wins if a
+    // number occurs twice). Grows the segment when the table no longer fits.
+    bool Publish(const std::vector<Contact>& contacts);
+
+    // Number of Publish() calls on this segment so far.
+    uint64_t GetGeneration() const;
+
+    // Removes the segment name; mapped readers keep their mapping.
+    static bool Remove(const std::string& name);
+
+private:
+    bool Resize(size_t bytes);
+
+    int fd = -1;
+    char* base = nullptr;
+    size_t mappedBytes = 0;
+};
+
+// Maps the segment read-only and answers lookups from it.
+class SharedPhoneTableReader {
+public:
+    SharedPhoneTableReader() = default;
+    ~SharedPhoneTableReader();
+
+    SharedPhoneTableReader(const SharedPhoneTableReader&) = delete;
+    SharedPhoneTableReader& operator=(const SharedPhoneTableReader&) = delete;
+
+    // Fails (quietly, so callers can poll) until a writer has initialized the segment.
+    bool Open(const std::string& name);
+    void Close();
+    bool IsOpen() const { return base != nullptr; }
+
+    // Copies the name stored for exactly 'phone' into 'name'. Only remaps (a syscall)
+    // when the writer has grown the segment since the last call.
+    bool Lookup(std::string_view phone, std::string& name);
+
+    // Generation and number of entries of the table currently published.
+    uint64_t GetGeneration() const;
+    size_t Size();
+
+private:
+    bool Remap();
+
+    int fd = -1;
+    const char* base = nullptr;
+    size_t mappedBytes = 0;
+};
+
+#endif // SHAREDPHONETABLE_HPP
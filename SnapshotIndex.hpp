@@ -0,0 +1,17 @@
+#ifndef SNAPSHOTINDEX_HPP
+#define SNAPSHOTINDEX_HPP
+
+#include <cstdint>
+#include <vector>
+
+// How a snapshot was derived from the previous one, so that an index holding positions
+// can be patched in one pass instead of rebuilt. Surviving contacts keep their relative
+// order, so 'remap' is increasing wherever it is not kRemoved.
+struct SnapshotDelta {
+    static constexpr uint32_t kRemoved = UINT32_MAX;
+
+    std::vector<uint32_t> remap; // Previous position -> new position, or kRemoved
+    std::vector<uint32_t> added; // New positions of the added contacts, ascending
+};
+
+#endif // SNAPSHOTINDEX_HPP
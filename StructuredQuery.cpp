@@ -0,0 +1,992 @@
+#include "StructuredQuery.hpp"
+#include "Collation.hpp"
+#include "EmailDomainIndex.hpp"
+#include "FuzzyNameIndex.hpp"
+#include "NameWordIndex.hpp"
+#include "PhonePrefixIndex.hpp"
+#include <algorithm>
+#include <iterator>
+#include <unordered_map>
+
+namespace {
+
+enum class QueryField { Any, Name, Phone, Email };
+
+// How a term compares against its field. See the grammar in StructuredQuery.hpp.
+enum class TermMatch {
+    Contains, // Substring (bare terms, e-mails without '@')
+    Exact,    // Whole name word / normalized phone number
+    Prefix,   // Name word or phone number starting with 'key'
+    Glob,     // '*' and '?' wildcards over a name word, phone number or e-mail
+    Phrase,   // Consecutive name words
+    Fuzzy,    // Name word within 'distance' edits
+    Domain,   // E-mail domain or subdomain
+    Address   // Whole e-mail address
+};
+
+// How a plan step produces its rows.
+enum class Access {
+    NameWords,     // Name word index lookup
+    FuzzyNames,    // Fuzzy name index lookup
+    PhonePrefixes, // Phone prefix index lookup
+    EmailDomains,  // E-mail domain index lookup
+    Scan,          // Every contact checked against the clause
+    AllRows,       // Every contact (an AND of negations only)
+    Filter,        // Rows of the single input, then the checks
+    Intersect,     // Rows present in every input, then the exclusions and checks
+    Difference,    // Rows of the single input minus the exclusions, then the checks
+    Union,         // Rows present in any input
+    Complement     // Rows missing from the input
+};
+
+// Checks are several times dearer per row than reading an index entry (string
+// conversion and comparison), so an AND intersects a second index result up to this
+// many times larger than its candidates before it falls back to checking them.
+constexpr size_t kIntersectFactor = 4;
+
+constexpr const char* kWordSeparators = " \t-,.";
+
+std::string ToLowerAscii(std::string text) {
+    for (char& c : text) {
+        if (c >= 'A' && c <= 'Z') {
+            c = static_cast<char>(c - 'A' + 'a');
+        }
+    }
+    return text;
+}
+
+bool IsSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+bool HasWildcard(const std::string& text) {
+    return text.find_first_of("*?") != std::string::npos;
+}
+
+// Text before the first wildcard; the part of a glob an index can look up.
+std::string LiteralPrefix(const std::string& pattern) {
+    return pattern.substr(0, pattern.find_first_of("*?"));
+}
+
+std::vector<std::string> SplitWords(const std::string& text) {
+    std::vector<std::string> words;
+    size_t start = 0;
+    while (start < text.size()) {
+        size_t end = text.find_first_of(kWordSeparators, start);
+        if (end == std::string::npos) {
+            end = text.size();
+        }
+        if (end > start) {
+            words.push_back(text.substr(start, end - start));
+        }
+        start = end + 1;
+    }
+    return words;
+}
+
+// Whole-string match with '*' (any run) and '?' (any one byte).
+bool GlobMatch(const std::string& text, const std::string& pattern) {
+    size_t t = 0;
+    size_t p = 0;
+    size_t starPattern = std::string::npos;
+    size_t starText = 0;
+    while (t < text.size()) {
+        if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == text[t])) {
+            ++t;
+            ++p;
+        } else if (p < pattern.size() && pattern[p] == '*') {
+            starPattern = p++;
+            starText = t;
+        } else if (starPattern != std::string::npos) {
+            p = starPattern + 1;
+            t = ++starText;
+        } else {
+            return false;
+        }
+    }
+    while (p < pattern.size() && pattern[p] == '*') {
+        ++p;
+    }
+    return p == pattern.size();
+}
+
+// Digits and wildcards of a phone pattern, with the international prefix removed the
+// same way NormalizePhone does.
+std::string PhonePattern(const std::string& text) {
+    std::string pattern;
+    for (char c : text) {
+        if ((c >= '0' && c <= '9') || c == '*' || c == '?') {
+            pattern += c;
+        }
+    }
+    if (pattern.size() >= 2 && pattern.compare(0, 2, "00") == 0) {
+        pattern.erase(0, 2);
+    }
+    return pattern;
+}
+
+struct Token {
+    enum class Type { Word, Open, Close, And, Or, Not, End };
+    Type type = Type::End;
+    std::string field; // "name" in name:ali*; empty for bare terms
+    std::string value; // Quotes removed
+    std::string text;  // As written
+    bool quoted = false;
+    size_t offset = 0;
+};
+
+bool Tokenize(const std::string& text, std::vector<Token>& tokens, std::string& error) {
+    size_t i = 0;
+    while (true) {
+        while (i < text.size() && IsSpace(text[i])) {
+            ++i;
+        }
+        if (i == text.size()) {
+            break;
+        }
+        Token token;
+        token.offset = i;
+        char c = text[i];
+        if (c == '(' || c == ')') {
+            token.type = c == '(' ? Token::Type::Open : Token::Type::Close;
+            token.text = std::string(1, c);
+            tokens.push_back(token);
+            ++i;
+            continue;
+        }
+        // "-term" is shorthand for NOT term; a lone '-' is a term of its own.
+        if (c == '-' && i + 1 < text.size() && !IsSpace(text[i + 1]) && text[i + 1] != ')') {
+            token.type = Token::Type::Not;
+            token.text = "-";
+            tokens.push_back(token);
+            ++i;
+            continue;
+        }
+
+        token.type = Token::Type::Word;
+        bool letters = true; // Only letters so far, so a ':' ends a field name
+        while (i < text.size() && !IsSpace(text[i]) && text[i] != '(' && text[i] != ')') {
+            if (text[i] == '"') {
+                size_t close = text.find('"', i + 1);
+                if (close == std::string::npos) {
+                    error = "Unterminated quote at offset " + std::to_string(i);
+                    return false;
+                }
+                token.value.append(text, i + 1, close - i - 1);
+                token.quoted = true;
+                letters = false;
+                i = close + 1;
+                continue;
+            }
+            if (text[i] == ':' && letters && token.field.empty() && !token.value.empty()) {
+                token.field = ToLowerAscii(token.value);
+                token.value.clear();
+            } else {
+                char ch = text[i];
+                letters = letters && ((ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z'));
+                token.value += ch;
+            }
+            ++i;
+        }
+        token.text = text.substr(token.offset, i - token.offset);
+        if (!token.quoted && token.field.empty()) {
+            if (token.value == "AND") {
+                token.type = Token::Type::And;
+            } else if (token.value == "OR") {
+                token.type = Token::Type::Or;
+            } else if (token.value == "NOT") {
+                token.type = Token::Type::Not;
+            }
+        }
+        tokens.push_back(token);
+    }
+    Token end;
+    end.offset = text.size();
+    tokens.push_back(end);
+    return true;
+}
+
+} // namespace
+
+struct StructuredQuery::Node {
+    enum class Kind { Term, And, Or, Not };
+
+    Kind kind = Kind::Term;
+    QueryField field = QueryField::Any;
+    TermMatch match = TermMatch::Contains;
+    std::string value;              // Folded word, prefix, pattern, phrase or address
+    std::string key;                // Index key: normalized phone (pattern) or e-mail domain
+    std::vector<std::string> words; // Phrase words
+    uint32_t distance = 0;          // Fuzzy edits
+    std::string text;               // As written, for Explain
+    std::vector<std::unique_ptr<Node>> children;
+};
+
+namespace {
+
+using Node = StructuredQuery::Node;
+
+std::unique_ptr<Node> MakeNode(Node::Kind kind) {
+    auto node = std::make_unique<Node>();
+    node->kind = kind;
+    return node;
+}
+
+// Turns a word token into a term, deciding its field and match kind.
+std::unique_ptr<Node> MakeTerm(const Token& token, std::string& error) {
+    auto node = MakeNode(Node::Kind::Term);
+    node->text = token.text;
+    if (token.field.empty()) {
+        node->field = QueryField::Any;
+    } else if (token.field == "name") {
+        node->field = QueryField::Name;
+    } else if (token.field == "phone") {
+        node->field = QueryField::Phone;
+    } else if (token.field == "email") {
+        node->field = QueryField::Email;
+    } else {
+        error = "Unknown field '" + token.field + ":' at offset " + std::to_string(token.offset) +
+                " (use name:, phone: or email:)";
+        return nullptr;
+    }
+    if (token.value.empty()) {
+        error = "Missing value for '" + token.text + "' at offset " + std::to_string(token.offset);
+        return nullptr;
+    }
+    // Folded exactly as the name index folds names, so "STRAUSS" finds "Strauß".
+    std::string value = FoldCase(token.value);
+    bool wildcard = !token.quoted && HasWildcard(value);
+
+    // name:jon~ / name:jon~1 (bare "jon~" is a fuzzy name search as well)
+    size_t tilde = value.rfind('~');
+    if (!token.quoted && tilde != std::string::npos && tilde > 0 &&
+        (node->field == QueryField::Name || node->field == QueryField::Any) &&
+        value.find_first_not_of("0123456789", tilde + 1) == std::string::npos) {
+        std::string digits = value.substr(tilde + 1);
+        node->field = QueryField::Name;
+        node->match = TermMatch::Fuzzy;
+        node->value = value.substr(0, tilde);
+        node->distance = digits.empty() ? 2u : static_cast<uint32_t>(std::stoul(digits.substr(0, 2)));
+        if (node->distance > 2) {
+            error = "Fuzzy distance in '" + token.text + "' must be 0, 1 or 2";
+            return nullptr;
+        }
+        return node;
+    }
+
+    switch (node->field) {
+    case QueryField::Any:
+        node->match = wildcard ? TermMatch::Glob : TermMatch::Contains;
+        node->value = value;
+        break;
+    case QueryField::Name:
+        node->value = value;
+        if (wildcard) {
+            bool trailingStarOnly = value.back() == '*' && !HasWildcard(value.substr(0, value.size() - 1));
+            node->match = trailingStarOnly && value.size() > 1 ? TermMatch::Prefix : TermMatch::Glob;
+            if (node->match == TermMatch::Prefix) {
+                node->value.pop_back();
+            }
+        } else {
+            node->words = SplitWords(value);
+            node->match = node->words.size() > 1 ? TermMatch::Phrase : TermMatch::Exact;
+            if (node->words.empty()) {
+                error = "'" + token.text + "' has no name words";
+                return nullptr;
+            }
+            if (node->match == TermMatch::Exact) {
+                node->value = node->words.front();
+            }
+        }
+        break;
+    case QueryField::Phone:
+        node->key = PhonePattern(value);
+        if (node->key.find_first_of("0123456789*") == std::string::npos) {
+            error = "'" + token.text + "' has no digits";
+            return nullptr;
+        }
+        if (!wildcard) {
+            node->match = TermMatch::Exact;
+        } else if (node->key.back() == '*' && !HasWildcard(node->key.substr(0, node->key.size() - 1)) &&
+                   node->key.size() > 1) {
+            node->match = TermMatch::Prefix;
+            node->key.pop_back();
+        } else {
+            node->match = TermMatch::Glob;
+        }
+        node->value = node->key;
+        break;
+    case QueryField::Email: {
+        node->value = value;
+        size_t at = value.rfind('@');
+        if (wildcard) {
+            // email:*@corp.com is the same as email:@corp.com
+            bool domainOnly = at == 1 && value[0] == '*' && !HasWildcard(value.substr(at + 1));
+            node->match = domainOnly ? TermMatch::Domain : TermMatch::Glob;
+        } else if (at == std::string::npos) {
+            node->match = TermMatch::Contains;
+        } else {
+            node->match = at == 0 ? TermMatch::Domain : TermMatch::Address;
+        }
+        if (node->match == TermMatch::Domain || node->match == TermMatch::Address) {
+            node->value = value.substr(node->match == TermMatch::Domain ? at + 1 : 0);
+            node->key = ReversedEmailDomain(value.substr(at));
+            if (node->key.empty()) {
+                error = "'" + token.text + "' has no domain";
+                return nullptr;
+            }
+        }
+        break;
+    }
+    }
+    return node;
+}
+
+// Recursive descent over the token list:
+//   or    := and ("OR" and)*
+//   and   := unary (["AND"] unary)*
+//   unary := ("NOT" | "-") unary | "(" or ")" | term
+class Parser {
+public:
+    Parser(const std::vector<Token>& tokens, std::string& error) : tokens(tokens), error(error) {}
+
+    std::unique_ptr<Node> ParseQuery() {
+        if (Peek().type == Token::Type::End) {
+            error = "Empty query";
+            return nullptr;
+        }
+        std::unique_ptr<Node> node = ParseOr();
+        if (node && Peek().type != Token::Type::End) {
+            error = Unexpected(Peek());
+            return nullptr;
+        }
+        return node;
+    }
+
+private:
+    const Token& Peek() const { return tokens[position]; }
+
+    std::string Unexpected(const Token& token) const {
+        if (token.type == Token::Type::End) {
+            return "Query ends after an operator";
+        }
+        return "Unexpected '" + token.text + "' at offset " + std::to_string(token.offset);
+    }
+
+    bool StartsOperand(Token::Type type) const {
+        return type == Token::Type::Word || type == Token::Type::Open || type == Token::Type::Not;
+    }
+
+    std::unique_ptr<Node> ParseOr() {
+        std::unique_ptr<Node> first = ParseAnd();
+        if (!first || Peek().type != Token::Type::Or) {
+            return first;
+        }
+        auto node = MakeNode(Node::Kind::Or);
+        node->children.push_back(std::move(first));
+        while (Peek().type == Token::Type::Or) {
+            ++position;
+            std::unique_ptr<Node> next = ParseAnd();
+            if (!next) {
+                return nullptr;
+            }
+            node->children.push_back(std::move(next));
+        }
+        return node;
+    }
+
+    std::unique_ptr<Node> ParseAnd() {
+        std::unique_ptr<Node> first = ParseUnary();
+        if (!first) {
+            return nullptr;
+        }
+        std::unique_ptr<Node> node;
+        while (Peek().type == Token::Type::And || StartsOperand(Peek().type)) {
+            if (Peek().type == Token::Type::And) {
+                ++position;
+            }
+            std::unique_ptr<Node> next = ParseUnary();
+            if (!next) {
+                return nullptr;
+            }
+            if (!node) {
+                node = MakeNode(Node::Kind::And);
+                node->children.push_back(std::move(first));
+            }
+            node->children.push_back(std::move(next));
+        }
+        return node ? std::move(node) : std::move(first);
+    }
+
+    std::unique_ptr<Node> ParseUnary() {
+        const Token& token = Peek();
+        switch (token.type) {
+        case Token::Type::Not: {
+            ++position;
+            std::unique_ptr<Node> child = ParseUnary();
+            if (!child) {
+                return nullptr;
+            }
+            auto node = MakeNode(Node::Kind::Not);
+            node->children.push_back(std::move(child));
+            return node;
+        }
+        case Token::Type::Open: {
+            ++position;
+            std::unique_ptr<Node> inner = ParseOr();
+            if (!inner) {
+                return nullptr;
+            }
+            if (Peek().type != Token::Type::Close) {
+                error = "Missing ')' for '(' at offset " + std::to_string(token.offset);
+                return nullptr;
+            }
+            ++position;
+            return inner;
+        }
+        case Token::Type::Word:
+            ++position;
+            return MakeTerm(token, error);
+        default:
+            error = Unexpected(token);
+            return nullptr;
+        }
+    }
+
+    const std::vector<Token>& tokens;
+    std::string& error;
+    size_t position = 0;
+};
+
+// Which index answers a term, if any. Decided from the term alone, so the required
+// indexes are known before any of them is built.
+Access TermAccess(const Node& node) {
+    switch (node.field) {
+    case QueryField::Name:
+        switch (node.match) {
+        case TermMatch::Exact:
+        case TermMatch::Prefix:
+        case TermMatch::Phrase:
+            return Access::NameWords;
+        case TermMatch::Fuzzy:
+            return Access::FuzzyNames;
+        case TermMatch::Glob:
+            return LiteralPrefix(node.value).empty() ? Access::Scan : Access::NameWords;
+        default:
+            return Access::Scan;
+        }
+    case QueryField::Phone:
+        return LiteralPrefix(node.key).empty() ? Access::Scan : Access::PhonePrefixes;
+    case QueryField::Email:
+        return node.match == TermMatch::Domain || node.match == TermMatch::Address ? Access::EmailDomains
+                                                                                    : Access::Scan;
+    default:
+        return Access::Scan;
+    }
+}
+
+// Whether index rows for the term still have to be checked against it because the
+// index key is broader than the term (phrases, globs, exact phones).
+bool NeedsCheck(const Node& node) {
+    switch (TermAccess(node)) {
+    case Access::NameWords:
+        return node.match == TermMatch::Phrase || node.match == TermMatch::Glob;
+    case Access::PhonePrefixes:
+        return node.match != TermMatch::Prefix;
+    default:
+        return false;
+    }
+}
+
+// The word (or word prefix) a name term looks up: the longest word of a phrase, which
+// is usually the rarest.
+std::string NameKey(const Node& node, bool& prefix) {
+    prefix = node.match == TermMatch::Prefix || node.match == TermMatch::Glob;
+    if (node.match == TermMatch::Phrase) {
+        return *std::max_element(node.words.begin(), node.words.end(),
+                                 [](const std::string& a, const std::string& b) { return a.size() < b.size(); });
+    }
+    return node.match == TermMatch::Glob ? LiteralPrefix(node.value) : node.value;
+}
+
+unsigned CollectIndexes(const Node& node) {
+    unsigned needs = 0;
+    if (node.kind == Node::Kind::Term) {
+        switch (TermAccess(node)) {
+        case Access::NameWords:
+            needs |= kQueryNeedsNameWords;
+            break;
+        case Access::FuzzyNames:
+            needs |= kQueryNeedsFuzzyNames;
+            break;
+        case Access::PhonePrefixes:
+            needs |= kQueryNeedsPhonePrefixes;
+            break;
+        case Access::EmailDomains:
+            // Domain entries carry phone numbers, mapped back to positions by phone
+            needs |= kQueryNeedsEmailDomains | kQueryNeedsPhonePrefixes;
+            break;
+        default:
+            break;
+        }
+    }
+    for (const auto& child : node.children) {
+        needs |= CollectIndexes(*child);
+    }
+    return needs;
+}
+
+std::string Render(const Node& node) {
+    if (node.kind == Node::Kind::Term) {
+        return node.text;
+    }
+    auto operand = [](const Node& child) {
+        return child.kind == Node::Kind::Term || child.kind == Node::Kind::Not ? Render(child)
+                                                                               : "(" + Render(child) + ")";
+    };
+    if (node.kind == Node::Kind::Not) {
+        return "NOT " + operand(*node.children.front());
+    }
+    std::string text;
+    for (const auto& child : node.children) {
+        if (!text.empty()) {
+            text += node.kind == Node::Kind::And ? " AND " : " OR ";
+        }
+        text += operand(*child);
+    }
+    return text;
+}
+
+struct PlanStep {
+    const Node* node = nullptr;
+    Access access = Access::Scan;
+    size_t estimate = 0;
+    std::vector<PlanStep> inputs;
+    std::vector<PlanStep> excluded;  // Rows removed from the result (indexed NOT clauses of an AND)
+    std::vector<const Node*> checks; // Clauses every remaining row must satisfy
+};
+
+// Plans and runs one query against one snapshot. Index lookups whose size is only
+// known after running them (fuzzy, e-mail domain) are run while planning and kept
+// for execution.
+class Executor {
+public:
+    explicit Executor(const QueryIndexes& indexes) : indexes(indexes), rowCount(indexes.contacts->size()) {}
+
+    PlanStep Plan(const Node& node) {
+        switch (node.kind) {
+        case Node::Kind::Term: {
+            PlanStep step{&node, TermAccess(node), rowCount, {}, {}, {}};
+            if (step.access != Access::Scan) {
+                step.estimate = Estimate(node);
+            }
+            return step;
+        }
+        case Node::Kind::And:
+            return PlanAnd(node);
+        case Node::Kind::Or: {
+            PlanStep step{&node, Access::Union, 0, {}, {}, {}};
+            for (const auto& child : node.children) {
+                step.inputs.push_back(Plan(*child));
+                if (step.inputs.back().access == Access::Scan) {
+                    // One pass over the contacts answers the whole OR
+                    return PlanStep{&node, Access::Scan, rowCount, {}, {}, {}};
+                }
+                step.estimate = std::min(rowCount, step.estimate + step.inputs.back().estimate);
+            }
+            return step;
+        }
+        case Node::Kind::Not: {
+            PlanStep input = Plan(*node.children.front());
+            if (input.access == Access::Scan) {
+                return PlanStep{&node, Access::Scan, rowCount, {}, {}, {}};
+            }
+            PlanStep step{&node, Access::Complement, rowCount - std::min(rowCount, input.estimate), {}, {}, {}};
+            step.inputs.push_back(std::move(input));
+            return step;
+        }
+        }
+        return PlanStep{&node, Access::Scan, rowCount, {}, {}, {}};
+    }
+
+    std::vector<uint32_t> Run(const PlanStep& step) {
+        std::vector<uint32_t> rows;
+        switch (step.access) {
+        case Access::NameWords:
+        case Access::FuzzyNames:
+        case Access::PhonePrefixes:
+        case Access::EmailDomains:
+            rows = Lookup(*step.node);
+            if (NeedsCheck(*step.node)) {
+                Keep(rows, {step.node});
+            }
+            return rows;
+        case Access::Scan:
+            for (uint32_t position = 0; position < rowCount; ++position) {
+                if (Matches(*step.node, position)) {
+                    rows.push_back(position);
+                }
+            }
+            return rows;
+        case Access::AllRows:
+            rows.resize(rowCount);
+            for (uint32_t position = 0; position < rowCount; ++position) {
+                rows[position] = position;
+            }
+            break;
+        case Access::Filter:
+        case Access::Intersect:
+        case Access::Difference:
+            rows = Run(step.inputs.front());
+            for (size_t i = 1; i < step.inputs.size() && !rows.empty(); ++i) {
+                std::vector<uint32_t> other = Run(step.inputs[i]);
+                std::vector<uint32_t> both;
+                std::set_intersection(rows.begin(), rows.end(), other.begin(), other.end(), std::back_inserter(both));
+                rows.swap(both);
+            }
+            break;
+        case Access::Union:
+            for (const PlanStep& input : step.inputs) {
+                std::vector<uint32_t> other = Run(input);
+                std::vector<uint32_t> either;
+                std::set_union(rows.begin(), rows.end(), other.begin(), other.end(), std::back_inserter(either));
+                rows.swap(either);
+            }
+            return rows;
+        case Access::Complement: {
+            std::vector<uint32_t> excluded = Run(step.inputs.front());
+            size_t next = 0;
+            for (uint32_t position = 0; position < rowCount; ++position) {
+                if (next < excluded.size() && excluded[next] == position) {
+                    ++next;
+                } else {
+                    rows.push_back(position);
+                }
+            }
+            return rows;
+        }
+        }
+        for (size_t i = 0; i < step.excluded.size() && !rows.empty(); ++i) {
+            std::vector<uint32_t> other = Run(step.excluded[i]);
+            std::vector<uint32_t> remaining;
+            std::set_difference(rows.begin(), rows.end(), other.begin(), other.end(), std::back_inserter(remaining));
+            rows.swap(remaining);
+        }
+        Keep(rows, step.checks);
+        return rows;
+    }
+
+    void Describe(const PlanStep& step, int depth, std::string& out) const {
+        std::string indent(static_cast<size_t>(depth) * 2, ' ');
+        std::string line = indent;
+        switch (step.access) {
+        case Access::NameWords: {
+            bool prefix = false;
+            std::string word = NameKey(*step.node, prefix);
+            line += "INDEX name_words " + std::string(prefix ? "prefix" : "word") + " \"" + word + "\"";
+            break;
+        }
+        case Access::FuzzyNames:
+            line += "INDEX fuzzy_names \"" + step.node->value + "\" within " + std::to_string(step.node->distance);
+            break;
+        case Access::PhonePrefixes:
+            line += "INDEX phone_prefix \"" + LiteralPrefix(step.node->key) + "\"";
+            break;
+        case Access::EmailDomains:
+            line += "INDEX email_domain \"" + step.node->value.substr(step.node->value.rfind('@') + 1) + "\"";
+            break;
+        case Access::Scan:
+            line += "SCAN contacts";
+            break;
+        case Access::AllRows:
+            line += "ALL contacts";
+            break;
+        case Access::Filter:
+            line += "FILTER";
+            break;
+        case Access::Intersect:
+            line += "INTERSECT";
+            break;
+        case Access::Difference:
+            line += "DIFFERENCE";
+            break;
+        case Access::Union:
+            line += "UNION";
+            break;
+        case Access::Complement:
+            line += "COMPLEMENT";
+            break;
+        }
+        bool leaf = step.access == Access::Scan || step.inputs.empty();
+        if (leaf && step.access != Access::AllRows) {
+            line += std::string(NeedsCheck(*step.node) && step.access != Access::Scan ? " + check" : "") + " for " +
+                    Render(*step.node);
+        }
+        out += line + "  (~" + std::to_string(step.estimate) + " rows)\n";
+        for (const PlanStep& input : step.inputs) {
+            Describe(input, depth + 1, out);
+        }
+        for (const PlanStep& input : step.excluded) {
+            std::string excluded;
+            Describe(input, depth + 1, excluded);
+            out += indent + "  MINUS " + excluded.substr(indent.size() + 2);
+        }
+        for (const Node* check : step.checks) {
+            out += indent + "  CHECK " + Render(*check) + "\n";
+        }
+    }
+
+private:
+    PlanStep PlanAnd(const Node& node) {
+        std::vector<PlanStep> positives;
+        std::vector<const Node*> negatives;
+        for (const auto& child : node.children) {
+            if (child->kind == Node::Kind::Not) {
+                negatives.push_back(child.get());
+            } else {
+                positives.push_back(Plan(*child));
+            }
+        }
+        std::stable_sort(positives.begin(), positives.end(), [](const PlanStep& a, const PlanStep& b) {
+            return (a.access != Access::Scan && b.access == Access::Scan) ||
+                   ((a.access == Access::Scan) == (b.access == Access::Scan) && a.estimate < b.estimate);
+        });
+        if (!positives.empty() && positives.front().access == Access::Scan) {
+            // Nothing indexed to start from: check the whole AND in one pass
+            return PlanStep{&node, Access::Scan, rowCount, {}, {}, {}};
+        }
+
+        PlanStep step{&node, Access::AllRows, rowCount, {}, {}, {}};
+        for (PlanStep& positive : positives) {
+            if (step.inputs.empty()) {
+                step.estimate = positive.estimate;
+                step.inputs.push_back(std::move(positive));
+            } else if (positive.access != Access::Scan && positive.estimate <= kIntersectFactor * step.estimate) {
+                step.inputs.push_back(std::move(positive));
+            } else {
+                step.checks.push_back(positive.node);
+            }
+        }
+        // A negated clause with a small index result is subtracted; otherwise its
+        // negation is checked on every candidate.
+        for (const Node* negative : negatives) {
+            PlanStep excluded = Plan(*negative->children.front());
+            if (excluded.access != Access::Scan && excluded.estimate <= kIntersectFactor * step.estimate) {
+                step.excluded.push_back(std::move(excluded));
+            } else {
+                step.checks.push_back(negative);
+            }
+        }
+        if (step.inputs.size() == 1 && step.excluded.empty() && step.checks.empty()) {
+            return std::move(step.inputs.front());
+        }
+        if (step.inputs.size() > 1) {
+            step.access = Access::Intersect;
+        } else if (step.inputs.size() == 1) {
+            step.access = step.excluded.empty() ? Access::Filter : Access::Difference;
+        }
+        return step;
+    }
+
+    size_t Estimate(const Node& node) {
+        switch (TermAccess(node)) {
+        case Access::NameWords: {
+            bool prefix = false;
+            std::string word = NameKey(node, prefix);
+            return std::min(rowCount, indexes.nameWords->Count(word, prefix));
+        }
+        case Access::PhonePrefixes:
+            return indexes.phonePrefixes->Count(LiteralPrefix(node.key));
+        default:
+            return Lookup(node).size();
+        }
+    }
+
+    // Index rows for a term, sorted. Fuzzy and e-mail domain results are kept because
+    // planning already produced them.
+    const std::vector<uint32_t>& Lookup(const Node& node) {
+        auto cached = lookups.find(&node);
+        if (cached != lookups.end()) {
+            return cached->second;
+        }
+        std::vector<uint32_t> rows;
+        switch (TermAccess(node)) {
+        case Access::NameWords: {
+            bool prefix = false;
+            std::string word = NameKey(node, prefix);
+            rows = indexes.nameWords->Find(word, prefix);
+            break;
+        }
+        case Access::FuzzyNames:
+            for (const FuzzyMatch& match : indexes.fuzzyNames->Search(node.value, node.distance, SIZE_MAX)) {
+                rows.push_back(static_cast<uint32_t>(match.index));
+            }
+            break;
+        case Access::PhonePrefixes:
+            for (size_t position : indexes.phonePrefixes->Find(LiteralPrefix(node.key))) {
+                rows.push_back(static_cast<uint32_t>(position));
+            }
+            break;
+        case Access::EmailDomains: {
+            // The domain index follows the writer rather than the snapshot, so an entry
+            // only counts if the snapshot has the same phone with the same e-mail.
+            std::string domain = node.value.substr(node.value.rfind('@') + 1);
+            for (const EmailDomainIndex::Entry& entry :
+                 indexes.emailDomains->Find(domain, node.match == TermMatch::Domain)) {
+                if (node.match == TermMatch::Address && FoldCase(entry.email) != node.value) {
+                    continue;
+                }
+                for (size_t position : indexes.phonePrefixes->Find(entry.phone)) {
+                    const Contact& contact = (*indexes.contacts)[position];
+                    if (contact.GetPhone() == entry.phone && contact.GetEmail() == entry.email) {
+                        rows.push_back(static_cast<uint32_t>(position));
+                    }
+                }
+            }
+            break;
+        }
+        default:
+            break;
+        }
+        std::sort(rows.begin(), rows.end());
+        rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+        return lookups.emplace(&node, std::move(rows)).first->second;
+    }
+
+    void Keep(std::vector<uint32_t>& rows, const std::vector<const Node*>& checks) {
+        if (checks.empty()) {
+            return;
+        }
+        rows.erase(std::remove_if(rows.begin(), rows.end(),
+                                  [&](uint32_t position) {
+                                      return !std::all_of(checks.begin(), checks.end(), [&](const Node* check) {
+                                          return Matches(*check, position);
+                                      });
+                                  }),
+                   rows.end());
+    }
+
+    bool Matches(const Node& node, uint32_t position) {
+        switch (node.kind) {
+        case Node::Kind::And:
+            return std::all_of(node.children.begin(), node.children.end(),
+                               [&](const std::unique_ptr<Node>& child) { return Matches(*child, position); });
+        case Node::Kind::Or:
+            return std::any_of(node.children.begin(), node.children.end(),
+                               [&](const std::unique_ptr<Node>& child) { return Matches(*child, position); });
+        case Node::Kind::Not:
+            return !Matches(*node.children.front(), position);
+        case Node::Kind::Term:
+            break;
+        }
+
+        const Contact& contact = (*indexes.contacts)[position];
+        switch (node.field) {
+        case QueryField::Name: {
+            if (node.match == TermMatch::Fuzzy) {
+                const std::vector<uint32_t>& rows = Lookup(node);
+                return std::binary_search(rows.begin(), rows.end(), position);
+            }
+            std::vector<std::string> words = SplitWords(FoldCase(contact.GetName()));
+            if (node.match == TermMatch::Phrase) {
+                return std::search(words.begin(), words.end(), node.words.begin(), node.words.end()) != words.end();
+            }
+            return std::any_of(words.begin(), words.end(), [&](const std::string& word) {
+                switch (node.match) {
+                case TermMatch::Exact:
+                    return word == node.value;
+                case TermMatch::Prefix:
+                    return word.compare(0, node.value.size(), node.value) == 0;
+                default:
+                    return GlobMatch(word, node.value);
+                }
+            });
+        }
+        case QueryField::Phone: {
+            std::string phone = NormalizePhone(contact.GetPhone());
+            switch (node.match) {
+            case TermMatch::Exact:
+                return phone == node.key;
+            case TermMatch::Prefix:
+                return phone.compare(0, node.key.size(), node.key) == 0;
+            default:
+                return GlobMatch(phone, node.key);
+            }
+        }
+        case QueryField::Email: {
+            std::string email = FoldCase(contact.GetEmail());
+            switch (node.match) {
+            case TermMatch::Domain: {
+                std::string domain = ReversedEmailDomain(email);
+                return domain == node.key || domain.compare(0, node.key.size() + 1, node.key + ".") == 0;
+            }
+            case TermMatch::Address:
+                return email == node.value;
+            case TermMatch::Glob:
+                return GlobMatch(email, node.value);
+            default:
+                return email.find(node.value) != std::string::npos;
+            }
+        }
+        case QueryField::Any: {
+            std::string fields[] = {FoldCase(contact.GetName()), contact.GetPhone(), FoldCase(contact.GetEmail())};
+            if (node.match == TermMatch::Contains) {
+                return std::any_of(std::begin(fields), std::end(fields), [&](const std::string& field) {
+                    return field.find(node.value) != std::string::npos;
+                });
+            }
+            for (const std::string& word : SplitWords(fields[0])) {
+                if (GlobMatch(word, node.value)) {
+                    return true;
+                }
+            }
+            return std::any_of(std::begin(fields), std::end(fields),
+                               [&](const std::string& field) { return GlobMatch(field, node.value); });
+        }
+        }
+        return false;
+    }
+
+    const QueryIndexes& indexes;
+    size_t rowCount;
+    std::unordered_map<const Node*, std::vector<uint32_t>> lookups;
+};
+
+} // namespace
+
+StructuredQuery::StructuredQuery() = default;
+StructuredQuery::~StructuredQuery() = default;
+StructuredQuery::StructuredQuery(StructuredQuery&&) noexcept = default;
+StructuredQuery& StructuredQuery::operator=(StructuredQuery&&) noexcept = default;
+
+bool StructuredQuery::Parse(const std::string& text, std::string& error) {
+    root.reset();
+    std::vector<Token> tokens;
+    if (!Tokenize(text, tokens, error)) {
+        return false;
+    }
+    root = Parser(tokens, error).ParseQuery();
+    return root != nullptr;
+}
+
+unsigned StructuredQuery::RequiredIndexes() const {
+    return root ? CollectIndexes(*root) : 0u;
+}
+
+std::vector<uint32_t> StructuredQuery::Execute(const QueryIndexes& indexes) const {
+    if (!root) {
+        return {};
+    }
+    Executor executor(indexes);
+    return executor.Run(executor.Plan(*root));
+}
+
+std::string StructuredQuery::Explain(const QueryIndexes& indexes) const {
+    if (!root) {
+        return "";
+    }
+    Executor executor(indexes);
+    std::string plan;
+    executor.Describe(executor.Plan(*root), 0, plan);
+    return plan;
+}
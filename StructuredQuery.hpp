@@ -0,0 +1,75 @@
+#ifndef STRUCTUREDQUERY_HPP
+#define STRUCTUREDQUERY_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Contact.hpp"
+
+class EmailDomainIndex;
+class FuzzyNameIndex;
+class NameWordIndex;
+class PhonePrefixIndex;
+
+// What a query runs against. The snapshot indexes must all be built from 'contacts';
+// only the ones reported by StructuredQuery::RequiredIndexes() have to be set.
+struct QueryIndexes {
+    const std::vector<Contact>* contacts = nullptr;
+    const NameWordIndex* nameWords = nullptr;
+    const FuzzyNameIndex* fuzzyNames = nullptr;
+    const PhonePrefixIndex* phonePrefixes = nullptr;
+    const EmailDomainIndex* emailDomains = nullptr;
+};
+
+// Bits returned by StructuredQuery::RequiredIndexes().
+enum QueryIndexFlags : unsigned {
+    kQueryNeedsNameWords = 1u << 0,
+    kQueryNeedsFuzzyNames = 1u << 1,
+    kQueryNeedsPhonePrefixes = 1u << 2,
+    kQueryNeedsEmailDomains = 1u << 3
+};
+
+// Small search language over the contact list:
+//
+//   name:ali*  name:smith  name:"john smith"  name:jon~  name:jon~1
+//   phone:0049301*  phone:+49301234567  phone:*123
+//   email:@corp.com  email:ali@corp.com  email:*.org  email:ali
+//   ali  "ali smith"  ali*               (any field)
+//   a b = a AND b,  a OR b,  NOT a,  -a,  ( ... )
+//
+// Names and phones are matched per word / per normalized number, e-mails without a
+// wildcard or '@' by substring, and bare terms by substring in any field (like
+// SearchContacts). Upper-case AND, OR and NOT are operators; anything else is a term.
+//
+// Execution plans each clause separately: exact words and word prefixes use the name
+// word index, "~" the fuzzy index, phone prefixes the phone prefix index and e-mail
+// domains the domain index. Clauses no index can answer are checked row by row. In an
+// AND the cheapest clause produces the candidates; other clauses are intersected
+// when their index result is smaller, and otherwise checked on the candidates only.
+class StructuredQuery {
+public:
+    StructuredQuery();
+    ~StructuredQuery();
+    StructuredQuery(StructuredQuery&&) noexcept;
+    StructuredQuery& operator=(StructuredQuery&&) noexcept;
+
+    // Parses 'text'. Returns false and describes the problem in 'error' on a syntax error.
+    bool Parse(const std::string& text, std::string& error);
+
+    // Combination of QueryIndexFlags for the indexes the plan uses.
+    unsigned RequiredIndexes() const;
+
+    // Positions in *indexes.contacts of the matching contacts, ascending.
+    std::vector<uint32_t> Execute(const QueryIndexes& indexes) const;
+
+    // The chosen plan, one line per step with its access path and estimated rows.
+    std::string Explain(const QueryIndexes& indexes) const;
+
+    struct Node;
+
+private:
+    std::unique_ptr<Node> root;
+};
+
+#endif // STRUCTUREDQUERY_HPP
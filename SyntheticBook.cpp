@@ -0,0 +1,173 @@
+#include "SyntheticBook.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+
+namespace {
+
+// Name pools, roughly ordered by popularity so that the Zipf skew makes the
+// first entries the most common ones.
+const char* const kFirstNames[] = {
+    "Ali", "Maria", "John", "Sara", "Michael", "Anna", "David", "Laura", "Thomas", "Julia",
+    "Reza", "Emma", "Daniel", "Sophie", "Peter", "Lena", "Hassan", "Nina", "Robert", "Eva",
+    "James", "Leila", "Markus", "Hannah", "Omar", "Clara", "Stefan", "Mina", "Paul", "Zahra",
+    "Jonas", "Olivia", "Felix", "Fatemeh", "Lukas", "Mia", "Amir", "Lea", "Martin", "Nora",
+    "Andreas", "Elena", "Kevin", "Maryam", "Tobias", "Isabel", "Farid", "Katharina", "Simon", "Yasmin"
+};
+
+const char* const kLastNames[] = {
+    "Smith", "Mueller", "Ahmadi", "Schmidt", "Johnson", "Schneider", "Hosseini", "Fischer", "Brown", "Weber",
+    "Rezaei", "Meyer", "Jones", "Wagner", "Mohammadi", "Becker", "Miller", "Schulz", "Karimi", "Hoffmann",
+    "Davis", "Koch", "Moradi", "Richter", "Wilson", "Klein", "Jafari", "Wolf", "Taylor", "Neumann",
+    "Abbasi", "Schwarz", "Clark", "Zimmermann", "Rahimi", "Braun", "Lewis", "Krueger", "Ghorbani", "Hofmann",
+    "Walker", "Hartmann", "Sadeghi", "Lange", "Young", "Werner", "Nazari", "Krause", "King", "Lehmann"
+};
+
+// Non-ASCII names (UTF-8). A contact takes both parts from the same pool, so
+// German and Persian names are never mixed within one name.
+const size_t kUnicodePoolSize = 8;
+
+const char* const kGermanFirstNames[kUnicodePoolSize] = {
+    "J\u00fcrgen", "Bj\u00f6rn", "J\u00f6rg", "R\u00fcdiger", "G\u00fcnter", "S\u00f6ren", "Zo\u00eb", "M\u00e4rta"
+};
+
+const char* const kGermanLastNames[kUnicodePoolSize] = {
+    "M\u00fcller", "Wei\u00df", "Sch\u00e4fer", "B\u00f6hm", "Kr\u00e4mer", "G\u00f6tz", "Fu\u00df", "L\u00f6ffler"
+};
+
+const char* const kPersianFirstNames[kUnicodePoolSize] = {
+    "\u0639\u0644\u06cc",                     // Ali
+    "\u0645\u0631\u06cc\u0645",               // Maryam
+    "\u0631\u0636\u0627",                     // Reza
+    "\u0632\u0647\u0631\u0627",               // Zahra
+    "\u067e\u0631\u06cc\u0633\u0627",         // Parisa
+    "\u06a9\u0627\u0648\u0647",               // Kaveh
+    "\u0698\u06cc\u0644\u0627",               // Zhila
+    "\u0686\u0646\u06af\u06cc\u0632"          // Changiz
+};
+
+const char* const kPersianLastNames[kUnicodePoolSize] = {
+    "\u0627\u062d\u0645\u062f\u06cc",         // Ahmadi
+    "\u062d\u0633\u06cc\u0646\u06cc",         // Hosseini
+    "\u06a9\u0631\u06cc\u0645\u06cc",         // Karimi
+    "\u0631\u0636\u0627\u06cc\u06cc",         // Rezaei
+    "\u0686\u0645\u0646\u06cc",               // Chamani
+    "\u06af\u0644\u0633\u062a\u0627\u0646\u06cc", // Golestani
+    "\u067e\u0627\u06a9\u0632\u0627\u062f", // Pakzad
+    "\u0645\u0648\u0633\u0648\u06cc"          // Mousavi
+};
+
+const size_t kFirstNameCount = sizeof(kFirstNames) / sizeof(kFirstNames[0]);
+const size_t kLastNameCount = sizeof(kLastNames) / sizeof(kLastNames[0]);
+
+// SplitMix64: tiny, fast and fully specified, so results are identical everywhere.
+uint64_t SplitMix64(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Uniform double in [0, 1) from the top 53 bits.
+double NextUnit(uint64_t& state) {
+    return static_cast<double>(SplitMix64(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+std::string ToLowerAscii(const std::string& text) {
+    std::string lower = text;
+    for (char& c : lower) {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    return lower;
+}
+
+} // namespace
+
+SyntheticBook::SyntheticBook(SyntheticBookConfig config)
+    : config(std::move(config)),
+      firstNameTable(BuildZipf(kFirstNameCount, this->config.nameSkew)),
+      lastNameTable(BuildZipf(kLastNameCount, this->config.nameSkew)),
+      unicodeNameTable(BuildZipf(kUnicodePoolSize, this->config.nameSkew)),
+      domainTable(BuildZipf(std::max<size_t>(this->config.emailDomains.size(), 1), this->config.nameSkew)) {}
+
+SyntheticBook::ZipfTable SyntheticBook::BuildZipf(size_t size, double skew) {
+    ZipfTable table;
+    table.cumulative.reserve(size);
+    double total = 0.0;
+    for (size_t rank = 1; rank <= size; ++rank) {
+        total += 1.0 / std::pow(static_cast<double>(rank), skew);
+        table.cumulative.push_back(total);
+    }
+    for (double& value : table.cumulative) {
+        value /= total;
+    }
+    return table;
+}
+
+size_t SyntheticBook::ZipfTable::Sample(double u) const {
+    auto it = std::upper_bound(cumulative.begin(), cumulative.end(), u);
+    if (it == cumulative.end()) {
+        return cumulative.size() - 1;
+    }
+    return static_cast<size_t>(it - cumulative.begin());
+}
+
+std::string SyntheticBook::GenerateName(uint64_t index, bool& ascii) const {
+    uint64_t state = config.seed ^ (index * 0xD1B54A32D192ED03ULL);
+    SplitMix64(state); // Decorrelate neighbouring indices
+
+    if (NextUnit(state) < config.unicodeFraction) {
+        ascii = false;
+        bool persian = NextUnit(state) < 0.5;
+        const char* const* firstNames = persian ? kPersianFirstNames : kGermanFirstNames;
+        const char* const* lastNames = persian ? kPersianLastNames : kGermanLastNames;
+        return std::string(firstNames[unicodeNameTable.Sample(NextUnit(state))]) + " " +
+               lastNames[unicodeNameTable.Sample(NextUnit(state))];
+    }
+    ascii = true;
+    return std::string(kFirstNames[firstNameTable.Sample(NextUnit(state))]) + " " +
+           kLastNames[lastNameTable.Sample(NextUnit(state))];
+}
+
+SyntheticContact SyntheticBook::Generate(uint64_t index) const {
+    // A separate stream from GenerateName(), so a cluster leader's name does not
+    // depend on whether it is looked up as a leader or generated directly.
+    uint64_t state = (config.seed + 0x632BE59BD9B4E019ULL) ^ (index * 0x9E3779B97F4A7C15ULL);
+    SplitMix64(state);
+
+    SyntheticContact contact;
+    bool ascii = true;
+    uint64_t clusterSize = std::max<uint64_t>(config.duplicateClusterSize, 1);
+    if (NextUnit(state) < config.duplicateFraction) {
+        contact.name = GenerateName(index - index % clusterSize, ascii);
+    } else {
+        contact.name = GenerateName(index, ascii);
+    }
+
+    // 10^10 numbers after the "49" country code; multiplying by a constant coprime to
+    // 10 is a bijection modulo 10^10, so distinct indices give distinct phones.
+    const uint64_t kSpace = 10000000000ULL;
+    uint64_t offset = (config.seed % kSpace) * 104729ULL % kSpace;
+    uint64_t subscriber = ((index % kSpace) * 7919ULL % kSpace + offset) % kSpace;
+    std::string digits = std::to_string(subscriber);
+    contact.phone = "49" + std::string(10 - digits.size(), '0') + digits;
+
+    if (!config.emailDomains.empty() && NextUnit(state) < config.emailFraction) {
+        const std::string& domain = config.emailDomains[domainTable.Sample(NextUnit(state))];
+        // Email local parts stay ASCII; non-ASCII names fall back to a numbered mailbox.
+        std::string local = "user";
+        if (ascii) {
+            size_t space = contact.name.find(' ');
+            local = ToLowerAscii(contact.name.substr(0, space)) + "." + ToLowerAscii(contact.name.substr(space + 1));
+        }
+        contact.email = local + std::to_string(index) + "@" + domain;
+    }
+    return contact;
+}
+
+void SyntheticBook::GenerateRange(uint64_t begin, uint64_t end, std::vector<SyntheticContact>& out) const {
+    out.reserve(out.size() + static_cast<size_t>(end > begin ? end - begin : 0));
+    for (uint64_t index = begin; index < end; ++index) {
+        out.push_back(Generate(index));
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef SYNTHETICBOOK_HPP
+#define SYNTHETICBOOK_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Settings for the synthetic contact generator.
+struct SyntheticBookConfig {
+    uint64_t seed = 42;                 // Same seed + same index = same contact, on every machine
+    uint64_t count = 10000;             // Number of contacts the caller intends to generate
+    double nameSkew = 1.0;              // Zipf exponent for first/last name popularity (0 = uniform)
+    double emailFraction = 0.9;         // Share of contacts that get an email address
+    double unicodeFraction = 0.0;       // Share of names drawn from the German/Persian pools
+    double duplicateFraction = 0.0;     // Share of contacts that reuse their cluster's name
+    uint64_t duplicateClusterSize = 16; // Contacts [k*size, (k+1)*size) form one cluster
+    std::vector<std::string> emailDomains = {
+        "example.com", "mail.example.org", "corp.example.net", "telekom.example.de", "post.example.ir"
+    };
+};
+
+// One generated contact, stored as UTF-8.
+struct SyntheticContact {
+    std::string name;
+    std::string phone;
+    std::string email;
+};
+
+// Deterministic generator of realistic-looking contacts for benchmarks and test books.
+// Names follow a Zipf distribution, optionally mixed with non-ASCII (German and
+// Persian) names and with clusters of contacts sharing exactly the same name.
+// Every contact is a pure function of (seed, index), so any range of indices can be
+// generated independently (e.g. on several threads) and still produce the same book.
+// It uses its own PRNG and sampling code rather than <random> distributions, whose
+// output differs between standard library implementations.
+class SyntheticBook {
+public:
+    explicit SyntheticBook(SyntheticBookConfig config = SyntheticBookConfig());
+
+    // Generates the contact with the given index. Phones are unique per index
+    // (12 digits, never more than 10^10 distinct values) and pass Contact::IsValidPhone.
+    SyntheticContact Generate(uint64_t index) const;
+
+    // Appends contacts [begin, end) to 'out'.
+    void GenerateRange(uint64_t begin, uint64_t end, std::vector<SyntheticContact>& out) const;
+
+    const SyntheticBookConfig& GetConfig() const { return config; }
+
+private:
+    // Cumulative Zipf weights for a list of names, sampled by binary search.
+    struct ZipfTable {
+        std::vector<double> cumulative;
+        size_t Sample(double u) const;
+    };
+
+    static ZipfTable BuildZipf(size_t size, double skew);
+
+    // Picks the name for 'index'; 'ascii' is cleared when the name is not pure ASCII.
+    std::string GenerateName(uint64_t index, bool& ascii) const;
+
+    SyntheticBookConfig config;
+    ZipfTable firstNameTable;
+    ZipfTable lastNameTable;
+    ZipfTable unicodeNameTable; // Shared by the German and Persian pools (same size)
+    ZipfTable domainTable;
+};
+
+#endif // SYNTHETICBOOK_HPP
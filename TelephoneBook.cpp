@@ -1,5 +1,7 @@
 #include "TelephoneBook.hpp"
 #include "TelephoneBookLogic.hpp"
+#include "Trace.hpp"
+#include "WxAdapter.hpp"
 
 #include <wx/msgdlg.h> // For wxMessageBox
 #include <wx/log.h>    // For wxLogMessage and wxLogError
@@ -94,16 +96,18 @@ TelephoneBook::~TelephoneBook() {
 
 // Method to refresh the wxListCtrl with contacts from the coreLogic
 void TelephoneBook::RefreshList() {
+    TRACE_SCOPE("TelephoneBook::RefreshList");
     contactList->DeleteAllItems(); // Clear current items in the list
 
-    // Get contacts from the core logic
-    const std::vector<Contact>& currentContacts = coreLogic->GetContacts();
+    // Hold the snapshot: a change watch may publish a newer one while the list fills
+    TelephoneBookLogic::ContactSnapshot snapshot = coreLogic->GetSnapshot();
+    const std::vector<Contact>& currentContacts = *snapshot;
 
     // Populate the list with contacts from the provided vector
     for (size_t i = 0; i < currentContacts.size(); ++i) {
-        contactList->InsertItem(i, currentContacts[i].GetName());
-        contactList->SetItem(i, 1, currentContacts[i].GetPhone());
-        contactList->SetItem(i, 2, currentContacts[i].GetEmail());
+        contactList->InsertItem(i, ToWx(currentContacts[i].GetName()));
+        contactList->SetItem(i, 1, ToWx(currentContacts[i].GetPhone()));
+        contactList->SetItem(i, 2, ToWx(currentContacts[i].GetEmail()));
     }
 }
 
@@ -111,6 +115,7 @@ void TelephoneBook::RefreshList() {
 
 // Handler for the "Add Contact" button
 void TelephoneBook::OnAddContact(wxCommandEvent& event) {
+    TRACE_SCOPE("TelephoneBook::OnAddContact");
     wxString name = nameInput->GetValue();
     wxString phone = phoneInput->GetValue();
     wxString email = emailInput->GetValue();
@@ -135,7 +140,7 @@ void TelephoneBook::OnAddContact(wxCommandEvent& event) {
     }
 }
 
-    Contact newContact(name, phone, email);
+    Contact newContact = ContactFromWx(name, phone, email);
 
     // Delegate the adding of the contact to the core logic
     if (coreLogic->AddContact(newContact)) {
@@ -154,10 +159,11 @@ void TelephoneBook::OnAddContact(wxCommandEvent& event) {
 
 // Handler for the "Search Contact" button
 void TelephoneBook::OnSearchContact(wxCommandEvent& event) {
+    TRACE_SCOPE("TelephoneBook::OnSearchContact");
     wxString search = searchInput->GetValue();
 
     // Delegate the search operation to the core logic
-    std::vector<Contact> searchResults = coreLogic->SearchContacts(search);
+    std::vector<Contact> searchResults = coreLogic->SearchContacts(ToUtf8(search));
 
     contactList->DeleteAllItems(); // Clear the list before displaying results
 
@@ -165,10 +171,13 @@ void TelephoneBook::OnSearchContact(wxCommandEvent& event) {
         wxMessageBox("No contacts found matching your search.", "Search Results", wxOK | wxICON_INFORMATION);
     }
     // Populate the list with search results
-    for (size_t i = 0; i < searchResults.size(); ++i) {
-        contactList->InsertItem(i, searchResults[i].GetName());
-        contactList->SetItem(i, 1, searchResults[i].GetPhone());
-        contactList->SetItem(i, 2, searchResults[i].GetEmail());
+    {
+        TRACE_SCOPE("TelephoneBook::OnSearchContact.populate");
+        for (size_t i = 0; i < searchResults.size(); ++i) {
+            contactList->InsertItem(i, ToWx(searchResults[i].GetName()));
+            contactList->SetItem(i, 1, ToWx(searchResults[i].GetPhone()));
+            contactList->SetItem(i, 2, ToWx(searchResults[i].GetEmail()));
+        }
     }
 
     // If search field was empty, refresh to show all contacts
@@ -180,6 +189,7 @@ void TelephoneBook::OnSearchContact(wxCommandEvent& event) {
 
 // Handler for the "Sort Contacts" button
 void TelephoneBook::OnSortContact(wxCommandEvent& event) {
+    TRACE_SCOPE("TelephoneBook::OnSortContact");
     // Delegate the sort operation to the core logic
     coreLogic->SortContactsByName();
     // Refresh the list to show the sorted order
@@ -194,6 +204,7 @@ void TelephoneBook::OnQuit(wxCommandEvent& event) {
 
 // Handler for when an item in the wxListCtrl is selected
 void TelephoneBook::OnContactSelected(wxListEvent& event) {
+    TRACE_SCOPE("TelephoneBook::OnContactSelected");
     long itemIndex = event.GetIndex(); // Get the index of the selected item
 
     if (itemIndex == wxNOT_FOUND) {
@@ -213,6 +224,7 @@ void TelephoneBook::OnContactSelected(wxListEvent& event) {
 
 // Handler for the "Delete" button
 void TelephoneBook::OnDeleteContact(wxCommandEvent& event) {
+    TRACE_SCOPE("TelephoneBook::OnDeleteContact");
     long selected = contactList->GetNextItem(-1, wxLIST_NEXT_ALL, wxLIST_STATE_SELECTED);
     if (selected == -1) {
         wxMessageBox("Please select a contact to delete.", "Deletion Error", wxOK | wxICON_ERROR);
@@ -230,7 +242,7 @@ void TelephoneBook::OnDeleteContact(wxCommandEvent& event) {
     }
 
     // Delegate the deletion to the core logic
-    if (coreLogic->DeleteContact(nameToDelete, phoneToDelete)) {
+    if (coreLogic->DeleteContact(ToUtf8(nameToDelete), ToUtf8(phoneToDelete))) {
         wxMessageBox("Contact deleted successfully.", "Success", wxOK | wxICON_INFORMATION);
         // Clear input fields and refresh list after successful deletion
         nameInput->Clear();
@@ -245,6 +257,7 @@ void TelephoneBook::OnDeleteContact(wxCommandEvent& event) {
 
 // Handler for the "Edit" button
 void TelephoneBook::OnEditContact(wxCommandEvent& event) {
+    TRACE_SCOPE("TelephoneBook::OnEditContact");
     long selected = contactList->GetNextItem(-1, wxLIST_NEXT_ALL, wxLIST_STATE_SELECTED);
     if (selected == -1) {
         wxMessageBox("Please select a contact to edit.", "Edit Error", wxOK | wxICON_ERROR);
@@ -285,10 +298,10 @@ void TelephoneBook::OnEditContact(wxCommandEvent& event) {
     }
 
     // Create a new Contact object with the updated details
-    Contact updatedContact(newName, newPhone, newEmail);
+    Contact updatedContact = ContactFromWx(newName, newPhone, newEmail);
 
     // Delegate the update operation to the core logic
-    if (coreLogic->EditContact(oldName, oldPhone, updatedContact)) {
+    if (coreLogic->EditContact(ToUtf8(oldName), ToUtf8(oldPhone), updatedContact)) {
         wxMessageBox("Contact updated successfully.", "Success", wxOK | wxICON_INFORMATION);
         // Refresh the list to show the updated contact
         RefreshList();
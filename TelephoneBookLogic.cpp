@@ -1,54 +1,292 @@
 #include "TelephoneBookLogic.hpp" // Make sure this is included
-#include <wx/log.h> // Needed for wxLogMessage
+#include "Collation.hpp"
+#include "Phonetic.hpp"
+#include "Trace.hpp"
+#include "CoreLog.hpp"
+#include <algorithm> // For std::sort
+#include <thread>    // For hardware_concurrency
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+// Schema versions, stored in PRAGMA user_version:
+//   0 - name, phone, email
+//   1 - phonetic key column (see Phonetic.hpp) with index idx_contacts_phonetic
+//   2 - index idx_contacts_phone for the duplicate check on every add and import
+//   3 - change log table contact_changes, filled by triggers (see ChangesSince)
+const int kSchemaVersion = 3;
+
+// The change log. Triggers write it in the same transaction as the change itself, so
+// it is complete even for writes made by other processes or the sqlite3 shell.
+// AUTOINCREMENT never reuses a sequence number, and a rolled-back write takes its
+// numbers back with it, so the retained sequence numbers have no gaps. Updates that
+// only touch the phonetic column (the backfill) are not changes of the contact.
+const char* kChangeLogSchema =
+    "CREATE TABLE IF NOT EXISTS contact_changes ("
+    "  seq INTEGER PRIMARY KEY AUTOINCREMENT,"
+    "  op TEXT NOT NULL,"                           // 'add', 'edit' or 'delete'
+    "  name TEXT, phone TEXT, email TEXT,"          // After the change (NULL for delete)
+    "  old_name TEXT, old_phone TEXT, old_email TEXT);" // Before it (NULL for add)
+    "CREATE TRIGGER IF NOT EXISTS contacts_log_add AFTER INSERT ON contacts BEGIN"
+    "  INSERT INTO contact_changes (op, name, phone, email) VALUES ('add', NEW.name, NEW.phone, NEW.email);"
+    " END;"
+    "CREATE TRIGGER IF NOT EXISTS contacts_log_edit AFTER UPDATE OF name, phone, email ON contacts"
+    " WHEN OLD.name IS NOT NEW.name OR OLD.phone IS NOT NEW.phone OR OLD.email IS NOT NEW.email BEGIN"
+    "  INSERT INTO contact_changes (op, name, phone, email, old_name, old_phone, old_email)"
+    "  VALUES ('edit', NEW.name, NEW.phone, NEW.email, OLD.name, OLD.phone, OLD.email);"
+    " END;"
+    "CREATE TRIGGER IF NOT EXISTS contacts_log_delete AFTER DELETE ON contacts BEGIN"
+    "  INSERT INTO contact_changes (op, old_name, old_phone, old_email) VALUES ('delete', OLD.name, OLD.phone, OLD.email);"
+    " END;";
+
+// Latest sequence number ever handed out (0 = none), also after pruning.
+const char* kLatestChangeSql = "SELECT seq FROM sqlite_sequence WHERE name = 'contact_changes';";
+
+// Rows per page while streaming the change log.
+const int kChangePageSize = 1000;
+
+// Rows updated per transaction while backfilling, so a large book never holds the
+// write lock for long.
+const int kBackfillBatchSize = 1000;
+
+// SQLite keeps TEXT as UTF-8, the same encoding Contact uses, so this is a plain copy.
+std::string ColumnString(sqlite3_stmt* stmt, int column) {
+    const char* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, column));
+    if (!text) {
+        return std::string();
+    }
+    return std::string(text, static_cast<size_t>(sqlite3_column_bytes(stmt, column)));
+}
+
+// One row of "SELECT seq, op, name, phone, email, old_name, old_phone, old_email".
+ContactChange ReadChangeRow(sqlite3_stmt* stmt) {
+    ContactChange change;
+    change.sequence = static_cast<uint64_t>(sqlite3_column_int64(stmt, 0));
+    std::string op = ColumnString(stmt, 1);
+    change.type = op == "add" ? ContactChangeType::Add : op == "edit" ? ContactChangeType::Edit : ContactChangeType::Delete;
+    if (change.type != ContactChangeType::Delete) {
+        change.after = Contact(ColumnString(stmt, 2), ColumnString(stmt, 3), ColumnString(stmt, 4));
+    }
+    if (change.type != ContactChangeType::Add) {
+        change.before = Contact(ColumnString(stmt, 5), ColumnString(stmt, 6), ColumnString(stmt, 7));
+    }
+    return change;
+}
+
+} // namespace
 
 // New constructor implementation
-TelephoneBookLogic::TelephoneBookLogic(const wxString& dbPath) : db(nullptr), databasePath(dbPath) {
-    wxLogMessage("TelephoneBookLogic constructor started for DB: %s", databasePath);
+TelephoneBookLogic::TelephoneBookLogic(const std::string& dbPath, ConcurrencyMode mode, size_t readPoolSize)
+    : db(nullptr), databasePath(dbPath), concurrencyMode(mode),
+      profiler(std::make_unique<QueryProfiler>(dbPath)),
+      snapshot([] {
+          auto empty = std::make_shared<PublishedSnapshot>();
+          empty->contacts = std::make_shared<const std::vector<Contact>>();
+          BuildIndexes(*empty, kQueryNeedsPhonePrefixes);
+          return empty;
+      }()) {
+    LogMessage("TelephoneBookLogic constructor started for DB: %s", databasePath.c_str());
+    // The EXPLAIN connection must know fold() and COLLATE PHONEBOOK to plan our queries
+    profiler->SetConnectionInitializer([](sqlite3* connection) { RegisterCollation(connection); });
     OpenDatabase(); // Call OpenDatabase after setting databasePath
+    if (db && concurrencyMode == ConcurrencyMode::MultiReader) {
+        if (readPoolSize == 0) {
+            readPoolSize = std::max(1u, std::thread::hardware_concurrency());
+        }
+        readPool = std::make_unique<ConnectionPool>(databasePath, readPoolSize);
+        readPool->SetConnectionInitializer([](sqlite3* connection) { RegisterCollation(connection); });
+        // Installs or removes the profiler's hook as configured (see ConfigureQueryProfiler)
+        readPool->SetConnectionConfigurator([this](sqlite3* connection) { profiler->Attach(connection); });
+    }
+    std::lock_guard<std::mutex> lock(writeMutex);
     LoadContactsFromDatabase();
-    wxLogMessage("TelephoneBookLogic initialized for DB: %s", databasePath);
+    // From here on the domain index is kept up to date by the write operations.
+    for (const Contact& contact : *GetSnapshot()) {
+        emailDomainIndex.Add(contact.GetName(), contact.GetPhone(), contact.GetEmail());
+    }
+    dataVersion = ReadDataVersion();
+    LogMessage("TelephoneBookLogic initialized for DB: %s", databasePath.c_str());
 }
 
 // Ensure destructor cleans up
 TelephoneBookLogic::~TelephoneBookLogic() {
+    changeWatcher.reset(); // Its callback uses everything below
+    metricsDumper.reset(); // Final metrics dump while everything is still alive
+    readPool.reset(); // Close reader connections before the writer connection
     CloseDatabase();
-    wxLogMessage("TelephoneBookLogic destructor called.");
+    LogMessage("TelephoneBookLogic destructor called.");
 }
 
 void TelephoneBookLogic::OpenDatabase() {
-    wxLogMessage("Opening database at: %s", databasePath); // Use the member variable
-    int rc = sqlite3_open(databasePath.ToStdString().c_str(), &db);
+    LogMessage("Opening database at: %s", databasePath.c_str()); // Use the member variable
+    int rc = sqlite3_open(databasePath.c_str(), &db);
     if (rc != SQLITE_OK) {
-        wxLogError("Cannot open database: %s", sqlite3_errmsg(db));
+        LogError("Cannot open database: %s", sqlite3_errmsg(db));
         sqlite3_close(db);
         db = nullptr; // Important to set to nullptr if opening failed
         return;
     }
+    if (!RegisterCollation(db)) {
+        LogError("Failed to register collation: %s", sqlite3_errmsg(db));
+    }
+    // Other processes may hold the file locked for a moment (see RefreshFromDatabase)
+    sqlite3_busy_timeout(db, 5000);
     // Create contacts table if it doesn't exist
     const char* sql = "CREATE TABLE IF NOT EXISTS contacts (name TEXT, phone TEXT, email TEXT);";
     char* errMsg = nullptr;
     rc = sqlite3_exec(db, sql, 0, 0, &errMsg);
     if (rc != SQLITE_OK) {
-        wxLogError("SQL error creating table: %s", errMsg);
+        LogError("SQL error creating table: %s", errMsg);
         sqlite3_free(errMsg);
     }
+    MigrateSchema();
+
+    if (concurrencyMode == ConcurrencyMode::MultiReader) {
+        // WAL lets readers on other connections keep going while the writer commits.
+        rc = sqlite3_exec(db, "PRAGMA journal_mode=WAL;", 0, 0, &errMsg);
+        if (rc != SQLITE_OK) {
+            LogError("Failed to enable WAL mode: %s", errMsg);
+            sqlite3_free(errMsg);
+        }
+    }
 }
+
+void TelephoneBookLogic::MigrateSchema() {
+    int version = 0;
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, "PRAGMA user_version;", -1, &stmt, 0) == SQLITE_OK && sqlite3_step(stmt) == SQLITE_ROW) {
+        version = sqlite3_column_int(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    if (version >= kSchemaVersion) {
+        return;
+    }
+
+    if (version < 1) {
+        LogMessage("Migrating database schema from version %d to 1 (phonetic keys).", version);
+        // The column may already exist if an earlier migration was interrupted.
+        bool hasColumn = sqlite3_prepare_v2(db, "SELECT phonetic FROM contacts LIMIT 0;", -1, &stmt, 0) == SQLITE_OK;
+        sqlite3_finalize(stmt);
+        char* errMsg = nullptr;
+        if ((!hasColumn && sqlite3_exec(db, "ALTER TABLE contacts ADD COLUMN phonetic TEXT;", 0, 0, &errMsg) != SQLITE_OK) ||
+            sqlite3_exec(db, "CREATE INDEX IF NOT EXISTS idx_contacts_phonetic ON contacts(phonetic);", 0, 0, &errMsg) != SQLITE_OK) {
+            LogError("Failed to add phonetic column: %s", errMsg);
+            sqlite3_free(errMsg);
+            return;
+        }
+        if (!BackfillPhoneticKeys()) {
+            return; // user_version stays at 0, the backfill resumes on the next start
+        }
+    }
+
+    if (version < 2) {
+        LogMessage("Migrating database schema from version %d to 2 (phone index).", version);
+        char* errMsg = nullptr;
+        if (sqlite3_exec(db, "CREATE INDEX IF NOT EXISTS idx_contacts_phone ON contacts(phone);", 0, 0, &errMsg) != SQLITE_OK) {
+            LogError("Failed to create phone index: %s", errMsg);
+            sqlite3_free(errMsg);
+            return;
+        }
+    }
+
+    if (version < 3) {
+        // Changes made before this point are not in the log: consumers start from a
+        // snapshot and its sequence number (GetSnapshotWithSequence)
+        LogMessage("Migrating database schema from version %d to 3 (change log).", version);
+        char* errMsg = nullptr;
+        if (sqlite3_exec(db, kChangeLogSchema, 0, 0, &errMsg) != SQLITE_OK) {
+            LogError("Failed to create change log: %s", errMsg);
+            sqlite3_free(errMsg);
+            return;
+        }
+    }
+
+    std::string setVersion = "PRAGMA user_version = " + std::to_string(kSchemaVersion) + ";";
+    if (sqlite3_exec(db, setVersion.c_str(), 0, 0, 0) != SQLITE_OK) {
+        LogError("Failed to update schema version: %s", sqlite3_errmsg(db));
+    }
+}
+
+bool TelephoneBookLogic::BackfillPhoneticKeys() {
+    TRACE_SCOPE("TelephoneBookLogic::BackfillPhoneticKeys");
+    sqlite3_stmt* selectStmt = nullptr;
+    sqlite3_stmt* updateStmt = nullptr;
+    if (sqlite3_prepare_v2(db, "SELECT rowid, name FROM contacts WHERE phonetic IS NULL LIMIT ?;", -1, &selectStmt, 0) != SQLITE_OK ||
+        sqlite3_prepare_v2(db, "UPDATE contacts SET phonetic = ? WHERE rowid = ?;", -1, &updateStmt, 0) != SQLITE_OK) {
+        LogError("Failed to prepare phonetic backfill: %s", sqlite3_errmsg(db));
+        sqlite3_finalize(selectStmt);
+        sqlite3_finalize(updateStmt);
+        return false;
+    }
+
+    bool ok = true;
+    size_t total = 0;
+    while (ok) {
+        // Every selected row gets a non-NULL key (possibly ''), so each batch makes progress.
+        std::vector<std::pair<sqlite3_int64, std::string>> batch;
+        sqlite3_reset(selectStmt);
+        sqlite3_bind_int(selectStmt, 1, kBackfillBatchSize);
+        while (sqlite3_step(selectStmt) == SQLITE_ROW) {
+            const unsigned char* name = sqlite3_column_text(selectStmt, 1);
+            batch.emplace_back(sqlite3_column_int64(selectStmt, 0), name ? reinterpret_cast<const char*>(name) : "");
+        }
+        sqlite3_reset(selectStmt);
+        if (batch.empty()) {
+            break;
+        }
+
+        sqlite3_exec(db, "BEGIN;", 0, 0, 0);
+        for (const auto& row : batch) {
+            std::string key = PhoneticKey(row.second);
+            sqlite3_reset(updateStmt);
+            sqlite3_bind_text(updateStmt, 1, key.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_int64(updateStmt, 2, row.first);
+            if (sqlite3_step(updateStmt) != SQLITE_DONE) {
+                ok = false;
+                break;
+            }
+        }
+        if (!ok || sqlite3_exec(db, "COMMIT;", 0, 0, 0) != SQLITE_OK) {
+            LogError("Failed to backfill phonetic keys: %s", sqlite3_errmsg(db));
+            sqlite3_exec(db, "ROLLBACK;", 0, 0, 0);
+            ok = false;
+        } else {
+            total += batch.size();
+        }
+    }
+    metrics.RecordStatement(selectStmt);
+    sqlite3_finalize(selectStmt);
+    metrics.RecordStatement(updateStmt);
+    sqlite3_finalize(updateStmt);
+    LogMessage("Backfilled phonetic keys for %zu contacts.", total);
+    return ok;
+}
+
 void TelephoneBookLogic::CloseDatabase() {
     if (db) {
         int rc = sqlite3_close(db);
         if (rc != SQLITE_OK) {
             // Handle error closing the database (e.g., log it)
-            wxLogError("Failed to close database: %s", sqlite3_errmsg(db));
+            LogError("Failed to close database: %s", sqlite3_errmsg(db));
         } else {
-            wxLogMessage("Database closed successfully.");
+            LogMessage("Database closed successfully.");
         }
         db = nullptr; // Set to nullptr after closing
     }
 }
 
 bool TelephoneBookLogic::AddContact(const Contact& contact) {
+    TRACE_SCOPE("TelephoneBookLogic::AddContact");
+    ScopedLatency timer(metrics.Latency(MetricOp::Add));
+    std::lock_guard<std::mutex> lock(writeMutex);
     if (!db) {
-        wxLogError("Database not open, cannot add contact.");
+        LogError("Database not open, cannot add contact.");
+        return false;
+    }
+    uint32_t errors = contact.Validate();
+    if (errors != kContactFieldsValid) {
+        LogError("Invalid contact '%s': %s", contact.GetName().c_str(), DescribeContactErrors(errors).c_str());
         return false;
     }
 
@@ -57,89 +295,288 @@ bool TelephoneBookLogic::AddContact(const Contact& contact) {
     sqlite3_stmt* checkStmt;
     int rc = sqlite3_prepare_v2(db, checkSql, -1, &checkStmt, 0);
     if (rc != SQLITE_OK) {
-        wxLogError("Failed to prepare duplicate check statement: %s", sqlite3_errmsg(db));
+        LogError("Failed to prepare duplicate check statement: %s", sqlite3_errmsg(db));
         return false;
     }
-    sqlite3_bind_text(checkStmt, 1, contact.GetPhone().ToStdString().c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(checkStmt, 1, contact.GetPhone().c_str(), -1, SQLITE_STATIC);
     sqlite3_step(checkStmt);
     int count = sqlite3_column_int(checkStmt, 0);
+    metrics.RecordStatement(checkStmt);
     sqlite3_finalize(checkStmt);
 
     if (count > 0) {
-        wxLogError("Contact with phone number '%s' already exists.", contact.GetPhone());
+        LogError("Contact with phone number '%s' already exists.", contact.GetPhone().c_str());
         return false; // Prevent adding duplicate phone numbers
     }
 
-    const char* sql = "INSERT INTO contacts (name, phone, email) VALUES (?, ?, ?);";
+    const char* sql = "INSERT INTO contacts (name, phone, email, phonetic) VALUES (?, ?, ?, ?);";
     sqlite3_stmt* stmt;
     rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
 
     if (rc != SQLITE_OK) {
-        wxLogError("Failed to prepare statement for adding contact: %s", sqlite3_errmsg(db));
+        LogError("Failed to prepare statement for adding contact: %s", sqlite3_errmsg(db));
         return false;
     }
 
-    sqlite3_bind_text(stmt, 1, contact.GetName().ToStdString().c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 2, contact.GetPhone().ToStdString().c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 3, contact.GetEmail().ToStdString().c_str(), -1, SQLITE_TRANSIENT);
+    // The contact outlives the statement, so SQLite can use its bytes without copying
+    std::string phonetic = PhoneticKey(contact.GetName());
+    sqlite3_bind_text(stmt, 1, contact.GetName().c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, contact.GetPhone().c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 3, contact.GetEmail().c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 4, phonetic.c_str(), -1, SQLITE_STATIC);
 
     rc = sqlite3_step(stmt);
+    metrics.RecordStatement(stmt);
     sqlite3_finalize(stmt);
 
     if (rc != SQLITE_DONE) {
-        wxLogError("Failed to insert contact: %s", sqlite3_errmsg(db));
+        LogError("Failed to insert contact: %s", sqlite3_errmsg(db));
         return false;
     }
-    LoadContactsFromDatabase(); // Reload contacts after modification to update in-memory list
+    RefreshSnapshot(); // Applies the logged insert (and anything other processes committed)
     return true;
 }
 
-std::vector<Contact> TelephoneBookLogic::SearchContacts(const wxString& query) {
-    std::vector<Contact> results;
+size_t TelephoneBookLogic::ImportContacts(const std::vector<Contact>& newContacts,
+                                          std::vector<ImportIssue>* rejected) {
+    TRACE_SCOPE("TelephoneBookLogic::ImportContacts");
+    ScopedLatency timer(metrics.Latency(MetricOp::Import));
+    std::lock_guard<std::mutex> lock(writeMutex);
     if (!db) {
-        wxLogError("Database not open, cannot search contacts.");
+        LogError("Database not open, cannot import contacts.");
+        return 0;
+    }
+
+    // One transaction and two statements for the whole batch instead of one
+    // prepare/commit/reload cycle per contact.
+    sqlite3_stmt* checkStmt = nullptr;
+    sqlite3_stmt* insertStmt = nullptr;
+    if (sqlite3_prepare_v2(db, "SELECT COUNT(*) FROM contacts WHERE phone = ?;", -1, &checkStmt, 0) != SQLITE_OK ||
+        sqlite3_prepare_v2(db, "INSERT INTO contacts (name, phone, email, phonetic) VALUES (?, ?, ?, ?);", -1, &insertStmt, 0) != SQLITE_OK) {
+        LogError("Failed to prepare import statements: %s", sqlite3_errmsg(db));
+        sqlite3_finalize(checkStmt);
+        sqlite3_finalize(insertStmt);
+        return 0;
+    }
+
+    sqlite3_exec(db, "BEGIN;", 0, 0, 0);
+    size_t inserted = 0;
+    size_t invalid = 0;
+    for (size_t i = 0; i < newContacts.size(); ++i) {
+        // Problems are collected instead of logged one by one
+        const Contact& contact = newContacts[i];
+        uint32_t errors = contact.Validate();
+        if (errors != kContactFieldsValid) {
+            ++invalid;
+            if (rejected) {
+                rejected->push_back(ImportIssue{i, errors});
+            }
+            continue;
+        }
+        sqlite3_reset(checkStmt);
+        sqlite3_bind_text(checkStmt, 1, contact.GetPhone().c_str(), -1, SQLITE_STATIC);
+        if (sqlite3_step(checkStmt) == SQLITE_ROW && sqlite3_column_int(checkStmt, 0) > 0) {
+            continue; // Duplicate phone number
+        }
+
+        // The contact outlives the step, so SQLite can use its bytes without copying them
+        std::string phonetic = PhoneticKey(contact.GetName());
+        sqlite3_reset(insertStmt);
+        sqlite3_bind_text(insertStmt, 1, contact.GetName().c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(insertStmt, 2, contact.GetPhone().c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(insertStmt, 3, contact.GetEmail().c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(insertStmt, 4, phonetic.c_str(), -1, SQLITE_STATIC);
+        if (sqlite3_step(insertStmt) != SQLITE_DONE) {
+            LogError("Failed to insert contact during import: %s", sqlite3_errmsg(db));
+            continue;
+        }
+        ++inserted;
+    }
+    sqlite3_clear_bindings(checkStmt);
+    sqlite3_clear_bindings(insertStmt);
+    metrics.RecordStatement(checkStmt);
+    sqlite3_finalize(checkStmt);
+    metrics.RecordStatement(insertStmt);
+    sqlite3_finalize(insertStmt);
+
+    if (sqlite3_exec(db, "COMMIT;", 0, 0, 0) != SQLITE_OK) {
+        LogError("Failed to commit import: %s", sqlite3_errmsg(db));
+        sqlite3_exec(db, "ROLLBACK;", 0, 0, 0);
+        inserted = 0;
+    }
+    RefreshSnapshot();
+    LogMessage("Imported %zu of %zu contacts (%zu invalid).", inserted, newContacts.size(), invalid);
+    return inserted;
+}
+
+std::vector<Contact> TelephoneBookLogic::SearchContacts(const std::string& query) {
+    TRACE_SCOPE("TelephoneBookLogic::SearchContacts");
+    ScopedLatency timer(metrics.Latency(MetricOp::Search));
+    std::vector<Contact> results;
+
+    // The generation is read before querying: if a write commits meanwhile, the
+    // result is stored under the old generation and never served afterwards.
+    std::string cacheKey = FoldCase(query);
+    uint64_t generation = dataGeneration.load(std::memory_order_acquire);
+    if (searchCache.Lookup(cacheKey, generation, results)) {
+        metrics.AddRowsReturned(results.size());
         return results;
     }
 
-    wxString likeQuery = "%" + query.Lower() + "%"; // Case-insensitive search
-    const char* sql = "SELECT name, phone, email FROM contacts WHERE LOWER(name) LIKE ? OR LOWER(phone) LIKE ? OR LOWER(email) LIKE ?;";
-    sqlite3_stmt* stmt;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    // Case-insensitive for every script: both sides are folded the same way (FoldCase)
+    std::string likeBytes = "%" + cacheKey + "%";
+    const char* sql = "SELECT name, phone, email FROM contacts WHERE fold(name) LIKE ? OR fold(phone) LIKE ? OR fold(email) LIKE ?;";
+    sqlite3_stmt* stmt = nullptr;
 
-    if (rc != SQLITE_OK) {
-        wxLogError("Failed to prepare search statement: %s", sqlite3_errmsg(db));
+    // In MultiReader mode a pooled read connection (with its cached statement) is used;
+    // otherwise the shared writer connection, which may only be touched under writeMutex.
+    ConnectionPool::Lease lease;
+    std::unique_lock<std::mutex> lock(writeMutex, std::defer_lock);
+    sqlite3* conn = nullptr;
+    if (readPool) {
+        {
+            TRACE_SCOPE("SearchContacts.checkout");
+            lease = readPool->Checkout();
+        }
+        conn = lease.Get();
+        if (!conn) {
+            LogError("Cannot open reader connection: %s", readPool->GetLastError().c_str());
+            return results;
+        }
+        TRACE_SCOPE("SearchContacts.prepare");
+        stmt = lease.Prepare(sql);
+    } else {
+        TRACE_SCOPE("SearchContacts.prepare");
+        lock.lock();
+        conn = db;
+        if (!conn) {
+            LogError("Database not open, cannot search contacts.");
+            return results;
+        }
+        if (sqlite3_prepare_v2(conn, sql, -1, &stmt, 0) != SQLITE_OK) {
+            stmt = nullptr;
+        }
+    }
+
+    if (!stmt) {
+        LogError("Failed to prepare search statement: %s", sqlite3_errmsg(conn));
         return results;
     }
 
-    sqlite3_bind_text(stmt, 1, likeQuery.ToStdString().c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 2, likeQuery.ToStdString().c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 3, likeQuery.ToStdString().c_str(), -1, SQLITE_TRANSIENT);
+    {
+        TRACE_SCOPE("SearchContacts.bind");
+        sqlite3_bind_text(stmt, 1, likeBytes.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 2, likeBytes.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 3, likeBytes.c_str(), -1, SQLITE_TRANSIENT);
+    }
 
+    // Columns are already UTF-8, so rows become contacts without a conversion pass
+    {
+        TRACE_SCOPE("SearchContacts.step");
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            results.emplace_back(ColumnString(stmt, 0), ColumnString(stmt, 1), ColumnString(stmt, 2));
+        }
+    }
+
+    metrics.RecordStatement(stmt);
+    metrics.AddRowsReturned(results.size());
+    if (!readPool) {
+        sqlite3_finalize(stmt); // Pooled statements stay cached on their connection
+    }
+    searchCache.Store(cacheKey, generation, results);
+    return results;
+}
+
+std::vector<Contact> TelephoneBookLogic::SearchPhonetic(const std::string& query) {
+    TRACE_SCOPE("TelephoneBookLogic::SearchPhonetic");
+    ScopedLatency timer(metrics.Latency(MetricOp::PhoneticSearch));
+    std::string key = PhoneticKey(query);
+    if (key.empty()) {
+        return {}; // Nothing pronounceable in the query (e.g. digits only)
+    }
+    // Codes have a fixed width, so [key, key + 0x7F) holds the key itself and every
+    // longer key that starts with the same words; one index seek plus the matches.
+    const char* sql = "SELECT name, phone, email FROM contacts WHERE phonetic >= ? AND phonetic < ? "
+                      "ORDER BY name COLLATE PHONEBOOK;";
+    return QueryContacts(sql, {key, key + '\x7f'});
+}
+
+std::vector<Contact> TelephoneBookLogic::QueryContacts(const char* sql, const std::vector<std::string>& params) {
+    std::vector<Contact> results;
+    sqlite3_stmt* stmt = nullptr;
+    ConnectionPool::Lease lease;
+    std::unique_lock<std::mutex> lock(writeMutex, std::defer_lock);
+    sqlite3* conn = nullptr;
+    if (readPool) {
+        lease = readPool->Checkout();
+        conn = lease.Get();
+        if (!conn) {
+            LogError("Cannot open reader connection: %s", readPool->GetLastError().c_str());
+            return results;
+        }
+        stmt = lease.Prepare(sql);
+    } else {
+        lock.lock();
+        conn = db;
+        if (!conn) {
+            LogError("Database not open, cannot query contacts.");
+            return results;
+        }
+        if (sqlite3_prepare_v2(conn, sql, -1, &stmt, 0) != SQLITE_OK) {
+            stmt = nullptr;
+        }
+    }
+    if (!stmt) {
+        LogError("Failed to prepare query: %s", sqlite3_errmsg(conn));
+        return results;
+    }
+
+    for (size_t i = 0; i < params.size(); ++i) {
+        sqlite3_bind_text(stmt, static_cast<int>(i + 1), params[i].c_str(), -1, SQLITE_TRANSIENT);
+    }
     while (sqlite3_step(stmt) == SQLITE_ROW) {
-        wxString name = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
-        wxString phone = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
-        wxString email = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
-        results.emplace_back(name, phone, email);
+        results.emplace_back(ColumnString(stmt, 0), ColumnString(stmt, 1), ColumnString(stmt, 2));
     }
 
-    sqlite3_finalize(stmt);
+    metrics.RecordStatement(stmt);
+    metrics.AddRowsReturned(results.size());
+    if (!readPool) {
+        sqlite3_finalize(stmt); // Pooled statements stay cached on their connection
+    }
     return results;
 }
 
 void TelephoneBookLogic::SortContactsByName() {
-    std::sort(contacts.begin(), contacts.end(),
-              [](const Contact& a, const Contact& b) {
-                  return a.GetName().CmpNoCase(b.GetName()) < 0;
-              });
+    TRACE_SCOPE("TelephoneBookLogic::SortContactsByName");
+    ScopedLatency timer(metrics.Latency(MetricOp::Sort));
+    std::lock_guard<std::mutex> lock(writeMutex);
+    // Published snapshots are immutable, so sort a copy and publish it instead.
+    // Each name's collation key is computed once; the sort itself only compares bytes.
+    ContactSnapshot current = GetSnapshot();
+    std::vector<std::pair<std::string, uint32_t>> keys;
+    keys.reserve(current->size());
+    for (size_t i = 0; i < current->size(); ++i) {
+        keys.emplace_back(CollationKey((*current)[i].GetName()), static_cast<uint32_t>(i));
+    }
+    std::sort(keys.begin(), keys.end());
+    std::vector<Contact> contacts;
+    contacts.reserve(keys.size());
+    for (const auto& key : keys) {
+        contacts.push_back((*current)[key.second]);
+    }
+    PublishSnapshot(std::move(contacts));
     // For sorting, we typically just sort the in-memory 'contacts' vector,
     // as the database itself doesn't need to be reordered for display.
     // If you need persistent sort order, you'd need to modify the DB schema
     // and re-save contacts with an order field.
 }
 
-bool TelephoneBookLogic::DeleteContact(const wxString& name, const wxString& phone) {
+bool TelephoneBookLogic::DeleteContact(const std::string& name, const std::string& phone) {
+    TRACE_SCOPE("TelephoneBookLogic::DeleteContact");
+    ScopedLatency timer(metrics.Latency(MetricOp::Delete));
+    std::lock_guard<std::mutex> lock(writeMutex);
     if (!db) {
-        wxLogError("Database not open, cannot delete contact.");
+        LogError("Database not open, cannot delete contact.");
         return false;
     }
 
@@ -148,106 +585,687 @@ bool TelephoneBookLogic::DeleteContact(const wxString& name, const wxString& pho
     int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
 
     if (rc != SQLITE_OK) {
-        wxLogError("Failed to prepare delete statement: %s", sqlite3_errmsg(db));
+        LogError("Failed to prepare delete statement: %s", sqlite3_errmsg(db));
         return false;
     }
 
-    sqlite3_bind_text(stmt, 1, name.ToStdString().c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 2, phone.ToStdString().c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 1, name.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, phone.c_str(), -1, SQLITE_STATIC);
 
     rc = sqlite3_step(stmt);
+    metrics.RecordStatement(stmt);
     sqlite3_finalize(stmt);
 
     if (rc != SQLITE_DONE) {
-        wxLogError("Failed to delete contact: %s", sqlite3_errmsg(db));
+        LogError("Failed to delete contact: %s", sqlite3_errmsg(db));
         return false;
     }
-    LoadContactsFromDatabase(); // Reload contacts to reflect deletion
+    RefreshSnapshot(); // Applies the logged deletion
     return true;
 }
 
-bool TelephoneBookLogic::EditContact(const wxString& oldName, const wxString& oldPhone, const Contact& updatedContact) {
+bool TelephoneBookLogic::EditContact(const std::string& oldName, const std::string& oldPhone, const Contact& updatedContact) {
+    TRACE_SCOPE("TelephoneBookLogic::EditContact");
+    ScopedLatency timer(metrics.Latency(MetricOp::Edit));
+    std::lock_guard<std::mutex> lock(writeMutex);
     if (!db) {
-        wxLogError("Database not open, cannot edit contact.");
+        LogError("Database not open, cannot edit contact.");
+        return false;
+    }
+    uint32_t errors = updatedContact.Validate();
+    if (errors != kContactFieldsValid) {
+        LogError("Invalid contact '%s': %s", updatedContact.GetName().c_str(), DescribeContactErrors(errors).c_str());
         return false;
     }
 
-    const char* sql = "UPDATE contacts SET name = ?, phone = ?, email = ? WHERE name = ? AND phone = ?;";
+    // Moving onto a number another contact has is refused, as AddContact does
+    if (updatedContact.GetPhone() != oldPhone) {
+        sqlite3_stmt* checkStmt;
+        if (sqlite3_prepare_v2(db, "SELECT COUNT(*) FROM contacts WHERE phone = ?;", -1, &checkStmt, 0) != SQLITE_OK) {
+            LogError("Failed to prepare duplicate check statement: %s", sqlite3_errmsg(db));
+            return false;
+        }
+        sqlite3_bind_text(checkStmt, 1, updatedContact.GetPhone().c_str(), -1, SQLITE_STATIC);
+        sqlite3_step(checkStmt);
+        int count = sqlite3_column_int(checkStmt, 0);
+        metrics.RecordStatement(checkStmt);
+        sqlite3_finalize(checkStmt);
+        if (count > 0) {
+            LogError("Contact with phone number '%s' already exists.", updatedContact.GetPhone().c_str());
+            return false;
+        }
+    }
+
+    const char* sql = "UPDATE contacts SET name = ?, phone = ?, email = ?, phonetic = ? WHERE name = ? AND phone = ?;";
     sqlite3_stmt* stmt;
     int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
 
     if (rc != SQLITE_OK) {
-        wxLogError("Failed to prepare edit statement: %s", sqlite3_errmsg(db));
+        LogError("Failed to prepare edit statement: %s", sqlite3_errmsg(db));
         return false;
     }
 
-    sqlite3_bind_text(stmt, 1, updatedContact.GetName().ToStdString().c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 2, updatedContact.GetPhone().ToStdString().c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 3, updatedContact.GetEmail().ToStdString().c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 4, oldName.ToStdString().c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 5, oldPhone.ToStdString().c_str(), -1, SQLITE_TRANSIENT);
+    std::string phonetic = PhoneticKey(updatedContact.GetName());
+    sqlite3_bind_text(stmt, 1, updatedContact.GetName().c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, updatedContact.GetPhone().c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 3, updatedContact.GetEmail().c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 4, phonetic.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 5, oldName.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 6, oldPhone.c_str(), -1, SQLITE_STATIC);
 
     rc = sqlite3_step(stmt);
+    metrics.RecordStatement(stmt);
     sqlite3_finalize(stmt);
 
     if (rc != SQLITE_DONE) {
-        wxLogError("Failed to update contact: %s", sqlite3_errmsg(db));
+        LogError("Failed to update contact: %s", sqlite3_errmsg(db));
         return false;
     }
-    LoadContactsFromDatabase(); // Reload contacts to reflect update
+    RefreshSnapshot(); // Applies the logged edit
     return true;
 }
 
-void TelephoneBookLogic::LoadContactsFromDatabase() {
-    contacts.clear(); // Clear existing contacts
+bool TelephoneBookLogic::LoadContactsFromDatabase() {
+    TRACE_SCOPE("TelephoneBookLogic::LoadContactsFromDatabase");
+    ScopedLatency timer(metrics.Latency(MetricOp::Load));
+    std::vector<Contact> contacts;
     if (!db) {
-        wxLogError("Database not open, cannot load contacts.");
-        return;
+        PublishSnapshot(std::move(contacts)); // Clear existing contacts
+        LogError("Database not open, cannot load contacts.");
+        return false;
     }
 
-    const char* sql = "SELECT name, phone, email FROM contacts ORDER BY name COLLATE NOCASE;";
+    const char* sql = "SELECT name, phone, email FROM contacts ORDER BY name COLLATE PHONEBOOK;";
     sqlite3_stmt* stmt;
     int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
 
     if (rc != SQLITE_OK) {
-        wxLogError("Failed to prepare statement to load contacts: %s", sqlite3_errmsg(db));
-        return;
+        LogError("Failed to prepare statement to load contacts: %s", sqlite3_errmsg(db));
+        return false;
     }
 
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        wxString name = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
-        wxString phone = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
-        wxString email = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
-        contacts.emplace_back(name, phone, email);
+    // One read transaction, so the change sequence matches the rows exactly even if
+    // another process writes meanwhile
+    sqlite3_exec(db, "BEGIN;", 0, 0, 0);
+    {
+        TRACE_SCOPE("LoadContactsFromDatabase.step+convert");
+        while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+            contacts.emplace_back(ColumnString(stmt, 0), ColumnString(stmt, 1), ColumnString(stmt, 2));
+        }
+    }
+
+    metrics.RecordStatement(stmt);
+
+    sqlite3_finalize(stmt);
+    uint64_t sequence = 0;
+    if (rc == SQLITE_DONE && sqlite3_prepare_v2(db, kLatestChangeSql, -1, &stmt, 0) == SQLITE_OK) {
+        rc = sqlite3_step(stmt);
+        if (rc == SQLITE_ROW) {
+            sequence = static_cast<uint64_t>(sqlite3_column_int64(stmt, 0));
+            rc = SQLITE_DONE;
+        }
+        sqlite3_finalize(stmt);
+    }
+    sqlite3_exec(db, "COMMIT;", 0, 0, 0);
+    if (rc != SQLITE_DONE) {
+        // E.g. busy past the timeout: a partial list must not replace the snapshot
+        LogError("Failed to load contacts: %s", sqlite3_errstr(rc));
+        return false;
+    }
+    snapshotSequence = sequence;
+    LogMessage("Contacts loaded from database. Count: %zu", contacts.size());
+    metrics.AddRowsReturned(contacts.size());
+    PublishSnapshot(std::move(contacts));
+    return true;
+}
+
+bool TelephoneBookLogic::ReadChangesLocked(uint64_t sequence, size_t limit, std::vector<ContactChange>& changes) {
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db,
+                           "SELECT seq, op, name, phone, email, old_name, old_phone, old_email FROM contact_changes "
+                           "WHERE seq > ? ORDER BY seq LIMIT ?;",
+                           -1, &stmt, 0) != SQLITE_OK) {
+        return false; // No change log (migration failed); the caller reloads everything
+    }
+    // The page and the latest sequence must come from the same read transaction
+    sqlite3_exec(db, "BEGIN;", 0, 0, 0);
+    sqlite3_bind_int64(stmt, 1, static_cast<sqlite3_int64>(sequence));
+    sqlite3_bind_int64(stmt, 2, static_cast<sqlite3_int64>(std::min<size_t>(limit, INT64_MAX - 1) + 1));
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        changes.push_back(ReadChangeRow(stmt));
+    }
+    metrics.RecordStatement(stmt);
+    sqlite3_finalize(stmt);
+    uint64_t latest = 0;
+    if (rc == SQLITE_DONE && sqlite3_prepare_v2(db, kLatestChangeSql, -1, &stmt, 0) == SQLITE_OK) {
+        rc = sqlite3_step(stmt);
+        if (rc == SQLITE_ROW) {
+            latest = static_cast<uint64_t>(sqlite3_column_int64(stmt, 0));
+            rc = SQLITE_DONE;
+        }
+        sqlite3_finalize(stmt);
+    }
+    sqlite3_exec(db, "COMMIT;", 0, 0, 0);
+
+    // Complete only if nothing failed, nothing was pruned (sequence numbers have no gaps)
+    // and there were no more than 'limit' changes
+    return rc == SQLITE_DONE && changes.size() <= limit &&
+           (changes.empty() ? latest <= sequence : changes.front().sequence == sequence + 1);
+}
+
+bool TelephoneBookLogic::RefreshSnapshot() {
+    TRACE_SCOPE("TelephoneBookLogic::RefreshSnapshot");
+    ContactSnapshot current = GetSnapshot();
+    std::vector<ContactChange> changes;
+    // Past about half the book, reading it again is cheaper than patching it
+    if (!db || !ReadChangesLocked(snapshotSequence, current->size() / 2 + kChangePageSize, changes)) {
+        if (!LoadContactsFromDatabase()) {
+            return false; // The old snapshot stays; the next write or refresh tries again
+        }
+        dataGeneration.fetch_add(1, std::memory_order_release);
+        emailDomainIndex.Clear();
+        for (const Contact& contact : *GetSnapshot()) {
+            emailDomainIndex.Add(contact.GetName(), contact.GetPhone(), contact.GetEmail());
+        }
+        return true;
+    }
+    if (changes.empty()) {
+        return true;
+    }
+    dataGeneration.fetch_add(1, std::memory_order_release);
+
+    // Net effect per exact (name, phone, email): an edit removes its old values and adds
+    // the new ones, and a contact added and removed again within the batch cancels out
+    auto keyOf = [](const Contact& contact) {
+        return contact.GetName() + '\0' + contact.GetPhone() + '\0' + contact.GetEmail();
+    };
+    std::unordered_map<std::string, std::pair<int, const Contact*>> delta;
+    for (const ContactChange& change : changes) {
+        if (change.type != ContactChangeType::Add) {
+            delta[keyOf(change.before)].first -= 1;
+            emailDomainIndex.Remove(change.before.GetName(), change.before.GetPhone(), change.before.GetEmail());
+        }
+        if (change.type != ContactChangeType::Delete) {
+            auto& entry = delta[keyOf(change.after)];
+            entry.first += 1;
+            entry.second = &change.after;
+            emailDomainIndex.Add(change.after.GetName(), change.after.GetPhone(), change.after.GetEmail());
+        }
+    }
+    std::unordered_map<std::string, int> removals; // Key -> occurrences still to drop
+    std::unordered_set<std::string> removedPhones; // Cheap pre-check before building a key
+    std::vector<Contact> additions;
+    for (const auto& [key, entry] : delta) {
+        if (entry.first < 0) {
+            removals.emplace(key, -entry.first);
+            removedPhones.insert(key.substr(key.find('\0') + 1, key.rfind('\0') - key.find('\0') - 1));
+        }
+        for (int i = 0; i < entry.first; ++i) {
+            additions.push_back(*entry.second);
+        }
+    }
+    std::vector<std::pair<std::string, uint32_t>> additionKeys;
+    for (size_t i = 0; i < additions.size(); ++i) {
+        additionKeys.emplace_back(CollationKey(additions[i].GetName()), static_cast<uint32_t>(i));
+    }
+    std::sort(additionKeys.begin(), additionKeys.end());
+
+    // One pass over the current (name-ordered) snapshot: drop the removed contacts and
+    // slot each addition in behind the names that sort before or equal to it. The pass
+    // also records where every contact went, so the indexes can be patched alike.
+    std::vector<Contact> contacts;
+    contacts.reserve(current->size() + additions.size());
+    SnapshotDelta moves;
+    moves.remap.reserve(current->size());
+    moves.added.reserve(additions.size());
+    size_t next = 0;
+    for (const Contact& contact : *current) {
+        if (!removedPhones.empty() && removedPhones.count(contact.GetPhone()) > 0) {
+            auto removal = removals.find(keyOf(contact));
+            if (removal != removals.end() && removal->second > 0) {
+                --removal->second;
+                moves.remap.push_back(SnapshotDelta::kRemoved);
+                continue;
+            }
+        }
+        while (next < additionKeys.size() &&
+               CollationCompare(additions[additionKeys[next].second].GetName(), contact.GetName()) < 0) {
+            moves.added.push_back(static_cast<uint32_t>(contacts.size()));
+            contacts.push_back(std::move(additions[additionKeys[next++].second]));
+        }
+        moves.remap.push_back(static_cast<uint32_t>(contacts.size()));
+        contacts.push_back(contact);
+    }
+    while (next < additionKeys.size()) {
+        moves.added.push_back(static_cast<uint32_t>(contacts.size()));
+        contacts.push_back(std::move(additions[additionKeys[next++].second]));
+    }
+    snapshotSequence = changes.back().sequence;
+    LogMessage("Applied %zu logged changes. Count: %zu", changes.size(), contacts.size());
+    PublishSnapshot(std::move(contacts), &moves);
+    return true;
+}
+
+void TelephoneBookLogic::PublishSnapshot(std::vector<Contact> contacts, const SnapshotDelta* delta) {
+    TRACE_SCOPE("TelephoneBookLogic::PublishSnapshot");
+    // Readers that still hold the previous snapshot keep it alive until they drop it;
+    // the last shared_ptr owner frees it, so no reader ever sees a half-built list.
+    auto published = std::make_shared<PublishedSnapshot>();
+    published->contacts = std::make_shared<const std::vector<Contact>>(std::move(contacts));
+    const std::vector<Contact>& list = *published->contacts;
+    // The indexes are ready before the snapshot is visible: the writer pays for them
+    // here, in O(N) for a patch, instead of the first reader after every write. Indexes
+    // nobody has used yet are not built.
+    std::shared_ptr<const PublishedSnapshot> previous = snapshot.Load();
+    if (delta) {
+        std::vector<std::string> phones;
+        std::vector<std::string> names;
+        for (uint32_t position : delta->added) {
+            phones.push_back(list[position].GetPhone());
+            names.push_back(FoldCase(list[position].GetName()));
+        }
+        published->phonePrefixes = std::make_shared<const PhonePrefixIndex>(*previous->phonePrefixes, *delta, phones);
+        if (previous->nameWords) {
+            published->nameWords = std::make_shared<const NameWordIndex>(*previous->nameWords, *delta, names);
+        }
+        if (previous->fuzzyNames) {
+            published->fuzzyNames = std::make_shared<const FuzzyNameIndex>(*previous->fuzzyNames, *delta, names);
+        }
+    } else {
+        BuildIndexes(*published, kQueryNeedsPhonePrefixes | (previous->nameWords ? kQueryNeedsNameWords : 0u) |
+                                     (previous->fuzzyNames ? kQueryNeedsFuzzyNames : 0u));
+    }
+    snapshot.Store(published);
+    if (phoneTable && !phoneTable->Publish(list)) {
+        LogError("Failed to publish the shared phone table.");
+    }
+}
+
+std::vector<FuzzyContactMatch> TelephoneBookLogic::FuzzySearchContacts(const std::string& query, unsigned maxDistance,
+                                                                       size_t limit) const {
+    TRACE_SCOPE("TelephoneBookLogic::FuzzySearchContacts");
+    ScopedLatency timer(metrics.Latency(MetricOp::FuzzySearch));
+    std::shared_ptr<const PublishedSnapshot> current = LoadSnapshotWith(kQueryNeedsFuzzyNames);
+
+    std::vector<FuzzyContactMatch> results;
+    for (const FuzzyMatch& match : current->fuzzyNames->Search(FoldCase(query), maxDistance, limit)) {
+        results.push_back({(*current->contacts)[match.index], match.distance});
+    }
+    metrics.AddRowsReturned(results.size());
+    return results;
+}
+
+std::vector<Contact> TelephoneBookLogic::SearchByPhonePrefix(const std::string& prefix, size_t limit) const {
+    TRACE_SCOPE("TelephoneBookLogic::SearchByPhonePrefix");
+    ScopedLatency timer(metrics.Latency(MetricOp::PhonePrefixSearch));
+    std::shared_ptr<const PublishedSnapshot> current = snapshot.Load();
+
+    std::vector<Contact> results;
+    for (size_t position : current->phonePrefixes->Find(prefix, limit)) {
+        results.push_back((*current->contacts)[position]);
+    }
+    metrics.AddRowsReturned(results.size());
+    return results;
+}
+
+size_t TelephoneBookLogic::CountByPhonePrefix(const std::string& prefix) const {
+    return snapshot.Load()->phonePrefixes->Count(prefix);
+}
+
+std::vector<Contact> TelephoneBookLogic::SearchByEmailDomain(const std::string& domain) const {
+    TRACE_SCOPE("TelephoneBookLogic::SearchByEmailDomain");
+    ScopedLatency timer(metrics.Latency(MetricOp::EmailDomainSearch));
+    std::vector<Contact> results;
+    for (const EmailDomainIndex::Entry& entry : emailDomainIndex.Find(domain)) {
+        results.emplace_back(entry.name, entry.phone, entry.email);
+    }
+    metrics.AddRowsReturned(results.size());
+    return results;
+}
+
+std::vector<std::pair<std::string, size_t>> TelephoneBookLogic::DomainHistogram() const {
+    std::vector<std::pair<std::string, size_t>> histogram;
+    for (const auto& bucket : emailDomainIndex.Histogram()) {
+        histogram.emplace_back(bucket.first, bucket.second);
+    }
+    return histogram;
+}
+
+std::vector<Contact> TelephoneBookLogic::SearchStructured(const std::string& query) const {
+    TRACE_SCOPE("TelephoneBookLogic::SearchStructured");
+    ScopedLatency timer(metrics.Latency(MetricOp::StructuredSearch));
+    StructuredQuery parsed;
+    std::string error;
+    if (!parsed.Parse(query, error)) {
+        LogError("Invalid search query '%s': %s", query.c_str(), error.c_str());
+        return {};
+    }
+    StructuredQueryInput input = PrepareStructuredQuery(parsed);
+
+    std::vector<Contact> results;
+    for (uint32_t position : parsed.Execute(input.indexes)) {
+        results.push_back((*input.snapshot->contacts)[position]);
+    }
+    metrics.AddRowsReturned(results.size());
+    return results;
+}
+
+std::string TelephoneBookLogic::ExplainStructured(const std::string& query) const {
+    StructuredQuery parsed;
+    std::string error;
+    if (!parsed.Parse(query, error)) {
+        return error;
+    }
+    StructuredQueryInput input = PrepareStructuredQuery(parsed);
+    return parsed.Explain(input.indexes);
+}
+
+TelephoneBookLogic::StructuredQueryInput TelephoneBookLogic::PrepareStructuredQuery(const StructuredQuery& query) const {
+    unsigned needs = query.RequiredIndexes();
+    StructuredQueryInput input;
+    // Published indexes always match the snapshot they were published with
+    input.snapshot = LoadSnapshotWith(needs);
+    input.indexes.contacts = input.snapshot->contacts.get();
+    input.indexes.nameWords = input.snapshot->nameWords.get();
+    input.indexes.fuzzyNames = input.snapshot->fuzzyNames.get();
+    input.indexes.phonePrefixes = input.snapshot->phonePrefixes.get();
+    input.indexes.emailDomains = &emailDomainIndex;
+    return input;
+}
+
+std::shared_ptr<const TelephoneBookLogic::PublishedSnapshot> TelephoneBookLogic::LoadSnapshotWith(unsigned needs) const {
+    auto missing = [needs](const PublishedSnapshot& published) {
+        return ((needs & kQueryNeedsNameWords) && !published.nameWords) ||
+               ((needs & kQueryNeedsFuzzyNames) && !published.fuzzyNames);
+    };
+    std::shared_ptr<const PublishedSnapshot> current = snapshot.Load();
+    if (!missing(*current)) {
+        return current;
+    }
+    // First use: writers wait for this one build, and every later write patches the
+    // index instead of leaving a rebuild to the next reader
+    std::lock_guard<std::mutex> lock(writeMutex);
+    current = snapshot.Load();
+    if (missing(*current)) {
+        auto extended = std::make_shared<PublishedSnapshot>(*current);
+        BuildIndexes(*extended, needs);
+        snapshot.Store(extended);
+        current = extended;
+    }
+    return current;
+}
+
+void TelephoneBookLogic::BuildIndexes(PublishedSnapshot& published, unsigned needs) {
+    const std::vector<Contact>& contacts = *published.contacts;
+    if ((needs & kQueryNeedsPhonePrefixes) && !published.phonePrefixes) {
+        TRACE_SCOPE("TelephoneBookLogic::BuildIndexes.phonePrefixes");
+        std::vector<std::string> phones;
+        phones.reserve(contacts.size());
+        for (const Contact& contact : contacts) {
+            phones.push_back(contact.GetPhone());
+        }
+        published.phonePrefixes = std::make_shared<const PhonePrefixIndex>(phones);
+    }
+    bool words = (needs & kQueryNeedsNameWords) && !published.nameWords;
+    bool fuzzy = (needs & kQueryNeedsFuzzyNames) && !published.fuzzyNames;
+    std::vector<std::string> names; // Folded once for both name indexes
+    if (words || fuzzy) {
+        names.reserve(contacts.size());
+        for (const Contact& contact : contacts) {
+            names.push_back(FoldCase(contact.GetName()));
+        }
+    }
+    if (words) {
+        TRACE_SCOPE("TelephoneBookLogic::BuildIndexes.nameWords");
+        published.nameWords = std::make_shared<const NameWordIndex>(names);
+    }
+    if (fuzzy) {
+        TRACE_SCOPE("TelephoneBookLogic::BuildIndexes.fuzzyNames");
+        published.fuzzyNames = std::make_shared<const FuzzyNameIndex>(names);
+    }
+}
+
+void TelephoneBookLogic::ConfigureSearchCache(size_t budgetBytes) {
+    searchCache.SetBudget(budgetBytes);
+}
+
+std::optional<Contact> TelephoneBookLogic::FindByPhone(const std::string& phone) const {
+    TRACE_SCOPE("TelephoneBookLogic::FindByPhone");
+    ScopedLatency timer(metrics.Latency(MetricOp::Lookup));
+    std::shared_ptr<const PublishedSnapshot> current = snapshot.Load();
+    // The prefix index matches on normalized digits, so confirm the stored spelling
+    std::vector<size_t> candidates = current->phonePrefixes->FindExact(phone);
+    metrics.AddRowsScanned(candidates.size());
+    for (size_t position : candidates) {
+        const Contact& contact = (*current->contacts)[position];
+        if (contact.GetPhone() == phone) {
+            metrics.AddRowsReturned(1);
+            return contact;
+        }
+    }
+    return std::nullopt;
+}
+
+bool TelephoneBookLogic::ReadRows(const char* sql, const std::function<void(sqlite3_stmt*)>& bind,
+                                  const std::function<void(sqlite3_stmt*)>& row) {
+    sqlite3_stmt* stmt = nullptr;
+    ConnectionPool::Lease lease;
+    std::unique_lock<std::mutex> lock(writeMutex, std::defer_lock);
+    sqlite3* conn = nullptr;
+    if (readPool) {
+        lease = readPool->Checkout();
+        conn = lease.Get();
+        if (!conn) {
+            LogError("Cannot open reader connection: %s", readPool->GetLastError().c_str());
+            return false;
+        }
+        stmt = lease.Prepare(sql);
+    } else {
+        lock.lock();
+        conn = db;
+        if (!conn) {
+            LogError("Database not open, cannot read.");
+            return false;
+        }
+        if (sqlite3_prepare_v2(conn, sql, -1, &stmt, 0) != SQLITE_OK) {
+            stmt = nullptr;
+        }
+    }
+    if (!stmt) {
+        LogError("Failed to prepare query: %s", sqlite3_errmsg(conn));
+        return false;
     }
 
+    bind(stmt);
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        row(stmt);
+    }
+    if (rc != SQLITE_DONE) {
+        LogError("Query failed: %s", sqlite3_errmsg(conn));
+    }
+    metrics.RecordStatement(stmt);
+    if (!readPool) {
+        sqlite3_finalize(stmt); // Pooled statements stay cached on their connection
+    }
+    return rc == SQLITE_DONE;
+}
+
+bool TelephoneBookLogic::ChangesSince(uint64_t sequence, const std::function<bool(const ContactChange&)>& visit,
+                                      size_t limit) {
+    TRACE_SCOPE("TelephoneBookLogic::ChangesSince");
+    const char* pageSql = "SELECT seq, op, name, phone, email, old_name, old_phone, old_email FROM contact_changes "
+                          "WHERE seq > ? ORDER BY seq LIMIT ?;";
+    // The first sequence still in the log (or the next one to be handed out)
+    const char* firstSql = "SELECT COALESCE((SELECT MIN(seq) FROM contact_changes),"
+                           " (SELECT seq FROM sqlite_sequence WHERE name = 'contact_changes') + 1, 1);";
+    while (limit > 0) {
+        // Pages are read without holding the connection (or the writer lock) while the
+        // consumer works on them
+        int pageSize = static_cast<int>(std::min<size_t>(limit, kChangePageSize));
+        std::vector<ContactChange> page;
+        bool ok = ReadRows(
+            pageSql,
+            [&](sqlite3_stmt* stmt) {
+                sqlite3_bind_int64(stmt, 1, static_cast<sqlite3_int64>(sequence));
+                sqlite3_bind_int(stmt, 2, pageSize);
+            },
+            [&](sqlite3_stmt* stmt) { page.push_back(ReadChangeRow(stmt)); });
+        if (!ok) {
+            return false;
+        }
+
+        // Sequence numbers have no gaps, so the next change must be sequence + 1
+        uint64_t next = 0;
+        if (!page.empty()) {
+            next = page.front().sequence;
+        } else if (!ReadRows(firstSql, [](sqlite3_stmt*) {},
+                             [&](sqlite3_stmt* stmt) { next = static_cast<uint64_t>(sqlite3_column_int64(stmt, 0)); })) {
+            return false;
+        }
+        if (next > sequence + 1) {
+            LogError("Changes %llu to %llu have been pruned; start over from a snapshot.",
+                     static_cast<unsigned long long>(sequence + 1), static_cast<unsigned long long>(next - 1));
+            return false;
+        }
+
+        for (const ContactChange& change : page) {
+            if (!visit(change)) {
+                return true;
+            }
+            sequence = change.sequence;
+        }
+        if (page.size() < static_cast<size_t>(pageSize)) {
+            break; // Caught up
+        }
+        limit -= page.size();
+    }
+    return true;
+}
+
+std::pair<TelephoneBookLogic::ContactSnapshot, uint64_t> TelephoneBookLogic::GetSnapshotWithSequence() {
+    std::lock_guard<std::mutex> lock(writeMutex);
+    return {GetSnapshot(), snapshotSequence};
+}
+
+uint64_t TelephoneBookLogic::GetChangeSequence() {
+    uint64_t sequence = 0;
+    ReadRows(kLatestChangeSql, [](sqlite3_stmt*) {},
+             [&](sqlite3_stmt* stmt) { sequence = static_cast<uint64_t>(sqlite3_column_int64(stmt, 0)); });
+    return sequence;
+}
+
+bool TelephoneBookLogic::PruneChanges(uint64_t sequence) {
+    std::lock_guard<std::mutex> lock(writeMutex);
+    if (!db) {
+        LogError("Database not open, cannot prune changes.");
+        return false;
+    }
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, "DELETE FROM contact_changes WHERE seq <= ?;", -1, &stmt, 0) != SQLITE_OK) {
+        LogError("Failed to prepare change log pruning: %s", sqlite3_errmsg(db));
+        return false;
+    }
+    sqlite3_bind_int64(stmt, 1, static_cast<sqlite3_int64>(sequence));
+    int rc = sqlite3_step(stmt);
+    metrics.RecordStatement(stmt);
     sqlite3_finalize(stmt);
-    wxLogMessage("Contacts loaded from database. Count: %zu", contacts.size());
+    if (rc != SQLITE_DONE) {
+        LogError("Failed to prune change log: %s", sqlite3_errmsg(db));
+        return false;
+    }
+    return true;
+}
+
+ConnectionPoolStats TelephoneBookLogic::GetReadPoolStats() const {
+    return readPool ? readPool->GetStats() : ConnectionPoolStats();
+}
+
+MetricsSnapshot TelephoneBookLogic::GetMetrics() const {
+    MetricsSnapshot result = metrics.Snapshot();
+    ConnectionPoolStats pool = GetReadPoolStats();
+    result.statementCacheHits = pool.statementCacheHits;
+    result.statementCacheMisses = pool.statementCacheMisses;
+    SearchCacheStats cache = searchCache.GetStats();
+    result.searchCacheHits = cache.hits;
+    result.searchCacheMisses = cache.misses;
+    return result;
+}
+
+int64_t TelephoneBookLogic::ReadDataVersion() {
+    sqlite3_stmt* stmt = nullptr;
+    int64_t version = -1;
+    if (db && sqlite3_prepare_v2(db, "PRAGMA data_version;", -1, &stmt, 0) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            version = sqlite3_column_int64(stmt, 0);
+        }
+        sqlite3_finalize(stmt);
+    }
+    return version;
+}
+
+bool TelephoneBookLogic::RefreshFromDatabase() {
+    std::lock_guard<std::mutex> lock(writeMutex);
+    // Our own commits on 'db' do not change data_version, and they refresh on their own
+    int64_t version = ReadDataVersion();
+    if (version == dataVersion) {
+        return false;
+    }
+    uint64_t generation = dataGeneration.load(std::memory_order_acquire);
+    if (RefreshSnapshot()) {
+        dataVersion = version; // Otherwise the next call tries again
+    }
+    return dataGeneration.load(std::memory_order_acquire) != generation;
 }
 
-// Private helper to save to database (used internally by AddContact, EditContact, DeleteContact)
-// This is not called directly from the GUI layer, so it can remain private.
-// Note: This function is primarily for internal consistency if you had multiple
-// places directly inserting into the DB. Since AddContact, EditContact, DeleteContact
-// already handle DB operations, this specific 'SaveContactToDatabase' might be redundant
-// unless it's designed for bulk saving. For this context, I'll provide a minimal example.
-bool TelephoneBookLogic::SaveContactToDatabase(const Contact& contact) {
-    // This function is now implicitly handled by AddContact.
-    // If you need a direct "save" independent of "add" for existing contacts,
-    // you'd typically use 'UpdateContactInDatabase' or similar.
-    // For now, if called, it acts like an add.
-    return AddContact(contact); // Reusing AddContact for simplicity here.
+void TelephoneBookLogic::StartChangeWatch(std::chrono::milliseconds interval) {
+    changeWatcher.reset(); // Replaces any previous watcher
+    changeWatcher = std::make_unique<DatabaseWatcher>(databasePath, [this]() { RefreshFromDatabase(); }, interval);
 }
 
+void TelephoneBookLogic::StopChangeWatch() {
+    changeWatcher.reset();
+}
 
-// Private helper to update contact in database
-bool TelephoneBookLogic::UpdateContactInDatabase(const wxString& oldName, const wxString& oldPhone, const Contact& updatedContact) {
-    // This function is the core of what EditContact does
-    return EditContact(oldName, oldPhone, updatedContact);
+void TelephoneBookLogic::StartMetricsDump(const std::string& path, std::chrono::milliseconds interval) {
+    metricsDumper.reset(); // Replaces any previous dumper
+    metricsDumper = std::make_unique<MetricsFileDumper>([this]() { return GetMetrics(); },
+                                                        path, interval);
+    LogMessage("Dumping metrics to %s every %lld ms", path.c_str(), static_cast<long long>(interval.count()));
 }
 
-// Private helper to delete contact from database
-bool TelephoneBookLogic::DeleteContactFromDatabase(const wxString& name, const wxString& phone) {
-    // This function is the core of what DeleteContact does
-    return DeleteContact(name, phone);
+void TelephoneBookLogic::StopMetricsDump() {
+    metricsDumper.reset();
+}
+
+bool TelephoneBookLogic::StartPhoneTablePublishing(const std::string& shmName) {
+    std::lock_guard<std::mutex> lock(writeMutex);
+    auto writer = std::make_unique<SharedPhoneTableWriter>();
+    if (!writer->Open(shmName) || !writer->Publish(*GetSnapshot())) {
+        return false;
+    }
+    phoneTable = std::move(writer);
+    LogMessage("Publishing the phone table to shared memory %s", shmName.c_str());
+    return true;
+}
+
+void TelephoneBookLogic::StopPhoneTablePublishing() {
+    std::lock_guard<std::mutex> lock(writeMutex);
+    phoneTable.reset();
+}
+
+void TelephoneBookLogic::ConfigureQueryProfiler(const QueryProfilerConfig& config) {
+    profiler->Configure(config);
+    {
+        std::lock_guard<std::mutex> lock(writeMutex); // The writer connection's owner
+        profiler->Attach(db);
+    }
+    if (readPool) {
+        readPool->Reconfigure(); // Each pooled connection follows on its next checkout
+    }
+    if (!config.slowLogPath.empty()) {
+        LogMessage("Logging statements slower than %lld us to %s",
+                     static_cast<long long>(config.slowThreshold.count()), config.slowLogPath.c_str());
+    }
 }
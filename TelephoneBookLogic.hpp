@@ -1,44 +1,298 @@
 #ifndef TELEPHONEBOOKLOGIC_HPP
 #define TELEPHONEBOOKLOGIC_HPP
 
-#include <wx/string.h>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
 #include <vector>
 #include <sqlite3.h>
 #include "Contact.hpp"  // Assuming you have a Contact class header
+#include "ConnectionPool.hpp"
+#include "DatabaseWatcher.hpp"
+#include "EmailDomainIndex.hpp"
+#include "FuzzyNameIndex.hpp"
+#include "NameWordIndex.hpp"
+#include "PhonePrefixIndex.hpp"
+#include "Metrics.hpp"
+#include "QueryProfiler.hpp"
+#include "RcuCell.hpp"
+#include "SearchResultCache.hpp"
+#include "SharedPhoneTable.hpp"
+#include "SnapshotIndex.hpp"
+#include "StructuredQuery.hpp"
 
+// How the logic object is going to be used.
+// - SingleThreaded: the original behaviour, every query runs on the one shared connection.
+// - MultiReader: the database is switched to WAL mode and searches check out a read-only
+//   connection from a bounded pool, so they never wait for each other or for the writer.
+enum class ConcurrencyMode {
+    SingleThreaded,
+    MultiReader
+};
+
+// A contact ImportContacts rejected: its position in the input and what is wrong with it.
+struct ImportIssue {
+    size_t index = 0;
+    uint32_t errors = 0; // ContactFieldError bits, see DescribeContactErrors
+};
+
+// A contact returned by FuzzySearchContacts together with its edit distance.
+struct FuzzyContactMatch {
+    Contact contact;
+    unsigned distance = 0;
+};
+
+// Kind of a logged change to the contacts table.
+enum class ContactChangeType {
+    Add,
+    Edit,
+    Delete
+};
+
+// One committed change from the change log (see ChangesSince).
+struct ContactChange {
+    uint64_t sequence = 0;
+    ContactChangeType type = ContactChangeType::Add;
+    Contact before; // Empty for Add
+    Contact after;  // Empty for Delete
+};
+
+// The phone book itself (part of phonebook_core, no wxWidgets dependency). Every
+// string taken or returned is UTF-8; errors are reported through CoreLog.hpp.
 class TelephoneBookLogic {
 public:
+    // Immutable view of the contact list. A snapshot is never modified after it has been
+    // published, so any number of threads can read it without locking, and it stays valid
+    // for as long as the caller holds on to it (even if the writer publishes a newer one).
+    using ContactSnapshot = std::shared_ptr<const std::vector<Contact>>;
+
     // Constructor / Destructor
-    explicit TelephoneBookLogic(const wxString& dbPath = "contacts.db");
+    // readPoolSize limits the read connections used in MultiReader mode (0 = one per core).
+    explicit TelephoneBookLogic(const std::string& dbPath = "contacts.db",
+                                ConcurrencyMode mode = ConcurrencyMode::SingleThreaded,
+                                size_t readPoolSize = 0);
     ~TelephoneBookLogic();
 
-    // Public interface
+    TelephoneBookLogic(const TelephoneBookLogic&) = delete;
+    TelephoneBookLogic& operator=(const TelephoneBookLogic&) = delete;
+
+    // Public interface (writers are serialized internally, readers may run concurrently)
+    // AddContact and EditContact refuse contacts that break the Contact rules
+    // (see ContactValidation.hpp) and log every problem found.
     bool AddContact(const Contact& contact);
-    std::vector<Contact> SearchContacts(const wxString& query);
+    // Adds many contacts in one transaction with a single reload at the end.
+    // Contacts whose phone number already exists are skipped, like in AddContact.
+    // Invalid contacts are skipped too; they are not logged individually but listed in
+    // 'rejected' (if given) with every problem found.
+    // Returns the number of contacts actually inserted.
+    size_t ImportContacts(const std::vector<Contact>& newContacts, std::vector<ImportIssue>* rejected = nullptr);
+    // Substring search over name, phone and e-mail. Results of repeated queries are
+    // served from an LRU cache until the next write (see ConfigureSearchCache).
+    std::vector<Contact> SearchContacts(const std::string& query);
     void SortContactsByName();
-    bool DeleteContact(const wxString& name, const wxString& phone);
-    bool EditContact(const wxString& oldName, const wxString& oldPhone, const Contact& updatedContact);
+    bool DeleteContact(const std::string& name, const std::string& phone);
+    // Like AddContact, refuses to move a contact onto a number that is already taken.
+    bool EditContact(const std::string& oldName, const std::string& oldPhone, const Contact& updatedContact);
+
+    // Typo-tolerant name search: every query word must be within 'maxDistance' edits
+    // (insert, delete, substitute, swap adjacent letters) of a word in the name.
+    // Results are ranked by total distance. Runs against the current snapshot; the
+    // fuzzy index is built by the first search and then kept up to date by every write.
+    std::vector<FuzzyContactMatch> FuzzySearchContacts(const std::string& query, unsigned maxDistance = 2,
+                                                       size_t limit = 20) const;
+
+    // Sounds-like search ("Jon Smyth" finds "John Smith"): the query's Soundex key is
+    // looked up as a range on the indexed phonetic column, so leading name words
+    // ("Jon") match too. Results are sorted by name.
+    std::vector<Contact> SearchPhonetic(const std::string& query);
+
+    // Contacts whose number starts with 'prefix' (e.g. an area or operator code),
+    // compared after NormalizePhone(), so "+4930", "004930" and "4930" are the same
+    // prefix. Sorted by number, at most 'limit' results. Answered from an in-memory
+    // sorted index published with the current snapshot in O(len * log N + results).
+    std::vector<Contact> SearchByPhonePrefix(const std::string& prefix, size_t limit = SIZE_MAX) const;
+    // Number of contacts SearchByPhonePrefix would return (two binary searches, for UI previews).
+    size_t CountByPhonePrefix(const std::string& prefix) const;
+
+    // Contacts whose e-mail is at 'domain' ("example.com" or "@example.com"), including
+    // subdomains such as "mail.example.com". Ordered by domain, then phone number.
+    std::vector<Contact> SearchByEmailDomain(const std::string& domain) const;
+    // Contact count per e-mail domain, largest first (read from the domain index).
+    std::vector<std::pair<std::string, size_t>> DomainHistogram() const;
+
+    // Field-qualified search, e.g. "name:ali* phone:0049* -email:@corp.com" or
+    // "(name:smith OR name:smyth) email:@example.com" (syntax in StructuredQuery.hpp).
+    // Each clause is answered from the cheapest in-memory index of the current
+    // snapshot and the partial results are intersected. Results are in snapshot
+    // (name) order; a syntax error is logged and gives no results. The name word index
+    // is built by the first query that uses it and then kept up to date by every write.
+    std::vector<Contact> SearchStructured(const std::string& query) const;
+    // The plan SearchStructured would run for 'query' (one step per line with its
+    // access path and estimated rows), or the syntax error.
+    std::string ExplainStructured(const std::string& query) const;
+
+    // Memory budget of the SearchContacts result cache (default 16 MiB, 0 disables it).
+    void ConfigureSearchCache(size_t budgetBytes);
+    // Hits, misses, invalidations and evictions of the result cache.
+    SearchCacheStats GetSearchCacheStats() const { return searchCache.GetStats(); }
+
+    // Lock-free exact lookup by phone number against the current snapshot, answered in
+    // O(log N) from the phone prefix index published with it. The writer keeps that
+    // index up to date, so a lookup never waits for a rebuild, not even after a write.
+    std::optional<Contact> FindByPhone(const std::string& phone) const;
+
+    // Returns the currently published snapshot (lock-free, safe from any thread).
+    ContactSnapshot GetSnapshot() const { return snapshot.Load()->contacts; }
 
-    // Getter for the in-memory contacts list
-    const std::vector<Contact>& GetContacts() const { return contacts; }
+    // Change data capture. Every committed add, edit and delete on the contacts table,
+    // including those made by other processes, is appended to a change log with a
+    // gap-free, increasing sequence number in the same transaction as the change.
+    //
+    // A consumer starts from GetSnapshotWithSequence() (the snapshot and the last change
+    // it contains) and then calls ChangesSince() with the last sequence it has applied,
+    // in O(changes) instead of reloading the book. 'visit' is called in sequence order
+    // and may return false to stop early; it runs without any lock held, so it may call
+    // back into this object. Returns false (and logs why) when changes after 'sequence'
+    // have already been pruned, in which case the consumer must start over from a snapshot.
+    bool ChangesSince(uint64_t sequence, const std::function<bool(const ContactChange&)>& visit,
+                      size_t limit = SIZE_MAX);
+    std::pair<ContactSnapshot, uint64_t> GetSnapshotWithSequence();
+    // Sequence number of the newest change in the log (0 = none yet).
+    uint64_t GetChangeSequence();
+    // Drops changes up to and including 'sequence' once every consumer has applied them.
+    bool PruneChanges(uint64_t sequence);
+
+    // Picks up writes made by other processes (another instance, the sqlite3 CLI).
+    // PRAGMA data_version tells cheaply whether anyone else committed since the last
+    // check; if so, only the logged changes are applied to the snapshot (a full reload
+    // only when they were pruned or are more than about half the book). Returns true if
+    // the snapshot changed.
+    bool RefreshFromDatabase();
+    // Calls RefreshFromDatabase() from a background thread whenever the database files
+    // change on disk (inotify), and at least every 'interval' as a fallback.
+    void StartChangeWatch(std::chrono::milliseconds interval = std::chrono::seconds(1));
+    void StopChangeWatch();
+
+    // Copy of the in-memory contacts list. A reference could not outlive the next
+    // snapshot (the next write, or any moment once StartChangeWatch() is running);
+    // GetSnapshot() shares the list without copying it.
+    std::vector<Contact> GetContacts() const { return *GetSnapshot(); }
+
+    ConcurrencyMode GetConcurrencyMode() const { return concurrencyMode; }
+
+    // Read pool metrics (checkouts, wait time, statement cache); all zero in SingleThreaded mode.
+    ConnectionPoolStats GetReadPoolStats() const;
+
+    // Latency histograms per operation, row/step counters and cache hit ratio.
+    MetricsSnapshot GetMetrics() const;
+
+    // Periodically writes GetMetrics() in Prometheus text format to a local file
+    // (e.g. for node_exporter's textfile collector). A final dump is written on stop.
+    void StartMetricsDump(const std::string& path, std::chrono::milliseconds interval = std::chrono::seconds(15));
+    void StopMetricsDump();
+
+    // Mirrors the phone -> name map of every published snapshot into the POSIX
+    // shared-memory segment 'shmName' (e.g. "/phonebook"), where other processes read
+    // it with SharedPhoneTableReader without syscalls. Publishes the current contacts
+    // right away; the segment is left in place when publishing stops.
+    bool StartPhoneTablePublishing(const std::string& shmName);
+    void StopPhoneTablePublishing();
+
+    // SQL statement profiling: wall time and rows per statement, slow-query log and
+    // EXPLAIN QUERY PLAN capture. Off by default; a config with a slow-query log or plan
+    // capture installs the trace hook on every connection this object uses, and one
+    // with neither (e.g. QueryProfilerConfig()) removes it again.
+    void ConfigureQueryProfiler(const QueryProfilerConfig& config);
+    const QueryProfiler& GetQueryProfiler() const { return *profiler; }
 
 private:
     // Database handling
     void OpenDatabase();
     void CloseDatabase();
 
-    // Loads contacts from DB into memory vector
-    void LoadContactsFromDatabase();
+    // Brings an existing database up to the current schema (tracked in PRAGMA user_version)
+    void MigrateSchema();
+    // Fills the phonetic column of rows written before it existed, in small transactions
+    bool BackfillPhoneticKeys();
+
+    // Runs a SELECT of (name, phone, email) with text parameters, on a pooled read
+    // connection in MultiReader mode and on the writer connection otherwise.
+    std::vector<Contact> QueryContacts(const char* sql, const std::vector<std::string>& params);
+
+    // Runs a read-only statement on a pooled read connection (MultiReader) or on the
+    // writer connection under writeMutex; 'row' is called for each result row.
+    bool ReadRows(const char* sql, const std::function<void(sqlite3_stmt*)>& bind,
+                  const std::function<void(sqlite3_stmt*)>& row);
 
-    // Internal helpers for DB operations
-    bool SaveContactToDatabase(const Contact& contact);
-    bool UpdateContactInDatabase(const wxString& oldName, const wxString& oldPhone, const Contact& updatedContact);
-    bool DeleteContactFromDatabase(const wxString& name, const wxString& phone);
+    // Loads contacts from DB into memory vector (caller must hold writeMutex); on a read
+    // error the published snapshot is kept and false is returned
+    bool LoadContactsFromDatabase();
+    // Brings the snapshot and the domain index up to the change log, incrementally where
+    // possible; called after every write (caller must hold writeMutex)
+    bool RefreshSnapshot();
+    // Reads up to 'limit' changes after 'sequence' on the writer connection (caller must
+    // hold writeMutex); false if some are missing, more exist or the read failed
+    bool ReadChangesLocked(uint64_t sequence, size_t limit, std::vector<ContactChange>& changes);
+    // PRAGMA data_version of the writer connection (caller must hold writeMutex)
+    int64_t ReadDataVersion();
+
+    // A published contact list and the indexes the writer keeps in step with it. Readers
+    // take both from one Load(), so index positions always refer to 'contacts'.
+    struct PublishedSnapshot {
+        ContactSnapshot contacts;
+        std::shared_ptr<const PhonePrefixIndex> phonePrefixes; // Always there
+        std::shared_ptr<const NameWordIndex> nameWords;        // From its first use on
+        std::shared_ptr<const FuzzyNameIndex> fuzzyNames;      // From its first use on
+    };
+
+    // Replaces the published snapshot with a new immutable contact list. Its indexes are
+    // patched from the previous ones when 'delta' tells how the list was derived from
+    // the published one, and rebuilt otherwise; either way before readers can see it.
+    void PublishSnapshot(std::vector<Contact> contacts, const SnapshotDelta* delta = nullptr);
+
+    // The published snapshot with every index in 'needs' (kQueryNeeds* flags). An index
+    // not published yet is built here once, under writeMutex, and published with the
+    // snapshot; from then on each write patches it (see PublishSnapshot).
+    std::shared_ptr<const PublishedSnapshot> LoadSnapshotWith(unsigned needs) const;
+    // Builds the indexes in 'needs' that 'published' lacks, from its contacts
+    static void BuildIndexes(PublishedSnapshot& published, unsigned needs);
+
+    // A snapshot with the indexes a structured query needs
+    struct StructuredQueryInput {
+        std::shared_ptr<const PublishedSnapshot> snapshot;
+        QueryIndexes indexes; // Raw pointers to the objects held above
+    };
+    StructuredQueryInput PrepareStructuredQuery(const StructuredQuery& query) const;
 
 private:
-    sqlite3* db = nullptr;                // SQLite database handle
-    wxString databasePath;               // Path to the SQLite database file
-    std::vector<Contact> contacts;       // In-memory cache of contacts
+    sqlite3* db = nullptr;                // SQLite database handle (writer connection)
+    std::string databasePath;            // Path to the SQLite database file
+    ConcurrencyMode concurrencyMode;     // Selected at construction time
+    std::unique_ptr<QueryProfiler> profiler; // Trace hooks, only while configured
+
+    // In-memory cache of contacts (published snapshot); mutable so that a reader can
+    // publish an index on its first use (under writeMutex, like every Store)
+    mutable RcuCell<PublishedSnapshot> snapshot;
+    mutable std::mutex writeMutex;         // Serializes writers and every use of 'db'
+    uint64_t snapshotSequence = 0;         // Last change in the published snapshot, guarded by writeMutex
+    int64_t dataVersion = 0;               // Last PRAGMA data_version seen, guarded by writeMutex
+
+    std::unique_ptr<ConnectionPool> readPool; // Read-only connections, MultiReader only
+
+    EmailDomainIndex emailDomainIndex; // Updated by every successful write
+
+    // Bumped after every committed change; cached results from older generations are stale
+    std::atomic<uint64_t> dataGeneration{0};
+    SearchResultCache searchCache; // SearchContacts results keyed by lower-cased query
+
+    mutable MetricsRegistry metrics;                 // Lock-free counters, updated by readers too
+    std::unique_ptr<MetricsFileDumper> metricsDumper; // Optional periodic Prometheus dump
+    std::unique_ptr<SharedPhoneTableWriter> phoneTable; // Optional, guarded by writeMutex
+    std::unique_ptr<DatabaseWatcher> changeWatcher;     // Optional, see StartChangeWatch
 };
 
 #endif // TELEPHONEBOOKLOGIC_HPP
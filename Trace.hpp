@@ -0,0 +1,87 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Hot-path tracing with Chrome trace-event output.
+//
+// TRACE_SCOPE("name") records a complete ("ph":"X") event covering the rest of the
+// enclosing scope. Events go into a fixed-size, lock-free ring buffer; the oldest
+// events are overwritten when it is full. Tracer::Instance().Flush(path) writes the
+// buffer as trace_event JSON that chrome://tracing and Perfetto can open. If the
+// TELEPHONEBOOK_TRACE_FILE environment variable is set, the buffer is also flushed
+// there when the program exits.
+//
+// Spans are compiled in only when TELEPHONEBOOK_TRACING is defined (CMake option
+// TELEPHONEBOOK_ENABLE_TRACING); otherwise TRACE_SCOPE expands to nothing.
+// 'name' must be a string literal (only the pointer is stored).
+
+class Tracer {
+public:
+    static constexpr size_t kCapacity = size_t(1) << 16; // Events kept in the ring buffer
+
+    static Tracer& Instance();
+
+    void Record(const char* name, uint64_t startNanos, uint64_t durationNanos);
+
+    // Writes all events currently in the buffer to 'path'. Returns false on I/O error.
+    bool Flush(const std::string& path) const;
+
+    // Nanoseconds since the tracer was created (the trace's time origin).
+    uint64_t NowNanos() const;
+
+    // Number of events recorded so far (including overwritten ones).
+    uint64_t RecordedCount() const { return next.load(std::memory_order_relaxed); }
+
+private:
+    Tracer();
+    ~Tracer();
+
+    // Every field is atomic so Flush() can run while other threads are recording.
+    // 'sequence' works like a seqlock: it is odd while the slot is being written.
+    struct Slot {
+        std::atomic<uint64_t> sequence{0};
+        std::atomic<const char*> name{nullptr};
+        std::atomic<uint64_t> start{0};
+        std::atomic<uint64_t> duration{0};
+        std::atomic<uint32_t> thread{0};
+    };
+
+    static uint32_t CurrentThreadId();
+
+    std::chrono::steady_clock::time_point origin;
+    std::atomic<uint64_t> next{0};
+    std::array<Slot, kCapacity>* slots; // Heap allocated: the buffer is a few MB
+};
+
+// RAII span; use through TRACE_SCOPE.
+class TraceSpan {
+public:
+    explicit TraceSpan(const char* name) : name(name), start(Tracer::Instance().NowNanos()) {}
+    ~TraceSpan() {
+        Tracer& tracer = Tracer::Instance();
+        tracer.Record(name, start, tracer.NowNanos() - start);
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    const char* name;
+    uint64_t start;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+#ifdef TELEPHONEBOOK_TRACING
+#define TRACE_SCOPE(name) TraceSpan TRACE_CONCAT(traceSpan_, __LINE__)(name)
+#else
+#define TRACE_SCOPE(name) do { } while (0)
+#endif
+
+#endif // TRACE_HPP
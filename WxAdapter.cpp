@@ -0,0 +1,14 @@
+#include "WxAdapter.hpp"
+#include "CoreLog.hpp"
+#include <wx/log.h>
+
+void InstallWxLogSink() {
+    SetLogSink([](LogLevel level, const std::string& text) {
+        // "%s" keeps '%' in the text from being read as a format
+        if (level == LogLevel::Error) {
+            wxLogError("%s", ToWx(text));
+        } else {
+            wxLogMessage("%s", ToWx(text));
+        }
+    });
+}
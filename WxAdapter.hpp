@@ -0,0 +1,28 @@
+#ifndef WXADAPTER_HPP
+#define WXADAPTER_HPP
+
+#include <wx/string.h>
+#include <string>
+#include "Contact.hpp"
+
+// The GUI's only bridge to phonebook_core: the core works on UTF-8 std::string and
+// logs through CoreLog.hpp, wxWidgets works on wxString and wxLog. Conversions happen
+// here, once per value crossing the boundary, and never inside the core.
+
+inline wxString ToWx(const std::string& utf8) {
+    return wxString::FromUTF8(utf8.data(), utf8.size());
+}
+
+inline std::string ToUtf8(const wxString& text) {
+    return std::string(text.utf8_str());
+}
+
+inline Contact ContactFromWx(const wxString& name, const wxString& phone, const wxString& email) {
+    return Contact(ToUtf8(name), ToUtf8(phone), ToUtf8(email));
+}
+
+// Routes the core's LogError/LogMessage to wxLogError/wxLogMessage, so core messages
+// reach the GUI's log target like its own.
+void InstallWxLogSink();
+
+#endif // WXADAPTER_HPP
@@ -0,0 +1,436 @@
+// bench.cpp
+// Microbenchmarks for every TelephoneBookLogic operation on a synthetic book.
+// Results are written as JSON (latency percentiles per operation), so runs from
+// different releases can be compared.
+//
+// Usage: benchBook [--count N] [--ops K] [--seed S] [--skew Z] [--unicode F]
+//                  [--domains a.com,b.org] [--db path] [--out results.json]
+#include "TelephoneBookLogic.hpp"
+#include "Contact.hpp"
+#include "SyntheticBook.hpp"
+#include "CoreLog.hpp"
+#include "SharedPhoneTable.hpp"
+#include "ShardedBook.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct BenchOptions {
+    SyntheticBookConfig book;
+    size_t ops = 100;                   // Samples per operation
+    std::string dbPath = "bench_phonebook.db";
+    std::string outPath;                // Empty = stdout
+};
+
+struct BenchResult {
+    std::string name;
+    std::vector<double> micros;         // One latency sample per operation
+    size_t itemsPerSample = 1;          // e.g. N for a bulk import run
+};
+
+using Clock = std::chrono::steady_clock;
+
+double ElapsedMicros(Clock::time_point start) {
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+}
+
+// Nearest-rank percentile over sorted samples.
+double Percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    size_t rank = static_cast<size_t>(p / 100.0 * static_cast<double>(sorted.size()) + 0.5);
+    rank = std::clamp<size_t>(rank, 1, sorted.size());
+    return sorted[rank - 1];
+}
+
+Contact ToContact(const SyntheticContact& c) {
+    return Contact(c.name, c.phone, c.email);
+}
+
+void RemoveDatabase(const std::string& path) {
+    for (const char* suffix : {"", "-wal", "-shm", "-journal"}) {
+        std::filesystem::remove(path + suffix);
+    }
+}
+
+bool ParseOptions(int argc, char** argv, BenchOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto next = [&]() -> const char* { return i + 1 < argc ? argv[++i] : nullptr; };
+        const char* value = nullptr;
+        if (arg == "--count" && (value = next())) {
+            options.book.count = std::strtoull(value, nullptr, 10);
+        } else if (arg == "--ops" && (value = next())) {
+            options.ops = std::strtoull(value, nullptr, 10);
+        } else if (arg == "--seed" && (value = next())) {
+            options.book.seed = std::strtoull(value, nullptr, 10);
+        } else if (arg == "--skew" && (value = next())) {
+            options.book.nameSkew = std::strtod(value, nullptr);
+        } else if (arg == "--unicode" && (value = next())) {
+            // Share of German/Persian names, to measure sort and search on non-ASCII data
+            options.book.unicodeFraction = std::clamp(std::strtod(value, nullptr), 0.0, 1.0);
+        } else if (arg == "--domains" && (value = next())) {
+            options.book.emailDomains.clear();
+            std::stringstream list(value);
+            std::string domain;
+            while (std::getline(list, domain, ',')) {
+                if (!domain.empty()) {
+                    options.book.emailDomains.push_back(domain);
+                }
+            }
+        } else if (arg == "--db" && (value = next())) {
+            options.dbPath = value;
+        } else if (arg == "--out" && (value = next())) {
+            options.outPath = value;
+        } else {
+            std::cerr << "Unknown or incomplete option: " << arg << std::endl;
+            return false;
+        }
+    }
+    options.ops = std::max<size_t>(options.ops, 1);
+    return true;
+}
+
+std::string JsonEscape(const std::string& text) {
+    std::string escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+    return escaped;
+}
+
+void WriteJson(std::ostream& out, const BenchOptions& options, std::vector<BenchResult>& results) {
+    out << "{\n  \"benchmark\": \"benchBook\",\n";
+    out << "  \"config\": {\"count\": " << options.book.count << ", \"ops\": " << options.ops
+        << ", \"seed\": " << options.book.seed << ", \"skew\": " << options.book.nameSkew
+        << ", \"unicode\": " << options.book.unicodeFraction << ", \"domains\": [";
+    for (size_t i = 0; i < options.book.emailDomains.size(); ++i) {
+        out << (i ? ", " : "") << "\"" << JsonEscape(options.book.emailDomains[i]) << "\"";
+    }
+    out << "]},\n  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        BenchResult& result = results[i];
+        std::sort(result.micros.begin(), result.micros.end());
+        double total = 0.0;
+        for (double sample : result.micros) {
+            total += sample;
+        }
+        double mean = result.micros.empty() ? 0.0 : total / static_cast<double>(result.micros.size());
+        double itemsPerSec = total > 0.0
+            ? static_cast<double>(result.micros.size() * result.itemsPerSample) * 1e6 / total : 0.0;
+        char line[512];
+        std::snprintf(line, sizeof(line),
+                      "    {\"name\": \"%s\", \"samples\": %zu, \"items_per_sample\": %zu, "
+                      "\"mean_us\": %.2f, \"p50_us\": %.2f, \"p90_us\": %.2f, \"p99_us\": %.2f, "
+                      "\"max_us\": %.2f, \"items_per_sec\": %.1f}%s\n",
+                      result.name.c_str(), result.micros.size(), result.itemsPerSample, mean,
+                      Percentile(result.micros, 50), Percentile(result.micros, 90),
+                      Percentile(result.micros, 99), result.micros.empty() ? 0.0 : result.micros.back(),
+                      itemsPerSec, i + 1 < results.size() ? "," : "");
+        out << line;
+    }
+    out << "  ]\n}\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    SetLogSink([](LogLevel, const std::string&) {}); // Per-operation log lines would dominate the timings
+
+    BenchOptions options;
+    if (!ParseOptions(argc, argv, options)) {
+        return 1;
+    }
+
+    SyntheticBook generator(options.book);
+    std::vector<SyntheticContact> generated;
+    generator.GenerateRange(0, options.book.count, generated);
+    std::vector<Contact> book;
+    book.reserve(generated.size());
+    for (const SyntheticContact& c : generated) {
+        book.push_back(ToContact(c));
+    }
+
+    std::vector<BenchResult> results;
+    const std::string& dbPath = options.dbPath;
+
+    // Bulk import into an empty database (a few full runs).
+    {
+        BenchResult result{"bulk_import", {}, book.size()};
+        for (int run = 0; run < 3; ++run) {
+            RemoveDatabase(options.dbPath);
+            TelephoneBookLogic phonebook(dbPath);
+            auto start = Clock::now();
+            phonebook.ImportContacts(book);
+            result.micros.push_back(ElapsedMicros(start));
+        }
+        results.push_back(std::move(result));
+    }
+
+    // Cold load: open the populated database and read everything into memory.
+    {
+        BenchResult result{"cold_load", {}, book.size()};
+        for (int run = 0; run < 5; ++run) {
+            auto start = Clock::now();
+            TelephoneBookLogic phonebook(dbPath);
+            result.micros.push_back(ElapsedMicros(start));
+        }
+        results.push_back(std::move(result));
+    }
+
+    TelephoneBookLogic phonebook(dbPath);
+
+    // Searches. Queries come from the generated book so they always hit something.
+    // The result cache is off here so every sample measures the query itself.
+    phonebook.ConfigureSearchCache(0);
+    {
+        BenchResult prefix{"search_name_prefix", {}, 1};
+        BenchResult substring{"search_substring", {}, 1};
+        BenchResult phone{"search_phone", {}, 1};
+        for (size_t i = 0; i < options.ops; ++i) {
+            const SyntheticContact& target = generated[(i * 7919) % generated.size()];
+            std::string prefixQuery = target.name.substr(0, 3);
+            size_t space = target.name.find(' ');
+            std::string substringQuery = target.name.substr(space + 1, 4);
+            std::string phoneQuery = target.phone.substr(4, 6);
+
+            auto start = Clock::now();
+            phonebook.SearchContacts(prefixQuery);
+            prefix.micros.push_back(ElapsedMicros(start));
+
+            start = Clock::now();
+            phonebook.SearchContacts(substringQuery);
+            substring.micros.push_back(ElapsedMicros(start));
+
+            start = Clock::now();
+            phonebook.SearchContacts(phoneQuery);
+            phone.micros.push_back(ElapsedMicros(start));
+        }
+        results.push_back(std::move(prefix));
+        results.push_back(std::move(substring));
+        results.push_back(std::move(phone));
+    }
+    phonebook.ConfigureSearchCache(16 * 1024 * 1024);
+
+    // Repeated searches from a small working set of queries, as at a call center;
+    // after the first round every query is a result cache hit.
+    {
+        BenchResult cached{"search_repeated", {}, 1};
+        for (size_t i = 0; i < options.ops; ++i) {
+            const SyntheticContact& target = generated[((i % 10) * 7919) % generated.size()];
+            std::string query = target.name.substr(0, 3);
+
+            auto start = Clock::now();
+            phonebook.SearchContacts(query);
+            cached.micros.push_back(ElapsedMicros(start));
+        }
+        results.push_back(std::move(cached));
+    }
+
+    // Fuzzy search with one transposition in the last name. The first call builds the
+    // fuzzy index for the snapshot and is reported separately.
+    {
+        BenchResult build{"fuzzy_index_build", {}, book.size()};
+        auto start = Clock::now();
+        phonebook.FuzzySearchContacts("warmup");
+        build.micros.push_back(ElapsedMicros(start));
+        results.push_back(std::move(build));
+
+        BenchResult fuzzy{"search_name_fuzzy", {}, 1};
+        for (size_t i = 0; i < options.ops; ++i) {
+            std::string name = generated[(i * 7919) % generated.size()].name;
+            size_t space = name.find(' ');
+            if (space != std::string::npos && space + 2 < name.size()) {
+                std::swap(name[space + 1], name[space + 2]);
+            }
+
+            start = Clock::now();
+            phonebook.FuzzySearchContacts(name);
+            fuzzy.micros.push_back(ElapsedMicros(start));
+        }
+        results.push_back(std::move(fuzzy));
+    }
+
+    // Phone prefix search (area code plus a few digits) from the in-memory prefix index.
+    {
+        BenchResult build{"phone_prefix_index_build", {}, book.size()};
+        auto start = Clock::now();
+        phonebook.CountByPhonePrefix("0");
+        build.micros.push_back(ElapsedMicros(start));
+        results.push_back(std::move(build));
+
+        BenchResult prefix{"search_phone_prefix", {}, 1};
+        for (size_t i = 0; i < options.ops; ++i) {
+            const SyntheticContact& target = generated[(i * 7919) % generated.size()];
+            std::string query = "+" + target.phone.substr(0, 6);
+
+            start = Clock::now();
+            phonebook.SearchByPhonePrefix(query, 100);
+            prefix.micros.push_back(ElapsedMicros(start));
+        }
+        results.push_back(std::move(prefix));
+    }
+
+    // Structured query combining a name prefix and a phone prefix; the planner
+    // intersects the name word and phone prefix index results.
+    {
+        BenchResult structured{"search_structured", {}, 1};
+        for (size_t i = 0; i < options.ops; ++i) {
+            const SyntheticContact& target = generated[(i * 7919) % generated.size()];
+            std::string query = "name:" + target.name.substr(0, 3) + "* phone:+" + target.phone.substr(0, 4) + "*";
+
+            auto start = Clock::now();
+            phonebook.SearchStructured(query);
+            structured.micros.push_back(ElapsedMicros(start));
+        }
+        results.push_back(std::move(structured));
+    }
+
+    // Exact lookups by number: FindByPhone in this process, and the shared-memory table
+    // another process would read. Each sample times a batch of lookups.
+    {
+        const size_t batch = 1000;
+        BenchResult find{"find_by_phone", {}, batch};
+        for (size_t i = 0; i < options.ops; ++i) {
+            auto start = Clock::now();
+            for (size_t k = 0; k < batch; ++k) {
+                phonebook.FindByPhone(generated[((i * batch + k) * 7919) % generated.size()].phone);
+            }
+            find.micros.push_back(ElapsedMicros(start));
+        }
+        results.push_back(std::move(find));
+
+        const std::string shmName = "/phonebook_bench";
+        BenchResult publish{"shared_table_publish", {}, book.size()};
+        auto start = Clock::now();
+        bool published = phonebook.StartPhoneTablePublishing(shmName);
+        publish.micros.push_back(ElapsedMicros(start));
+        results.push_back(std::move(publish));
+
+        SharedPhoneTableReader reader;
+        if (published && reader.Open(shmName)) {
+            BenchResult shared{"shared_table_lookup", {}, batch};
+            std::string name;
+            for (size_t i = 0; i < options.ops; ++i) {
+                start = Clock::now();
+                for (size_t k = 0; k < batch; ++k) {
+                    reader.Lookup(generated[((i * batch + k) * 7919) % generated.size()].phone, name);
+                }
+                shared.micros.push_back(ElapsedMicros(start));
+            }
+            results.push_back(std::move(shared));
+        }
+        phonebook.StopPhoneTablePublishing();
+        SharedPhoneTableWriter::Remove(shmName);
+    }
+
+    // Sort of the in-memory list.
+    {
+        BenchResult result{"sort", {}, book.size()};
+        for (size_t i = 0; i < std::min<size_t>(options.ops, 20); ++i) {
+            auto start = Clock::now();
+            phonebook.SortContactsByName();
+            result.micros.push_back(ElapsedMicros(start));
+        }
+        results.push_back(std::move(result));
+    }
+
+    // Single-row writes: add, then edit and delete the same rows.
+    std::vector<Contact> extra;
+    for (size_t i = 0; i < options.ops; ++i) {
+        extra.push_back(ToContact(generator.Generate(options.book.count + i)));
+    }
+    {
+        BenchResult add{"add", {}, 1};
+        for (const Contact& contact : extra) {
+            auto start = Clock::now();
+            phonebook.AddContact(contact);
+            add.micros.push_back(ElapsedMicros(start));
+        }
+        results.push_back(std::move(add));
+
+        BenchResult edit{"edit", {}, 1};
+        for (const Contact& contact : extra) {
+            Contact updated(contact.GetName() + " Jr", contact.GetPhone(), contact.GetEmail());
+            auto start = Clock::now();
+            phonebook.EditContact(contact.GetName(), contact.GetPhone(), updated);
+            edit.micros.push_back(ElapsedMicros(start));
+        }
+        results.push_back(std::move(edit));
+
+        BenchResult remove{"delete", {}, 1};
+        for (const Contact& contact : extra) {
+            auto start = Clock::now();
+            phonebook.DeleteContact(contact.GetName() + " Jr", contact.GetPhone());
+            remove.micros.push_back(ElapsedMicros(start));
+        }
+        results.push_back(std::move(remove));
+    }
+
+    // The same book split over four shards: parallel bulk import, single adds (which
+    // patch one shard's snapshot from its change log) and scatter-gather substring search.
+    {
+        const size_t shardCount = 4;
+        auto removeShards = [&]() {
+            for (size_t i = 0; i < shardCount; ++i) {
+                RemoveDatabase(ShardPath(dbPath, i, shardCount));
+            }
+        };
+        BenchResult import{"sharded_bulk_import", {}, book.size()};
+        for (int run = 0; run < 3; ++run) {
+            removeShards();
+            ShardedBook sharded(dbPath, shardCount);
+            auto start = Clock::now();
+            sharded.ImportContacts(book);
+            import.micros.push_back(ElapsedMicros(start));
+        }
+        results.push_back(std::move(import));
+
+        ShardedBook sharded(dbPath, shardCount);
+        for (size_t i = 0; i < shardCount; ++i) {
+            sharded.GetShard(i).ConfigureSearchCache(0);
+        }
+        BenchResult add{"sharded_add", {}, 1};
+        for (const Contact& contact : extra) {
+            auto start = Clock::now();
+            sharded.AddContact(contact);
+            add.micros.push_back(ElapsedMicros(start));
+        }
+        results.push_back(std::move(add));
+
+        BenchResult substring{"sharded_search_substring", {}, 1};
+        for (size_t i = 0; i < options.ops; ++i) {
+            const SyntheticContact& target = generated[(i * 7919) % generated.size()];
+            std::string query = target.name.substr(target.name.find(' ') + 1, 4);
+
+            auto start = Clock::now();
+            sharded.SearchContacts(query);
+            substring.micros.push_back(ElapsedMicros(start));
+        }
+        results.push_back(std::move(substring));
+        removeShards();
+    }
+
+    if (options.outPath.empty()) {
+        WriteJson(std::cout, options, results);
+    } else {
+        std::ofstream out(options.outPath);
+        WriteJson(out, options, results);
+    }
+
+    return 0;
+}
@@ -0,0 +1,87 @@
+// bookdiff.cpp
+// Writes the changeset that turns one book into another (see BookDiff.hpp): both books
+// are read once, ordered by normalized phone number, and merged in a single pass, so
+// time is dominated by SQLite's sort and memory does not grow with the books.
+//
+// Usage: bookdiff --from old.db --to new.db [--out changes.txt|-]
+//
+// The counts go to stderr. Exit status: 0 no differences, 1 differences, 2 error
+// (as diff(1)). Apply the result with bookmerge --changes.
+#include "BookDiff.hpp"
+#include "CoreLog.hpp"
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+namespace {
+
+struct DiffOptions {
+    std::string fromPath;
+    std::string toPath;
+    std::string outPath = "-";
+};
+
+bool ParseOptions(int argc, char** argv, DiffOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!value) {
+            std::fprintf(stderr, "Missing value for %s\n", arg.c_str());
+            return false;
+        }
+        ++i;
+        if (arg == "--from") {
+            options.fromPath = value;
+        } else if (arg == "--to") {
+            options.toPath = value;
+        } else if (arg == "--out") {
+            options.outPath = value;
+        } else {
+            std::fprintf(stderr, "Unknown option: %s\n", arg.c_str());
+            return false;
+        }
+    }
+    return !options.fromPath.empty() && !options.toPath.empty();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    DiffOptions options;
+    if (!ParseOptions(argc, argv, options)) {
+        std::fprintf(stderr, "Usage: bookdiff --from old.db --to new.db [--out changes.txt|-]\n");
+        return 2;
+    }
+    SetLogSink([](LogLevel level, const std::string& text) {
+        if (level == LogLevel::Error) {
+            std::fprintf(stderr, "Error: %s\n", text.c_str());
+        }
+    });
+
+    std::FILE* out = options.outPath == "-" ? stdout : std::fopen(options.outPath.c_str(), "w");
+    if (!out) {
+        std::perror(options.outPath.c_str());
+        return 2;
+    }
+    auto start = std::chrono::steady_clock::now();
+    ChangesetWriter writer(out);
+    bool written = true;
+    BookDiffStats stats;
+    bool read = DiffBooks(options.fromPath, options.toPath, [&](const BookChange& change) {
+        return written = writer.Write(change);
+    }, &stats);
+    written = std::fflush(out) == 0 && written;
+    if (out != stdout) {
+        written = std::fclose(out) == 0 && written;
+    }
+    if (!read || !written) {
+        if (!written) {
+            std::fprintf(stderr, "Error: cannot write %s\n", options.outPath.c_str());
+        }
+        return 2;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::fprintf(stderr, "%zu added, %zu removed, %zu modified, %zu unchanged (%.2f s)\n", stats.added,
+                 stats.removed, stats.modified, stats.unchanged, seconds);
+    return stats.added + stats.removed + stats.modified > 0 ? 1 : 0;
+}
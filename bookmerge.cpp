@@ -0,0 +1,167 @@
+// bookmerge.cpp
+// Applies changes to a book in one transaction (see BookDiff.hpp), either a changeset
+// written by bookdiff or the contacts of another book.
+//
+// Usage: bookmerge --into contacts.db --changes changes.txt|- [--on-conflict P]
+//        bookmerge --into contacts.db --from department.db [--on-conflict P]
+//
+// P is abort (default: nothing is applied if any change conflicts), skip (keep the
+// target's rows) or overwrite (take the change). With --from the other book's numbers
+// that are missing are added; numbers present in both with a different name or e-mail
+// are conflicts, and nothing is removed. A target that does not exist yet is created,
+// an older one is migrated to the current schema first.
+// Running applications pick the result up through the change log.
+#include "BookDiff.hpp"
+#include "CoreLog.hpp"
+#include "TelephoneBookLogic.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+namespace {
+
+struct MergeOptions {
+    std::string intoPath;
+    std::string changesPath; // Changeset file, "-" = stdin
+    std::string fromPath;    // Or a book to merge in
+    ConflictPolicy policy = ConflictPolicy::Abort;
+};
+
+bool ParseOptions(int argc, char** argv, MergeOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!value) {
+            std::fprintf(stderr, "Missing value for %s\n", arg.c_str());
+            return false;
+        }
+        ++i;
+        if (arg == "--into") {
+            options.intoPath = value;
+        } else if (arg == "--changes") {
+            options.changesPath = value;
+        } else if (arg == "--from") {
+            options.fromPath = value;
+        } else if (arg == "--on-conflict") {
+            std::string policy = value;
+            if (policy == "abort") {
+                options.policy = ConflictPolicy::Abort;
+            } else if (policy == "skip") {
+                options.policy = ConflictPolicy::Skip;
+            } else if (policy == "overwrite") {
+                options.policy = ConflictPolicy::Overwrite;
+            } else {
+                std::fprintf(stderr, "Unknown conflict policy: %s\n", value);
+                return false;
+            }
+        } else {
+            std::fprintf(stderr, "Unknown option: %s\n", arg.c_str());
+            return false;
+        }
+    }
+    return !options.intoPath.empty() && options.changesPath.empty() != options.fromPath.empty();
+}
+
+// The changes that bring the other book's contacts into the target, as a temporary
+// changeset: additions as they are, differing entries for the same number as changes
+// that are all conflicts by definition, so the policy decides about each of them.
+std::FILE* MergeChangeset(const MergeOptions& options, size_t& conflicts) {
+    std::FILE* changeset = std::tmpfile();
+    if (!changeset) {
+        std::perror("tmpfile");
+        return nullptr;
+    }
+    conflicts = 0;
+    ChangesetWriter writer(changeset);
+    bool written = true;
+    bool read = DiffBooks(options.intoPath, options.fromPath, [&](const BookChange& change) {
+        if (change.kind == BookChangeKind::Removed) {
+            return true; // Only in the target: kept
+        }
+        if (change.kind == BookChangeKind::Modified) {
+            if (options.policy == ConflictPolicy::Abort) {
+                if (++conflicts <= 10) { // Enough to see what is going on
+                    LogError("%s, %s, %s differs from %s, %s, %s in the target", change.after.GetName().c_str(),
+                             change.after.GetPhone().c_str(), change.after.GetEmail().c_str(),
+                             change.before.GetName().c_str(), change.before.GetPhone().c_str(),
+                             change.before.GetEmail().c_str());
+                }
+                return true;
+            }
+            ++conflicts;
+            if (options.policy == ConflictPolicy::Skip) {
+                return true;
+            }
+        }
+        return written = writer.Write(change);
+    });
+    if (!read || !written || std::fflush(changeset) != 0) {
+        std::fclose(changeset);
+        return nullptr;
+    }
+    std::rewind(changeset);
+    return changeset;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    MergeOptions options;
+    if (!ParseOptions(argc, argv, options)) {
+        std::fprintf(stderr, "Usage: bookmerge --into contacts.db (--changes changes.txt|- | --from other.db) "
+                             "[--on-conflict abort|skip|overwrite]\n");
+        return 2;
+    }
+    SetLogSink([](LogLevel level, const std::string& text) {
+        if (level == LogLevel::Error) {
+            std::fprintf(stderr, "Error: %s\n", text.c_str());
+        }
+    });
+
+    {
+        // Creates a missing target and brings an older one up to the current schema
+        // (phonetic column, change log) before the changes are written to it
+        TelephoneBookLogic target(options.intoPath);
+    }
+    auto start = std::chrono::steady_clock::now();
+    size_t bookConflicts = 0;
+    std::FILE* in = nullptr;
+    if (!options.fromPath.empty()) {
+        in = MergeChangeset(options, bookConflicts);
+        if (in && bookConflicts > 0 && options.policy == ConflictPolicy::Abort) {
+            std::fprintf(stderr, "%zu conflicting numbers; nothing merged\n", bookConflicts);
+            std::fclose(in);
+            return 1;
+        }
+    } else {
+        in = options.changesPath == "-" ? stdin : std::fopen(options.changesPath.c_str(), "r");
+        if (!in) {
+            std::perror(options.changesPath.c_str());
+        }
+    }
+    if (!in) {
+        return 2;
+    }
+
+    ChangesetReader reader(in);
+    ApplyStats stats;
+    bool applied = ApplyChangeset(options.intoPath, reader, options.policy, &stats);
+    if (in != stdin) {
+        std::fclose(in);
+    }
+    if (!applied) {
+        return 1;
+    }
+    // Conflicts with the other book were resolved while writing the changeset
+    stats.conflicts += bookConflicts;
+    if (options.policy == ConflictPolicy::Overwrite) {
+        bookConflicts = std::min(bookConflicts, stats.applied);
+        stats.applied -= bookConflicts;
+        stats.overwritten += bookConflicts;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::fprintf(stderr, "%zu changes applied, %zu conflicts (%zu overwritten) in %.2f s\n", stats.applied,
+                 stats.conflicts, stats.overwritten, seconds);
+    return 0;
+}
@@ -0,0 +1,157 @@
+// bookverify.cpp
+// Checks that a replica holds exactly the primary's contacts (see BookReplica.hpp and
+// BookChecksum.hpp). Both books are summarized into checksum trees; equal roots end
+// the check, otherwise only the differing subtrees are followed down to the number
+// ranges that disagree, and the rows of those ranges are listed.
+//
+// Usage: bookverify --primary contacts.db --replica replica.db [--depth 12] [--show 20]
+//
+// Exit status: 0 equal, 1 different, 2 usage or read error. A replica that is not at
+// the primary's log position yet is reported as such; its differences may be in flight.
+#include "BookChecksum.hpp"
+#include "CoreLog.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <tuple>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+
+struct VerifyOptions {
+    std::string primaryPath;
+    std::string replicaPath;
+    unsigned depth = 12;
+    size_t show = 20; // Differing rows printed
+};
+
+bool ParseOptions(int argc, char** argv, VerifyOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!value) {
+            std::fprintf(stderr, "Missing value for %s\n", arg.c_str());
+            return false;
+        }
+        ++i;
+        if (arg == "--primary") {
+            options.primaryPath = value;
+        } else if (arg == "--replica") {
+            options.replicaPath = value;
+        } else if (arg == "--depth") {
+            options.depth = static_cast<unsigned>(std::strtoul(value, nullptr, 10));
+        } else if (arg == "--show") {
+            options.show = std::strtoul(value, nullptr, 10);
+        } else {
+            std::fprintf(stderr, "Unknown option: %s\n", arg.c_str());
+            return false;
+        }
+    }
+    return !options.primaryPath.empty() && !options.replicaPath.empty();
+}
+
+sqlite3* OpenReadOnly(const std::string& path) {
+    sqlite3* db = nullptr;
+    if (sqlite3_open_v2(path.c_str(), &db, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+        std::fprintf(stderr, "Cannot open %s: %s\n", path.c_str(), sqlite3_errmsg(db));
+        sqlite3_close(db);
+        return nullptr;
+    }
+    sqlite3_busy_timeout(db, 5000);
+    return db;
+}
+
+using Row = std::tuple<std::string, std::string, std::string>; // name, phone, email
+
+// Rows of 'db' whose number falls into one of 'ranges', with their multiplicity.
+std::map<Row, int> RowsInRanges(sqlite3* db, const BookChecksumTree& tree, const std::unordered_set<size_t>& ranges) {
+    std::map<Row, int> rows;
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, "SELECT name, phone, email FROM contacts;", -1, &stmt, 0) != SQLITE_OK) {
+        return rows;
+    }
+    auto text = [&](int column) {
+        const char* value = reinterpret_cast<const char*>(sqlite3_column_text(stmt, column));
+        return value ? std::string(value) : std::string();
+    };
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        std::string phone = text(1);
+        if (ranges.count(tree.RangeOf(phone)) > 0) {
+            ++rows[Row(text(0), phone, text(2))];
+        }
+    }
+    sqlite3_finalize(stmt);
+    return rows;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    VerifyOptions options;
+    if (!ParseOptions(argc, argv, options)) {
+        std::fprintf(stderr, "Usage: bookverify --primary contacts.db --replica replica.db [--depth 12] [--show 20]\n");
+        return 2;
+    }
+    SetLogSink([](LogLevel level, const std::string& text) {
+        if (level == LogLevel::Error) {
+            std::fprintf(stderr, "Error: %s\n", text.c_str());
+        }
+    });
+
+    sqlite3* primary = OpenReadOnly(options.primaryPath);
+    sqlite3* replica = primary ? OpenReadOnly(options.replicaPath) : nullptr;
+    BookChecksumTree primaryTree(options.depth);
+    BookChecksumTree replicaTree(options.depth);
+    uint64_t primarySequence = 0;
+    uint64_t replicaSequence = 0;
+    if (!replica || !ComputeBookChecksum(primary, primaryTree, &primarySequence) ||
+        !ComputeBookChecksum(replica, replicaTree, &replicaSequence)) {
+        sqlite3_close(primary);
+        sqlite3_close(replica);
+        return 2;
+    }
+    std::printf("primary: %llu contacts at sequence %llu, root %016llx\n",
+                static_cast<unsigned long long>(primaryTree.Count()), static_cast<unsigned long long>(primarySequence),
+                static_cast<unsigned long long>(primaryTree.Root()));
+    std::printf("replica: %llu contacts at sequence %llu, root %016llx\n",
+                static_cast<unsigned long long>(replicaTree.Count()), static_cast<unsigned long long>(replicaSequence),
+                static_cast<unsigned long long>(replicaTree.Root()));
+    if (primarySequence != replicaSequence) {
+        std::printf("replica is %s the primary; differences may not be final\n",
+                    replicaSequence < primarySequence ? "behind" : "ahead of");
+    }
+
+    size_t compared = 0;
+    std::vector<size_t> ranges = primaryTree.DifferingRanges(replicaTree, &compared);
+    if (ranges.empty()) {
+        std::printf("equal (%zu of %zu nodes compared)\n", compared, 2 * primaryTree.GetRangeCount() - 1);
+        sqlite3_close(primary);
+        sqlite3_close(replica);
+        return 0;
+    }
+    std::printf("%zu of %zu ranges differ (%zu nodes compared)\n", ranges.size(), primaryTree.GetRangeCount(), compared);
+
+    // Second pass over both books, keeping only the rows of the differing ranges
+    std::unordered_set<size_t> differing(ranges.begin(), ranges.end());
+    std::map<Row, int> primaryRows = RowsInRanges(primary, primaryTree, differing);
+    std::map<Row, int> replicaRows = RowsInRanges(replica, replicaTree, differing);
+    size_t shown = 0;
+    auto report = [&](const std::map<Row, int>& from, const std::map<Row, int>& other, const char* side) {
+        for (const auto& [row, count] : from) {
+            auto match = other.find(row);
+            int extra = count - (match == other.end() ? 0 : match->second);
+            for (int i = 0; i < extra && shown < options.show; ++i, ++shown) {
+                std::printf("  only in %s: %s, %s, %s\n", side, std::get<0>(row).c_str(), std::get<1>(row).c_str(),
+                            std::get<2>(row).c_str());
+            }
+        }
+    };
+    report(primaryRows, replicaRows, "primary");
+    report(replicaRows, primaryRows, "replica");
+    sqlite3_close(primary);
+    sqlite3_close(replica);
+    return 1;
+}
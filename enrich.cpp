@@ -0,0 +1,412 @@
+// enrich.cpp
+// Joins call detail records (CDRs) against the phone book: every CSV line of the input
+// gets the caller's and the callee's name appended as two more columns (empty when the
+// number is unknown). The input is mmapped and cut into chunks at line boundaries;
+// worker threads resolve both numbers through an in-memory PhoneHashIndex, and the
+// main thread writes the enriched chunks in input order, one large write() each, so
+// the run is bounded by disk bandwidth rather than by lookups.
+//
+// Usage: enrich --in calls.csv [--out enriched.csv|-] [--db contacts.db] [--threads T]
+//               [--chunk-mb M] [--caller-column N] [--callee-column N] [--header]
+//               [--normalize]
+//
+// Columns are counted from 0 (defaults 0 and 1). --header passes the first line through
+// with "caller_name,callee_name" appended. --normalize matches numbers by digits only,
+// so "+49 30 1234" in a CDR finds "004930 1234" in the book.
+#include "TelephoneBookLogic.hpp"
+#include "PhoneHashIndex.hpp"
+#include "CoreLog.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct EnrichOptions {
+    std::string dbPath = "contacts.db";
+    std::string inPath;
+    std::string outPath = "-"; // "-" = stdout
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    size_t chunkBytes = size_t{8} << 20;
+    size_t callerColumn = 0;
+    size_t calleeColumn = 1;
+    bool header = false;
+    bool normalize = false;
+};
+
+// One enriched chunk, plus the counters for the summary.
+struct EnrichedChunk {
+    std::string text;
+    uint64_t lines = 0;
+    uint64_t callerHits = 0;
+    uint64_t calleeHits = 0;
+};
+
+bool ParseOptions(int argc, char** argv, EnrichOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--header") {
+            options.header = true;
+            continue;
+        } else if (arg == "--normalize") {
+            options.normalize = true;
+            continue;
+        }
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!value) {
+            std::fprintf(stderr, "Missing value for %s\n", arg.c_str());
+            return false;
+        }
+        ++i;
+        if (arg == "--db") {
+            options.dbPath = value;
+        } else if (arg == "--in") {
+            options.inPath = value;
+        } else if (arg == "--out") {
+            options.outPath = value;
+        } else if (arg == "--threads") {
+            options.threads = std::max(1u, static_cast<unsigned>(std::strtoul(value, nullptr, 10)));
+        } else if (arg == "--chunk-mb") {
+            options.chunkBytes = std::max<size_t>(1, std::strtoul(value, nullptr, 10)) << 20;
+        } else if (arg == "--caller-column") {
+            options.callerColumn = std::strtoul(value, nullptr, 10);
+        } else if (arg == "--callee-column") {
+            options.calleeColumn = std::strtoul(value, nullptr, 10);
+        } else {
+            std::fprintf(stderr, "Unknown option: %s\n", arg.c_str());
+            return false;
+        }
+    }
+    if (options.inPath.empty()) {
+        std::fprintf(stderr, "--in is required\n");
+        return false;
+    }
+    return true;
+}
+
+// Same bounded, in-order hand-over as genbook's: workers finish chunks in any order,
+// the writer takes them strictly in sequence, and no worker gets more than
+// 'maxPending' chunks ahead of it, which caps memory at a few chunks per thread.
+class ChunkQueue {
+public:
+    explicit ChunkQueue(size_t maxPending) : maxPending(maxPending) {}
+
+    void Put(uint64_t chunk, EnrichedChunk result) {
+        std::unique_lock<std::mutex> lock(mutex);
+        spaceAvailable.wait(lock, [&]() { return chunk < nextToWrite + maxPending; });
+        ready.emplace(chunk, std::move(result));
+        chunkReady.notify_all();
+    }
+
+    EnrichedChunk TakeNext() {
+        std::unique_lock<std::mutex> lock(mutex);
+        chunkReady.wait(lock, [&]() { return ready.count(nextToWrite) > 0; });
+        auto it = ready.find(nextToWrite);
+        EnrichedChunk result = std::move(it->second);
+        ready.erase(it);
+        ++nextToWrite;
+        spaceAvailable.notify_all();
+        return result;
+    }
+
+private:
+    size_t maxPending;
+    std::mutex mutex;
+    std::condition_variable chunkReady;
+    std::condition_variable spaceAvailable;
+    std::map<uint64_t, EnrichedChunk> ready;
+    uint64_t nextToWrite = 0;
+};
+
+// Everything the workers share, read-only.
+struct EnrichContext {
+    const std::vector<Contact>& contacts;
+    const PhoneHashIndex& index;
+    const EnrichOptions& options;
+};
+
+// Field 'column' of a CSV line, without surrounding quotes. Doubled quotes inside a
+// quoted field are left as they are; phone numbers never contain any.
+std::string_view CsvField(std::string_view line, size_t column) {
+    size_t pos = 0;
+    for (size_t field = 0;; ++field) {
+        size_t begin = pos;
+        size_t end;
+        size_t next;
+        if (pos < line.size() && line[pos] == '"') {
+            // Quoted: the field ends at the first quote not followed by another quote
+            size_t close = pos + 1;
+            while (true) {
+                close = line.find('"', close);
+                if (close == std::string_view::npos || close + 1 >= line.size() || line[close + 1] != '"') {
+                    break;
+                }
+                close += 2;
+            }
+            begin = pos + 1;
+            end = close == std::string_view::npos ? line.size() : close;
+            next = line.find(',', end);
+        } else {
+            const void* comma = std::memchr(line.data() + pos, ',', line.size() - pos);
+            end = comma ? static_cast<size_t>(static_cast<const char*>(comma) - line.data()) : line.size();
+            next = comma ? end : std::string_view::npos;
+        }
+        if (field == column) {
+            return line.substr(begin, end - begin);
+        }
+        if (next == std::string_view::npos) {
+            return std::string_view();
+        }
+        pos = next + 1;
+    }
+}
+
+bool NeedsCsvQuotes(const std::string& value) {
+    // Hand-rolled: find_first_of() with a set is a nested loop per character
+    for (char c : value) {
+        if (c == ',' || c == '"' || c == '\r' || c == '\n') {
+            return true;
+        }
+    }
+    return false;
+}
+
+void AppendCsvField(std::string& out, const std::string& value) {
+    if (!NeedsCsvQuotes(value)) {
+        out += value;
+        return;
+    }
+    out += '"';
+    for (char c : value) {
+        if (c == '"') {
+            out += '"';
+        }
+        out += c;
+    }
+    out += '"';
+}
+
+// Lines resolved per FindMany() call: both numbers of all of them are looked up in
+// one go, so the hash table misses overlap.
+constexpr size_t kLineBatch = 64;
+
+void AppendName(std::string& out, const EnrichContext& context, size_t position, uint64_t& hits) {
+    if (position != PhoneHashIndex::npos) {
+        AppendCsvField(out, context.contacts[position].GetName());
+        ++hits;
+    }
+}
+
+EnrichedChunk EnrichChunk(const EnrichContext& context, const char* begin, const char* end) {
+    EnrichedChunk result;
+    // Names add a few dozen bytes per line; one reserve up front avoids regrowing
+    result.text.reserve(static_cast<size_t>(end - begin) + static_cast<size_t>(end - begin) / 2);
+    std::string_view lines[kLineBatch];
+    std::string_view phones[kLineBatch * 2]; // Caller, callee, caller, ...
+    size_t positions[kLineBatch * 2];
+    while (begin < end) {
+        size_t count = 0;
+        while (count < kLineBatch && begin < end) {
+            const char* newline =
+                static_cast<const char*>(std::memchr(begin, '\n', static_cast<size_t>(end - begin)));
+            const char* lineEnd = newline ? newline : end;
+            const char* contentEnd = lineEnd > begin && lineEnd[-1] == '\r' ? lineEnd - 1 : lineEnd;
+            std::string_view line(begin, static_cast<size_t>(contentEnd - begin));
+            begin = newline ? newline + 1 : end;
+            lines[count] = line;
+            phones[count * 2] = line.empty() ? line : CsvField(line, context.options.callerColumn);
+            phones[count * 2 + 1] = line.empty() ? line : CsvField(line, context.options.calleeColumn);
+            ++count;
+        }
+        context.index.FindMany(phones, count * 2, positions);
+        for (size_t i = 0; i < count * 2; ++i) {
+            if (positions[i] != PhoneHashIndex::npos) {
+                __builtin_prefetch(&context.contacts[positions[i]]);
+            }
+        }
+
+        for (size_t i = 0; i < count; ++i) {
+            if (lines[i].empty()) {
+                result.text += '\n'; // Blank lines pass through as they are
+                continue;
+            }
+            result.text.append(lines[i]);
+            result.text += ',';
+            AppendName(result.text, context, positions[i * 2], result.callerHits);
+            result.text += ',';
+            AppendName(result.text, context, positions[i * 2 + 1], result.calleeHits);
+            result.text += '\n';
+            ++result.lines;
+        }
+    }
+    return result;
+}
+
+bool WriteAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::fprintf(stderr, "Write failed: %s\n", std::strerror(errno));
+            return false;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    EnrichOptions options;
+    if (!ParseOptions(argc, argv, options)) {
+        std::fprintf(stderr, "Usage: enrich --in calls.csv [--out enriched.csv|-] [--db contacts.db] [--threads T] "
+                             "[--chunk-mb M] [--caller-column N] [--callee-column N] [--header] [--normalize]\n");
+        return 2;
+    }
+    // stdout may carry the output, so the book only reports errors
+    SetLogSink([](LogLevel level, const std::string& text) {
+        if (level == LogLevel::Error) {
+            std::fprintf(stderr, "Error: %s\n", text.c_str());
+        }
+    });
+
+    int inFd = open(options.inPath.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat inStat {};
+    if (inFd < 0 || fstat(inFd, &inStat) != 0) {
+        std::fprintf(stderr, "Cannot open %s: %s\n", options.inPath.c_str(), std::strerror(errno));
+        return 1;
+    }
+    size_t inSize = static_cast<size_t>(inStat.st_size);
+    const char* input = nullptr;
+    if (inSize > 0) {
+        void* mapped = mmap(nullptr, inSize, PROT_READ, MAP_PRIVATE, inFd, 0);
+        if (mapped == MAP_FAILED) {
+            std::fprintf(stderr, "Cannot map %s: %s\n", options.inPath.c_str(), std::strerror(errno));
+            return 1;
+        }
+        // Every byte is read once, front to back: let the kernel read ahead aggressively
+        madvise(mapped, inSize, MADV_SEQUENTIAL);
+        input = static_cast<const char*>(mapped);
+    }
+
+    int outFd = STDOUT_FILENO;
+    if (options.outPath != "-") {
+        outFd = open(options.outPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (outFd < 0) {
+            std::fprintf(stderr, "Cannot create %s: %s\n", options.outPath.c_str(), std::strerror(errno));
+            return 1;
+        }
+    }
+
+    Clock::time_point loadStart = Clock::now();
+    std::shared_ptr<const std::vector<Contact>> contacts;
+    {
+        // Only the snapshot is needed; it outlives the book
+        TelephoneBookLogic book(options.dbPath, ConcurrencyMode::MultiReader, 1);
+        contacts = book.GetSnapshot();
+    }
+    PhoneHashIndex index(*contacts, options.normalize);
+    double loadSeconds = std::chrono::duration<double>(Clock::now() - loadStart).count();
+    std::fprintf(stderr, "Indexed %zu numbers of %zu contacts in %.2f s\n", index.Size(), contacts->size(),
+                 loadSeconds);
+
+    // The header line, if any, is not a record
+    size_t dataStart = 0;
+    if (options.header && inSize > 0) {
+        const char* newline = static_cast<const char*>(std::memchr(input, '\n', inSize));
+        dataStart = newline ? static_cast<size_t>(newline - input) + 1 : inSize;
+        std::string header(input, dataStart);
+        while (!header.empty() && (header.back() == '\n' || header.back() == '\r')) {
+            header.pop_back();
+        }
+        header += ",caller_name,callee_name\n";
+        if (!WriteAll(outFd, header.data(), header.size())) {
+            return 1;
+        }
+    }
+
+    // Chunk k covers the lines starting in [k * chunkBytes, (k + 1) * chunkBytes) of the
+    // data; each worker finds its own boundaries, so nothing scans the file up front.
+    size_t dataSize = inSize - dataStart;
+    const char* data = input + dataStart;
+    uint64_t chunkCount = (dataSize + options.chunkBytes - 1) / options.chunkBytes;
+    auto boundary = [&](uint64_t chunk) -> size_t {
+        size_t nominal = static_cast<size_t>(chunk) * options.chunkBytes;
+        if (chunk == 0 || nominal >= dataSize) {
+            return std::min(nominal, dataSize);
+        }
+        // A line starting exactly at 'nominal' belongs to this chunk
+        const void* newline = std::memchr(data + nominal - 1, '\n', dataSize - nominal + 1);
+        return newline ? static_cast<size_t>(static_cast<const char*>(newline) - data) + 1 : dataSize;
+    };
+
+    EnrichContext context{*contacts, index, options};
+    ChunkQueue queue(options.threads * 2);
+    Clock::time_point start = Clock::now();
+
+    // Worker t enriches chunks t, t+T, t+2T, ...
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < options.threads; ++t) {
+        workers.emplace_back([&, t]() {
+            for (uint64_t chunk = t; chunk < chunkCount; chunk += options.threads) {
+                size_t first = boundary(chunk);
+                size_t last = boundary(chunk + 1);
+                queue.Put(chunk, EnrichChunk(context, data + first, data + last));
+            }
+        });
+    }
+
+    uint64_t lines = 0;
+    uint64_t callerHits = 0;
+    uint64_t calleeHits = 0;
+    size_t outBytes = 0;
+    for (uint64_t chunk = 0; chunk < chunkCount; ++chunk) {
+        EnrichedChunk result = queue.TakeNext();
+        if (!WriteAll(outFd, result.text.data(), result.text.size())) {
+            // Workers may be blocked on the queue; nothing is left worth cleaning up
+            std::_Exit(1);
+        }
+        lines += result.lines;
+        callerHits += result.callerHits;
+        calleeHits += result.calleeHits;
+        outBytes += result.text.size();
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    if (outFd != STDOUT_FILENO && close(outFd) != 0) {
+        std::fprintf(stderr, "Cannot close %s: %s\n", options.outPath.c_str(), std::strerror(errno));
+        return 1;
+    }
+
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    double megabytes = static_cast<double>(inSize) / (1024.0 * 1024.0);
+    std::fprintf(stderr,
+                 "Enriched %llu lines (%llu callers, %llu callees named) in %.2f s: %.1f MB in, %.1f MB out, "
+                 "%.0f MB/s, %.0f lines/s\n",
+                 static_cast<unsigned long long>(lines), static_cast<unsigned long long>(callerHits),
+                 static_cast<unsigned long long>(calleeHits), seconds, megabytes,
+                 static_cast<double>(outBytes) / (1024.0 * 1024.0), seconds > 0.0 ? megabytes / seconds : 0.0,
+                 seconds > 0.0 ? static_cast<double>(lines) / seconds : 0.0);
+    return 0;
+}
@@ -0,0 +1,219 @@
+// genbook.cpp
+// Writes a synthetic contacts.db of any size (10k .. tens of millions of rows) for
+// sizing hardware and for benchmarks. Contacts come from SyntheticBook, so the same
+// seed and options produce byte-for-byte the same rows on every machine, no matter
+// how many generator threads are used.
+//
+// Usage: genbook [--count N] [--seed S] [--threads T] [--batch B] [--skew Z]
+//                [--unicode F] [--duplicates F] [--out contacts.db]
+#include "Phonetic.hpp"
+#include "SyntheticBook.hpp"
+#include <sqlite3.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct GenOptions {
+    SyntheticBookConfig book;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    uint64_t batch = 100000;            // Rows per chunk and per write transaction
+    std::string outPath = "contacts.db";
+};
+
+bool ParseOptions(int argc, char** argv, GenOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!value) {
+            std::cerr << "Missing value for " << arg << std::endl;
+            return false;
+        }
+        ++i;
+        if (arg == "--count") {
+            options.book.count = std::strtoull(value, nullptr, 10);
+        } else if (arg == "--seed") {
+            options.book.seed = std::strtoull(value, nullptr, 10);
+        } else if (arg == "--threads") {
+            options.threads = std::max(1u, static_cast<unsigned>(std::strtoul(value, nullptr, 10)));
+        } else if (arg == "--batch") {
+            options.batch = std::max<uint64_t>(1, std::strtoull(value, nullptr, 10));
+        } else if (arg == "--skew") {
+            options.book.nameSkew = std::strtod(value, nullptr);
+        } else if (arg == "--unicode") {
+            options.book.unicodeFraction = std::strtod(value, nullptr);
+        } else if (arg == "--duplicates") {
+            options.book.duplicateFraction = std::strtod(value, nullptr);
+        } else if (arg == "--out") {
+            options.outPath = value;
+        } else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Exec(sqlite3* db, const char* sql) {
+    char* errMsg = nullptr;
+    if (sqlite3_exec(db, sql, 0, 0, &errMsg) != SQLITE_OK) {
+        std::cerr << "SQL error (" << sql << "): " << (errMsg ? errMsg : "") << std::endl;
+        sqlite3_free(errMsg);
+        return false;
+    }
+    return true;
+}
+
+// Chunks are generated out of order by the worker threads and handed to the single
+// writer strictly in index order, which keeps the output deterministic. The number
+// of finished-but-unwritten chunks is bounded so memory stays flat for huge books.
+class ChunkQueue {
+public:
+    explicit ChunkQueue(size_t maxPending) : maxPending(maxPending) {}
+
+    // Blocks while the writer is too far behind 'chunk'.
+    void Put(uint64_t chunk, std::vector<SyntheticContact> rows) {
+        std::unique_lock<std::mutex> lock(mutex);
+        spaceAvailable.wait(lock, [&]() { return chunk < nextToWrite + maxPending; });
+        ready.emplace(chunk, std::move(rows));
+        chunkReady.notify_all();
+    }
+
+    std::vector<SyntheticContact> TakeNext() {
+        std::unique_lock<std::mutex> lock(mutex);
+        chunkReady.wait(lock, [&]() { return ready.count(nextToWrite) > 0; });
+        auto it = ready.find(nextToWrite);
+        std::vector<SyntheticContact> rows = std::move(it->second);
+        ready.erase(it);
+        ++nextToWrite;
+        spaceAvailable.notify_all();
+        return rows;
+    }
+
+private:
+    size_t maxPending;
+    std::mutex mutex;
+    std::condition_variable chunkReady;
+    std::condition_variable spaceAvailable;
+    std::map<uint64_t, std::vector<SyntheticContact>> ready;
+    uint64_t nextToWrite = 0;
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    GenOptions options;
+    if (!ParseOptions(argc, argv, options)) {
+        return 1;
+    }
+
+    for (const char* suffix : {"", "-wal", "-shm", "-journal"}) {
+        std::filesystem::remove(options.outPath + suffix);
+    }
+
+    sqlite3* db = nullptr;
+    if (sqlite3_open(options.outPath.c_str(), &db) != SQLITE_OK) {
+        std::cerr << "Cannot open database: " << sqlite3_errmsg(db) << std::endl;
+        sqlite3_close(db);
+        return 1;
+    }
+
+    // Same schema as TelephoneBookLogic::OpenDatabase() after its migrations up to
+    // schema version 2, so the application does not have to backfill phonetic keys on
+    // open. It adds the (empty) change log of version 3 itself, so the generated rows
+    // are the baseline rather than millions of logged changes.
+    // The file is brand new, so journaling can be off while loading; a crash just
+    // means running genbook again.
+    if (!Exec(db, "PRAGMA journal_mode=OFF;") || !Exec(db, "PRAGMA synchronous=OFF;") ||
+        !Exec(db, "PRAGMA cache_size=-262144;") ||
+        !Exec(db, "CREATE TABLE IF NOT EXISTS contacts (name TEXT, phone TEXT, email TEXT, phonetic TEXT);")) {
+        sqlite3_close(db);
+        return 1;
+    }
+
+    sqlite3_stmt* insertStmt = nullptr;
+    if (sqlite3_prepare_v2(db, "INSERT INTO contacts (name, phone, email, phonetic) VALUES (?, ?, ?, ?);", -1, &insertStmt, 0) != SQLITE_OK) {
+        std::cerr << "Failed to prepare insert: " << sqlite3_errmsg(db) << std::endl;
+        sqlite3_close(db);
+        return 1;
+    }
+
+    SyntheticBook generator(options.book);
+    uint64_t chunkCount = (options.book.count + options.batch - 1) / options.batch;
+    ChunkQueue queue(options.threads * 2);
+
+    // Worker t generates chunks t, t+T, t+2T, ...
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < options.threads; ++t) {
+        workers.emplace_back([&, t]() {
+            for (uint64_t chunk = t; chunk < chunkCount; chunk += options.threads) {
+                uint64_t begin = chunk * options.batch;
+                uint64_t end = std::min(begin + options.batch, options.book.count);
+                std::vector<SyntheticContact> rows;
+                generator.GenerateRange(begin, end, rows);
+                queue.Put(chunk, std::move(rows));
+            }
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t written = 0;
+    bool ok = true;
+    for (uint64_t chunk = 0; chunk < chunkCount && ok; ++chunk) {
+        std::vector<SyntheticContact> rows = queue.TakeNext();
+        ok = Exec(db, "BEGIN;");
+        for (const SyntheticContact& row : rows) {
+            sqlite3_reset(insertStmt);
+            sqlite3_bind_text(insertStmt, 1, row.name.c_str(), static_cast<int>(row.name.size()), SQLITE_STATIC);
+            sqlite3_bind_text(insertStmt, 2, row.phone.c_str(), static_cast<int>(row.phone.size()), SQLITE_STATIC);
+            sqlite3_bind_text(insertStmt, 3, row.email.c_str(), static_cast<int>(row.email.size()), SQLITE_STATIC);
+            std::string phonetic = PhoneticKey(row.name);
+            sqlite3_bind_text(insertStmt, 4, phonetic.c_str(), static_cast<int>(phonetic.size()), SQLITE_TRANSIENT);
+            if (sqlite3_step(insertStmt) != SQLITE_DONE) {
+                std::cerr << "Insert failed: " << sqlite3_errmsg(db) << std::endl;
+                ok = false;
+                break;
+            }
+        }
+        sqlite3_reset(insertStmt); // Drop the SQLITE_STATIC references before 'rows' goes away
+        ok = ok && Exec(db, "COMMIT;");
+        written += rows.size();
+        std::cerr << "\rWritten " << written << " / " << options.book.count << std::flush;
+    }
+    std::cerr << std::endl;
+
+    if (!ok) {
+        // Workers may be blocked waiting for the writer; there is nothing worth
+        // cleaning up in a half-written file, so leave without joining them.
+        std::cerr << "Generation failed." << std::endl;
+        std::_Exit(1);
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    sqlite3_finalize(insertStmt);
+    // Building the indexes once after loading is much cheaper than maintaining them per row.
+    if (!Exec(db, "CREATE INDEX IF NOT EXISTS idx_contacts_phonetic ON contacts(phonetic);") ||
+        !Exec(db, "CREATE INDEX IF NOT EXISTS idx_contacts_phone ON contacts(phone);") ||
+        !Exec(db, "PRAGMA user_version = 2;")) {
+        sqlite3_close(db);
+        return 1;
+    }
+    Exec(db, "PRAGMA journal_mode=DELETE;"); // Back to the default used by the application
+    sqlite3_close(db);
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Wrote " << written << " contacts to " << options.outPath << " in " << seconds << " s ("
+              << static_cast<uint64_t>(static_cast<double>(written) / std::max(seconds, 1e-9)) << " rows/s)" << std::endl;
+    return 0;
+}
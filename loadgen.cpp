@@ -0,0 +1,224 @@
+// loadgen.cpp
+// Load generator for phonebookd. Every connection runs on its own thread and keeps
+// --pipeline requests in flight for --seconds, then QPS and latency percentiles
+// (measured from queuing a request to receiving its response) are printed and
+// optionally written as JSON. Query keys are regenerated from the same SyntheticBook
+// settings genbook used, so --count/--seed must match the served book; --miss mixes
+// in numbers that are not in it.
+//
+// Usage: loadgen [--socket phonebookd.sock] [--connections C] [--pipeline P]
+//                [--seconds S] [--op lookup|search|prefix|ping] [--count N]
+//                [--seed S] [--miss F] [--out results.json]
+#include "LookupClient.hpp"
+#include "SyntheticBook.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct LoadOptions {
+    SyntheticBookConfig book;
+    std::string socketPath = "phonebookd.sock";
+    size_t connections = 4;
+    size_t pipeline = 32;
+    double seconds = 10.0;
+    LookupOp op = LookupOp::Lookup;
+    std::string opName = "lookup";
+    double missFraction = 0.0;
+    std::string outPath; // Empty = no JSON
+};
+
+struct ConnectionResult {
+    std::vector<double> micros;
+    uint64_t notFound = 0;
+    bool failed = false;
+};
+
+bool ParseOptions(int argc, char** argv, LoadOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!value) {
+            std::fprintf(stderr, "Missing value for %s\n", arg.c_str());
+            return false;
+        }
+        ++i;
+        if (arg == "--socket") {
+            options.socketPath = value;
+        } else if (arg == "--connections") {
+            options.connections = std::max<size_t>(1, std::strtoul(value, nullptr, 10));
+        } else if (arg == "--pipeline") {
+            options.pipeline = std::max<size_t>(1, std::strtoul(value, nullptr, 10));
+        } else if (arg == "--seconds") {
+            options.seconds = std::strtod(value, nullptr);
+        } else if (arg == "--op") {
+            options.opName = value;
+            if (options.opName == "lookup") {
+                options.op = LookupOp::Lookup;
+            } else if (options.opName == "search") {
+                options.op = LookupOp::Search;
+            } else if (options.opName == "prefix") {
+                options.op = LookupOp::Prefix;
+            } else if (options.opName == "ping") {
+                options.op = LookupOp::Ping;
+            } else {
+                std::fprintf(stderr, "Unknown op: %s\n", value);
+                return false;
+            }
+        } else if (arg == "--count") {
+            options.book.count = std::strtoull(value, nullptr, 10);
+        } else if (arg == "--seed") {
+            options.book.seed = std::strtoull(value, nullptr, 10);
+        } else if (arg == "--miss") {
+            options.missFraction = std::clamp(std::strtod(value, nullptr), 0.0, 1.0);
+        } else if (arg == "--out") {
+            options.outPath = value;
+        } else {
+            std::fprintf(stderr, "Unknown option: %s\n", arg.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+// SplitMix64: a tiny per-thread generator, enough to pick keys uniformly.
+uint64_t NextRandom(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// What each request asks for: a phone number, a surname or a number prefix.
+std::vector<std::string> BuildKeys(const LoadOptions& options) {
+    SyntheticBook generator(options.book);
+    std::vector<std::string> keys;
+    keys.reserve(options.book.count);
+    for (uint64_t i = 0; i < options.book.count; ++i) {
+        SyntheticContact contact = generator.Generate(i);
+        if (options.op == LookupOp::Search) {
+            size_t space = contact.name.rfind(' ');
+            keys.push_back(space == std::string::npos ? contact.name : contact.name.substr(space + 1));
+        } else if (options.op == LookupOp::Prefix) {
+            keys.push_back(contact.phone.substr(0, 7));
+        } else {
+            keys.push_back(contact.phone);
+        }
+    }
+    return keys;
+}
+
+void RunConnection(const LoadOptions& options, const std::vector<std::string>& keys, uint64_t seed,
+                   Clock::time_point deadline, ConnectionResult& result) {
+    LookupClient client;
+    if (!client.Connect(options.socketPath)) {
+        result.failed = true;
+        return;
+    }
+    uint64_t rng = seed;
+    uint64_t missThreshold = static_cast<uint64_t>(options.missFraction * 18446744073709551615.0);
+    std::unordered_map<uint32_t, Clock::time_point> sentAt;
+    auto sendOne = [&]() {
+        uint64_t pick = NextRandom(rng);
+        uint32_t id;
+        if (options.missFraction > 0.0 && NextRandom(rng) <= missThreshold) {
+            id = client.Send(options.op, "0" + std::to_string(pick % 10000000000ull), 10);
+        } else {
+            id = client.Send(options.op, keys.empty() ? std::string() : keys[pick % keys.size()], 10);
+        }
+        sentAt[id] = Clock::now();
+    };
+
+    for (size_t i = 0; i < options.pipeline; ++i) {
+        sendOne();
+    }
+    LookupResponse response;
+    while (true) {
+        if (!client.Receive(response)) {
+            result.failed = true;
+            return;
+        }
+        Clock::time_point now = Clock::now();
+        auto it = sentAt.find(response.id);
+        if (it != sentAt.end()) {
+            result.micros.push_back(std::chrono::duration<double, std::micro>(now - it->second).count());
+            sentAt.erase(it);
+        }
+        if (response.status == LookupStatus::NotFound) {
+            ++result.notFound;
+        }
+        if (now >= deadline) {
+            break;
+        }
+        sendOne();
+    }
+}
+
+double Percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    size_t rank = static_cast<size_t>(p / 100.0 * static_cast<double>(sorted.size()) + 0.5);
+    rank = std::clamp<size_t>(rank, 1, sorted.size());
+    return sorted[rank - 1];
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    LoadOptions options;
+    if (!ParseOptions(argc, argv, options)) {
+        return 2;
+    }
+    std::vector<std::string> keys = BuildKeys(options);
+
+    std::vector<ConnectionResult> results(options.connections);
+    std::vector<std::thread> threads;
+    Clock::time_point start = Clock::now();
+    Clock::time_point deadline = start + std::chrono::duration_cast<Clock::duration>(
+                                             std::chrono::duration<double>(options.seconds));
+    for (size_t i = 0; i < options.connections; ++i) {
+        threads.emplace_back(RunConnection, std::cref(options), std::cref(keys), options.book.seed + i + 1, deadline,
+                             std::ref(results[i]));
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::vector<double> micros;
+    uint64_t notFound = 0;
+    size_t failed = 0;
+    for (ConnectionResult& result : results) {
+        micros.insert(micros.end(), result.micros.begin(), result.micros.end());
+        notFound += result.notFound;
+        failed += result.failed ? 1 : 0;
+    }
+    std::sort(micros.begin(), micros.end());
+    double qps = elapsed > 0.0 ? static_cast<double>(micros.size()) / elapsed : 0.0;
+
+    char summary[512];
+    std::snprintf(summary, sizeof(summary),
+                  "{\"benchmark\": \"loadgen\", \"op\": \"%s\", \"connections\": %zu, \"pipeline\": %zu, "
+                  "\"seconds\": %.2f, \"requests\": %zu, \"not_found\": %llu, \"failed_connections\": %zu, "
+                  "\"qps\": %.0f, \"p50_us\": %.2f, \"p99_us\": %.2f, \"p999_us\": %.2f, \"max_us\": %.2f}\n",
+                  options.opName.c_str(), options.connections, options.pipeline, elapsed, micros.size(),
+                  static_cast<unsigned long long>(notFound), failed, qps, Percentile(micros, 50),
+                  Percentile(micros, 99), Percentile(micros, 99.9), micros.empty() ? 0.0 : micros.back());
+    std::fputs(summary, stdout);
+    if (!options.outPath.empty()) {
+        std::ofstream out(options.outPath);
+        out << summary;
+    }
+    return failed == 0 ? 0 : 1;
+}
@@ -1,11 +1,13 @@
 #include <wx/wx.h>
 #include "TelephoneBook.hpp"
+#include "WxAdapter.hpp"
 
 class MyApp : public wxApp {
 public:
     virtual bool OnInit() {
         wxLogStderr* logger = new wxLogStderr(); // Create a logger that outputs to stderr (usually the terminal)
         wxLog::SetActiveTarget(logger);
+        InstallWxLogSink(); // Core messages go through wxLog as well
         TelephoneBook* frame = new TelephoneBook("Telephone Book");
         frame->Show(true);
         return true;
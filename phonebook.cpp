@@ -0,0 +1,844 @@
+// phonebook.cpp
+// Headless command-line front end to TelephoneBookLogic for scripts and pipelines.
+// The book is opened once per run and every command reuses it, its read connection
+// and prepared statements, so batch mode answers millions of queries streamed on
+// stdin at close to engine speed. Results are TSV (name, phone, email) or JSON lines.
+//
+// Usage: phonebook [--db contacts.db] [--verbose] COMMAND [ARGS]
+//   add NAME PHONE EMAIL
+//   search QUERY
+//   lookup PHONE
+//   import [--format csv|jsonl] FILE|-
+//   export [--format csv|jsonl]
+//   stats [--metrics]
+//   batch [--format text|jsonl] [--op lookup|search|prefix|structured]
+//
+// Batch text mode reads one query per line for --op. A lookup prints exactly one
+// line per query (empty if the number is unknown); the other operations print their
+// result lines followed by an empty line. Batch jsonl mode reads requests such as
+//   {"id":7,"op":"lookup","phone":"004930123456"}
+//   {"op":"search","query":"smith"}  {"op":"prefix","prefix":"+4930","limit":10}
+//   {"op":"structured","query":"name:ali*"}  {"op":"add","name":..,"phone":..,"email":..}
+// and answers each with one line {"id":7,"ok":true,"count":1,"results":[...]} or
+// {"id":7,"ok":false,"error":"..."}.
+#include "TelephoneBookLogic.hpp"
+#include "CoreLog.hpp"
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+// Contacts handed to ImportContacts at a time: each call commits and reloads the
+// snapshot once, so chunks are large, but bounded to keep huge files streaming.
+const size_t kImportChunk = 1000000;
+
+// Output is collected and written with one fwrite per this many bytes.
+const size_t kOutputFlushBytes = 64 * 1024;
+
+struct CliOptions {
+    std::string dbPath = "contacts.db";
+    bool verbose = false;
+    std::string command;
+    std::vector<std::string> args;
+};
+
+// Buffered stdout. Batch mode flushes it before it blocks on more input, so a
+// script driving phonebook as a coprocess always gets its answers.
+class Output {
+public:
+    ~Output() { Flush(); }
+
+    void Append(std::string_view text) {
+        buffer.append(text);
+        if (buffer.size() >= kOutputFlushBytes) {
+            Flush();
+        }
+    }
+
+    void Flush() {
+        if (!buffer.empty()) {
+            std::fwrite(buffer.data(), 1, buffer.size(), stdout);
+            buffer.clear();
+        }
+        std::fflush(stdout);
+    }
+
+private:
+    std::string buffer;
+};
+
+// Reads lines from a file descriptor with read(2) in large blocks. Unlike fread it
+// returns whatever a pipe has available, and it calls 'beforeBlock' right before
+// waiting for more input.
+class LineReader {
+public:
+    explicit LineReader(int fd) : fd(fd) {}
+
+    template <typename BeforeBlock>
+    bool Next(std::string& line, BeforeBlock beforeBlock) {
+        line.clear();
+        while (true) {
+            size_t newline = buffer.find('\n', start);
+            if (newline != std::string::npos) {
+                line.append(buffer, start, newline - start);
+                start = newline + 1;
+                break;
+            }
+            line.append(buffer, start, std::string::npos);
+            buffer.clear();
+            start = 0;
+            if (eof) {
+                if (line.empty()) {
+                    return false;
+                }
+                break;
+            }
+            beforeBlock();
+            buffer.resize(kOutputFlushBytes);
+            ssize_t got = ::read(fd, buffer.data(), buffer.size());
+            if (got < 0 && errno == EINTR) {
+                buffer.clear();
+                continue;
+            }
+            buffer.resize(got > 0 ? static_cast<size_t>(got) : 0);
+            eof = got <= 0;
+        }
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        return true;
+    }
+
+private:
+    int fd;
+    std::string buffer;
+    size_t start = 0;
+    bool eof = false;
+};
+
+// ---- JSON (flat objects of strings, numbers and literals are all batch mode needs)
+
+void AppendJsonString(std::string& out, std::string_view text) {
+    out.push_back('"');
+    for (char c : text) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char escape[8];
+                    std::snprintf(escape, sizeof(escape), "\\u%04x", static_cast<unsigned>(c));
+                    out += escape;
+                } else {
+                    out.push_back(c); // UTF-8 passes through unchanged
+                }
+        }
+    }
+    out.push_back('"');
+}
+
+struct JsonValue {
+    std::string text; // Decoded string, or the literal as written (number, true, ...)
+    bool isString = false;
+};
+
+void AppendUtf8(std::string& out, uint32_t code) {
+    if (code < 0x80) {
+        out.push_back(static_cast<char>(code));
+    } else if (code < 0x800) {
+        out.push_back(static_cast<char>(0xC0 | (code >> 6)));
+        out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    } else if (code < 0x10000) {
+        out.push_back(static_cast<char>(0xE0 | (code >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    } else {
+        out.push_back(static_cast<char>(0xF0 | (code >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((code >> 12) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    }
+}
+
+class JsonObjectParser {
+public:
+    explicit JsonObjectParser(std::string_view text) : text(text) {}
+
+    // Parses one object whose values are scalars. Returns false (with 'error') on
+    // anything else, including nested objects and arrays.
+    bool Parse(std::map<std::string, JsonValue>& fields, std::string& error) {
+        SkipSpace();
+        if (!Consume('{')) {
+            error = "expected a JSON object";
+            return false;
+        }
+        SkipSpace();
+        if (Consume('}')) {
+            return AtEnd(error);
+        }
+        while (true) {
+            std::string key;
+            JsonValue value;
+            SkipSpace();
+            if (!ParseString(key)) {
+                error = "expected a string key";
+                return false;
+            }
+            SkipSpace();
+            if (!Consume(':')) {
+                error = "expected ':' after \"" + key + "\"";
+                return false;
+            }
+            SkipSpace();
+            if (!ParseValue(value)) {
+                error = "unsupported value for \"" + key + "\"";
+                return false;
+            }
+            fields[key] = std::move(value);
+            SkipSpace();
+            if (Consume('}')) {
+                return AtEnd(error);
+            }
+            if (!Consume(',')) {
+                error = "expected ',' or '}'";
+                return false;
+            }
+        }
+    }
+
+private:
+    void SkipSpace() {
+        while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\r' || text[pos] == '\n')) {
+            ++pos;
+        }
+    }
+
+    bool Consume(char c) {
+        if (pos < text.size() && text[pos] == c) {
+            ++pos;
+            return true;
+        }
+        return false;
+    }
+
+    bool AtEnd(std::string& error) {
+        SkipSpace();
+        if (pos != text.size()) {
+            error = "trailing characters after the object";
+            return false;
+        }
+        return true;
+    }
+
+    bool ParseHex4(uint32_t& code) {
+        if (pos + 4 > text.size()) {
+            return false;
+        }
+        code = 0;
+        for (int i = 0; i < 4; ++i) {
+            char c = text[pos++];
+            code <<= 4;
+            if (c >= '0' && c <= '9') {
+                code |= static_cast<uint32_t>(c - '0');
+            } else if (c >= 'a' && c <= 'f') {
+                code |= static_cast<uint32_t>(c - 'a' + 10);
+            } else if (c >= 'A' && c <= 'F') {
+                code |= static_cast<uint32_t>(c - 'A' + 10);
+            } else {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool ParseString(std::string& out) {
+        if (!Consume('"')) {
+            return false;
+        }
+        while (pos < text.size()) {
+            char c = text[pos++];
+            if (c == '"') {
+                return true;
+            }
+            if (c != '\\') {
+                out.push_back(c);
+                continue;
+            }
+            if (pos >= text.size()) {
+                return false;
+            }
+            char escape = text[pos++];
+            switch (escape) {
+                case '"': out.push_back('"'); break;
+                case '\\': out.push_back('\\'); break;
+                case '/': out.push_back('/'); break;
+                case 'b': out.push_back('\b'); break;
+                case 'f': out.push_back('\f'); break;
+                case 'n': out.push_back('\n'); break;
+                case 'r': out.push_back('\r'); break;
+                case 't': out.push_back('\t'); break;
+                case 'u': {
+                    uint32_t code = 0;
+                    if (!ParseHex4(code)) {
+                        return false;
+                    }
+                    // A surrogate pair encodes one code point above U+FFFF
+                    if (code >= 0xD800 && code < 0xDC00 && text.substr(pos, 2) == "\\u") {
+                        pos += 2;
+                        uint32_t low = 0;
+                        if (!ParseHex4(low) || low < 0xDC00 || low > 0xDFFF) {
+                            return false;
+                        }
+                        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                    }
+                    AppendUtf8(out, code);
+                    break;
+                }
+                default:
+                    return false;
+            }
+        }
+        return false;
+    }
+
+    bool ParseValue(JsonValue& value) {
+        if (pos < text.size() && text[pos] == '"') {
+            value.isString = true;
+            return ParseString(value.text);
+        }
+        size_t begin = pos;
+        while (pos < text.size() && (std::isalnum(static_cast<unsigned char>(text[pos])) || text[pos] == '-' ||
+                                     text[pos] == '+' || text[pos] == '.')) {
+            ++pos;
+        }
+        value.text.assign(text.substr(begin, pos - begin));
+        return !value.text.empty();
+    }
+
+    std::string_view text;
+    size_t pos = 0;
+};
+
+// ---- CSV (RFC 4180 quoting; a "name,phone,email" header line is skipped)
+
+bool ParseCsvLine(const std::string& line, std::vector<std::string>& fields) {
+    fields.assign(1, std::string());
+    bool quoted = false;
+    for (size_t i = 0; i < line.size(); ++i) {
+        char c = line[i];
+        if (quoted) {
+            if (c == '"' && i + 1 < line.size() && line[i + 1] == '"') {
+                fields.back().push_back('"');
+                ++i;
+            } else if (c == '"') {
+                quoted = false;
+            } else {
+                fields.back().push_back(c);
+            }
+        } else if (c == '"') {
+            quoted = true;
+        } else if (c == ',') {
+            fields.emplace_back();
+        } else {
+            fields.back().push_back(c);
+        }
+    }
+    return !quoted;
+}
+
+void AppendCsvField(std::string& out, const std::string& field) {
+    if (field.find_first_of(",\"\r\n") == std::string::npos) {
+        out += field;
+        return;
+    }
+    out.push_back('"');
+    for (char c : field) {
+        if (c == '"') {
+            out.push_back('"');
+        }
+        out.push_back(c);
+    }
+    out.push_back('"');
+}
+
+// ---- Result formatting
+
+void AppendTsv(std::string& out, const Contact& contact) {
+    out += contact.GetName();
+    out.push_back('\t');
+    out += contact.GetPhone();
+    out.push_back('\t');
+    out += contact.GetEmail();
+    out.push_back('\n');
+}
+
+void AppendJsonContact(std::string& out, const Contact& contact) {
+    out += "{\"name\":";
+    AppendJsonString(out, contact.GetName());
+    out += ",\"phone\":";
+    AppendJsonString(out, contact.GetPhone());
+    out += ",\"email\":";
+    AppendJsonString(out, contact.GetEmail());
+    out.push_back('}');
+}
+
+int Usage() {
+    std::fprintf(stderr,
+                 "Usage: phonebook [--db contacts.db] [--verbose] COMMAND [ARGS]\n"
+                 "  add NAME PHONE EMAIL\n"
+                 "  search QUERY\n"
+                 "  lookup PHONE\n"
+                 "  import [--format csv|jsonl] FILE|-\n"
+                 "  export [--format csv|jsonl]\n"
+                 "  stats [--metrics]\n"
+                 "  batch [--format text|jsonl] [--op lookup|search|prefix|structured]\n");
+    return 2;
+}
+
+bool ParseOptions(int argc, char** argv, CliOptions& options) {
+    int i = 1;
+    for (; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--db" && i + 1 < argc) {
+            options.dbPath = argv[++i];
+        } else if (arg == "--verbose") {
+            options.verbose = true;
+        } else if (arg.rfind("--", 0) == 0) {
+            std::fprintf(stderr, "Unknown option: %s\n", arg.c_str());
+            return false;
+        } else {
+            break;
+        }
+    }
+    if (i >= argc) {
+        return false;
+    }
+    options.command = argv[i];
+    options.args.assign(argv + i + 1, argv + argc);
+    return true;
+}
+
+// Splits "--name value" pairs off the front of 'args'; the rest stays positional.
+bool TakeFlags(std::vector<std::string>& args, std::map<std::string, std::string>& flags,
+               std::initializer_list<const char*> valued, std::initializer_list<const char*> bare = {}) {
+    std::vector<std::string> positional;
+    for (size_t i = 0; i < args.size(); ++i) {
+        const std::string& arg = args[i];
+        if (arg.size() > 2 && arg.rfind("--", 0) == 0) {
+            bool known = false;
+            for (const char* name : valued) {
+                if (arg == name && i + 1 < args.size()) {
+                    flags[arg] = args[++i];
+                    known = true;
+                    break;
+                }
+            }
+            for (const char* name : bare) {
+                if (!known && arg == name) {
+                    flags[arg] = "1";
+                    known = true;
+                }
+            }
+            if (!known) {
+                std::fprintf(stderr, "Unknown or incomplete option: %s\n", arg.c_str());
+                return false;
+            }
+        } else {
+            positional.push_back(arg);
+        }
+    }
+    args = std::move(positional);
+    return true;
+}
+
+std::string FlagOr(const std::map<std::string, std::string>& flags, const char* name, const char* fallback) {
+    auto it = flags.find(name);
+    return it == flags.end() ? fallback : it->second;
+}
+
+// ---- Commands
+
+int RunAdd(TelephoneBookLogic& book, const std::vector<std::string>& args) {
+    if (args.size() != 3) {
+        return Usage();
+    }
+    return book.AddContact(Contact(args[0], args[1], args[2])) ? 0 : 1;
+}
+
+int RunSearch(TelephoneBookLogic& book, const std::vector<std::string>& args) {
+    if (args.size() != 1) {
+        return Usage();
+    }
+    Output out;
+    std::string text;
+    for (const Contact& contact : book.SearchContacts(args[0])) {
+        text.clear();
+        AppendTsv(text, contact);
+        out.Append(text);
+    }
+    return 0;
+}
+
+int RunLookup(TelephoneBookLogic& book, const std::vector<std::string>& args) {
+    if (args.size() != 1) {
+        return Usage();
+    }
+    std::optional<Contact> found = book.FindByPhone(args[0]);
+    if (!found) {
+        return 1;
+    }
+    std::string text;
+    AppendTsv(text, *found);
+    Output out;
+    out.Append(text);
+    return 0;
+}
+
+int RunImport(TelephoneBookLogic& book, std::vector<std::string> args) {
+    std::map<std::string, std::string> flags;
+    if (!TakeFlags(args, flags, {"--format"}) || args.size() != 1) {
+        return Usage();
+    }
+    bool jsonl = FlagOr(flags, "--format", "csv") == "jsonl";
+    int fd = 0;
+    if (args[0] != "-") {
+        fd = ::open(args[0].c_str(), O_RDONLY);
+        if (fd < 0) {
+            std::fprintf(stderr, "Cannot open %s: %s\n", args[0].c_str(), std::strerror(errno));
+            return 1;
+        }
+    }
+
+    LineReader reader(fd);
+    std::string line;
+    std::vector<std::string> fields;
+    std::vector<Contact> chunk;
+    std::vector<size_t> chunkLines; // Input line of every contact in 'chunk'
+    std::vector<ImportIssue> rejected;
+    size_t lineNumber = 0;
+    size_t read = 0;
+    size_t inserted = 0;
+    size_t invalid = 0;
+    size_t malformed = 0;
+
+    auto flush = [&]() {
+        rejected.clear();
+        inserted += book.ImportContacts(chunk, &rejected);
+        for (const ImportIssue& issue : rejected) {
+            std::fprintf(stderr, "line %zu: %s\n", chunkLines[issue.index], DescribeContactErrors(issue.errors).c_str());
+        }
+        invalid += rejected.size();
+        chunk.clear();
+        chunkLines.clear();
+    };
+
+    while (reader.Next(line, [] {})) {
+        ++lineNumber;
+        if (line.empty()) {
+            continue;
+        }
+        std::string error;
+        if (jsonl) {
+            std::map<std::string, JsonValue> object;
+            if (!JsonObjectParser(line).Parse(object, error)) {
+                std::fprintf(stderr, "line %zu: %s\n", lineNumber, error.c_str());
+                ++malformed;
+                continue;
+            }
+            chunk.emplace_back(object["name"].text, object["phone"].text, object["email"].text);
+        } else {
+            if (!ParseCsvLine(line, fields) || fields.size() != 3) {
+                std::fprintf(stderr, "line %zu: expected name,phone,email\n", lineNumber);
+                ++malformed;
+                continue;
+            }
+            if (lineNumber == 1 && fields[0] == "name" && fields[1] == "phone" && fields[2] == "email") {
+                continue;
+            }
+            chunk.emplace_back(std::move(fields[0]), std::move(fields[1]), std::move(fields[2]));
+        }
+        chunkLines.push_back(lineNumber);
+        ++read;
+        if (chunk.size() >= kImportChunk) {
+            flush();
+        }
+    }
+    if (!chunk.empty()) {
+        flush();
+    }
+    if (fd != 0) {
+        ::close(fd);
+    }
+
+    std::fprintf(stderr, "Imported %zu of %zu contacts (%zu invalid, %zu duplicates, %zu malformed lines).\n",
+                 inserted, read, invalid, read - inserted - invalid, malformed);
+    return invalid == 0 && malformed == 0 ? 0 : 1;
+}
+
+int RunExport(TelephoneBookLogic& book, std::vector<std::string> args) {
+    std::map<std::string, std::string> flags;
+    if (!TakeFlags(args, flags, {"--format"}) || !args.empty()) {
+        return Usage();
+    }
+    bool jsonl = FlagOr(flags, "--format", "csv") == "jsonl";
+    TelephoneBookLogic::ContactSnapshot contacts = book.GetSnapshot();
+    Output out;
+    std::string text;
+    if (!jsonl) {
+        out.Append("name,phone,email\n");
+    }
+    for (const Contact& contact : *contacts) {
+        text.clear();
+        if (jsonl) {
+            AppendJsonContact(text, contact);
+            text.push_back('\n');
+        } else {
+            AppendCsvField(text, contact.GetName());
+            text.push_back(',');
+            AppendCsvField(text, contact.GetPhone());
+            text.push_back(',');
+            AppendCsvField(text, contact.GetEmail());
+            text.push_back('\n');
+        }
+        out.Append(text);
+    }
+    return 0;
+}
+
+int RunStats(TelephoneBookLogic& book, std::vector<std::string> args) {
+    std::map<std::string, std::string> flags;
+    if (!TakeFlags(args, flags, {}, {"--metrics"}) || !args.empty()) {
+        return Usage();
+    }
+    std::string text;
+    char line[256];
+    std::snprintf(line, sizeof(line), "contacts\t%zu\n", book.GetSnapshot()->size());
+    text += line;
+
+    std::vector<std::pair<std::string, size_t>> domains = book.DomainHistogram();
+    std::snprintf(line, sizeof(line), "email_domains\t%zu\n", domains.size());
+    text += line;
+    for (size_t i = 0; i < domains.size() && i < 10; ++i) {
+        text += "domain\t" + domains[i].first + "\t" + std::to_string(domains[i].second) + "\n";
+    }
+
+    if (flags.count("--metrics")) {
+        text += book.GetMetrics().ToPrometheusText();
+    }
+    Output out;
+    out.Append(text);
+    return 0;
+}
+
+enum class BatchOp {
+    Lookup,
+    Search,
+    Prefix,
+    Structured
+};
+
+bool ParseBatchOp(const std::string& name, BatchOp& op) {
+    if (name == "lookup") {
+        op = BatchOp::Lookup;
+    } else if (name == "search") {
+        op = BatchOp::Search;
+    } else if (name == "prefix") {
+        op = BatchOp::Prefix;
+    } else if (name == "structured") {
+        op = BatchOp::Structured;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+std::vector<Contact> RunQuery(TelephoneBookLogic& book, BatchOp op, const std::string& query, size_t limit) {
+    switch (op) {
+        case BatchOp::Lookup: {
+            std::optional<Contact> found = book.FindByPhone(query);
+            return found ? std::vector<Contact>{*found} : std::vector<Contact>();
+        }
+        case BatchOp::Search: {
+            std::vector<Contact> results = book.SearchContacts(query);
+            if (results.size() > limit) {
+                results.resize(limit);
+            }
+            return results;
+        }
+        case BatchOp::Prefix:
+            return book.SearchByPhonePrefix(query, limit);
+        case BatchOp::Structured: {
+            std::vector<Contact> results = book.SearchStructured(query);
+            if (results.size() > limit) {
+                results.resize(limit);
+            }
+            return results;
+        }
+    }
+    return {};
+}
+
+// Answers one JSON-lines request into 'response' (without the newline).
+void AnswerJson(TelephoneBookLogic& book, const std::string& request, std::string& response) {
+    std::map<std::string, JsonValue> fields;
+    std::string error;
+    bool parsed = JsonObjectParser(request).Parse(fields, error);
+
+    response = "{";
+    auto id = fields.find("id");
+    if (id != fields.end()) {
+        response += "\"id\":";
+        if (id->second.isString) {
+            AppendJsonString(response, id->second.text);
+        } else {
+            response += id->second.text;
+        }
+        response.push_back(',');
+    }
+    auto fail = [&response](const std::string& message) {
+        response += "\"ok\":false,\"error\":";
+        AppendJsonString(response, message);
+        response.push_back('}');
+    };
+    if (!parsed) {
+        fail(error);
+        return;
+    }
+
+    const std::string& opName = fields["op"].text;
+    if (opName == "add") {
+        Contact contact(fields["name"].text, fields["phone"].text, fields["email"].text);
+        uint32_t errors = contact.Validate();
+        if (errors != kContactFieldsValid) {
+            fail(DescribeContactErrors(errors));
+        } else if (!book.AddContact(contact)) {
+            fail("not added (duplicate phone number?)");
+        } else {
+            response += "\"ok\":true,\"count\":1}";
+        }
+        return;
+    }
+
+    BatchOp op;
+    if (!ParseBatchOp(opName, op)) {
+        fail("unknown op \"" + opName + "\"");
+        return;
+    }
+    const char* argument = op == BatchOp::Lookup ? "phone" : op == BatchOp::Prefix ? "prefix" : "query";
+    auto value = fields.find(argument);
+    if (value == fields.end()) {
+        fail(std::string("missing \"") + argument + "\"");
+        return;
+    }
+    size_t limit = SIZE_MAX;
+    auto limitField = fields.find("limit");
+    if (limitField != fields.end()) {
+        limit = std::strtoull(limitField->second.text.c_str(), nullptr, 10);
+    }
+
+    std::vector<Contact> results = RunQuery(book, op, value->second.text, limit);
+    response += "\"ok\":true,\"count\":" + std::to_string(results.size()) + ",\"results\":[";
+    for (size_t i = 0; i < results.size(); ++i) {
+        if (i > 0) {
+            response.push_back(',');
+        }
+        AppendJsonContact(response, results[i]);
+    }
+    response += "]}";
+}
+
+int RunBatch(TelephoneBookLogic& book, std::vector<std::string> args) {
+    std::map<std::string, std::string> flags;
+    if (!TakeFlags(args, flags, {"--format", "--op"}) || !args.empty()) {
+        return Usage();
+    }
+    bool jsonl = FlagOr(flags, "--format", "text") == "jsonl";
+    BatchOp op;
+    if (!ParseBatchOp(FlagOr(flags, "--op", "lookup"), op)) {
+        return Usage();
+    }
+
+    Output out;
+    LineReader reader(0);
+    std::string line;
+    std::string text;
+    // Answers already produced are written out before waiting for more queries
+    auto beforeBlock = [&out]() { out.Flush(); };
+    while (reader.Next(line, beforeBlock)) {
+        text.clear();
+        if (jsonl) {
+            if (line.empty()) {
+                continue;
+            }
+            AnswerJson(book, line, text);
+            text.push_back('\n');
+        } else if (op == BatchOp::Lookup) {
+            std::optional<Contact> found = book.FindByPhone(line);
+            if (found) {
+                AppendTsv(text, *found);
+            } else {
+                text.push_back('\n');
+            }
+        } else {
+            for (const Contact& contact : RunQuery(book, op, line, SIZE_MAX)) {
+                AppendTsv(text, contact);
+            }
+            text.push_back('\n');
+        }
+        out.Append(text);
+    }
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    CliOptions options;
+    if (!ParseOptions(argc, argv, options)) {
+        return Usage();
+    }
+    // stdout carries results only; errors (and with --verbose, messages) go to stderr
+    bool verbose = options.verbose;
+    SetLogSink([verbose](LogLevel level, const std::string& text) {
+        if (level == LogLevel::Error || verbose) {
+            std::fprintf(stderr, "%s%s\n", level == LogLevel::Error ? "Error: " : "", text.c_str());
+        }
+    });
+
+    // One read connection is enough for a single client and keeps its statement cache warm
+    TelephoneBookLogic book(options.dbPath, ConcurrencyMode::MultiReader, 1);
+
+    const std::string& command = options.command;
+    if (command == "add") {
+        return RunAdd(book, options.args);
+    } else if (command == "search") {
+        return RunSearch(book, options.args);
+    } else if (command == "lookup") {
+        return RunLookup(book, options.args);
+    } else if (command == "import") {
+        return RunImport(book, options.args);
+    } else if (command == "export") {
+        return RunExport(book, options.args);
+    } else if (command == "stats") {
+        return RunStats(book, options.args);
+    } else if (command == "batch") {
+        return RunBatch(book, options.args);
+    }
+    std::fprintf(stderr, "Unknown command: %s\n", command.c_str());
+    return Usage();
+}
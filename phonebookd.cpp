@@ -0,0 +1,108 @@
+// phonebookd.cpp
+// Lookup daemon: holds one in-memory book and serves caller-ID lookups and searches
+// to any number of local processes over a Unix domain socket (see LookupServer.hpp
+// for the event loop and LookupProtocol.hpp for the wire format). Runs until SIGINT
+// or SIGTERM, then prints its request counters.
+//
+// Usage: phonebookd [--db contacts.db] [--socket phonebookd.sock] [--workers N]
+//                   [--metrics-file phonebookd.prom] [--shm /phonebook]
+//
+// With --shm the phone -> name table is also kept in a shared-memory segment, where
+// processes on the same host look numbers up without going through the socket
+// (SharedPhoneTableReader).
+//
+// Contacts changed in the database by other programs (the GUI, the sqlite3 shell)
+// show up within a moment: the daemon watches the database files and applies the
+// logged changes to its book.
+#include "TelephoneBookLogic.hpp"
+#include "LookupServer.hpp"
+#include "CoreLog.hpp"
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+namespace {
+
+struct DaemonOptions {
+    std::string dbPath = "contacts.db";
+    LookupServerConfig server;
+    std::string metricsPath; // Empty = no Prometheus dump
+    std::string shmName;     // Empty = no shared-memory phone table
+};
+
+bool ParseOptions(int argc, char** argv, DaemonOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!value) {
+            std::fprintf(stderr, "Missing value for %s\n", arg.c_str());
+            return false;
+        }
+        ++i;
+        if (arg == "--db") {
+            options.dbPath = value;
+        } else if (arg == "--socket") {
+            options.server.socketPath = value;
+        } else if (arg == "--workers") {
+            options.server.workers = std::strtoul(value, nullptr, 10);
+        } else if (arg == "--metrics-file") {
+            options.metricsPath = value;
+        } else if (arg == "--shm") {
+            options.shmName = value;
+        } else {
+            std::fprintf(stderr, "Unknown option: %s\n", arg.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    DaemonOptions options;
+    if (!ParseOptions(argc, argv, options)) {
+        std::fprintf(stderr, "Usage: phonebookd [--db contacts.db] [--socket phonebookd.sock] [--workers N] "
+                             "[--metrics-file phonebookd.prom] [--shm /phonebook]\n");
+        return 2;
+    }
+
+    // Block the shutdown signals before any thread starts, so all of them inherit the
+    // mask and only sigwait() below sees the signal
+    sigset_t shutdownSignals;
+    sigemptyset(&shutdownSignals);
+    sigaddset(&shutdownSignals, SIGINT);
+    sigaddset(&shutdownSignals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &shutdownSignals, nullptr);
+
+    // Searches run on the worker threads, each with its own pooled read connection
+    TelephoneBookLogic book(options.dbPath, ConcurrencyMode::MultiReader, options.server.workers);
+    if (!options.metricsPath.empty()) {
+        book.StartMetricsDump(options.metricsPath);
+    }
+    if (!options.shmName.empty() && !book.StartPhoneTablePublishing(options.shmName)) {
+        return 1;
+    }
+    book.StartChangeWatch();
+    LookupServer server(book, options.server);
+    if (!server.Start()) {
+        return 1;
+    }
+    LogMessage("phonebookd serving %zu contacts on %s", book.GetSnapshot()->size(),
+               options.server.socketPath.c_str());
+
+    int signal = 0;
+    sigwait(&shutdownSignals, &signal);
+    server.Stop();
+    book.StopChangeWatch();
+    book.StopMetricsDump();
+
+    LookupServerStats stats = server.GetStats();
+    LogMessage("phonebookd stopped: %llu requests (%llu inline, %llu bad) on %llu connections, "
+               "reading paused %llu times",
+               static_cast<unsigned long long>(stats.requests), static_cast<unsigned long long>(stats.inlineAnswers),
+               static_cast<unsigned long long>(stats.badRequests), static_cast<unsigned long long>(stats.accepted),
+               static_cast<unsigned long long>(stats.backpressured));
+    return 0;
+}
@@ -0,0 +1,127 @@
+// replica.cpp
+// Follower process: keeps a read-only copy of a book up to date by applying the
+// primary's change log (see BookReplica.hpp). Bootstraps from a copy of the primary
+// when needed, then follows every write within a moment until SIGINT or SIGTERM.
+//
+// Usage: replica --primary contacts.db --replica replica.db [--batch N]
+//                [--interval-ms N] [--metrics-file replica.prom] [--once] [--resync]
+//
+// --once catches up and exits (e.g. from cron); --resync copies the primary again
+// first, to repair a replica bookverify reports as different; --metrics-file rewrites
+// the lag and batch counters in Prometheus text format every interval.
+#include "BookReplica.hpp"
+#include "CoreLog.hpp"
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <string>
+
+namespace {
+
+struct ReplicaOptions {
+    std::string primaryPath;
+    std::string replicaPath;
+    ReplicaConfig config;
+    std::string metricsPath; // Empty = no Prometheus dump
+    bool once = false;
+    bool resync = false;
+};
+
+bool ParseOptions(int argc, char** argv, ReplicaOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--once") {
+            options.once = true;
+            continue;
+        }
+        if (arg == "--resync") {
+            options.resync = true;
+            continue;
+        }
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!value) {
+            std::fprintf(stderr, "Missing value for %s\n", arg.c_str());
+            return false;
+        }
+        ++i;
+        if (arg == "--primary") {
+            options.primaryPath = value;
+        } else if (arg == "--replica") {
+            options.replicaPath = value;
+        } else if (arg == "--batch") {
+            options.config.batchSize = std::strtoul(value, nullptr, 10);
+        } else if (arg == "--interval-ms") {
+            options.config.pollInterval = std::chrono::milliseconds(std::strtoul(value, nullptr, 10));
+        } else if (arg == "--metrics-file") {
+            options.metricsPath = value;
+        } else {
+            std::fprintf(stderr, "Unknown option: %s\n", arg.c_str());
+            return false;
+        }
+    }
+    return !options.primaryPath.empty() && !options.replicaPath.empty();
+}
+
+bool WriteMetrics(const std::string& path, const ReplicaStats& stats) {
+    std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream out(tmpPath, std::ios::trunc);
+        out << stats.ToPrometheusText();
+        if (!out) {
+            return false;
+        }
+    }
+    return std::rename(tmpPath.c_str(), path.c_str()) == 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    ReplicaOptions options;
+    if (!ParseOptions(argc, argv, options)) {
+        std::fprintf(stderr, "Usage: replica --primary contacts.db --replica replica.db [--batch N] "
+                             "[--interval-ms N] [--metrics-file replica.prom] [--once] [--resync]\n");
+        return 2;
+    }
+
+    // As in phonebookd: only the main thread takes the shutdown signals
+    sigset_t shutdownSignals;
+    sigemptyset(&shutdownSignals);
+    sigaddset(&shutdownSignals, SIGINT);
+    sigaddset(&shutdownSignals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &shutdownSignals, nullptr);
+
+    BookReplica replica(options.primaryPath, options.replicaPath, options.config);
+    if (!(options.resync ? replica.Resync() : replica.CatchUp())) {
+        return 1;
+    }
+    ReplicaStats stats = replica.GetStats();
+    LogMessage("Replica %s at sequence %llu with %zu contacts", options.replicaPath.c_str(),
+               static_cast<unsigned long long>(stats.appliedSequence), replica.GetBook().GetSnapshot()->size());
+    if (options.once) {
+        return options.metricsPath.empty() || WriteMetrics(options.metricsPath, stats) ? 0 : 1;
+    }
+
+    replica.Start();
+    timespec interval{};
+    interval.tv_sec = static_cast<time_t>(options.config.pollInterval.count() / 1000);
+    interval.tv_nsec = static_cast<long>(options.config.pollInterval.count() % 1000 * 1000000);
+    for (;;) {
+        if (!options.metricsPath.empty()) {
+            WriteMetrics(options.metricsPath, replica.GetStats());
+        }
+        if (sigtimedwait(&shutdownSignals, nullptr, &interval) >= 0) {
+            break;
+        }
+    }
+    replica.Stop();
+
+    stats = replica.GetStats();
+    LogMessage("replica stopped at sequence %llu: %llu changes in %llu batches, %llu bootstraps, %llu divergences",
+               static_cast<unsigned long long>(stats.appliedSequence),
+               static_cast<unsigned long long>(stats.changesApplied), static_cast<unsigned long long>(stats.batches),
+               static_cast<unsigned long long>(stats.bootstraps), static_cast<unsigned long long>(stats.divergences));
+    return 0;
+}
@@ -0,0 +1,134 @@
+// stress_test.cpp
+// Concurrency stress test for TelephoneBookLogic in MultiReader mode.
+// Several reader threads search (through the read connection pool) and look up
+// contacts while one writer thread keeps adding, editing and deleting. Build with
+// -DTELEPHONEBOOK_ENABLE_TSAN=ON to run it under ThreadSanitizer; any data race is
+// reported there and fails the test.
+#include "TelephoneBookLogic.hpp"
+#include "Contact.hpp"
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const int kReaderThreads = 4;
+const int kWriterRounds = 200;
+
+std::string PhoneFor(int i) {
+    char phone[16];
+    std::snprintf(phone, sizeof(phone), "0049%07d", i); // 11 digits
+    return phone;
+}
+
+} // namespace
+
+int main() {
+    std::string dbPath = "stress_phonebook.db";
+    for (const char* suffix : {"", "-wal", "-shm"}) {
+        std::filesystem::remove(dbPath + suffix);
+    }
+
+    int failures = 0;
+    {
+        // Fewer pooled connections than readers, so checkouts also exercise the wait path.
+        TelephoneBookLogic phonebook(dbPath, ConcurrencyMode::MultiReader, kReaderThreads / 2);
+
+        // A few contacts that are never modified, so readers always have something to find.
+        for (int i = 0; i < 10; ++i) {
+            phonebook.AddContact(Contact("Stable " + std::to_string(i), PhoneFor(i), "stable@example.com"));
+        }
+
+        std::atomic<bool> done{false};
+        std::atomic<int> readerErrors{0};
+        std::atomic<long> readerOps{0};
+
+        std::vector<std::thread> readers;
+        for (int t = 0; t < kReaderThreads; ++t) {
+            readers.emplace_back([&, t]() {
+                int i = 0;
+                while (!done.load(std::memory_order_acquire)) {
+                    // Snapshot reads: the list must be internally consistent while we hold it.
+                    TelephoneBookLogic::ContactSnapshot snap = phonebook.GetSnapshot();
+                    size_t stable = 0;
+                    for (const Contact& c : *snap) {
+                        if (c.GetName().starts_with("Stable")) {
+                            ++stable;
+                        }
+                    }
+                    if (stable != 10) {
+                        ++readerErrors;
+                    }
+
+                    // Lock-free lookup of a contact that must always exist.
+                    std::optional<Contact> found = phonebook.FindByPhone(PhoneFor((i + t) % 10));
+                    if (!found || found->GetPhone() != PhoneFor((i + t) % 10)) {
+                        ++readerErrors;
+                    }
+
+                    // SQL search on a pooled read connection.
+                    if (phonebook.SearchContacts("Stable").size() != 10) {
+                        ++readerErrors;
+                    }
+
+                    // Fuzzy search; the writer patches the index as it publishes.
+                    if (phonebook.FuzzySearchContacts("Stabel", 2, 100).size() != 10) {
+                        ++readerErrors;
+                    }
+
+                    // Name word index: built by the first reader, then patched by the writer.
+                    if (phonebook.SearchStructured("name:stable").size() != 10) {
+                        ++readerErrors;
+                    }
+
+                    // Domain index, updated in place by the writer (churn rows share the domain).
+                    if (phonebook.SearchByEmailDomain("example.com").size() < 10) {
+                        ++readerErrors;
+                    }
+                    ++readerOps;
+                    ++i;
+                }
+            });
+        }
+
+        // Single writer: churn a set of contacts that readers do not depend on.
+        for (int round = 0; round < kWriterRounds; ++round) {
+            std::string phone = PhoneFor(1000 + round);
+            phonebook.AddContact(Contact("Churn", phone, "churn@example.com"));
+            phonebook.EditContact("Churn", phone, Contact("Churn Edited", phone, "edited@example.com"));
+            if (round % 2 == 0) {
+                phonebook.DeleteContact("Churn Edited", phone);
+            }
+            if (round % 25 == 0) {
+                phonebook.SortContactsByName();
+            }
+        }
+
+        done.store(true, std::memory_order_release);
+        for (std::thread& reader : readers) {
+            reader.join();
+        }
+
+        size_t expected = 10 + kWriterRounds / 2;
+        std::cout << "Reader operations: " << readerOps.load() << std::endl;
+        std::cout << "Reader consistency errors: " << readerErrors.load() << std::endl;
+        std::cout << "Final contact count: " << phonebook.GetSnapshot()->size()
+                  << " (expected " << expected << ")" << std::endl;
+        ConnectionPoolStats pool = phonebook.GetReadPoolStats();
+        std::cout << "Read pool: " << pool.opened << "/" << pool.capacity << " connections, "
+                  << pool.checkouts << " checkouts, " << pool.waits << " waits ("
+                  << pool.totalWaitNanos / 1000000 << " ms), statement cache "
+                  << pool.statementCacheHits << " hits / " << pool.statementCacheMisses << " misses" << std::endl;
+        SearchCacheStats cache = phonebook.GetSearchCacheStats();
+        std::cout << "Search result cache: " << cache.hits << " hits / " << cache.misses << " misses, "
+                  << cache.invalidated << " invalidated" << std::endl;
+        failures = readerErrors.load() + (phonebook.GetSnapshot()->size() == expected ? 0 : 1);
+    }
+
+    std::cout << (failures == 0 ? "SUCCESS" : "FAILURE") << std::endl;
+    return failures == 0 ? 0 : 1;
+}
@@ -1,27 +1,28 @@
 // test.cpp
 #include "TelephoneBookLogic.hpp"
 #include "Contact.hpp"
-#include <wx/app.h> // Needed for wx initialization
-#include <wx/log.h> // For wxLogError messages
-#include <wx/string.h>
+#include "SyntheticBook.hpp"
+#include "Collation.hpp"
+#include "CoreLog.hpp"
+#include "PhonePrefixIndex.hpp"
+#include "LookupServer.hpp"
+#include "LookupClient.hpp"
+#include "SharedPhoneTable.hpp"
+#include "PhoneHashIndex.hpp"
+#include "ShardedBook.hpp"
+#include "BookReplica.hpp"
+#include "BookChecksum.hpp"
+#include "BookDiff.hpp"
 #include <iostream>
 #include <filesystem>
+#include <map>
+#include <thread>
 #include <vector> // Required for std::vector
 
-class DummyApp : public wxApp {
-public:
-    virtual bool OnInit() override { return true; }
-};
-
-wxIMPLEMENT_APP_NO_MAIN(DummyApp);
-
-int main(int argc, char** argv) {
-    wxEntryStart(argc, argv);
-    wxTheApp->CallOnInit();
-
-    wxString dbPath = "test_phonebook.db";
-    if (std::filesystem::exists(dbPath.ToStdString())) {
-        std::filesystem::remove(dbPath.ToStdString());
+int main() {
+    std::string dbPath = "test_phonebook.db";
+    if (std::filesystem::exists(dbPath)) {
+        std::filesystem::remove(dbPath);
     }
     TelephoneBookLogic phonebook(dbPath);
 
@@ -115,7 +116,781 @@ int main(int argc, char** argv) {
               << (phonebook.DeleteContact("Bob Jones", "98765432109") ? "Success" : "Failure")
               << std::endl;
 
-    // Clean up
-    wxEntryCleanup();
+    // --- Test 5: Metrics ---
+    std::cout << "\n--- Testing metrics ---" << std::endl;
+    MetricsSnapshot metrics = phonebook.GetMetrics();
+    std::cout << "Add latency recorded: "
+              << (metrics.For(MetricOp::Add).count >= 2 ? "SUCCESS" : "FAILURE") << std::endl;
+    std::cout << "Search latency recorded: "
+              << (metrics.For(MetricOp::Search).count == 1 ? "SUCCESS" : "FAILURE") << std::endl;
+    std::cout << "SQLite steps counted: " << (metrics.sqliteSteps > 0 ? "SUCCESS" : "FAILURE") << std::endl;
+    std::string prometheus = metrics.ToPrometheusText();
+    std::cout << "Prometheus text export: "
+              << (prometheus.find("phonebook_operation_duration_seconds_count{op=\"add\"}") != std::string::npos
+                      ? "SUCCESS" : "FAILURE") << std::endl;
+
+    // --- Test 6: Synthetic contacts are valid ---
+    std::cout << "\n--- Testing synthetic book generator ---" << std::endl;
+    SyntheticBookConfig config;
+    config.unicodeFraction = 0.3;
+    config.duplicateFraction = 0.2;
+    SyntheticBook generator(config);
+    int invalidSynthetic = 0;
+    for (uint64_t i = 0; i < 1000; ++i) {
+        SyntheticContact c = generator.Generate(i);
+        Contact probe;
+        if (c.name.empty() ||
+            !probe.IsValidPhone(c.phone) ||
+            !probe.IsValidEmail(c.email)) {
+            ++invalidSynthetic;
+        }
+    }
+    std::cout << "Synthetic contacts valid: " << (invalidSynthetic == 0 ? "SUCCESS" : "FAILURE") << std::endl;
+    bool deterministic = generator.Generate(123).name == SyntheticBook(config).Generate(123).name &&
+                         generator.Generate(123).phone == SyntheticBook(config).Generate(123).phone;
+    std::cout << "Synthetic contacts deterministic: " << (deterministic ? "SUCCESS" : "FAILURE") << std::endl;
+
+    // --- Test 7: Query profiler ---
+    std::cout << "\n--- Testing query profiler ---" << std::endl;
+    std::cout << "Profiler is off until configured: "
+              << (phonebook.GetQueryProfiler().GetStats().statements == 0 ? "SUCCESS" : "FAILURE") << std::endl;
+    QueryProfilerConfig profilerConfig;
+    profilerConfig.slowThreshold = std::chrono::microseconds(0); // Every statement counts as slow
+    profilerConfig.explain = ExplainCapture::All;
+    profilerConfig.countRows = true;
+    phonebook.ConfigureQueryProfiler(profilerConfig);
+    phonebook.SearchContacts("Alice");
+    std::vector<QueryProfile> profiles = phonebook.GetQueryProfiler().RecentQueries();
+    bool searchProfiled = !profiles.empty() && profiles.back().sql.find("LIKE '%alice%'") != std::string::npos;
+    std::cout << "Search statement profiled with expanded SQL: " << (searchProfiled ? "SUCCESS" : "FAILURE") << std::endl;
+    std::cout << "Search flagged as full table scan: "
+              << (searchProfiled && profiles.back().fullScan ? "SUCCESS" : "FAILURE") << std::endl;
+    std::cout << "Returned rows counted: " << (searchProfiled && profiles.back().rows == 1 ? "SUCCESS" : "FAILURE")
+              << std::endl;
+    phonebook.ConfigureQueryProfiler(QueryProfilerConfig());
+    uint64_t profiledStatements = phonebook.GetQueryProfiler().GetStats().statements;
+    phonebook.SearchPhonetic("Alice");
+    std::cout << "Default config detaches the profiler: "
+              << (phonebook.GetQueryProfiler().GetStats().statements == profiledStatements ? "SUCCESS" : "FAILURE")
+              << std::endl;
+
+    // --- Test 8: Fuzzy name search ---
+    std::cout << "\n--- Testing fuzzy name search ---" << std::endl;
+    std::cout << "Transposition counts as one edit: "
+              << (DamerauLevenshteinDistance(U"smith", U"smtih") == 1 ? "SUCCESS" : "FAILURE") << std::endl;
+    std::vector<FuzzyContactMatch> fuzzy = phonebook.FuzzySearchContacts("Alcie Jonson");
+    std::cout << "Misspelled 'Alcie Jonson' finds Alice Johnson: "
+              << (!fuzzy.empty() && fuzzy[0].contact.GetName() == "Alice Johnson" && fuzzy[0].distance == 2
+                      ? "SUCCESS" : "FAILURE") << std::endl;
+    std::cout << "Distance limit respected: "
+              << (phonebook.FuzzySearchContacts("Xlcie Jonson", 1).empty() ? "SUCCESS" : "FAILURE") << std::endl;
+    SnapshotDelta renamed;
+    renamed.remap = {0, SnapshotDelta::kRemoved, 1};
+    renamed.added = {2};
+    FuzzyNameIndex patchedNames(FuzzyNameIndex({"anna berg", "bo lind", "carl berg"}), renamed, {"dora lindqvist"});
+    std::vector<FuzzyMatch> berg = patchedNames.Search("berk", 1, 10);
+    std::cout << "Patched fuzzy index follows renames and new words: "
+              << (berg.size() == 2 && berg[0].index == 0 && berg[1].index == 1 && patchedNames.GetNameCount() == 3 &&
+                  patchedNames.Search("lindkvist", 1, 10).size() == 1 && patchedNames.Search("lindkvist", 1, 10)[0].index == 2 &&
+                  patchedNames.Search("lind", 0, 10).empty() ? "SUCCESS" : "FAILURE") << std::endl;
+
+    // --- Test 9: Phonetic search and schema migration ---
+    std::cout << "\n--- Testing phonetic search ---" << std::endl;
+    phonebook.AddContact(Contact("John Smith", "55566677788", "john@example.com"));
+    std::cout << "'Jon Smyth' sounds like John Smith: "
+              << (phonebook.SearchPhonetic("Jon Smyth").size() == 1 ? "SUCCESS" : "FAILURE") << std::endl;
+    std::cout << "Leading word 'Jon' matches: "
+              << (phonebook.SearchPhonetic("Jon").size() == 1 ? "SUCCESS" : "FAILURE") << std::endl;
+
+    // A book written before the phonetic column existed is migrated on open.
+    std::string legacyPath = "test_phonebook_v0.db";
+    std::filesystem::remove(legacyPath);
+    sqlite3* legacy = nullptr;
+    sqlite3_open(legacyPath.c_str(), &legacy);
+    sqlite3_exec(legacy, "CREATE TABLE contacts (name TEXT, phone TEXT, email TEXT);"
+                         "INSERT INTO contacts VALUES ('Robert Miller', '49111222333', 'rm@example.com');", 0, 0, 0);
+    sqlite3_close(legacy);
+    {
+        TelephoneBookLogic migrated(legacyPath);
+        std::cout << "Legacy book backfilled ('Rupert Muller'): "
+                  << (migrated.SearchPhonetic("Rupert Muller").size() == 1 ? "SUCCESS" : "FAILURE") << std::endl;
+    }
+    std::filesystem::remove(legacyPath);
+
+    // --- Test 10: Phone prefix search ---
+    std::cout << "\n--- Testing phone prefix search ---" << std::endl;
+    std::vector<Contact> byPrefix = phonebook.SearchByPhonePrefix("+555 666");
+    std::cout << "Prefix '+555 666' finds John Smith: "
+              << (byPrefix.size() == 1 && byPrefix[0].GetPhone() == "55566677788" ? "SUCCESS" : "FAILURE")
+              << std::endl;
+    std::cout << "Count for '00555' and '9': "
+              << (phonebook.CountByPhonePrefix("00555") == 1 && phonebook.CountByPhonePrefix("9") == 0 ? "SUCCESS" : "FAILURE")
+              << std::endl;
+
+    // --- Test 11: E-mail domain index ---
+    std::cout << "\n--- Testing e-mail domain index ---" << std::endl;
+    phonebook.AddContact(Contact("Sara Lee", "66677788899", "sara@Mail.Example.com"));
+    phonebook.AddContact(Contact("Max Roe", "77788899900", "max@corp.org"));
+    std::cout << "Domain 'example.com' includes subdomains: "
+              << (phonebook.SearchByEmailDomain("example.com").size() == 3 ? "SUCCESS" : "FAILURE") << std::endl;
+    phonebook.EditContact("Max Roe", "77788899900", Contact("Max Roe", "77788899900", "max@example.com"));
+    phonebook.DeleteContact("Sara Lee", "66677788899");
+    std::vector<std::pair<std::string, size_t>> histogram = phonebook.DomainHistogram();
+    std::cout << "Histogram follows edit and delete: "
+              << (histogram.size() == 1 && histogram[0].first == "example.com" && histogram[0].second == 3
+                      ? "SUCCESS" : "FAILURE") << std::endl;
+    {
+        // Another process gives Bob Alice's number and then drops him again
+        phonebook.AddContact(Contact("Alice Corp", "77788899911", "alice@corp.com"));
+        sqlite3* other = nullptr;
+        sqlite3_open(dbPath.c_str(), &other);
+        sqlite3_exec(other, "INSERT INTO contacts (name, phone, email) VALUES ('Bob Corp', '77788899911', 'bob@corp.com');",
+                     0, 0, 0);
+        phonebook.RefreshFromDatabase();
+        bool both = phonebook.SearchByEmailDomain("corp.com").size() == 2;
+        sqlite3_exec(other, "DELETE FROM contacts WHERE name = 'Bob Corp';", 0, 0, 0);
+        sqlite3_close(other);
+        phonebook.RefreshFromDatabase();
+        std::vector<Contact> corp = phonebook.SearchByEmailDomain("corp.com");
+        std::vector<Contact> structuredCorp = phonebook.SearchStructured("email:@corp.com");
+        std::cout << "Contacts sharing a number keep their own domain entries: "
+                  << (both && corp.size() == 1 && corp[0].GetName() == "Alice Corp" && structuredCorp.size() == 1 &&
+                      phonebook.DomainHistogram().size() == 2 ? "SUCCESS" : "FAILURE") << std::endl;
+        phonebook.DeleteContact("Alice Corp", "77788899911");
+    }
+
+    // --- Test 12: Structured queries ---
+    std::cout << "\n--- Testing structured queries ---" << std::endl;
+    std::vector<Contact> structured = phonebook.SearchStructured("name:jo* -name:alice");
+    std::cout << "Prefix with exclusion 'name:jo* -name:alice': "
+              << (structured.size() == 1 && structured[0].GetName() == "John Smith" ? "SUCCESS" : "FAILURE")
+              << std::endl;
+    std::cout << "Domain and phone prefix 'email:@example.com phone:+555*': "
+              << (phonebook.SearchStructured("email:@example.com phone:+555*").size() == 1 ? "SUCCESS" : "FAILURE")
+              << std::endl;
+    std::cout << "OR with fuzzy term '(name:max OR name:smtih~1) email:@example.com': "
+              << (phonebook.SearchStructured("(name:max OR name:smtih~1) email:@example.com").size() == 2
+                      ? "SUCCESS" : "FAILURE") << std::endl;
+    phonebook.AddContact(Contact("Aaron Zora", "49777000333", "zora@example.com")); // Word index is patched
+    bool foundAdded = phonebook.SearchStructured("name:zor* phone:49777*").size() == 1;
+    phonebook.DeleteContact("Aaron Zora", "49777000333");
+    std::cout << "Structured queries follow writes: "
+              << (foundAdded && phonebook.SearchStructured("name:zor*").empty() &&
+                  phonebook.SearchStructured("name:jo* -name:alice").size() == 1 ? "SUCCESS" : "FAILURE") << std::endl;
+    phonebook.AddContact(Contact("Anna Strauß", "49777000341", "anna@example.com"));
+    phonebook.AddContact(Contact("Hans Müller", "49777000342", "hans@example.com"));
+    phonebook.AddContact(Contact("علي كريمي", "49777000343", "ali@example.com"));
+    bool foldedTerms = phonebook.SearchStructured("name:strauß").size() == 1 &&
+                       phonebook.SearchStructured("name:STRAUSS").size() == 1 &&
+                       phonebook.SearchStructured("name:MÜLLER").size() == 1 &&
+                       phonebook.SearchStructured("name:mül*").size() == 1 &&
+                       phonebook.SearchStructured("name:\"hans MÜLLER\"").size() == 1 &&
+                       phonebook.SearchStructured("name:علی").size() == 1 &&      // Persian yeh finds Arabic yeh
+                       phonebook.SearchStructured("name:\"علی کریمی\"").size() == 1 &&
+                       phonebook.SearchStructured("MÜLLER -name:strauss").size() == 1; // Any field and checks
+    phonebook.DeleteContact("Anna Strauß", "49777000341");
+    phonebook.DeleteContact("Hans Müller", "49777000342");
+    phonebook.DeleteContact("علي كريمي", "49777000343");
+    std::cout << "Structured terms fold like the name index: " << (foldedTerms ? "SUCCESS" : "FAILURE") << std::endl;
+    std::string plan = phonebook.ExplainStructured("phone:555* name:\"john smith\"");
+    std::cout << "Plan:\n" << plan;
+    std::cout << "Plan uses the phone prefix and name word indexes: "
+              << (plan.find("INDEX phone_prefix") != std::string::npos && plan.find("INDEX name_words") != std::string::npos ? "SUCCESS" : "FAILURE")
+              << std::endl;
+    std::cout << "Unknown field is rejected: "
+              << (phonebook.SearchStructured("city:berlin").empty() &&
+                  phonebook.ExplainStructured("city:berlin").find("Unknown field") != std::string::npos ? "SUCCESS" : "FAILURE")
+              << std::endl;
+
+    // --- Test 13: Search result cache ---
+    std::cout << "\n--- Testing search result cache ---" << std::endl;
+    SearchCacheStats cacheBefore = phonebook.GetSearchCacheStats();
+    size_t firstCount = phonebook.SearchContacts("Roe").size();
+    size_t repeatCount = phonebook.SearchContacts("ROE").size(); // Same normalized query
+    SearchCacheStats cacheAfter = phonebook.GetSearchCacheStats();
+    std::cout << "Repeated query served from cache: "
+              << (firstCount == 1 && repeatCount == 1 && cacheAfter.hits == cacheBefore.hits + 1 ? "SUCCESS" : "FAILURE")
+              << std::endl;
+    phonebook.AddContact(Contact("Ann Roe", "88899900011", "ann@example.com"));
+    std::cout << "Write invalidates cached results: "
+              << (phonebook.SearchContacts("roe").size() == 2 &&
+                  phonebook.GetSearchCacheStats().invalidated == cacheAfter.invalidated + 1 ? "SUCCESS" : "FAILURE")
+              << std::endl;
+    phonebook.ConfigureSearchCache(0);
+    std::cout << "Zero budget disables the cache: "
+              << (phonebook.GetSearchCacheStats().entries == 0 ? "SUCCESS" : "FAILURE") << std::endl;
+
+    // --- Test 14: Unicode collation and case folding ---
+    std::cout << "\n--- Testing Unicode collation ---" << std::endl;
+    std::cout << "Umlaut sorts with its base vowel: "
+              << (CollationKey("Muller") < CollationKey("Müller") && CollationKey("Müller") < CollationKey("Mulz")
+                  ? "SUCCESS" : "FAILURE") << std::endl;
+    std::cout << "Case only breaks ties: "
+              << (CollationKey("anna") < CollationKey("Anna") && CollationKey("Anna") < CollationKey("anne")
+                  ? "SUCCESS" : "FAILURE") << std::endl;
+    std::cout << "Case only breaks ties for accented letters: "
+              << (CollationKey("ä") < CollationKey("Ä") && CollationKey("äa") < CollationKey("Äa") &&
+                  CollationKey("Äa") < CollationKey("äb") && CollationKey("é") < CollationKey("É") &&
+                  CollationKey("ÿ") < CollationKey("Ÿ") && CollationCompare("Ölaf", "ölaf") > 0
+                  ? "SUCCESS" : "FAILURE") << std::endl;
+    std::cout << "Persian alphabet order: "
+              << (CollationKey("آرش") < CollationKey("احمد") && CollationKey("احمد") < CollationKey("پویا") &&
+                  CollationKey("پویا") < CollationKey("کامران") ? "SUCCESS" : "FAILURE") << std::endl;
+    std::cout << "Key order matches CollationCompare: "
+              << (CollationCompare("Strauss", "Strauß") < 0 && CollationCompare("Zoë", "zoe") > 0 &&
+                  CollationCompare("Bob", "bob") > 0 ? "SUCCESS" : "FAILURE") << std::endl;
+    std::cout << "Case folding beyond ASCII: "
+              << (FoldCase("MÜLLER") == "müller" && FoldCase("Strauß") == "strauss" && FoldCase("علي") == "علی"
+                  ? "SUCCESS" : "FAILURE") << std::endl;
+    {
+        // The collation and fold() as SQLite sees them
+        sqlite3* memory = nullptr;
+        sqlite3_open(":memory:", &memory);
+        bool registered = RegisterCollation(memory);
+        sqlite3_exec(memory, "CREATE TABLE t (name TEXT); INSERT INTO t VALUES ('Özil'), ('Zander'), ('oscar');",
+                     nullptr, nullptr, nullptr);
+        std::string order;
+        sqlite3_stmt* stmt = nullptr;
+        sqlite3_prepare_v2(memory, "SELECT name FROM t WHERE fold(name) LIKE '%' || fold('ÖZ') || '%' OR fold(name) = 'oscar' "
+                                   "ORDER BY name COLLATE PHONEBOOK;", -1, &stmt, nullptr);
+        while (stmt && sqlite3_step(stmt) == SQLITE_ROW) {
+            order += reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+            order += ';';
+        }
+        sqlite3_finalize(stmt);
+        sqlite3_close(memory);
+        std::cout << "SQLite COLLATE PHONEBOOK and fold(): "
+                  << (registered && order == "oscar;Özil;" ? "SUCCESS" : "FAILURE") << std::endl;
+    }
+
+    // --- Test 15: Contact validation and import issues ---
+    std::cout << "\n--- Testing contact validation ---" << std::endl;
+    std::cout << "Digit check across SIMD chunk boundaries: "
+              << (IsAsciiDigits("12345678901234567890123") && !IsAsciiDigits("1234567890123456789x123") &&
+                  !IsAsciiDigits("12345678901234/") && !IsAsciiDigits("1234567890123456:") ? "SUCCESS" : "FAILURE")
+              << std::endl;
+    std::cout << "UTF-8 validation: "
+              << (IsValidUtf8("Müller علی 0123456789abcdef") && !IsValidUtf8("Mu\xC3") && !IsValidUtf8("\xC0\xAF") &&
+                  !IsValidUtf8("\xED\xA0\x80") && !IsValidUtf8("0123456789abcdef\xFF") ? "SUCCESS" : "FAILURE")
+              << std::endl;
+    std::cout << "All problems reported at once: "
+              << (ValidateContactFields("", "12-34", "a b@c") ==
+                  (kNameEmpty | kPhoneTooShort | kPhoneNotDigits | kEmailMissingDot | kEmailHasSpace) &&
+                  ValidateContactFields("Zoë", "12345678901", "") == kContactFieldsValid &&
+                  ValidateEmail("@x.y") == kEmailMissingAt && ValidateEmail("x@.y") == kEmailMissingDot
+                  ? "SUCCESS" : "FAILURE") << std::endl;
+    {
+        std::vector<Contact> batch = {Contact("Ivy Stone", "99900011122", "ivy@example.com"),
+                                      Contact("", "123", "bad"),
+                                      Contact("Jon Stone", "99900011133", "")};
+        std::vector<ImportIssue> rejected;
+        size_t imported = phonebook.ImportContacts(batch, &rejected);
+        std::cout << "Import skips and reports invalid contacts: "
+                  << (imported == 2 && rejected.size() == 1 && rejected[0].index == 1 &&
+                      rejected[0].errors == (kNameEmpty | kPhoneTooShort | kEmailMissingAt) ? "SUCCESS" : "FAILURE")
+                  << std::endl;
+        std::cout << "AddContact refuses invalid contacts: "
+                  << (!phonebook.AddContact(Contact("Kim", "1234", "kim@example.com")) ? "SUCCESS" : "FAILURE")
+                  << std::endl;
+    }
+
+    // --- Test 16: UTF-8 core and log sink ---
+    std::cout << "\n--- Testing UTF-8 core and log sink ---" << std::endl;
+    phonebook.AddContact(Contact("Jürgen Müller", "44455566677", "juergen@example.de"));
+    phonebook.AddContact(Contact("Muller Anton", "44455566688", ""));
+    std::vector<Contact> umlaut = phonebook.SearchContacts("MÜLLER");
+    std::cout << "Non-ASCII search is case-insensitive: "
+              << (umlaut.size() == 1 && umlaut[0].GetName() == "Jürgen Müller" ? "SUCCESS" : "FAILURE") << std::endl;
+    phonebook.SortContactsByName();
+    {
+        std::vector<Contact> sorted = phonebook.GetContacts();
+        bool ordered = true;
+        for (size_t i = 1; i < sorted.size(); ++i) {
+            ordered = ordered && CollationCompare(sorted[i - 1].GetName(), sorted[i].GetName()) <= 0;
+        }
+        std::cout << "Sort follows the collation: " << (ordered ? "SUCCESS" : "FAILURE") << std::endl;
+    }
+    std::vector<std::string> captured;
+    SetLogSink([&captured](LogLevel level, const std::string& text) {
+        if (level == LogLevel::Error) {
+            captured.push_back(text);
+        }
+    });
+    phonebook.AddContact(Contact("Lea", "12", "lea@example.com"));
+    SetLogSink(nullptr);
+    std::cout << "Core errors reach the installed log sink: "
+              << (captured.size() == 1 && captured[0].find("phone has fewer than 11 digits") != std::string::npos
+                  ? "SUCCESS" : "FAILURE") << std::endl;
+
+    // --- Test 17: Exact phone lookups from the prefix index ---
+    std::cout << "\n--- Testing exact phone lookup ---" << std::endl;
+    PhonePrefixIndex exact({"+49 30 1234", "004930 1234", "4930123", "030 1234"});
+    std::vector<size_t> same = exact.FindExact("4930-1234");
+    std::cout << "FindExact matches normalized numbers only: "
+              << (same.size() == 2 && same[0] == 0 && same[1] == 1 && exact.FindExact("493012").empty()
+                  ? "SUCCESS" : "FAILURE") << std::endl;
+    std::optional<Contact> byPhone = phonebook.FindByPhone("44455566677");
+    std::cout << "FindByPhone finds the stored number: "
+              << (byPhone && byPhone->GetName() == "Jürgen Müller" && !phonebook.FindByPhone("4445556667") &&
+                  !phonebook.FindByPhone("+44455566677") ? "SUCCESS" : "FAILURE") << std::endl;
+    SnapshotDelta moves;
+    moves.remap = {0, SnapshotDelta::kRemoved, 2};
+    moves.added = {1, 3};
+    PhonePrefixIndex patched(PhonePrefixIndex({"4930 1", "4940 2", "4930 3"}), moves, {"4940 9", "4930 0"});
+    PhonePrefixIndex rebuilt({"4930 1", "4940 9", "4930 3", "4930 0"});
+    std::cout << "Patched prefix index equals a rebuilt one: "
+              << (patched.Find("") == rebuilt.Find("") && patched.Find("4930") == std::vector<size_t>{3, 0, 2}
+                  ? "SUCCESS" : "FAILURE") << std::endl;
+    phonebook.AddContact(Contact("Aaron Abel", "49777000111", "aaron@example.com")); // Shifts every position
+    bool afterAdd = phonebook.FindByPhone("49777000111") && phonebook.FindByPhone("44455566677") &&
+                    phonebook.FindByPhone("44455566677")->GetName() == "Jürgen Müller";
+    phonebook.DeleteContact("Aaron Abel", "49777000111");
+    std::cout << "FindByPhone follows adds and deletes: "
+              << (afterAdd && !phonebook.FindByPhone("49777000111") &&
+                  phonebook.FindByPhone("44455566677")->GetName() == "Jürgen Müller" ? "SUCCESS" : "FAILURE") << std::endl;
+
+    // --- Test 18: Lookup daemon over a Unix domain socket ---
+    std::cout << "\n--- Testing lookup server ---" << std::endl;
+    {
+        LookupServerConfig serverConfig;
+        serverConfig.socketPath = "test_phonebookd.sock";
+        serverConfig.workers = 2;
+        LookupServer server(phonebook, serverConfig);
+        LookupClient client;
+        bool started = server.Start() && client.Connect(serverConfig.socketPath);
+        std::cout << "Server starts and accepts a client: " << (started ? "SUCCESS" : "FAILURE") << std::endl;
+
+        // Pipelined: all four requests go out in one write, answers are matched by id
+        uint32_t hitId = client.Send(LookupOp::Lookup, "44455566677");
+        uint32_t missId = client.Send(LookupOp::Lookup, "44455566600");
+        uint32_t prefixId = client.Send(LookupOp::Prefix, "444555", 1);
+        uint32_t pingId = client.Send(LookupOp::Ping, "");
+        std::map<uint32_t, LookupResponse> answers;
+        LookupResponse response;
+        while (answers.size() < 4 && client.Receive(response)) {
+            answers[response.id] = response;
+        }
+        std::cout << "Pipelined requests are all answered: "
+                  << (answers.size() == 4 && answers[hitId].contacts.size() == 1 &&
+                      answers[hitId].contacts[0].GetName() == "Jürgen Müller" &&
+                      answers[missId].status == LookupStatus::NotFound && answers[prefixId].contacts.size() == 1 &&
+                      answers[pingId].status == LookupStatus::Ok ? "SUCCESS" : "FAILURE") << std::endl;
+        std::cout << "Round-trip lookup: "
+                  << (client.Lookup("44455566688") && !client.Lookup("1") ? "SUCCESS" : "FAILURE") << std::endl;
+        phonebook.AddContact(Contact("Nina Vogel", "49777000222", "nina@example.com"));
+        bool servedNew = client.Lookup("49777000222").has_value();
+        phonebook.DeleteContact("Nina Vogel", "49777000222");
+        std::cout << "Lookups see writes made while serving: "
+                  << (servedNew && !client.Lookup("49777000222") ? "SUCCESS" : "FAILURE") << std::endl;
+
+        client.Send(static_cast<LookupOp>(99), "");
+        bool rejected = client.Receive(response) && response.status == LookupStatus::BadRequest;
+        std::cout << "Malformed request is refused and the connection closed: "
+                  << (rejected && !client.Receive(response) && server.GetStats().badRequests == 1 ? "SUCCESS" : "FAILURE")
+                  << std::endl;
+        server.Stop();
+        std::cout << "Socket file removed on stop: "
+                  << (!std::filesystem::exists(serverConfig.socketPath) ? "SUCCESS" : "FAILURE") << std::endl;
+    }
+
+    // --- Test 19: Shared-memory phone table ---
+    std::cout << "\n--- Testing shared-memory phone table ---" << std::endl;
+    {
+        SharedPhoneTableWriter::Remove("/phonebook_test");
+        SharedPhoneTableReader reader;
+        bool published = phonebook.StartPhoneTablePublishing("/phonebook_test") && reader.Open("/phonebook_test");
+        std::string name;
+        std::cout << "Reader maps the published table: "
+                  << (published && reader.Size() == phonebook.GetSnapshot()->size() &&
+                      reader.Lookup("44455566677", name) && name == "Jürgen Müller" && !reader.Lookup("4445556667", name)
+                      ? "SUCCESS" : "FAILURE") << std::endl;
+        uint64_t before = reader.GetGeneration();
+        phonebook.AddContact(Contact("Nora Shm", "55566677700", ""));
+        std::cout << "Writes are visible without reopening: "
+                  << (reader.GetGeneration() > before && reader.Lookup("55566677700", name) && name == "Nora Shm"
+                      ? "SUCCESS" : "FAILURE") << std::endl;
+        phonebook.StopPhoneTablePublishing();
+
+        // A book that outgrows the slot moves it; the reader remaps on its next lookup
+        SharedPhoneTableWriter writer;
+        std::vector<Contact> large;
+        SyntheticBookConfig largeConfig;
+        largeConfig.count = 20000;
+        SyntheticBook largeBook(largeConfig);
+        for (uint64_t i = 0; i < largeConfig.count; ++i) {
+            SyntheticContact generated = largeBook.Generate(i);
+            large.emplace_back(generated.name, generated.phone, generated.email);
+        }
+        bool grown = writer.Open("/phonebook_test") && writer.Publish(large) && writer.Publish(large);
+        std::cout << "Growing the table keeps readers working: "
+                  << (grown && reader.Size() == large.size() && reader.Lookup(large.back().GetPhone(), name) &&
+                      name == large.back().GetName() && !reader.Lookup("44455566677", name) ? "SUCCESS" : "FAILURE")
+                  << std::endl;
+        SharedPhoneTableWriter::Remove("/phonebook_test");
+    }
+
+    // --- Test 20: Phone hash index (CDR enrichment) ---
+    std::cout << "\n--- Testing phone hash index ---" << std::endl;
+    {
+        std::vector<Contact> contacts = {Contact("First", "+49 30 1234", ""), Contact("Second", "004930 1234", ""),
+                                         Contact("Third", "0301234", ""), Contact("No Phone", "", "")};
+        PhoneHashIndex exact(contacts);
+        PhoneHashIndex normalized(contacts, true);
+        std::cout << "Exact index matches raw numbers only: "
+                  << (exact.Size() == 3 && exact.Find("004930 1234") == 1 && exact.Find("+49301234") == PhoneHashIndex::npos &&
+                      exact.Find("") == PhoneHashIndex::npos ? "SUCCESS" : "FAILURE") << std::endl;
+        std::string_view phones[] = {"+49-30-1234", "0301234", "4930", "00 49 30 1234"};
+        size_t positions[4];
+        normalized.FindMany(phones, 4, positions);
+        std::cout << "Normalized index finds the first contact per number: "
+                  << (normalized.Size() == 2 && positions[0] == 0 && positions[1] == 2 &&
+                      positions[2] == PhoneHashIndex::npos && positions[3] == 0 ? "SUCCESS" : "FAILURE") << std::endl;
+    }
+
+    // --- Test 21: Sharded book ---
+    std::cout << "\n--- Testing sharded book ---" << std::endl;
+    {
+        auto removeShards = [](const std::string& base, size_t count) {
+            for (size_t i = 0; i < count; ++i) {
+                for (const char* suffix : {"", "-wal", "-shm"}) {
+                    std::filesystem::remove(ShardPath(base, i, count) + suffix);
+                }
+            }
+        };
+        removeShards("test_sharded.db", 3);
+        removeShards("test_resharded.db", 2);
+        {
+            ShardedBook sharded("test_sharded.db", 3);
+            std::vector<Contact> batch = {Contact("Zoe Adams", "49301110000", "zoe@example.com"),
+                                          Contact("Anna Berg", "49302220000", "anna@example.com"),
+                                          Contact("Max Weber", "49303330000", "max@corp.com"),
+                                          Contact("Lena Koch", "49404440000", "lena@corp.com"),
+                                          Contact("", "49405550000", "")};
+            std::vector<ImportIssue> rejected;
+            size_t imported = sharded.ImportContacts(batch, &rejected);
+            bool spread = false;
+            for (size_t i = 0; i < sharded.GetShardCount(); ++i) {
+                spread = spread || sharded.GetShard(i).GetSnapshot()->size() < 4;
+            }
+            std::cout << "Import spreads contacts over the shards: "
+                      << (imported == 4 && rejected.size() == 1 && rejected[0].index == 4 && spread &&
+                          ShardOf("+49 30 1110000", 3) == ShardOf("0049301110000", 3) ? "SUCCESS" : "FAILURE") << std::endl;
+
+            bool duplicateRefused = !sharded.AddContact(Contact("Other Zoe", "49301110000", ""));
+            std::vector<Contact> all = sharded.GetContacts();
+            std::vector<Contact> found = sharded.SearchContacts("e");
+            std::cout << "Searches merge shards in name order: "
+                      << (duplicateRefused && all.size() == 4 && all[0].GetName() == "Anna Berg" &&
+                          all[3].GetName() == "Zoe Adams" && found.size() == 4 && found[1].GetName() == "Lena Koch" &&
+                          sharded.SearchByPhonePrefix("+49 30", 2).size() == 2 &&
+                          sharded.SearchByPhonePrefix("4930").back().GetPhone() == "49303330000" &&
+                          sharded.SearchStructured("email:@corp.com").size() == 2 ? "SUCCESS" : "FAILURE")
+                      << std::endl;
+
+            // Move Max to numbers until one lands on another shard
+            std::string newPhone;
+            for (int n = 1; newPhone.empty(); ++n) {
+                std::string candidate = "4950000000" + std::to_string(n);
+                if (ShardOf(candidate, 3) != ShardOf("49303330000", 3)) {
+                    newPhone = candidate;
+                }
+            }
+            bool moved = sharded.EditContact("Max Weber", "49303330000", Contact("Max Weber", newPhone, "max@corp.com"));
+            bool deleted = sharded.DeleteContact("Zoe Adams", "49301110000");
+            std::cout << "Edits move contacts between shards: "
+                      << (moved && deleted && sharded.Size() == 3 && !sharded.FindByPhone("49303330000") &&
+                          sharded.FindByPhone(newPhone) && !sharded.FindByPhone("49301110000") ? "SUCCESS" : "FAILURE")
+                      << std::endl;
+
+            // A taken number is refused whether it is on Anna's shard or another one
+            std::string sameShard;
+            std::string otherShard;
+            for (int n = 1; sameShard.empty() || otherShard.empty(); ++n) {
+                std::string candidate = "4960000000" + std::to_string(n);
+                std::string& slot = ShardOf(candidate, 3) == ShardOf("49302220000", 3) ? sameShard : otherShard;
+                if (slot.empty()) {
+                    slot = candidate;
+                    sharded.AddContact(Contact("Taken Number", candidate, ""));
+                }
+            }
+            bool refused = !sharded.EditContact("Anna Berg", "49302220000", Contact("Anna Berg", sameShard, "")) &&
+                           !sharded.EditContact("Anna Berg", "49302220000", Contact("Anna Berg", otherShard, ""));
+            std::cout << "Edits onto a taken number are refused on every shard: "
+                      << (refused && sharded.FindByPhone("49302220000") && sharded.Size() == 5 ? "SUCCESS" : "FAILURE")
+                      << std::endl;
+            sharded.DeleteContact("Taken Number", sameShard);
+            sharded.DeleteContact("Taken Number", otherShard);
+        }
+        bool resharded = ReshardBook("test_sharded.db", 3, "test_resharded.db", 2);
+        {
+            ShardedBook target("test_resharded.db", 2);
+            std::cout << "Resharding keeps every contact: "
+                      << (resharded && target.Size() == 3 && target.FindByPhone("49404440000") &&
+                          target.FindByPhone("49404440000")->GetName() == "Lena Koch" &&
+                          !ReshardBook("test_sharded.db", 3, "test_resharded.db", 2) ? "SUCCESS" : "FAILURE")
+                      << std::endl;
+        }
+        removeShards("test_sharded.db", 3);
+        removeShards("test_resharded.db", 2);
+    }
+
+    // --- Test 22: Change log ---
+    std::cout << "\n--- Testing change log ---" << std::endl;
+    {
+        auto [baseline, baselineSequence] = phonebook.GetSnapshotWithSequence();
+        phonebook.AddContact(Contact("Carl Change", "49123000111", "carl@example.com"));
+        phonebook.EditContact("Carl Change", "49123000111", Contact("Carl Changed", "49123000222", "carl@example.com"));
+        phonebook.DeleteContact("Carl Changed", "49123000222");
+
+        // Another connection (e.g. the sqlite3 shell) is logged as well
+        sqlite3* other = nullptr;
+        sqlite3_open(dbPath.c_str(), &other);
+        sqlite3_exec(other, "INSERT INTO contacts (name, phone, email) VALUES ('Olga Outside', '49123000333', '');", 0,
+                     0, 0);
+        sqlite3_close(other);
+
+        std::vector<ContactChange> changes;
+        bool streamed = phonebook.ChangesSince(baselineSequence, [&](const ContactChange& change) {
+            changes.push_back(change);
+            return true;
+        });
+        std::cout << "Adds, edits, deletes and foreign writes are logged in order: "
+                  << (streamed && baseline && changes.size() == 4 &&
+                      changes[0].sequence == baselineSequence + 1 && changes[3].sequence == baselineSequence + 4 &&
+                      changes[0].type == ContactChangeType::Add && changes[0].after.GetName() == "Carl Change" &&
+                      changes[1].type == ContactChangeType::Edit && changes[1].before.GetPhone() == "49123000111" &&
+                      changes[1].after.GetPhone() == "49123000222" && changes[2].type == ContactChangeType::Delete &&
+                      changes[2].before.GetName() == "Carl Changed" && changes[3].after.GetName() == "Olga Outside" &&
+                      phonebook.GetChangeSequence() == baselineSequence + 4 ? "SUCCESS" : "FAILURE") << std::endl;
+
+        size_t visited = 0;
+        bool stopped = phonebook.ChangesSince(baselineSequence, [&](const ContactChange&) { return ++visited < 2; });
+        bool limited = phonebook.ChangesSince(baselineSequence, [&](const ContactChange&) { return ++visited > 0; }, 1);
+        bool pruned = phonebook.PruneChanges(baselineSequence + 2);
+        bool behind = phonebook.ChangesSince(baselineSequence, [](const ContactChange&) { return true; });
+        size_t tail = 0;
+        bool current = phonebook.ChangesSince(baselineSequence + 2, [&](const ContactChange&) { return ++tail > 0; });
+        std::cout << "Consumers can stop early, and pruned history is reported: "
+                  << (stopped && limited && visited == 3 && pruned && !behind && current && tail == 2
+                      ? "SUCCESS" : "FAILURE") << std::endl;
+        phonebook.DeleteContact("Olga Outside", "49123000333");
+    }
+
+    // --- Test 23: Writes by other processes ---
+    std::cout << "\n--- Testing refresh after foreign writes ---" << std::endl;
+    {
+        auto foreign = [&](const char* sql) {
+            sqlite3* other = nullptr;
+            sqlite3_open(dbPath.c_str(), &other);
+            sqlite3_exec(other, sql, 0, 0, 0);
+            sqlite3_close(other);
+        };
+        bool idle = !phonebook.RefreshFromDatabase();
+        foreign("INSERT INTO contacts (name, phone, email) VALUES ('Fiona Foreign', '49123000444', 'fiona@corp.com');");
+        foreign("UPDATE contacts SET email = 'alice@corp.com' WHERE phone = '12345678901';");
+        bool staleBefore = !phonebook.FindByPhone("49123000444");
+        bool refreshed = phonebook.RefreshFromDatabase();
+        bool again = phonebook.RefreshFromDatabase();
+
+        // The patched snapshot must equal what a fresh load sees, in the same order
+        TelephoneBookLogic reloaded(dbPath);
+        TelephoneBookLogic::ContactSnapshot patched = phonebook.GetSnapshot();
+        TelephoneBookLogic::ContactSnapshot loaded = reloaded.GetSnapshot();
+        bool same = patched->size() == loaded->size();
+        for (size_t i = 0; same && i < loaded->size(); ++i) {
+            same = (*patched)[i].GetPhone() == (*loaded)[i].GetPhone() &&
+                   (*patched)[i].GetEmail() == (*loaded)[i].GetEmail();
+        }
+        std::cout << "Foreign writes are applied incrementally on refresh: "
+                  << (idle && staleBefore && refreshed && !again && same && phonebook.FindByPhone("49123000444") &&
+                      phonebook.SearchByEmailDomain("corp.com").size() == 2 ? "SUCCESS" : "FAILURE") << std::endl;
+
+        // With the watch running nobody has to call RefreshFromDatabase
+        phonebook.StartChangeWatch(std::chrono::seconds(30));
+        foreign("DELETE FROM contacts WHERE phone = '49123000444';");
+        foreign("UPDATE contacts SET email = 'alice@example.com' WHERE phone = '12345678901';");
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while ((phonebook.FindByPhone("49123000444") || !phonebook.SearchByEmailDomain("corp.com").empty()) &&
+               std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        phonebook.StopChangeWatch();
+        std::cout << "The change watch picks up foreign writes: "
+                  << (!phonebook.FindByPhone("49123000444") && phonebook.SearchByEmailDomain("corp.com").empty() &&
+                      phonebook.FindByPhone("12345678901") && phonebook.GetSnapshot()->size() == loaded->size() - 1
+                      ? "SUCCESS" : "FAILURE") << std::endl;
+    }
+
+    // --- Test 24: Replicas ---
+    std::cout << "\n--- Testing log-shipping replica ---" << std::endl;
+    {
+        std::string replicaPath = "test_replica.db";
+        auto removeReplica = [&]() {
+            for (const char* suffix : {"", "-wal", "-shm", "-journal"}) {
+                std::filesystem::remove(replicaPath + suffix);
+            }
+        };
+        auto sameContacts = [](const std::vector<Contact>& a, const std::vector<Contact>& b) {
+            bool same = a.size() == b.size();
+            for (size_t i = 0; same && i < a.size(); ++i) {
+                same = a[i].GetName() == b[i].GetName() && a[i].GetPhone() == b[i].GetPhone() &&
+                       a[i].GetEmail() == b[i].GetEmail();
+            }
+            return same;
+        };
+        auto replicaLogSize = [&]() {
+            sqlite3* replicaDb = nullptr;
+            sqlite3_stmt* stmt = nullptr;
+            sqlite3_open_v2(replicaPath.c_str(), &replicaDb, SQLITE_OPEN_READONLY, nullptr);
+            sqlite3_prepare_v2(replicaDb, "SELECT COUNT(*) FROM contact_changes;", -1, &stmt, nullptr);
+            int64_t rows = stmt && sqlite3_step(stmt) == SQLITE_ROW ? sqlite3_column_int64(stmt, 0) : -1;
+            sqlite3_finalize(stmt);
+            sqlite3_close(replicaDb);
+            return rows;
+        };
+        auto checksumsDiffer = [&](std::vector<size_t>* ranges) {
+            sqlite3* primaryDb = nullptr;
+            sqlite3* replicaDb = nullptr;
+            sqlite3_open_v2(dbPath.c_str(), &primaryDb, SQLITE_OPEN_READONLY, nullptr);
+            sqlite3_open_v2(replicaPath.c_str(), &replicaDb, SQLITE_OPEN_READONLY, nullptr);
+            BookChecksumTree primaryTree(8);
+            BookChecksumTree replicaTree(8);
+            uint64_t primarySequence = 0;
+            uint64_t replicaSequence = 0;
+            bool read = ComputeBookChecksum(primaryDb, primaryTree, &primarySequence) &&
+                        ComputeBookChecksum(replicaDb, replicaTree, &replicaSequence);
+            sqlite3_close(primaryDb);
+            sqlite3_close(replicaDb);
+            *ranges = primaryTree.DifferingRanges(replicaTree);
+            return !read || primarySequence != replicaSequence || primaryTree.Root() != replicaTree.Root();
+        };
+        removeReplica();
+        {
+            ReplicaConfig config;
+            config.batchSize = 2;
+            BookReplica replica(dbPath, replicaPath, config);
+            bool copied = replica.CatchUp() && replica.GetStats().bootstraps == 1 &&
+                          sameContacts(*replica.GetBook().GetSnapshot(), *phonebook.GetSnapshot());
+
+            phonebook.AddContact(Contact("Rita Replica", "49123000555", "rita@example.com"));
+            phonebook.EditContact("Rita Replica", "49123000555", Contact("Rita Replicated", "49123000555", "rita@example.com"));
+            phonebook.AddContact(Contact("Rolf Replica", "49123000666", "rolf@example.com"));
+            phonebook.DeleteContact("Rolf Replica", "49123000666");
+            bool followed = replica.CatchUp();
+            ReplicaStats stats = replica.GetStats();
+            std::vector<size_t> ranges;
+            std::cout << "Replica bootstraps, then applies the log in batches: "
+                      << (copied && followed && stats.bootstraps == 1 && stats.batches == 2 &&
+                          stats.changesApplied == 4 && stats.lagChanges == 0 &&
+                          stats.appliedSequence == phonebook.GetChangeSequence() &&
+                          sameContacts(*replica.GetBook().GetSnapshot(), *phonebook.GetSnapshot()) &&
+                          !checksumsDiffer(&ranges) ? "SUCCESS" : "FAILURE") << std::endl;
+            std::cout << "Replica prunes its own change log once its book applied it: "
+                      << (replicaLogSize() == 0 ? "SUCCESS" : "FAILURE") << std::endl;
+
+            // A replica changed behind its back is found by the checksums and repaired
+            // by a new copy once the log no longer matches it
+            sqlite3* other = nullptr;
+            sqlite3_open(replicaPath.c_str(), &other);
+            sqlite3_exec(other, "DELETE FROM contacts WHERE phone = '49123000555';", 0, 0, 0);
+            sqlite3_close(other);
+            BookChecksumTree ranger(8);
+            bool found = checksumsDiffer(&ranges) && ranges.size() == 1 && ranges[0] == ranger.RangeOf("49123000555");
+            phonebook.DeleteContact("Rita Replicated", "49123000555");
+            bool repaired = replica.CatchUp() && replica.GetStats().divergences == 1 &&
+                            replica.GetStats().bootstraps == 2 && !checksumsDiffer(&ranges) &&
+                            sameContacts(*replica.GetBook().GetSnapshot(), *phonebook.GetSnapshot());
+            std::cout << "Checksum trees locate divergence, which forces a new copy: "
+                      << (found && repaired ? "SUCCESS" : "FAILURE") << std::endl;
+
+            replica.Start();
+            phonebook.AddContact(Contact("Rudi Remote", "49123000777", "rudi@example.com"));
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+            while (!replica.GetBook().FindByPhone("49123000777") && std::chrono::steady_clock::now() < deadline) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+            replica.Stop();
+            std::cout << "A started replica follows the primary: "
+                      << (replica.GetBook().FindByPhone("49123000777") ? "SUCCESS" : "FAILURE") << std::endl;
+        }
+        // A restarted replica continues from its recorded position
+        phonebook.DeleteContact("Rudi Remote", "49123000777");
+        {
+            BookReplica replica(dbPath, replicaPath);
+            bool resumed = replica.CatchUp() && replica.GetStats().bootstraps == 0 &&
+                           replica.GetStats().changesApplied == 1 && !replica.GetBook().FindByPhone("49123000777");
+            std::cout << "Restarted replica resumes from its log position: " << (resumed ? "SUCCESS" : "FAILURE")
+                      << std::endl;
+        }
+        removeReplica();
+    }
+
+    // --- Test 25: Book diff and changesets ---
+    std::cout << "\n--- Testing book diff and changesets ---" << std::endl;
+    {
+        std::vector<std::string> paths = {"test_diff_a.db", "test_diff_b.db", "test_diff_c.db"};
+        for (const std::string& path : paths) {
+            std::filesystem::remove(path);
+        }
+        auto makeBook = [](const std::string& path, const char* rows) {
+            { TelephoneBookLogic created(path); }
+            sqlite3* db = nullptr;
+            sqlite3_open(path.c_str(), &db);
+            sqlite3_exec(db, rows, 0, 0, 0);
+            sqlite3_close(db);
+        };
+        makeBook(paths[0], "INSERT INTO contacts (name, phone, email) VALUES "
+                           "('Anna', '49100000001', 'anna@x.de'), ('Bernd', '49100000002', 'b@x.de'), "
+                           "('Carla', '49100000003', 'c@x.de'), ('Dora', '+49100000004', 'd@x.de');");
+        makeBook(paths[1], "INSERT INTO contacts (name, phone, email) VALUES "
+                           "('Anna', '49100000001', 'anna@x.de'), ('Bernd', '49100000002', 'bernd@x.de'), "
+                           "('Dora', '0049100000004', 'd@x.de'), ('Emil', '49100000005', 'e\tmil@x.de');");
+        std::filesystem::copy_file(paths[0], paths[2]);
+
+        std::FILE* changeset = std::tmpfile();
+        ChangesetWriter writer(changeset);
+        BookDiffStats diff;
+        bool diffed = DiffBooks(paths[0], paths[1], [&](const BookChange& change) { return writer.Write(change); },
+                                &diff);
+        std::cout << "Diff pairs numbers across spellings: "
+                  << (diffed && diff.unchanged == 1 && diff.added == 1 && diff.removed == 1 && diff.modified == 2
+                      ? "SUCCESS" : "FAILURE") << std::endl;
+
+        auto applyTo = [&](const std::string& path, ConflictPolicy policy, ApplyStats* stats) {
+            std::rewind(changeset);
+            ChangesetReader reader(changeset);
+            return ApplyChangeset(path, reader, policy, stats);
+        };
+        auto equalsTarget = [&](const std::string& path) {
+            BookDiffStats left;
+            return DiffBooks(path, paths[1], [](const BookChange&) { return true; }, &left) &&
+                   left.added + left.removed + left.modified == 0;
+        };
+        ApplyStats first;
+        ApplyStats again;
+        ApplyStats skipped;
+        bool applied = applyTo(paths[2], ConflictPolicy::Abort, &first) && first.applied == 4 && equalsTarget(paths[2]);
+        bool aborted = !applyTo(paths[2], ConflictPolicy::Abort, &again) && again.conflicts == 1 &&
+                       equalsTarget(paths[2]);
+        bool skips = applyTo(paths[2], ConflictPolicy::Skip, &skipped) && skipped.conflicts == 4 &&
+                     skipped.applied == 0 && equalsTarget(paths[2]);
+        std::cout << "Changesets apply atomically with conflict policies: "
+                  << (applied && aborted && skips ? "SUCCESS" : "FAILURE") << std::endl;
+        std::fclose(changeset);
+
+        // Contacts in a changeset obey the same rules as AddContact, under every policy
+        changeset = std::tmpfile();
+        std::fputs("# phonebook changeset 1\n+\tFine\t49100000006\t\n+\tBad Guy\tnot-a-phone\tno email\n", changeset);
+        ApplyStats invalid;
+        bool rejected = !applyTo(paths[2], ConflictPolicy::Overwrite, &invalid) && invalid.applied == 0 &&
+                        equalsTarget(paths[2]);
+        std::cout << "Changesets with invalid contacts are rejected: " << (rejected ? "SUCCESS" : "FAILURE")
+                  << std::endl;
+        std::fclose(changeset);
+        for (const std::string& path : paths) {
+            std::filesystem::remove(path);
+        }
+    }
+
     return 0;
 }